@@ -0,0 +1,162 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Benchmark Hardware Counters
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Reads Linux perf_event counters around a benchmark stage
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Each counter is opened on its own rather than as a group, so a
+//           counter the CPU or VM does not have (often the cache events) only
+//           drops that column. Counting is user space only, which works with
+//           the default kernel.perf_event_paranoid of 2.
+//           Containers and VMs commonly block perf_event_open() entirely, so
+//           gbp_perf_open() failing is normal and the benchmark carries on with
+//           wall clock timings only.
+#ifndef GBP_PERF_H
+#define GBP_PERF_H
+#include <stdint.h>   // uint64_t
+#include <stdbool.h>  // bool
+#include <string.h>   // strerror
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+typedef enum
+{
+  GBP_PERF_CYCLES,
+  GBP_PERF_INSTRUCTIONS,
+  GBP_PERF_BRANCH_MISSES,
+  GBP_PERF_L1D_MISSES,
+  GBP_PERF_LLC_MISSES,
+  GBP_PERF_COUNTERS
+} gbp_perf_counter_t;
+
+typedef struct
+{
+  int fd[GBP_PERF_COUNTERS];        ///< -1 if the counter is unavailable
+  uint64_t value[GBP_PERF_COUNTERS]; ///< Last gbp_perf_stop(), scaled if the kernel multiplexed the counter
+  const char *error;                 ///< Why the first unavailable counter could not be opened
+} gbp_perf_t;
+
+static const char *const gbp_perf_names[GBP_PERF_COUNTERS] = {"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"};
+
+static inline bool gbp_perf_has(const gbp_perf_t *p, gbp_perf_counter_t c) { return p->fd[c] >= 0; }
+
+#ifdef __linux__
+typedef struct
+{
+  uint64_t value;
+  uint64_t timeEnabled;
+  uint64_t timeRunning;
+} gbp_perf_read_t;
+
+static int gbp_perf_openCounter(uint32_t type, uint64_t config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = type;
+  attr.config         = config;
+  attr.disabled       = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // This thread, any CPU
+}
+
+// True if at least one counter is available
+static inline bool gbp_perf_open(gbp_perf_t *p)
+{
+  const uint64_t cacheReadMiss = ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) | ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  const uint32_t type[GBP_PERF_COUNTERS]   = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+  const uint64_t config[GBP_PERF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                              PERF_COUNT_HW_CACHE_L1D | cacheReadMiss, PERF_COUNT_HW_CACHE_LL | cacheReadMiss};
+  bool any = false;
+  p->error = NULL;
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    p->value[c] = 0;
+    p->fd[c]    = gbp_perf_openCounter(type[c], config[c]);
+    if ((p->fd[c] < 0) && (p->error == NULL))
+      p->error = strerror(errno);
+    any = any || (p->fd[c] >= 0);
+  }
+  return any;
+}
+
+static inline void gbp_perf_start(gbp_perf_t *p)
+{
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    if (p->fd[c] < 0)
+      continue;
+    ioctl(p->fd[c], PERF_EVENT_IOC_RESET, 0);
+    ioctl(p->fd[c], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+static inline void gbp_perf_stop(gbp_perf_t *p)
+{
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    if (p->fd[c] >= 0)
+      ioctl(p->fd[c], PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    gbp_perf_read_t r;
+    p->value[c] = 0;
+    if ((p->fd[c] < 0) || (read(p->fd[c], &r, sizeof(r)) != (ssize_t)sizeof(r)) || (r.timeRunning == 0))
+      continue;
+    // More counters than the PMU has are time shared, so scale up to the whole run
+    p->value[c] = (r.timeRunning < r.timeEnabled) ? (uint64_t)((double)r.value * r.timeEnabled / r.timeRunning) : r.value;
+  }
+}
+
+static inline void gbp_perf_close(gbp_perf_t *p)
+{
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    if (p->fd[c] >= 0)
+      close(p->fd[c]);
+    p->fd[c] = -1;
+  }
+}
+#else
+static inline bool gbp_perf_open(gbp_perf_t *p)
+{
+  for (int c = 0; c < GBP_PERF_COUNTERS; c++)
+  {
+    p->fd[c]    = -1;
+    p->value[c] = 0;
+  }
+  p->error = "perf_event is Linux only";
+  return false;
+}
+static inline void gbp_perf_start(gbp_perf_t *p) { (void)p; }
+static inline void gbp_perf_stop(gbp_perf_t *p) { (void)p; }
+static inline void gbp_perf_close(gbp_perf_t *p) { (void)p; }
+#endif
+
+#endif
@@ -0,0 +1,440 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Tile Layout Benchmark
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V2 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Times the decode stages and compares gbp_tile_t (row-major) against gbp_tilemajor_t (tile-major)
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+  Usage: gbp_tiles_bench [--perf] CAPTURE...
+
+  Each capture is decoded to tiles and print instructions once, then both layouts
+  replay them the same way gpbdecoder does: tiles in, then at each print the palette
+  is applied and every line is read out as packed rows.
+  Fails if the layouts produce different rows.
+
+  Stages, each repeated for at least BENCH_MIN_NS:
+    hex        : hex text to packets, decompressed to tiles (per packet byte, per text byte)
+    row-major  : gbp_tiles_line_decoder() and gbp_tiles_print() (per tile, per tile byte)
+    tile-major : gbp_tilemajor_add() and gbp_tilemajor_toRows() (per tile, per tile byte)
+    strip      : gbp_tiles_strip_addTile() to a sink that holds raw lines until the print,
+                 as gpbdecoder --strips (per tile, per tile byte)
+    bmp        : gbp_bmp_add() of each line of rows, written to /dev/null (per line, per row byte)
+
+  --perf also reads hardware counters around each stage (see gbp_perf.h) and
+  reports them per op and per byte. Without counter access (e.g. in a container)
+  it says so and only the timings are reported.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+#include "gbp_bmp.h"
+#include "gbp_perf.h"
+
+#define BENCH_MIN_NS (500 * 1000 * 1000L) // Repeat each layout for at least this long
+
+typedef struct
+{
+  bool isPrint;
+  uint8_t pallet;
+  uint8_t tile[GBP_TILE_SIZE_IN_BYTE];
+} bench_op_t;
+
+typedef struct
+{
+  char *text;  ///< Capture file as read
+  size_t textSize;
+  size_t pktBytes;  ///< Packet bytes in the text
+  bench_op_t *ops;
+  size_t opCount;
+  size_t opMax;
+  size_t tileCount;
+  uint8_t *rows;  ///< Row-major output of every print
+  size_t rowsSize;
+  uint32_t checksum;
+} bench_capture_t;
+
+typedef struct
+{
+  const char *name;
+  const char *unit;  ///< What an op is
+  void (*run)(bench_capture_t *c);
+  size_t ops;    ///< Per run
+  size_t bytes;  ///< Per run, input to the stage
+} bench_stage_t;
+
+static gbp_tile_t rowMajor;
+static gbp_tilemajor_t tileMajor;
+static gbp_tiles_strip_t strip;
+static gbp_bmp_t bmp;
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static long nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Capture text to tile and print operations. Returns number of operations
+static size_t parseCapture(bench_capture_t *c)
+{
+  gbp_pkt_t pkt = {};
+  gbp_pkt_tileAcc_t tileBuff = {};
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE] = {0};
+  uint8_t pktbuffSize = 0;
+  size_t opCount = 0;
+  gbp_pkt_init(&pkt);
+  c->pktBytes = 0;
+
+  bool skipLine = false;
+  int nibCount = 0;
+  uint8_t byte = 0;
+  for (size_t t = 0; t < c->textSize; t++)
+  {
+    const char ch = c->text[t];
+    // Hex, skipping `//` comments (See gbp_hexstream.h)
+    if ((ch == '/') || skipLine)
+    {
+      skipLine = (ch != '\n');
+      continue;
+    }
+    int nib = -1;
+    if (('0' <= ch) && (ch <= '9'))
+      nib = ch - '0';
+    else if (('a' <= ch) && (ch <= 'f'))
+      nib = ch - 'a' + 10;
+    else if (('A' <= ch) && (ch <= 'F'))
+      nib = ch - 'A' + 10;
+    if (nib == -1)
+    {
+      nibCount = 0;
+      continue;
+    }
+    byte = (uint8_t)((byte << 4) | nib);
+    if (++nibCount < 2)
+      continue;
+    nibCount = 0;
+    c->pktBytes++;
+
+    if (!gbp_pkt_processByte(&pkt, byte, pktbuff, &pktbuffSize, sizeof(pktbuff)))
+      continue;
+    if (opCount + GBP_TILE_SIZE_IN_BYTE >= c->opMax)
+    {
+      c->opMax *= 2;
+      c->ops = (bench_op_t *)realloc(c->ops, c->opMax * sizeof(bench_op_t));
+    }
+    if (pkt.received == GBP_REC_GOT_PACKET)
+    {
+      if (pkt.command == GBP_COMMAND_PRINT)
+      {
+        c->ops[opCount].isPrint = true;
+        c->ops[opCount].pallet  = pktbuff[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE];
+        opCount++;
+      }
+      continue;
+    }
+    const uint8_t *tile;
+    while ((tile = gbp_pkt_tileNext(&pkt, pktbuff, pktbuffSize, &tileBuff)) != NULL)
+    {
+      c->ops[opCount].isPrint = false;
+      memcpy(c->ops[opCount].tile, tile, GBP_TILE_SIZE_IN_BYTE);
+      opCount++;
+    }
+  }
+  return opCount;
+}
+
+static bool loadCapture(const char *path, bench_capture_t *c)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  fseek(f, 0, SEEK_END);
+  c->textSize = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  c->text = (char *)malloc(c->textSize ? c->textSize : 1);
+  c->textSize = fread(c->text, 1, c->textSize, f);
+  fclose(f);
+
+  c->opMax = 1024;
+  c->ops = (bench_op_t *)malloc(c->opMax * sizeof(bench_op_t));
+  c->opCount = parseCapture(c);
+  c->tileCount = 0;
+  for (size_t n = 0; n < c->opCount; n++)
+    c->tileCount += c->ops[n].isPrint ? 0 : 1;
+  return true;
+}
+
+/*******************************************************************************
+ * Layouts
+*******************************************************************************/
+
+// Returns bytes of rows read out. Copies them to out if set
+static size_t runRowMajor(const bench_op_t *ops, size_t opCount, uint8_t *out, uint32_t *checksum)
+{
+  size_t outSize = 0;
+  gbp_tiles_reset(&rowMajor);
+  for (size_t n = 0; n < opCount; n++)
+  {
+    if (!ops[n].isPrint)
+    {
+      gbp_tiles_line_decoder(&rowMajor, ops[n].tile);
+      continue;
+    }
+    gbp_tiles_print(&rowMajor, 1, 0x03, ops[n].pallet, 0x40);
+    const size_t size = (size_t)rowMajor.tileRowOffset * GBP_TILE_PIXEL_HEIGHT * GBP_TILEMAJOR_LINE_ROWSIZE_B;
+    const uint8_t *rows = &rowMajor.bmpLineBuffer[0][0];
+    for (size_t i = 0; i < size; i++)
+      *checksum = (*checksum * 31) + rows[i];
+    if (out)
+      memcpy(&out[outSize], rows, size);
+    outSize += size;
+    gbp_tiles_reset(&rowMajor);
+  }
+  return outSize;
+}
+
+static size_t runTileMajor(const bench_op_t *ops, size_t opCount, uint8_t *out, uint32_t *checksum)
+{
+  size_t outSize = 0;
+  uint8_t lineBuff[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B];
+  gbp_tilemajor_reset(&tileMajor);
+  for (size_t n = 0; n < opCount; n++)
+  {
+    if (!ops[n].isPrint)
+    {
+      gbp_tilemajor_add(&tileMajor, ops[n].tile);
+      continue;
+    }
+    gbp_tilemajor_print(&tileMajor, ops[n].pallet);
+    for (uint16_t line = 0; line < gbp_tilemajor_lines(&tileMajor); line++)
+    {
+      gbp_tilemajor_toRows(&tileMajor, line, lineBuff);
+      const uint8_t *rows = &lineBuff[0][0];
+      for (size_t i = 0; i < sizeof(lineBuff); i++)
+        *checksum = (*checksum * 31) + rows[i];
+      if (out)
+        memcpy(&out[outSize], rows, sizeof(lineBuff));
+      outSize += sizeof(lineBuff);
+    }
+    gbp_tilemajor_reset(&tileMajor);
+  }
+  return outSize;
+}
+
+typedef struct
+{
+  uint16_t lineCount;
+  uint8_t lines[GBP_TILES_PER_ROW][GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B];  ///< Raw lines since the last print
+} bench_strip_sink_t;
+
+static bench_strip_sink_t stripHeld;
+
+static void stripSink(void *ctx, const uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B])
+{
+  bench_strip_sink_t *sink = (bench_strip_sink_t *)ctx;
+  memcpy(sink->lines[sink->lineCount++], rows, sizeof(sink->lines[0])); // Strip guard keeps it in bounds
+}
+
+static size_t runStrip(const bench_op_t *ops, size_t opCount, uint8_t *out, uint32_t *checksum)
+{
+  size_t outSize = 0;
+  stripHeld.lineCount = 0;
+  gbp_tiles_strip_init(&strip, stripSink, &stripHeld);
+  for (size_t n = 0; n < opCount; n++)
+  {
+    if (!ops[n].isPrint)
+    {
+      gbp_tiles_strip_addTile(&strip, ops[n].tile);
+      continue;
+    }
+    gbp_tiles_strip_print(&strip);
+    gbp_tiles_strip_harmonise(stripHeld.lines, stripHeld.lineCount, ops[n].pallet);
+    const uint8_t *rows = &stripHeld.lines[0][0][0];
+    const size_t size = stripHeld.lineCount * sizeof(stripHeld.lines[0]);
+    for (size_t i = 0; i < size; i++)
+      *checksum = (*checksum * 31) + rows[i];
+    if (out)
+      memcpy(&out[outSize], rows, size);
+    outSize += size;
+    stripHeld.lineCount = 0;
+  }
+  return outSize;
+}
+
+/*******************************************************************************
+ * Stages
+*******************************************************************************/
+
+static void stageHex(bench_capture_t *c)
+{
+  c->checksum = (c->checksum * 31) + (uint32_t)parseCapture(c);
+}
+
+static void stageRowMajor(bench_capture_t *c)
+{
+  runRowMajor(c->ops, c->opCount, NULL, &c->checksum);
+}
+
+static void stageTileMajor(bench_capture_t *c)
+{
+  runTileMajor(c->ops, c->opCount, NULL, &c->checksum);
+}
+
+static void stageStrip(bench_capture_t *c)
+{
+  runStrip(c->ops, c->opCount, NULL, &c->checksum);
+}
+
+static void stageBmp(bench_capture_t *c)
+{
+  static const uint32_t palletColor[4] = {0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000};
+  const size_t lineSize = GBP_TILE_PIXEL_HEIGHT * GBP_TILEMAJOR_LINE_ROWSIZE_B;
+  for (size_t offset = 0; (offset + lineSize) <= c->rowsSize; offset += lineSize)
+    gbp_bmp_add(&bmp, &c->rows[offset], GBP_BMP_WIDTH, GBP_TILE_PIXEL_HEIGHT, palletColor);
+}
+
+// Per op and per byte, or "-" if the counter is unavailable
+static void printCounter(const gbp_perf_t *perf, gbp_perf_counter_t counter, double runs, const bench_stage_t *stage)
+{
+  if (!gbp_perf_has(perf, counter))
+  {
+    printf(" | %s -", gbp_perf_names[counter]);
+    return;
+  }
+  const double total = (double)perf->value[counter] / runs;
+  printf(" | %s %.2f/%s %.3f/B", gbp_perf_names[counter], total / (stage->ops ? stage->ops : 1), stage->unit, total / (stage->bytes ? stage->bytes : 1));
+}
+
+// Returns ns per op
+static double benchStage(const bench_stage_t *stage, bench_capture_t *c, gbp_perf_t *perf)
+{
+  long iterations = 0;
+  if (perf)
+    gbp_perf_start(perf);
+  const long start = nowNs();
+  long elapsed = 0;
+  while (elapsed < BENCH_MIN_NS)
+  {
+    stage->run(c);
+    iterations++;
+    elapsed = nowNs() - start;
+  }
+  if (perf)
+    gbp_perf_stop(perf);
+
+  const double nsPerOp = (double)elapsed / (double)(iterations * (stage->ops ? stage->ops : 1));
+  const double nsPerByte = (double)elapsed / (double)(iterations * (stage->bytes ? stage->bytes : 1));
+  printf("  %-10s : %7.1f ns/%s %7.2f ns/B\n", stage->name, nsPerOp, stage->unit, nsPerByte);
+  if (perf)
+  {
+    printf("  %-10s  ", "");
+    for (int counter = 0; counter < GBP_PERF_COUNTERS; counter++)
+      printCounter(perf, (gbp_perf_counter_t)counter, (double)iterations, stage);
+    if (gbp_perf_has(perf, GBP_PERF_CYCLES) && gbp_perf_has(perf, GBP_PERF_INSTRUCTIONS) && (perf->value[GBP_PERF_CYCLES] > 0))
+      printf(" | IPC %.2f", (double)perf->value[GBP_PERF_INSTRUCTIONS] / (double)perf->value[GBP_PERF_CYCLES]);
+    printf("\n");
+  }
+  return nsPerOp;
+}
+
+/*******************************************************************************
+ * Main Benchmark Routine
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+  int failures = 0;
+  gbp_perf_t perfCounters;
+  gbp_perf_t *perf = NULL;
+  int a = 1;
+  if ((a < argc) && (strcmp(argv[a], "--perf") == 0))
+  {
+    a++;
+    if (gbp_perf_open(&perfCounters))
+      perf = &perfCounters;
+    if (perfCounters.error)
+      printf("perf counters: %s, %s\n", perf ? "some unavailable" : "unavailable, timings only", perfCounters.error);
+  }
+
+  bmp.f = fopen("/dev/null", "wb");
+  bmp.bmpSizeWidth = GBP_BMP_WIDTH;
+
+  for (; a < argc; a++)
+  {
+    bench_capture_t c;
+    memset(&c, 0, sizeof(c));
+    if (!loadCapture(argv[a], &c))
+    {
+      printf("%s: could not be read\n", argv[a]);
+      failures++;
+      continue;
+    }
+
+    // Same rows from both layouts
+    const size_t outMax = (c.opCount + 1) * sizeof(rowMajor.bmpLineBuffer);
+    uint8_t *outRow  = (uint8_t *)malloc(outMax);
+    uint8_t *outTile = (uint8_t *)malloc(outMax);
+    const size_t outRowSize  = runRowMajor(c.ops, c.opCount, outRow, &c.checksum);
+    const size_t outTileSize = runTileMajor(c.ops, c.opCount, outTile, &c.checksum);
+    const bool same = (outRowSize == outTileSize) && (memcmp(outRow, outTile, outRowSize) == 0);
+    const size_t outStripSize = runStrip(c.ops, c.opCount, outTile, &c.checksum);
+    const bool sameStrip = (outRowSize == outStripSize) && (memcmp(outRow, outTile, outRowSize) == 0);
+    failures += (same && sameStrip) ? 0 : 1;
+    c.rows = outRow;
+    c.rowsSize = outRowSize;
+
+    const size_t lines = outRowSize / (GBP_TILE_PIXEL_HEIGHT * GBP_TILEMAJOR_LINE_ROWSIZE_B);
+    const bench_stage_t stages[] = {
+      {"hex", "pktbyte", stageHex, c.pktBytes, c.textSize},
+      {"row-major", "tile", stageRowMajor, c.tileCount, c.tileCount * GBP_TILE_SIZE_IN_BYTE},
+      {"tile-major", "tile", stageTileMajor, c.tileCount, c.tileCount * GBP_TILE_SIZE_IN_BYTE},
+      {"strip", "tile", stageStrip, c.tileCount, c.tileCount * GBP_TILE_SIZE_IN_BYTE},
+      {"bmp", "line", stageBmp, lines, outRowSize},
+    };
+    printf("%s: %lu tiles, %lu row bytes, %s, strip rows %s\n", argv[a], (unsigned long)c.tileCount, (unsigned long)outRowSize,
+           same ? "rows match" : "ROWS DIFFER", sameStrip ? "match" : "DIFFER");
+    double nsPerOp[sizeof(stages) / sizeof(stages[0])];
+    for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++)
+      nsPerOp[s] = benchStage(&stages[s], &c, perf);
+    printf("  tile-major is %.2fx, strip is %.2fx row-major [checksum %08X]\n", nsPerOp[1] / nsPerOp[2], nsPerOp[1] / nsPerOp[3], c.checksum);
+
+    free(outRow);
+    free(outTile);
+    free(c.ops);
+    free(c.text);
+  }
+
+  if (bmp.f)
+    fclose(bmp.f);
+  if (perf)
+    gbp_perf_close(perf);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+// Fuzz target: gbp_pkt_decompressor() fed payload chunks of any size, as gbpdecoder_gotByte() does
+//              gbp_pkt_tileNext() on the same chunks must give the same tiles
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_fuzz.h"
+
+// Longest output of one input byte is a compressed run: 2 bytes in, 129 bytes out
+#define FUZZ_MAX_RUN_LENGTH (0xFF - 128 + 2)
+#define FUZZ_CHUNK_TILES_MAX (((0x7F + 2) * FUZZ_MAX_RUN_LENGTH) / GBP_TILE_SIZE_IN_BYTE + 2)
+
+static uint8_t chunkTiles[FUZZ_CHUNK_TILES_MAX + 1][GBP_TILE_SIZE_IN_BYTE];
+
+static void fuzzOne(const uint8_t *data, size_t size)
+{
+  if (size < 1)
+    return;
+
+  // First byte: bit 7 compression, bits 0-6 chunk size (payload buffer is streamed in chunks)
+  const bool compression     = (data[0] & 0x80) != 0;
+  const size_t chunkMax      = (data[0] & 0x7F) + 1;
+  gbp_pkt_t pkt              = {GBP_REC_NONE, 0};
+  gbp_pkt_tileAcc_t tileBuff = {0};
+  gbp_pkt_init(&pkt);
+  pkt.compression = compression;
+  gbp_pkt_t pktNext              = pkt;
+  gbp_pkt_tileAcc_t tileBuffNext = {0};
+
+  for (size_t offset = 1; offset < size; offset += chunkMax)
+  {
+    const size_t chunkSize = (size - offset < chunkMax) ? (size - offset) : chunkMax;
+
+    // Each call must consume input or emit a tile, so the tile count is bounded by the input
+    const size_t tilesMax = ((chunkSize + 1) * FUZZ_MAX_RUN_LENGTH) / GBP_TILE_SIZE_IN_BYTE + 2;
+    size_t tiles          = 0;
+    while (gbp_pkt_decompressor(&pkt, &data[offset], chunkSize, &tileBuff))
+    {
+      if (tileBuff.count > GBP_TILE_SIZE_IN_BYTE)
+        abort();
+      if (gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
+        memcpy(chunkTiles[tiles++], tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+      if (tiles > tilesMax)
+      {
+        fprintf(stderr, "==gbp_fuzz== decompressor spin: %lu tiles from %lu bytes\n", (unsigned long)tiles, (unsigned long)chunkSize);
+        abort();
+      }
+    }
+
+    size_t tilesNext = 0;
+    const uint8_t *tile;
+    while ((tile = gbp_pkt_tileNext(&pktNext, &data[offset], chunkSize, &tileBuffNext)) != NULL)
+    {
+      if ((tilesNext >= tiles) || (memcmp(tile, chunkTiles[tilesNext], GBP_TILE_SIZE_IN_BYTE) != 0))
+      {
+        fprintf(stderr, "==gbp_fuzz== tileNext differs at tile %lu of %lu\n", (unsigned long)tilesNext, (unsigned long)tiles);
+        abort();
+      }
+      tilesNext++;
+    }
+    if (tilesNext != tiles)
+    {
+      fprintf(stderr, "==gbp_fuzz== tileNext gave %lu tiles, expected %lu\n", (unsigned long)tilesNext, (unsigned long)tiles);
+      abort();
+    }
+  }
+}
+
+GBP_FUZZ_TARGET(fuzzOne)
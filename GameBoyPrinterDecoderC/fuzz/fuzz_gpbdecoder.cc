@@ -0,0 +1,56 @@
+// Fuzz target: the whole gpbdecoder path, hex text in and bmp files out
+// Output goes to $GBP_FUZZ_OUTPUT (default /tmp/gbp_fuzz_out), one file per cut per input
+#include <stdio.h>
+#include <string.h>
+
+#define GPBDECODER_NO_MAIN
+#include "../gpbdecoder.cc"
+#include "gbp_fuzz.h"
+
+static void fuzzOne(const uint8_t *data, size_t size)
+{
+  // Fresh decoder state, as if gpbdecoder was started on this input
+  pktCounter = 0;
+  memset(&pktTrack, 0, sizeof(pktTrack));
+  memset(&logTotals, 0, sizeof(logTotals));
+  logPrintLines = 0;
+  stripHeld.lineCount = 0;
+  memset(&gbp_pktBuff, 0, sizeof(gbp_pktBuff));
+  memset(&tileBuff, 0, sizeof(tileBuff));
+  memset(&gbp_tiles, 0, sizeof(gbp_tiles));
+  memset(&gbp_tilemajor, 0, sizeof(gbp_tilemajor));
+  memset(&gbp_phash, 0, sizeof(gbp_phash));
+  tilemajor_flag = (size & 1) != 0; // All tile layouts
+  strips_flag    = !tilemajor_flag && ((size & 2) != 0);
+  gbp_tiles_strip_init(&gbp_strip, gbpdecoder_stripSink, NULL);
+  if (gbp_bmp_isopen(&gbp_bmp))
+    fclose(gbp_bmp.f);
+  memset(&gbp_bmp, 0, sizeof(gbp_bmp));
+  gbp_pkt_init(&gbp_pktBuff);
+
+  if (ofilenameBuf[0] == '\0')
+  {
+    const char *output = getenv("GBP_FUZZ_OUTPUT");
+    snprintf(ofilenameBuf, sizeof(ofilenameBuf), "%s", output ? output : "/tmp/gbp_fuzz_out");
+    palletColor[0] = 0xFFFFFF;
+    palletColor[1] = 0xAAAAAA;
+    palletColor[2] = 0x555555;
+    palletColor[3] = 0x000000;
+  }
+
+  if (size == 0)
+    return;
+  FILE *f = fmemopen((void *)data, size, "rb");
+  if (!f)
+    return;
+  if (gbp_input_open(&gbp_input, f))
+    gbpdecoder_parseHexStream(&gbp_input);
+  gbp_input_close(&gbp_input);
+  fclose(f);
+
+  // Input ended mid print, finish the file like a cut would
+  if (gbp_bmp_isopen(&gbp_bmp))
+    gbp_bmp_render(&gbp_bmp);
+}
+
+GBP_FUZZ_TARGET(fuzzOne)
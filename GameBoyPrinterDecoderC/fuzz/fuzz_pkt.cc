@@ -0,0 +1,33 @@
+// Fuzz target: gbp_pkt_processByte() with every payload buffer size the callers could use
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_fuzz.h"
+
+static void fuzzOne(const uint8_t *data, size_t size)
+{
+  if (size < 1)
+    return;
+
+  // First byte picks the buffer size (processByte rejects anything under 4)
+  const size_t bufferMax = data[0];
+  uint8_t buffer[256];
+  uint8_t bufferSize = 0;
+  gbp_pkt_t pkt      = {GBP_REC_NONE, 0};
+  gbp_pkt_init(&pkt);
+
+  for (size_t i = 1; i < size; i++)
+  {
+    const bool received = gbp_pkt_processByte(&pkt, data[i], buffer, &bufferSize, bufferMax);
+    if (received && (pkt.received == GBP_REC_NONE))
+      abort();
+    if ((bufferMax >= 4) && (bufferSize > bufferMax))
+      abort();
+  }
+}
+
+GBP_FUZZ_TARGET(fuzzOne)
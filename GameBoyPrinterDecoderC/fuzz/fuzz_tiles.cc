@@ -0,0 +1,50 @@
+// Fuzz target: gbp_tiles_line_decoder() and gbp_tiles_print() in any order and count
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_tiles.h"
+#include "gbp_fuzz.h"
+
+#define FUZZ_OP_PRINT 0xA5  // Then palette byte
+#define FUZZ_OP_RESET 0x5A  // Rare in captures, so long runs of tiles are common
+
+static gbp_tile_t gbp_tiles;
+
+static void fuzzOne(const uint8_t *data, size_t size)
+{
+  memset(&gbp_tiles, 0, sizeof(gbp_tiles));
+  gbp_tiles_reset(&gbp_tiles);
+
+  // Opcode byte, then its operands. Any other opcode is a tile (16 bytes)
+  size_t i = 0;
+  while (i < size)
+  {
+    const uint8_t op = data[i++];
+    if (op == FUZZ_OP_PRINT)
+    {
+      if (size - i < 1)
+        break;
+      gbp_tiles_print(&gbp_tiles, 1, 0x03, data[i++], 0x40);
+    }
+    else if (op == FUZZ_OP_RESET)
+    {
+      gbp_tiles_reset(&gbp_tiles);
+    }
+    else
+    {
+      if (size - i < GBP_TILE_SIZE_IN_BYTE)
+        break;
+      gbp_tiles_line_decoder(&gbp_tiles, &data[i]);
+      i += GBP_TILE_SIZE_IN_BYTE;
+    }
+
+    if ((gbp_tiles.tileRowOffset > GBP_TILES_PER_ROW) || (gbp_tiles.tileLineOffset >= GBP_TILES_PER_LINE))
+      abort();
+  }
+}
+
+GBP_FUZZ_TARGET(fuzzOne)
@@ -0,0 +1,89 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Fuzz Targets
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V2 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Shared entry point and slow input detection for the fuzz targets
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+  Each target file defines `static void fuzzOne(const uint8_t *data, size_t size)`
+  and then `GBP_FUZZ_TARGET(fuzzOne)`, which provides LLVMFuzzerTestOneInput().
+
+  That entry point is linked either against libFuzzer (clang, -fsanitize=fuzzer)
+  or against gbp_fuzz_driver.cc, a small random mutator for when only gcc is around.
+
+  Both ways, an input is reported (abort()) if decoding it costs more CPU time than
+    GBP_FUZZ_BASE_NS + size * GBP_FUZZ_MAX_NS_PER_BYTE
+  Override the per byte cost with the GBP_FUZZ_MAX_NS_PER_BYTE environment variable (or -D when building).
+  Hangs are caught by libFuzzer's -timeout or the driver's alarm() watchdog.
+*/
+#ifndef GBP_FUZZ_H
+#define GBP_FUZZ_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef GBP_FUZZ_BASE_NS
+#define GBP_FUZZ_BASE_NS         (20 * 1000 * 1000L)  // Fixed allowance per input (file open, first touch of buffers)
+#endif
+#ifndef GBP_FUZZ_MAX_NS_PER_BYTE
+#define GBP_FUZZ_MAX_NS_PER_BYTE (20 * 1000L)         // Default. Compressed runs expand ~64x, so keep headroom
+#endif
+
+static inline long gbp_fuzz_cpuNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static inline long gbp_fuzz_maxNsPerByte(void)
+{
+  static long maxNsPerByte = 0;
+  if (maxNsPerByte == 0)
+  {
+    const char *env = getenv("GBP_FUZZ_MAX_NS_PER_BYTE");
+    maxNsPerByte    = (env && (atol(env) > 0)) ? atol(env) : GBP_FUZZ_MAX_NS_PER_BYTE;
+  }
+  return maxNsPerByte;
+}
+
+// Slow inputs are reported the same way as a crash so both drivers keep the input
+static inline void gbp_fuzz_checkCost(size_t size, long ns)
+{
+  const long limit = GBP_FUZZ_BASE_NS + (long)size * gbp_fuzz_maxNsPerByte();
+  if (ns <= limit)
+    return;
+  fprintf(stderr, "==gbp_fuzz== SLOW INPUT: %lu bytes took %ld ns (limit %ld ns, %ld ns/byte)\n",
+          (unsigned long)size, ns, limit, ns / (long)(size ? size : 1));
+  abort();
+}
+
+#define GBP_FUZZ_TARGET(FUNC)                                                  \
+  extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)      \
+  {                                                                            \
+    const long start = gbp_fuzz_cpuNs();                                       \
+    FUNC(data, size);                                                          \
+    gbp_fuzz_checkCost(size, gbp_fuzz_cpuNs() - start);                        \
+    return 0;                                                                  \
+  }
+
+#endif
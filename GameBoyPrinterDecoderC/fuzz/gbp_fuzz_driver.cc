@@ -0,0 +1,396 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Fuzz Driver
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V2 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Random mutation driver for the fuzz targets when libFuzzer is not available
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+  Takes the same basic flags as libFuzzer, so the Makefile can run either:
+
+    fuzz/fuzz_gpbdecoder -runs=20000 -seed=1 -max_len=8192 -timeout=10 -artifact_prefix=fuzz/ ./test/
+
+  * Seeds are files or directories. `-seed_hex=1` decodes seed files as hex captures first
+    (for targets that take packet bytes rather than capture text)
+  * With -runs=0 each seed is run once, e.g. to reproduce a saved artifact
+  * The input that crashed, tripped a sanitizer, ran slow (abort() from gbp_fuzz.h)
+    or hung past -timeout seconds is saved as <artifact_prefix>crash-<run> / timeout-<run>
+
+  There is no coverage feedback, only seeds plus stacked random mutations biased
+  towards the packet header and RLE run bytes.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "gbp_fuzz.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define FUZZ_SEEDS_MAX 256
+
+typedef struct
+{
+  uint8_t *data;
+  size_t size;
+} fuzz_input_t;
+
+/******************************************************************************/
+
+// Options
+static long runsMax              = 10000;
+static unsigned int seed         = 1;
+static size_t maxLen             = 4096;
+static unsigned int timeoutSec   = 10;
+static const char *artifactPrefix = "./";
+static bool seedHex              = false;
+
+// Corpus
+static fuzz_input_t seeds[FUZZ_SEEDS_MAX];
+static int seedCount = 0;
+
+// Input under test, saved by the signal handlers
+static uint8_t *current   = NULL;
+static size_t currentSize = 0;
+static long currentRun    = 0;
+
+/*******************************************************************************
+ * Artifacts
+*******************************************************************************/
+
+static void saveArtifact(const char *kind)
+{
+  static volatile sig_atomic_t saved = 0;
+  if (saved)
+    return;
+  saved = 1;
+  char path[512];
+  snprintf(path, sizeof(path), "%s%s-%ld", artifactPrefix, kind, currentRun);
+  FILE *f = fopen(path, "wb");
+  if (f)
+  {
+    fwrite(current, 1, currentSize, f);
+    fclose(f);
+  }
+  fprintf(stderr, "==gbp_fuzz== %s on run %ld (%lu bytes), input saved to %s\n", kind, currentRun, (unsigned long)currentSize, path);
+}
+
+static void onCrash(void)
+{
+  saveArtifact("crash");
+}
+
+static void onSignal(int sig)
+{
+  saveArtifact((sig == SIGALRM) ? "timeout" : "crash");
+  signal(sig, SIG_DFL);
+  raise((sig == SIGALRM) ? SIGABRT : sig);
+}
+
+/*******************************************************************************
+ * Seeds
+*******************************************************************************/
+
+// Hex bytes, skipping `//` comment lines. Same rules as the gpbdecoder hex input
+static size_t hexToBytes(uint8_t *data, size_t size)
+{
+  size_t out    = 0;
+  bool skipLine = false;
+  int nibCount  = 0;
+  uint8_t byte  = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    const char ch = (char)data[i];
+    if (ch == '/')
+      skipLine = true;
+    if (skipLine)
+    {
+      skipLine = (ch != '\n');
+      continue;
+    }
+    int nib = -1;
+    if (('0' <= ch) && (ch <= '9'))
+      nib = ch - '0';
+    else if (('a' <= ch) && (ch <= 'f'))
+      nib = ch - 'a' + 10;
+    else if (('A' <= ch) && (ch <= 'F'))
+      nib = ch - 'A' + 10;
+    if (nib == -1)
+    {
+      nibCount = 0;
+      continue;
+    }
+    byte = (uint8_t)((byte << 4) | nib);
+    if (++nibCount == 2)
+    {
+      data[out++] = byte;
+      nibCount    = 0;
+    }
+  }
+  return out;
+}
+
+static void addSeedFile(const char *path)
+{
+  if (seedCount >= FUZZ_SEEDS_MAX)
+    return;
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return;
+  fseek(f, 0, SEEK_END);
+  const long fileSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = (uint8_t *)malloc(fileSize > 0 ? fileSize : 1);
+  size_t size   = fread(data, 1, fileSize > 0 ? fileSize : 0, f);
+  fclose(f);
+  if (seedHex)
+    size = hexToBytes(data, size);
+  seeds[seedCount].data = data;
+  seeds[seedCount].size = size;
+  seedCount++;
+}
+
+static void addSeedPath(const char *path)
+{
+  struct stat st;
+  if (stat(path, &st) != 0)
+  {
+    fprintf(stderr, "seed `%s' not found\n", path);
+    return;
+  }
+  if (!S_ISDIR(st.st_mode))
+  {
+    addSeedFile(path);
+    return;
+  }
+  DIR *dir = opendir(path);
+  if (!dir)
+    return;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    char filePath[512];
+    snprintf(filePath, sizeof(filePath), "%s/%s", path, entry->d_name);
+    if ((stat(filePath, &st) == 0) && S_ISREG(st.st_mode))
+      addSeedFile(filePath);
+  }
+  closedir(dir);
+}
+
+/*******************************************************************************
+ * Mutator
+*******************************************************************************/
+
+static unsigned int rnd(unsigned int max)
+{
+  return (max == 0) ? 0 : (unsigned int)(rand() % max);
+}
+
+static uint8_t interestingByte(void)
+{
+  // Sync, commands, RLE run boundaries and hex text
+  static const uint8_t interesting[] = {0x88, 0x33, 0x01, 0x02, 0x04, 0x0F, 0x00, 0x7F, 0x80, 0x81, 0xFE, 0xFF, '/', '\n', ' ', 'x', '0', 'F'};
+  return interesting[rnd(sizeof(interesting))];
+}
+
+static size_t mutate(uint8_t *data, size_t size, size_t maxSize)
+{
+  switch (rnd(8))
+  {
+    case 0: // Flip a bit
+      if (size > 0)
+        data[rnd(size)] ^= (uint8_t)(1 << rnd(8));
+      break;
+    case 1: // Random byte
+      if (size > 0)
+        data[rnd(size)] = (uint8_t)rnd(256);
+      break;
+    case 2: // Interesting byte
+      if (size > 0)
+        data[rnd(size)] = interestingByte();
+      break;
+    case 3: // Insert bytes
+    {
+      const size_t n   = 1 + rnd(16);
+      const size_t pos = rnd(size + 1);
+      if (size + n > maxSize)
+        break;
+      memmove(&data[pos + n], &data[pos], size - pos);
+      for (size_t i = 0; i < n; i++)
+        data[pos + i] = (rnd(2) ? interestingByte() : (uint8_t)rnd(256));
+      size += n;
+      break;
+    }
+    case 4: // Erase bytes
+    {
+      if (size == 0)
+        break;
+      const size_t pos = rnd(size);
+      const size_t n   = 1 + rnd(size - pos);
+      memmove(&data[pos], &data[pos + n], size - pos - n);
+      size -= n;
+      break;
+    }
+    case 5: // Duplicate a range, e.g. repeat a packet or a run
+    {
+      if (size == 0)
+        break;
+      const size_t pos = rnd(size);
+      size_t n         = 1 + rnd(size - pos);
+      if (size + n > maxSize)
+        n = maxSize - size;
+      const size_t dst = rnd(size + 1);
+      memmove(&data[dst + n], &data[dst], size - dst);
+      memmove(&data[dst], &data[(pos < dst) ? pos : (pos + n)], n);
+      size += n;
+      break;
+    }
+    case 6: // Splice in part of another seed
+    {
+      if (seedCount == 0)
+        break;
+      const fuzz_input_t *other = &seeds[rnd(seedCount)];
+      if (other->size == 0)
+        break;
+      const size_t from = rnd(other->size);
+      size_t n          = 1 + rnd(other->size - from);
+      const size_t pos  = rnd(size + 1);
+      if (pos + n > maxSize)
+        n = maxSize - pos;
+      memcpy(&data[pos], &other->data[from], n);
+      size = (pos + n > size) ? (pos + n) : size;
+      break;
+    }
+    default: // Packet header with a random length
+    {
+      const uint8_t header[] = {0x88, 0x33, (uint8_t)(1 + rnd(0x0F)), (uint8_t)rnd(2), (uint8_t)rnd(256), (uint8_t)rnd(3)};
+      const size_t pos       = rnd(size + 1);
+      if (size + sizeof(header) > maxSize)
+        break;
+      memmove(&data[pos + sizeof(header)], &data[pos], size - pos);
+      memcpy(&data[pos], header, sizeof(header));
+      size += sizeof(header);
+      break;
+    }
+  }
+  return size;
+}
+
+/*******************************************************************************
+ * Main Fuzz Loop
+*******************************************************************************/
+
+static void runOne(const uint8_t *data, size_t size, long *worstNsPerByte)
+{
+  memcpy(current, data, size);
+  currentSize = size;
+  alarm(timeoutSec);
+  const long start = gbp_fuzz_cpuNs();
+  LLVMFuzzerTestOneInput(current, currentSize);
+  const long nsPerByte = (gbp_fuzz_cpuNs() - start) / (long)(size ? size : 1);
+  alarm(0);
+  if (nsPerByte > *worstNsPerByte)
+    *worstNsPerByte = nsPerByte;
+}
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    if (strncmp(arg, "-runs=", 6) == 0)
+      runsMax = atol(arg + 6);
+    else if (strncmp(arg, "-seed=", 6) == 0)
+      seed = (unsigned int)atol(arg + 6);
+    else if (strncmp(arg, "-max_len=", 9) == 0)
+      maxLen = (size_t)atol(arg + 9);
+    else if (strncmp(arg, "-timeout=", 9) == 0)
+      timeoutSec = (unsigned int)atol(arg + 9);
+    else if (strncmp(arg, "-artifact_prefix=", 17) == 0)
+      artifactPrefix = arg + 17;
+    else if (strncmp(arg, "-seed_hex=", 10) == 0)
+      seedHex = atol(arg + 10) != 0;
+    else if (arg[0] == '-')
+      fprintf(stderr, "ignoring unknown flag %s\n", arg);
+    else
+      addSeedPath(arg);
+  }
+
+  current = (uint8_t *)malloc(maxLen + 1);
+  uint8_t *work = (uint8_t *)malloc(maxLen + 1);
+
+#if defined(__SANITIZE_ADDRESS__)
+  __sanitizer_set_death_callback(onCrash);
+#else
+  signal(SIGSEGV, onSignal);
+  signal(SIGBUS, onSignal);
+  signal(SIGFPE, onSignal);
+  signal(SIGILL, onSignal);
+#endif
+  signal(SIGABRT, onSignal);
+  signal(SIGALRM, onSignal);
+
+  srand(seed);
+  long worstNsPerByte = 0;
+
+  // Seeds first, as is
+  for (int s = 0; s < seedCount; s++)
+  {
+    currentRun = -1 - s;
+    runOne(seeds[s].data, (seeds[s].size < maxLen) ? seeds[s].size : maxLen, &worstNsPerByte);
+  }
+
+  // Then mutations
+  const long start = gbp_fuzz_cpuNs();
+  for (currentRun = 0; currentRun < runsMax; currentRun++)
+  {
+    size_t size = 0;
+    if (seedCount > 0)
+    {
+      const fuzz_input_t *base = &seeds[rnd(seedCount)];
+      size                     = (base->size < maxLen) ? base->size : maxLen;
+      memcpy(work, base->data, size);
+    }
+    const int stack = 1 + rnd(8);
+    for (int m = 0; m < stack; m++)
+      size = mutate(work, size, maxLen);
+    runOne(work, size, &worstNsPerByte);
+  }
+  const long elapsedMs = (gbp_fuzz_cpuNs() - start) / 1000000L;
+
+  printf("%s: %d seeds, %ld runs in %ld ms, worst %ld ns/byte (limit %ld)\n",
+         argv[0], seedCount, runsMax, elapsedMs, worstNsPerByte, gbp_fuzz_maxNsPerByte());
+
+  for (int s = 0; s < seedCount; s++)
+    free(seeds[s].data);
+  free(current);
+  free(work);
+  return 0;
+}
@@ -28,7 +28,8 @@ void gbp_bmp_open(gbp_bmp_t * gbp_bmp, const char *outputFilename, const uint16_
     gbp_bmp->f = fopen(filenameBuff, "wb");
 
     // Skip over bmp header...
-    fseek(gbp_bmp->f, BMP_PIXEL_START_OFFSET, SEEK_SET);
+    if (gbp_bmp->f)
+        fseek(gbp_bmp->f, BMP_PIXEL_START_OFFSET, SEEK_SET);
 
     // Update
     gbp_bmp->bmpSizeWidth  = fixed_width_size;
@@ -42,6 +43,10 @@ void gbp_bmp_add(gbp_bmp_t * gbp_bmp, const uint8_t * bmpLineBuffer, const uint1
     if (sizex != gbp_bmp->bmpSizeWidth)
         return;
 
+    // Output file could not be opened
+    if (!gbp_bmp->f)
+        return;
+
     for (uint16_t y = 0; y < sizey; y++)
     {
         for (uint16_t x = 0; x < sizex; x++)
@@ -59,6 +64,9 @@ void gbp_bmp_add(gbp_bmp_t * gbp_bmp, const uint8_t * bmpLineBuffer, const uint1
 
 void gbp_bmp_render(gbp_bmp_t * gbp_bmp)
 {
+    if (!gbp_bmp->f)
+        return;
+
     // Rewind and write header with the now known image size
     fseek(gbp_bmp->f, 0, SEEK_SET);
     bmp_header(gbp_bmp->bmpBuffer, gbp_bmp->bmpSizeWidth, gbp_bmp->bmpSizeHeight);
@@ -0,0 +1,388 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Packet Columns
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Columnar packet table of many captures, for scans across sessions
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gbp_columns.h"
+
+#define GBP_COLUMNS_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+// Column layout, in file order
+typedef struct
+{
+  uint8_t id;
+  uint8_t width;
+} gbp_columns_def_t;
+
+static const gbp_columns_def_t gbp_columns_defs[GBP_COLUMNS_COUNT] = {
+  {GBP_COLUMNS_JOB,         4},
+  {GBP_COLUMNS_OFFSET,      4},
+  {GBP_COLUMNS_COMMAND,     1},
+  {GBP_COLUMNS_COMPRESSION, 1},
+  {GBP_COLUMNS_LENGTH,      2},
+  {GBP_COLUMNS_STATUS,      1},
+  {GBP_COLUMNS_CHECKSUM_OK, 1},
+  {GBP_COLUMNS_TILES,       2},
+};
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static uint8_t *gbp_columns_put16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  return p + 2;
+}
+
+static uint8_t *gbp_columns_put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+  return p + 4;
+}
+
+static uint32_t gbp_columns_get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t gbp_columns_align(size_t offset)
+{
+  return (offset + GBP_COLUMNS_ALIGN - 1) & ~(size_t)(GBP_COLUMNS_ALIGN - 1);
+}
+
+// Grows an array to max elements, false if out of memory (array is kept)
+static bool gbp_columns_grow(void **array, size_t max, size_t width)
+{
+  void *grown = realloc(*array, max * width);
+  if (grown == NULL)
+    return false;
+  *array = grown;
+  return true;
+}
+
+/*******************************************************************************
+ * Writer
+*******************************************************************************/
+
+uint32_t gbp_columns_addJob(gbp_columns_writer_t *w, const char *name)
+{
+  const size_t size = strlen(name) + 1;
+  if (w->error)
+    return w->jobs;
+  if (w->jobs == w->jobMax)
+  {
+    w->jobMax = w->jobMax ? (w->jobMax * 2) : 256;
+    w->error |= !gbp_columns_grow((void **)&w->nameOffset, w->jobMax, sizeof(w->nameOffset[0]));
+  }
+  while (!w->error && ((w->namesSize + size) > w->namesMax))
+  {
+    w->namesMax = w->namesMax ? (w->namesMax * 2) : 4096;
+    w->error |= !gbp_columns_grow((void **)&w->names, w->namesMax, 1);
+  }
+  if (w->error)
+    return w->jobs;
+
+  w->nameOffset[w->jobs] = (uint32_t)w->namesSize;
+  memcpy(&w->names[w->namesSize], name, size);
+  w->namesSize += size;
+  return w->jobs++;
+}
+
+void gbp_columns_add(gbp_columns_writer_t *w, const gbp_columns_row_t *row)
+{
+  if (w->error)
+    return;
+  if (w->rows == w->rowMax)
+  {
+    w->rowMax = w->rowMax ? (w->rowMax * 2) : 4096;
+    w->error |= !gbp_columns_grow((void **)&w->job,         w->rowMax, sizeof(w->job[0]));
+    w->error |= !gbp_columns_grow((void **)&w->offset,      w->rowMax, sizeof(w->offset[0]));
+    w->error |= !gbp_columns_grow((void **)&w->command,     w->rowMax, sizeof(w->command[0]));
+    w->error |= !gbp_columns_grow((void **)&w->compression, w->rowMax, sizeof(w->compression[0]));
+    w->error |= !gbp_columns_grow((void **)&w->length,      w->rowMax, sizeof(w->length[0]));
+    w->error |= !gbp_columns_grow((void **)&w->status,      w->rowMax, sizeof(w->status[0]));
+    w->error |= !gbp_columns_grow((void **)&w->checksumOk,  w->rowMax, sizeof(w->checksumOk[0]));
+    w->error |= !gbp_columns_grow((void **)&w->tiles,       w->rowMax, sizeof(w->tiles[0]));
+    if (w->error)
+      return;
+  }
+  const uint32_t r = w->rows++;
+  w->job[r]         = row->job;
+  w->offset[r]      = row->offset;
+  w->command[r]     = row->command;
+  w->compression[r] = row->compression;
+  w->length[r]      = row->length;
+  w->status[r]      = row->status;
+  w->checksumOk[r]  = row->checksumOk;
+  w->tiles[r]       = row->tiles;
+}
+
+static const void *gbp_columns_writerArray(const gbp_columns_writer_t *w, uint8_t id)
+{
+  switch (id)
+  {
+    case GBP_COLUMNS_JOB:         return w->job;
+    case GBP_COLUMNS_OFFSET:      return w->offset;
+    case GBP_COLUMNS_COMMAND:     return w->command;
+    case GBP_COLUMNS_COMPRESSION: return w->compression;
+    case GBP_COLUMNS_LENGTH:      return w->length;
+    case GBP_COLUMNS_STATUS:      return w->status;
+    case GBP_COLUMNS_CHECKSUM_OK: return w->checksumOk;
+    case GBP_COLUMNS_TILES:       return w->tiles;
+    default:                      return NULL;
+  }
+}
+
+// Zero bytes up to offset
+static bool gbp_columns_pad(FILE *f, size_t *written, size_t offset)
+{
+  static const uint8_t zeros[GBP_COLUMNS_ALIGN] = {0};
+  const size_t size = offset - *written;
+  *written = offset;
+  return fwrite(zeros, 1, size, f) == size;
+}
+
+bool gbp_columns_write(gbp_columns_writer_t *w, FILE *f)
+{
+  if (w->error || !GBP_COLUMNS_LITTLE_ENDIAN)
+    return false;
+
+  // Layout
+  uint32_t offsets[GBP_COLUMNS_COUNT];
+  size_t end = GBP_COLUMNS_HEADER_SIZE + GBP_COLUMNS_COUNT * GBP_COLUMNS_DIR_SIZE;
+  for (int i = 0; i < GBP_COLUMNS_COUNT; i++)
+  {
+    end = gbp_columns_align(end);
+    offsets[i] = (uint32_t)end;
+    end += (size_t)w->rows * gbp_columns_defs[i].width;
+  }
+  const size_t dictOffset = gbp_columns_align(end);
+  const size_t dictSize   = (size_t)w->jobs * 4 + w->namesSize;
+  if ((dictOffset + dictSize) > UINT32_MAX)
+    return false;
+
+  // Header and column directory
+  uint8_t head[GBP_COLUMNS_HEADER_SIZE + GBP_COLUMNS_COUNT * GBP_COLUMNS_DIR_SIZE];
+  uint8_t *p = head;
+  memcpy(p, GBP_COLUMNS_MAGIC, 4);
+  p[4] = GBP_COLUMNS_VERSION;
+  p[5] = GBP_COLUMNS_COUNT;
+  p = gbp_columns_put16(&p[6], 0);
+  p = gbp_columns_put32(p, w->rows);
+  p = gbp_columns_put32(p, w->jobs);
+  p = gbp_columns_put32(p, (uint32_t)dictOffset);
+  p = gbp_columns_put32(p, (uint32_t)dictSize);
+  for (int i = 0; i < GBP_COLUMNS_COUNT; i++)
+  {
+    p[0] = gbp_columns_defs[i].id;
+    p[1] = gbp_columns_defs[i].width;
+    p = gbp_columns_put16(&p[2], 0);
+    p = gbp_columns_put32(p, offsets[i]);
+  }
+  bool ok = fwrite(head, 1, sizeof(head), f) == sizeof(head);
+  size_t written = sizeof(head);
+
+  // Arrays are already little endian in memory
+  for (int i = 0; ok && (i < GBP_COLUMNS_COUNT); i++)
+  {
+    const size_t size = (size_t)w->rows * gbp_columns_defs[i].width;
+    ok = gbp_columns_pad(f, &written, offsets[i]);
+    ok = ok && ((size == 0) || (fwrite(gbp_columns_writerArray(w, gbp_columns_defs[i].id), 1, size, f) == size));
+    written += size;
+  }
+
+  // Dictionary
+  ok = ok && gbp_columns_pad(f, &written, dictOffset);
+  for (uint32_t j = 0; ok && (j < w->jobs); j++)
+  {
+    const uint32_t nameOffset = w->jobs * 4 + w->nameOffset[j];
+    uint8_t entry[4];
+    gbp_columns_put32(entry, nameOffset);
+    ok = fwrite(entry, 1, sizeof(entry), f) == sizeof(entry);
+  }
+  ok = ok && ((w->namesSize == 0) || (fwrite(w->names, 1, w->namesSize, f) == w->namesSize));
+  return ok && (fflush(f) == 0);
+}
+
+void gbp_columns_writerFree(gbp_columns_writer_t *w)
+{
+  free(w->job);
+  free(w->offset);
+  free(w->command);
+  free(w->compression);
+  free(w->length);
+  free(w->status);
+  free(w->checksumOk);
+  free(w->tiles);
+  free(w->nameOffset);
+  free(w->names);
+  memset(w, 0, sizeof(*w));
+}
+
+/*******************************************************************************
+ * Reader
+*******************************************************************************/
+
+static bool gbp_columns_fail(gbp_columns_t *c, const char *error)
+{
+  gbp_columns_free(c);
+  c->error = error;
+  return false;
+}
+
+bool gbp_columns_load(gbp_columns_t *c, FILE *f)
+{
+  memset(c, 0, sizeof(*c));
+  if (!GBP_COLUMNS_LITTLE_ENDIAN)
+    return gbp_columns_fail(c, "big endian hosts are not supported");
+
+  // Whole file, in a block aligned as the arrays in it are
+  if ((fseek(f, 0, SEEK_END) != 0) || (ftell(f) < 0))
+    return gbp_columns_fail(c, "not seekable");
+  c->fileSize = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (c->fileSize < GBP_COLUMNS_HEADER_SIZE)
+    return gbp_columns_fail(c, "too short");
+  c->file = (uint8_t *)aligned_alloc(GBP_COLUMNS_ALIGN, gbp_columns_align(c->fileSize));
+  if (c->file == NULL)
+    return gbp_columns_fail(c, "out of memory");
+  if (fread(c->file, 1, c->fileSize, f) != c->fileSize)
+    return gbp_columns_fail(c, "read failed");
+
+  const uint8_t *p = c->file;
+  if (memcmp(p, GBP_COLUMNS_MAGIC, 4) != 0)
+    return gbp_columns_fail(c, "not a columns file");
+  if (p[4] != GBP_COLUMNS_VERSION)
+    return gbp_columns_fail(c, "unsupported version");
+  const uint8_t columns   = p[5];
+  c->rows                 = gbp_columns_get32(&p[8]);
+  c->jobs                 = gbp_columns_get32(&p[12]);
+  const uint32_t dictOffset = gbp_columns_get32(&p[16]);
+  const uint32_t dictSize   = gbp_columns_get32(&p[20]);
+  if ((GBP_COLUMNS_HEADER_SIZE + (size_t)columns * GBP_COLUMNS_DIR_SIZE) > c->fileSize)
+    return gbp_columns_fail(c, "truncated column directory");
+  if (((size_t)dictOffset + dictSize > c->fileSize) || (dictSize < (size_t)c->jobs * 4) || (dictSize && (c->file[dictOffset + dictSize - 1] != '\0')))
+    return gbp_columns_fail(c, "bad dictionary");
+  c->dict = &c->file[dictOffset];
+
+  for (int i = 0; i < columns; i++)
+  {
+    const uint8_t *dir = &p[GBP_COLUMNS_HEADER_SIZE + i * GBP_COLUMNS_DIR_SIZE];
+    const uint8_t id     = dir[0];
+    const uint8_t width  = dir[1];
+    const uint32_t offset = gbp_columns_get32(&dir[4]);
+    if ((width == 0) || ((offset % width) != 0) || ((size_t)offset + (size_t)c->rows * width > c->fileSize))
+      return gbp_columns_fail(c, "bad column");
+
+    const void *array = &c->file[offset];
+    switch ((id << 8) | width)
+    {
+      case (GBP_COLUMNS_JOB << 8) | 4:         c->job         = (const uint32_t *)array; break;
+      case (GBP_COLUMNS_OFFSET << 8) | 4:      c->offset      = (const uint32_t *)array; break;
+      case (GBP_COLUMNS_COMMAND << 8) | 1:     c->command     = (const uint8_t *)array; break;
+      case (GBP_COLUMNS_COMPRESSION << 8) | 1: c->compression = (const uint8_t *)array; break;
+      case (GBP_COLUMNS_LENGTH << 8) | 2:      c->length      = (const uint16_t *)array; break;
+      case (GBP_COLUMNS_STATUS << 8) | 1:      c->status      = (const uint8_t *)array; break;
+      case (GBP_COLUMNS_CHECKSUM_OK << 8) | 1: c->checksumOk  = (const uint8_t *)array; break;
+      case (GBP_COLUMNS_TILES << 8) | 2:       c->tiles       = (const uint16_t *)array; break;
+      default: break; // Newer column, skipped
+    }
+  }
+
+  if (!c->job || !c->offset || !c->command || !c->compression || !c->length || !c->status || !c->checksumOk || !c->tiles)
+    return gbp_columns_fail(c, "missing column");
+  for (uint32_t r = 0; r < c->rows; r++)
+    if (c->job[r] >= c->jobs)
+      return gbp_columns_fail(c, "job not in dictionary");
+  for (uint32_t j = 0; j < c->jobs; j++)
+    if (gbp_columns_get32(&c->dict[j * 4]) >= dictSize)
+      return gbp_columns_fail(c, "bad dictionary");
+  return true;
+}
+
+void gbp_columns_free(gbp_columns_t *c)
+{
+  free(c->file);
+  memset(c, 0, sizeof(*c));
+}
+
+const char *gbp_columns_jobName(const gbp_columns_t *c, uint32_t job)
+{
+  if (job >= c->jobs)
+    return NULL;
+  return (const char *)&c->dict[gbp_columns_get32(&c->dict[job * 4])];
+}
+
+/*******************************************************************************
+ * Filters
+*******************************************************************************/
+
+void gbp_columns_maskEqU8(const uint8_t *column, size_t rows, uint8_t value, uint8_t *mask)
+{
+  for (size_t i = 0; i < rows; i++)
+    mask[i] = (column[i] == value);
+}
+
+void gbp_columns_maskAndEqU8(const uint8_t *column, size_t rows, uint8_t value, uint8_t *mask)
+{
+  for (size_t i = 0; i < rows; i++)
+    mask[i] &= (column[i] == value);
+}
+
+void gbp_columns_maskAndU8(const uint8_t *column, size_t rows, uint8_t *mask)
+{
+  for (size_t i = 0; i < rows; i++)
+    mask[i] &= (column[i] != 0);
+}
+
+size_t gbp_columns_maskCount(const uint8_t *mask, size_t rows)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < rows; i++)
+    count += mask[i];
+  return count;
+}
+
+uint64_t gbp_columns_maskSumU16(const uint16_t *column, size_t rows, const uint8_t *mask)
+{
+  uint64_t sum = 0;
+  for (size_t i = 0; i < rows; i++)
+    sum += (uint64_t)column[i] * mask[i];
+  return sum;
+}
+
+void gbp_columns_histogramU8(const uint8_t *column, size_t rows, const uint8_t *mask, uint32_t hist[256])
+{
+  for (size_t i = 0; i < rows; i++)
+    hist[column[i]] += mask ? mask[i] : 1;
+}
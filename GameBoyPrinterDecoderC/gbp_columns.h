@@ -0,0 +1,153 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Packet Columns
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Columnar packet table of many captures, for scans across sessions
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Columns File
+
+    [MAGIC "GBPT"][VERSION u8][COLUMNS u8][RESERVED u16]
+    [ROWS u32][JOBS u32][DICT_OFFSET u32][DICT_SIZE u32]
+    COLUMNS x [ID u8][WIDTH u8][RESERVED u16][OFFSET u32]
+    then the column arrays, then the dictionary
+
+  * One row per packet, in capture order then packet order
+  * A column is ROWS values of WIDTH bytes from OFFSET (from the start of the
+    file, a multiple of GBP_COLUMNS_ALIGN). Values are little endian
+  * Columns hold no strings. JOB is the capture's number in the dictionary:
+      JOBS x [NAME_OFFSET u32] then the names, each '\0' terminated
+    NAME_OFFSET is from DICT_OFFSET
+  * A reader skips column IDs it does not know, so newer versions only add
+    columns
+
+  ## Reader
+
+  gbp_columns_load() reads the whole file into one block and points each
+  column at its array in place, so a scan is a loop over a plain array (and
+  only little endian hosts can read or write the file). The mask helpers
+  below are branch free loops over one column at a time, which the compiler
+  vectorises (e.g. -O3). Filters are built up as byte masks:
+
+    gbp_columns_maskEqU8(c.command, c.rows, GBP_COMMAND_DATA, mask);
+    gbp_columns_maskAndU8(c.checksumOk, c.rows, mask);
+    printf("%zu good data packets\n", gbp_columns_maskCount(mask, c.rows));
+*******************************************************************************/
+#ifndef GBP_COLUMNS_H
+#define GBP_COLUMNS_H
+#include <stdio.h>    // FILE
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#define GBP_COLUMNS_MAGIC       "GBPT"
+#define GBP_COLUMNS_VERSION     1
+#define GBP_COLUMNS_HEADER_SIZE 24
+#define GBP_COLUMNS_DIR_SIZE    8   ///< Per column
+#define GBP_COLUMNS_ALIGN       64  ///< Column arrays start on a cache line
+
+typedef enum
+{
+  GBP_COLUMNS_JOB         = 1,  ///< u32 Capture, index into the dictionary
+  GBP_COLUMNS_OFFSET      = 2,  ///< u32 Byte offset of the packet's first sync byte in its capture
+  GBP_COLUMNS_COMMAND     = 3,  ///< u8
+  GBP_COLUMNS_COMPRESSION = 4,  ///< u8
+  GBP_COLUMNS_LENGTH      = 5,  ///< u16 Payload length as sent
+  GBP_COLUMNS_STATUS      = 6,  ///< u8 Printer status reply
+  GBP_COLUMNS_CHECKSUM_OK = 7,  ///< u8 1 if the checksum matched, else 0
+  GBP_COLUMNS_TILES       = 8,  ///< u16 Tiles the payload decompressed to
+  GBP_COLUMNS_COUNT       = 8
+} gbp_columns_id_t;
+
+typedef struct
+{
+  uint32_t job;
+  uint32_t offset;
+  uint8_t command;
+  uint8_t compression;
+  uint16_t length;
+  uint8_t status;
+  uint8_t checksumOk;
+  uint16_t tiles;
+} gbp_columns_row_t;
+
+/* Writer, rows are held in columns until written */
+typedef struct
+{
+  uint32_t rows;
+  uint32_t rowMax;
+  uint32_t *job;
+  uint32_t *offset;
+  uint8_t *command;
+  uint8_t *compression;
+  uint16_t *length;
+  uint8_t *status;
+  uint8_t *checksumOk;
+  uint16_t *tiles;
+
+  /* Dictionary */
+  uint32_t jobs;
+  uint32_t jobMax;
+  uint32_t *nameOffset;
+  char *names;
+  size_t namesSize;
+  size_t namesMax;
+
+  bool error;  ///< Out of memory, later rows and jobs are dropped
+} gbp_columns_writer_t;
+
+uint32_t gbp_columns_addJob(gbp_columns_writer_t *w, const char *name);  ///< Job number of the capture
+void gbp_columns_add(gbp_columns_writer_t *w, const gbp_columns_row_t *row);
+bool gbp_columns_write(gbp_columns_writer_t *w, FILE *f);  ///< False if out of memory earlier or a write failed
+void gbp_columns_writerFree(gbp_columns_writer_t *w);
+
+/* Reader, columns point into the loaded file */
+typedef struct
+{
+  uint32_t rows;
+  uint32_t jobs;
+  const uint32_t *job;
+  const uint32_t *offset;
+  const uint8_t *command;
+  const uint8_t *compression;
+  const uint16_t *length;
+  const uint8_t *status;
+  const uint8_t *checksumOk;
+  const uint16_t *tiles;
+  const char *error;  ///< Why gbp_columns_load() failed
+
+  uint8_t *file;
+  size_t fileSize;
+  const uint8_t *dict;
+} gbp_columns_t;
+
+bool gbp_columns_load(gbp_columns_t *c, FILE *f);  ///< False (with error set) if the file is not a columns file
+void gbp_columns_free(gbp_columns_t *c);
+const char *gbp_columns_jobName(const gbp_columns_t *c, uint32_t job);  ///< NULL if job is out of range
+
+/* Filters, mask[i] is 1 for rows that pass */
+void gbp_columns_maskEqU8(const uint8_t *column, size_t rows, uint8_t value, uint8_t *mask);
+void gbp_columns_maskAndEqU8(const uint8_t *column, size_t rows, uint8_t value, uint8_t *mask);
+void gbp_columns_maskAndU8(const uint8_t *column, size_t rows, uint8_t *mask);  ///< Keeps rows where column is not 0
+size_t gbp_columns_maskCount(const uint8_t *mask, size_t rows);
+uint64_t gbp_columns_maskSumU16(const uint16_t *column, size_t rows, const uint8_t *mask);
+void gbp_columns_histogramU8(const uint8_t *column, size_t rows, const uint8_t *mask, uint32_t hist[256]);  ///< Adds the rows that pass, mask may be NULL
+
+#endif
@@ -0,0 +1,96 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Decoder
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: One capture file to its printed lines and cuts, for tools that decode many captures at once
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_decode.h"
+
+static void gbp_decode_print(gbp_decode_t *dec)
+{
+  const uint8_t *payload = dec->pktbuff;
+  gbp_tiles_print(&dec->tiles,
+      payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_SHEETS],
+      payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED],
+      payload[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE],
+      payload[GBP_PRINT_INSTRUCT_INDEX_PRINT_DENSITY]);
+  dec->sink.print(dec->sink.ctx, &dec->tiles);
+  gbp_tiles_reset(&dec->tiles);
+  if ((payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED] & 0xF) != 0)
+    dec->sink.cut(dec->sink.ctx);
+}
+
+static void gbp_decode_gotByte(void *ctx, uint8_t byte)
+{
+  gbp_decode_t *dec = (gbp_decode_t *)ctx;
+  if (!gbp_pkt_processByte(&dec->pkt, byte, dec->pktbuff, &dec->pktbuffSize, sizeof(dec->pktbuff)))
+    return;
+
+  const bool streamed = dec->pkt.dataLength >= sizeof(dec->pktbuff);
+  if (dec->pkt.received == GBP_REC_GOT_PACKET)
+  {
+    if (!streamed && (dec->pkt.command == GBP_COMMAND_PRINT))
+      gbp_decode_print(dec);
+    return;
+  }
+
+  const uint8_t *tile;
+  while ((tile = gbp_pkt_tileNext(&dec->pkt, dec->pktbuff, dec->pktbuffSize, &dec->tileAcc)) != NULL)
+  {
+    if (dec->sink.tile)
+      dec->sink.tile(dec->sink.ctx, tile);
+    gbp_tiles_line_decoder(&dec->tiles, tile);
+  }
+}
+
+const char *gbp_decode_file(gbp_decode_t *dec, const char *capture, const gbp_decode_sink_t *sink)
+{
+  FILE *f = fopen(capture, "rb");
+  if (f == NULL)
+    return "file not found";
+
+  dec->sink        = *sink;
+  dec->pktbuffSize = 0;
+  memset(&dec->tileAcc, 0, sizeof(dec->tileAcc));
+  gbp_pkt_init(&dec->pkt);
+  gbp_tiles_reset(&dec->tiles);
+  gbp_hexstream_init(&dec->hex, gbp_decode_gotByte, dec, false); // Inquiry summaries print nothing
+
+  const char *error = NULL;
+  if (gbp_input_open(&dec->input, f))
+  {
+    size_t size;
+    while ((size = gbp_input_read(&dec->input, dec->chunk, sizeof(dec->chunk))) > 0)
+      gbp_hexstream_parse(&dec->hex, dec->chunk, size);
+    gbp_hexstream_end(&dec->hex);
+    dec->sink.cut(dec->sink.ctx); // Capture ended mid picture
+  }
+  if (!gbp_input_close(&dec->input))
+    error = dec->input.error;
+  fclose(f);
+  return error;
+}
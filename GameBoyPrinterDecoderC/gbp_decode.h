@@ -0,0 +1,78 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Decoder
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: One capture file to its printed lines and cuts, for tools that decode many captures at once
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Capture Decoder
+
+  The mosaic and the spool decode each capture with its own gbp_decode_t (one
+  per worker thread), through the same steps as gpbdecoder without --threads:
+
+    file -> gbp_input -> gbp_hexstream -> gbp_pkt -> gbp_tiles -> sink
+
+  The sink gets what the capture printed, and supplies the picture output:
+
+  * tile()  each tile as it arrives, raw tones before any palette (NULL for none)
+  * print() the lines of one print command, with the print palette applied:
+            tiles->tileRowOffset lines of GBP_TILE_PIXEL_HEIGHT rows in
+            tiles->bmpLineBuffer. The colour palette is the sink's
+  * cut()   end of a picture. Also called at the end of the capture, for a
+            picture still being printed, so it may follow another cut
+*******************************************************************************/
+#ifndef GBP_DECODE_H
+#define GBP_DECODE_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+#include "gbp_input.h"
+#include "gbp_hexstream.h"
+
+typedef struct
+{
+  void *ctx;
+  void (*tile)(void *ctx, const uint8_t tile[GBP_TILE_SIZE_IN_BYTE]);
+  void (*print)(void *ctx, const gbp_tile_t *tiles);
+  void (*cut)(void *ctx);
+} gbp_decode_sink_t;
+
+typedef struct
+{
+  gbp_input_t input;
+  uint8_t chunk[GBP_INPUT_BLOCK_SIZE];
+
+  gbp_hexstream_t hex;
+
+  /* Packets and tiles */
+  gbp_pkt_t pkt;
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktbuffSize;
+  gbp_pkt_tileAcc_t tileAcc;
+  gbp_tile_t tiles;
+
+  gbp_decode_sink_t sink;
+} gbp_decode_t;
+
+const char *gbp_decode_file(gbp_decode_t *dec, const char *capture, const gbp_decode_sink_t *sink);  ///< NULL, or why the capture could not be read to its end
+
+#endif
@@ -0,0 +1,131 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Hex Stream
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Hex text captures (with `//` comment lines) to packet bytes
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_hexstream.h"
+
+void gbp_hexstream_init(gbp_hexstream_t *hs, gbp_hexstream_byte_t onByte, void *ctx, bool expandInquiry)
+{
+  memset(hs, 0, sizeof(*hs));
+  hs->onByte        = onByte;
+  hs->ctx           = ctx;
+  hs->expandInquiry = expandInquiry;
+}
+
+// `// INQY ID STATUS *COUNT ...` inquiry summary line from capture mode (see gbp_capture.h in the emulator)
+static void gbp_hexstream_comment(gbp_hexstream_t *hs)
+{
+  static const uint8_t inquiry[] = {0x88, 0x33, GBP_COMMAND_INQUIRY, 0x00, 0x00, 0x00, GBP_COMMAND_INQUIRY, 0x00};
+  hs->comment[hs->commentLen] = '\0';
+  if (strncmp(hs->comment, "// INQY", 7) != 0)
+    return;
+  hs->inquiryLines++;
+  if (!hs->expandInquiry)
+    return;
+
+  const char *p = hs->comment + 7;
+  unsigned int printerID = 0;
+  unsigned int status = 0;
+  unsigned int count = 0;
+  int used = 0;
+  while (sscanf(p, " %2x %2x *%u%n", &printerID, &status, &count, &used) == 3)
+  {
+    for (unsigned int i = 0; i < count; i++)
+    {
+      for (size_t j = 0; j < sizeof(inquiry); j++)
+        hs->onByte(hs->ctx, inquiry[j]);
+      hs->onByte(hs->ctx, (uint8_t)printerID);
+      hs->onByte(hs->ctx, (uint8_t)status);
+      hs->bytes += sizeof(inquiry) + 2;
+    }
+    p += used;
+  }
+}
+
+void gbp_hexstream_char(gbp_hexstream_t *hs, unsigned char ch)
+{
+  // Skip Comments
+  if ((ch == '/') || hs->skipLine)
+  {
+    // Might be `//` or `/*`
+    if (!hs->skipLine)
+      hs->commentLen = 0;
+    hs->skipLine = true;
+    if (ch == '\n')
+    {
+      // Discarded line, unless it is an inquiry summary
+      gbp_hexstream_comment(hs);
+      hs->skipLine = false;
+    }
+    else if (hs->commentLen < (sizeof(hs->comment) - 1))
+    {
+      hs->comment[hs->commentLen++] = ch;
+    }
+    return;
+  }
+
+  // Parse Nibble
+  char nib = -1;
+  if (('0' <= ch) && (ch <= '9'))
+    nib = ch - '0';
+  else if (('a' <= ch) && (ch <= 'f'))
+    nib = ch - 'a' + 10;
+  else if (('A' <= ch) && (ch <= 'F'))
+    nib = ch - 'A' + 10;
+
+  if (hs->lowNibFound)
+  {
+    // '0x' found, or not a hex digit pair. Ignore
+    if (((hs->byte == 0) && (ch == 'x')) || (nib == -1))
+      hs->lowNibFound = false;
+  }
+  if (nib == -1)
+    return;
+  if (!hs->lowNibFound)
+  {
+    hs->lowNibFound = true;
+    hs->byte = nib << 4;
+    return;
+  }
+  hs->lowNibFound = false;
+  hs->bytes++;
+  hs->onByte(hs->ctx, hs->byte | nib);
+}
+
+void gbp_hexstream_parse(gbp_hexstream_t *hs, const uint8_t *text, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    gbp_hexstream_char(hs, text[i]);
+}
+
+void gbp_hexstream_end(gbp_hexstream_t *hs)
+{
+  if (hs->skipLine)
+    gbp_hexstream_char(hs, '\n');
+}
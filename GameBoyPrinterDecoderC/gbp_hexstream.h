@@ -0,0 +1,64 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Hex Stream
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Hex text captures (with `//` comment lines) to packet bytes
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Hex Text
+
+  Every tool that reads a capture (gpbdecoder, gbpcolumns, gbpslice, the
+  mosaic and the spool) parses the text the same way:
+
+  * Pairs of hex digits are bytes. `0x` prefixes and any other text between
+    pairs are ignored
+  * A `/` skips the rest of its line, which covers `//` comments
+  * `// INQY ID STATUS *COUNT ...` comment lines are inquiry summaries from
+    the emulator's capture mode. With `expandInquiry` each reply is expanded
+    back to COUNT inquiry packets, otherwise the line is skipped as a comment
+*******************************************************************************/
+#ifndef GBP_HEXSTREAM_H
+#define GBP_HEXSTREAM_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+
+typedef void (*gbp_hexstream_byte_t)(void *ctx, uint8_t byte);
+
+typedef struct
+{
+  gbp_hexstream_byte_t onByte;
+  void *ctx;
+  bool expandInquiry;   ///< Inquiry summaries to inquiry packets
+  bool skipLine;
+  bool lowNibFound;
+  uint8_t byte;
+  char comment[128];    ///< Start of a comment line, long enough for an inquiry summary
+  size_t commentLen;
+  uint32_t bytes;         ///< Bytes passed to onByte
+  uint32_t inquiryLines;  ///< Inquiry summary lines seen (expanded or not)
+} gbp_hexstream_t;
+
+void gbp_hexstream_init(gbp_hexstream_t *hs, gbp_hexstream_byte_t onByte, void *ctx, bool expandInquiry);
+void gbp_hexstream_char(gbp_hexstream_t *hs, unsigned char ch);
+void gbp_hexstream_parse(gbp_hexstream_t *hs, const uint8_t *text, size_t size);
+void gbp_hexstream_end(gbp_hexstream_t *hs);  ///< End of the capture. Last line may have no line ending
+
+#endif
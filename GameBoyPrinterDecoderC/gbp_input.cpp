@@ -0,0 +1,288 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Decoder Input
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Reads a capture as is, or gzip/zstd compressed, detected by its magic bytes
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef GBP_INPUT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GBP_INPUT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "gbp_input.h"
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+gbp_input_format_t gbp_input_detect(const uint8_t *magic, size_t size)
+{
+  if ((size >= 2) && (magic[0] == 0x1F) && (magic[1] == 0x8B))
+    return GBP_INPUT_GZIP;
+  if ((size >= 4) && (magic[0] == 0x28) && (magic[1] == 0xB5) && (magic[2] == 0x2F) && (magic[3] == 0xFD))
+    return GBP_INPUT_ZSTD;
+  return GBP_INPUT_PLAIN;
+}
+
+const char *gbp_input_formatToStr(gbp_input_format_t format)
+{
+  switch (format)
+  {
+    case GBP_INPUT_PLAIN : return "plain";
+    case GBP_INPUT_GZIP  : return "gzip";
+    case GBP_INPUT_ZSTD  : return "zstd";
+    default: return "?";
+  }
+}
+
+// Reads what is available, so a live stream is not held up waiting for a full chunk
+static size_t gbp_input_readFile(FILE *f, uint8_t *buff, size_t buffSize)
+{
+  const int fd = fileno(f);
+  if (fd < 0)
+    return fread(buff, 1, buffSize, f); // e.g. fmemopen()
+  const ssize_t got = read(fd, buff, buffSize);
+  return (got > 0) ? (size_t)got : 0;
+}
+
+// File bytes, starting with the ones read by gbp_input_open()
+static size_t gbp_input_readRaw(gbp_input_t *in, uint8_t *buff, size_t size)
+{
+  if (in->magicIndex < in->magicSize)
+  {
+    size_t n = in->magicSize - in->magicIndex;
+    if (n > size)
+      n = size;
+    memcpy(buff, &in->magic[in->magicIndex], n);
+    in->magicIndex += n;
+    return n;
+  }
+  return gbp_input_readFile(in->f, buff, size);
+}
+
+/*******************************************************************************
+ * Decompression Thread
+*******************************************************************************/
+
+static void gbp_input_push(gbp_input_t *in, bool end)
+{
+  in->filling.end = end;
+  gbp_spsc_wait_push(&in->queue, &in->filling);
+  in->filling.size = 0;
+}
+
+#ifdef GBP_INPUT_HAVE_ZLIB
+static void gbp_input_gunzip(gbp_input_t *in)
+{
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, 15 + 16) != Z_OK) // gzip header
+  {
+    in->error = "zlib init failed";
+    return;
+  }
+  bool eof = false;
+  bool inMember = false;
+  while (true)
+  {
+    if ((zs.avail_in == 0) && !eof)
+    {
+      zs.avail_in = gbp_input_readRaw(in, in->compressed, sizeof(in->compressed));
+      zs.next_in  = in->compressed;
+      eof = (zs.avail_in == 0);
+    }
+    if ((zs.avail_in == 0) && eof)
+      break;
+    zs.next_out  = &in->filling.data[in->filling.size];
+    zs.avail_out = sizeof(in->filling.data) - in->filling.size;
+    inMember = true;
+    const int ret = inflate(&zs, Z_NO_FLUSH);
+    in->filling.size = sizeof(in->filling.data) - zs.avail_out;
+    if (ret == Z_STREAM_END)
+    {
+      inflateReset(&zs); // Next member of concatenated captures (e.g. cat a.gz b.gz)
+      inMember = false;
+    }
+    else if ((ret != Z_OK) && (ret != Z_BUF_ERROR))
+    {
+      in->error = "corrupt gzip input";
+      break;
+    }
+    if (in->filling.size == sizeof(in->filling.data))
+      gbp_input_push(in, false);
+  }
+  if (inMember && !in->error)
+    in->error = "gzip input ends early";
+  inflateEnd(&zs);
+}
+#endif
+
+#ifdef GBP_INPUT_HAVE_ZSTD
+static void gbp_input_unzstd(gbp_input_t *in)
+{
+  ZSTD_DStream *zds = ZSTD_createDStream();
+  if ((zds == NULL) || ZSTD_isError(ZSTD_initDStream(zds)))
+  {
+    in->error = "zstd init failed";
+    ZSTD_freeDStream(zds);
+    return;
+  }
+  ZSTD_inBuffer zin = {in->compressed, 0, 0};
+  bool eof = false;
+  size_t frameRemain = 0; // Frames can be concatenated, 0 between frames
+  while (true)
+  {
+    if ((zin.pos == zin.size) && !eof)
+    {
+      zin.size = gbp_input_readRaw(in, in->compressed, sizeof(in->compressed));
+      zin.pos  = 0;
+      eof = (zin.size == 0);
+    }
+    if ((zin.pos == zin.size) && eof)
+      break;
+    ZSTD_outBuffer zout = {in->filling.data, sizeof(in->filling.data), in->filling.size};
+    frameRemain = ZSTD_decompressStream(zds, &zout, &zin);
+    in->filling.size = zout.pos;
+    if (ZSTD_isError(frameRemain))
+    {
+      in->error = "corrupt zstd input";
+      break;
+    }
+    if (in->filling.size == sizeof(in->filling.data))
+      gbp_input_push(in, false);
+  }
+  if ((frameRemain != 0) && !in->error)
+    in->error = "zstd input ends early";
+  ZSTD_freeDStream(zds);
+}
+#endif
+
+static void *gbp_input_thread(void *arg)
+{
+  gbp_input_t *in = (gbp_input_t *)arg;
+#ifdef GBP_INPUT_HAVE_ZLIB
+  if (in->format == GBP_INPUT_GZIP)
+    gbp_input_gunzip(in);
+#endif
+#ifdef GBP_INPUT_HAVE_ZSTD
+  if (in->format == GBP_INPUT_ZSTD)
+    gbp_input_unzstd(in);
+#endif
+  gbp_input_push(in, true); // What was decoded before any error is still passed on
+  return NULL;
+}
+
+/*******************************************************************************
+ * Reader
+*******************************************************************************/
+
+bool gbp_input_open(gbp_input_t *in, FILE *f)
+{
+  in->f = f;
+  in->error = NULL;
+  in->threadRunning = false;
+  in->magicIndex = 0;
+  in->magicSize = 0;
+  in->readIndex = 0;
+  in->reading.size = 0;
+  in->reading.end = false;
+  in->filling.size = 0;
+
+  // Needs a few bytes to tell. A plain capture is at least one packet long
+  while (in->magicSize < sizeof(in->magic))
+  {
+    const size_t got = gbp_input_readFile(f, &in->magic[in->magicSize], sizeof(in->magic) - in->magicSize);
+    if (got == 0)
+      break;
+    in->magicSize += got;
+  }
+  in->format = gbp_input_detect(in->magic, in->magicSize);
+
+  switch (in->format)
+  {
+    case GBP_INPUT_PLAIN:
+      return true;
+#ifdef GBP_INPUT_HAVE_ZLIB
+    case GBP_INPUT_GZIP:
+#endif
+#ifdef GBP_INPUT_HAVE_ZSTD
+    case GBP_INPUT_ZSTD:
+#endif
+      break;
+    default:
+      in->error = (in->format == GBP_INPUT_GZIP) ? "gzip input, but built without zlib" : "zstd input, but built without libzstd";
+      return false;
+  }
+
+  gbp_spsc_wait_init(&in->queue, (uint8_t *)in->queueBuff, sizeof(in->queueBuff[0]), GBP_INPUT_BLOCKS);
+  if (pthread_create(&in->thread, NULL, gbp_input_thread, in) != 0)
+  {
+    gbp_spsc_wait_destroy(&in->queue);
+    in->error = "could not start decompression thread";
+    return false;
+  }
+  in->threadRunning = true;
+  return true;
+}
+
+size_t gbp_input_read(gbp_input_t *in, uint8_t *buff, size_t size)
+{
+  if (in->format == GBP_INPUT_PLAIN)
+    return gbp_input_readRaw(in, buff, size);
+  if (!in->threadRunning)
+    return 0;
+
+  while (in->readIndex == in->reading.size)
+  {
+    if (in->reading.end)
+      return 0;
+    gbp_spsc_wait_pop(&in->queue, &in->reading);
+    in->readIndex = 0;
+  }
+  size_t n = in->reading.size - in->readIndex;
+  if (n > size)
+    n = size;
+  memcpy(buff, &in->reading.data[in->readIndex], n);
+  in->readIndex += n;
+  return n;
+}
+
+bool gbp_input_close(gbp_input_t *in)
+{
+  if (in->threadRunning)
+  {
+    // Reader may have stopped early, drain so the thread can finish
+    while (!in->reading.end)
+      gbp_spsc_wait_pop(&in->queue, &in->reading);
+    pthread_join(in->thread, NULL);
+    gbp_spsc_wait_destroy(&in->queue);
+    in->threadRunning = false;
+  }
+  return in->error == NULL;
+}
@@ -0,0 +1,86 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Decoder Input
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Reads a capture as is, or gzip/zstd compressed, detected by its magic bytes
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Compressed input is decompressed on its own thread into one block
+//           while the reader consumes the other (a gbp_spsc queue of two blocks),
+//           so decompression and decoding overlap and nothing is written to disk.
+//           gzip needs zlib (GBP_INPUT_HAVE_ZLIB) and zstd needs libzstd (GBP_INPUT_HAVE_ZSTD).
+//           The Makefile defines them when the libraries are installed.
+#ifndef GBP_INPUT_H
+#define GBP_INPUT_H
+#include <stdio.h>    // FILE
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include <pthread.h>
+
+#include "gbp_spsc_wait.h"
+
+#define GBP_INPUT_BLOCK_SIZE  (64 * 1024)
+#define GBP_INPUT_BLOCKS      2  ///< Being filled and being read (Power of two)
+#define GBP_INPUT_MAGIC_SIZE  4
+
+typedef enum
+{
+  GBP_INPUT_PLAIN,  ///< Hex text as captured
+  GBP_INPUT_GZIP,   ///< 1F 8B
+  GBP_INPUT_ZSTD,   ///< 28 B5 2F FD
+} gbp_input_format_t;
+
+typedef struct
+{
+  size_t size;
+  bool end;  ///< Last block
+  uint8_t data[GBP_INPUT_BLOCK_SIZE];
+} gbp_input_block_t;
+
+typedef struct
+{
+  FILE *f;
+  gbp_input_format_t format;
+  const char *error;  ///< Set once the input could not be read to its end
+
+  /* Bytes read to detect the format, handed out before the rest of the file */
+  uint8_t magic[GBP_INPUT_MAGIC_SIZE];
+  size_t magicSize;
+  size_t magicIndex;
+
+  /* Decompression (compressed formats) */
+  pthread_t thread;
+  bool threadRunning;
+  gbp_spsc_wait_t queue;
+  gbp_input_block_t queueBuff[GBP_INPUT_BLOCKS];
+  gbp_input_block_t filling;  ///< Decompression thread
+  gbp_input_block_t reading;  ///< Reader
+  size_t readIndex;
+  uint8_t compressed[GBP_INPUT_BLOCK_SIZE];
+} gbp_input_t;
+
+gbp_input_format_t gbp_input_detect(const uint8_t *magic, size_t size);
+const char *gbp_input_formatToStr(gbp_input_format_t format);
+
+bool gbp_input_open(gbp_input_t *in, FILE *f);  ///< False (with error set) if the format is not supported by this build
+size_t gbp_input_read(gbp_input_t *in, uint8_t *buff, size_t size);  ///< What is available, 0 at the end
+bool gbp_input_close(gbp_input_t *in);  ///< False if the input ended with an error
+
+#endif
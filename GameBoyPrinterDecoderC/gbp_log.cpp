@@ -0,0 +1,358 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Decoder Event Log
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Compact binary log of decoder events, rendered to text or JSONL on demand
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_log.h"
+
+#define GBP_LOG_PACKET_FIELDS_SIZE    18
+#define GBP_LOG_PRINT_END_FIELDS_SIZE 3
+#define GBP_LOG_END_FIELDS_SIZE       12
+#define GBP_LOG_IMAGE_FIELDS_SIZE     14
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static uint8_t *gbp_log_put16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  return p + 2;
+}
+
+static uint8_t *gbp_log_put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+  return p + 4;
+}
+
+static uint8_t *gbp_log_put64(uint8_t *p, uint64_t v)
+{
+  p = gbp_log_put32(p, (uint32_t)v);
+  return gbp_log_put32(p, (uint32_t)(v >> 32));
+}
+
+static uint16_t gbp_log_get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t gbp_log_get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t gbp_log_get64(const uint8_t *p)
+{
+  return (uint64_t)gbp_log_get32(p) | ((uint64_t)gbp_log_get32(&p[4]) << 32);
+}
+
+const char *gbp_log_commandToStr(uint8_t command)
+{
+  switch (command)
+  {
+    case GBP_COMMAND_INIT    : return "INIT";
+    case GBP_COMMAND_PRINT   : return "PRNT";
+    case GBP_COMMAND_DATA    : return "DATA";
+    case GBP_COMMAND_BREAK   : return "BREK";
+    case GBP_COMMAND_INQUIRY : return "INQY";
+    default: return "?";
+  }
+}
+
+/*******************************************************************************
+ * Records
+*******************************************************************************/
+
+// Returns the record size (0 for an unknown type)
+size_t gbp_log_encode(const gbp_log_record_t *rec, uint8_t out[GBP_LOG_RECORD_MAX])
+{
+  uint8_t *p = &out[2];
+  switch (rec->type)
+  {
+    case GBP_LOG_REC_PACKET:
+    {
+      const gbp_log_packet_t *pkt = &rec->packet;
+      const uint8_t payloadSize = (pkt->payloadSize < GBP_LOG_PAYLOAD_MAX) ? pkt->payloadSize : GBP_LOG_PAYLOAD_MAX;
+      p = gbp_log_put32(p, pkt->offset);
+      p = gbp_log_put32(p, pkt->index);
+      *p++ = pkt->command;
+      *p++ = pkt->compression;
+      p = gbp_log_put16(p, pkt->dataLength);
+      *p++ = pkt->printerID;
+      *p++ = pkt->status;
+      p = gbp_log_put16(p, pkt->checksum);
+      p = gbp_log_put16(p, pkt->checksumCalc);
+      memcpy(p, pkt->payload, payloadSize);
+      p += payloadSize;
+      break;
+    }
+    case GBP_LOG_REC_PRINT_END:
+      *p++ = rec->printEnd.cutPaper;
+      p = gbp_log_put16(p, rec->printEnd.lines);
+      break;
+    case GBP_LOG_REC_END:
+      p = gbp_log_put32(p, rec->end.packets);
+      p = gbp_log_put32(p, rec->end.checksumErrors);
+      p = gbp_log_put32(p, rec->end.cuts);
+      break;
+    case GBP_LOG_REC_IMAGE:
+      p = gbp_log_put32(p, rec->image.index);
+      p = gbp_log_put16(p, rec->image.lines);
+      p = gbp_log_put64(p, rec->image.phash);
+      break;
+    default:
+      return 0;
+  }
+  out[0] = rec->type;
+  out[1] = (uint8_t)(p - &out[2]);
+  return p - out;
+}
+
+bool gbp_log_decode(gbp_log_record_t *rec, const uint8_t *record, size_t size)
+{
+  if ((size < 2) || (size < (size_t)(2 + record[1])))
+    return false;
+  const uint8_t *p = &record[2];
+  const uint8_t len = record[1];
+  rec->type = record[0];
+  switch (rec->type)
+  {
+    case GBP_LOG_REC_PACKET:
+    {
+      if (len < GBP_LOG_PACKET_FIELDS_SIZE)
+        return false;
+      gbp_log_packet_t *pkt = &rec->packet;
+      pkt->offset       = gbp_log_get32(&p[0]);
+      pkt->index        = gbp_log_get32(&p[4]);
+      pkt->command      = p[8];
+      pkt->compression  = p[9];
+      pkt->dataLength   = gbp_log_get16(&p[10]);
+      pkt->printerID    = p[12];
+      pkt->status       = p[13];
+      pkt->checksum     = gbp_log_get16(&p[14]);
+      pkt->checksumCalc = gbp_log_get16(&p[16]);
+      pkt->payloadSize  = len - GBP_LOG_PACKET_FIELDS_SIZE;
+      if (pkt->payloadSize > GBP_LOG_PAYLOAD_MAX)
+        pkt->payloadSize = GBP_LOG_PAYLOAD_MAX;
+      memcpy(pkt->payload, &p[GBP_LOG_PACKET_FIELDS_SIZE], pkt->payloadSize);
+      return true;
+    }
+    case GBP_LOG_REC_PRINT_END:
+      if (len < GBP_LOG_PRINT_END_FIELDS_SIZE)
+        return false;
+      rec->printEnd.cutPaper = p[0];
+      rec->printEnd.lines    = gbp_log_get16(&p[1]);
+      return true;
+    case GBP_LOG_REC_END:
+      if (len < GBP_LOG_END_FIELDS_SIZE)
+        return false;
+      rec->end.packets        = gbp_log_get32(&p[0]);
+      rec->end.checksumErrors = gbp_log_get32(&p[4]);
+      rec->end.cuts           = gbp_log_get32(&p[8]);
+      return true;
+    case GBP_LOG_REC_IMAGE:
+      if (len < GBP_LOG_IMAGE_FIELDS_SIZE)
+        return false;
+      rec->image.index = gbp_log_get32(&p[0]);
+      rec->image.lines = gbp_log_get16(&p[4]);
+      rec->image.phash = gbp_log_get64(&p[6]);
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*******************************************************************************
+ * Writer
+*******************************************************************************/
+
+bool gbp_log_open(gbp_log_writer_t *w, FILE *f)
+{
+  const uint8_t header[GBP_LOG_HEADER_SIZE] = {'G', 'B', 'P', 'L', GBP_LOG_VERSION, 0, 0, 0};
+  w->f = f;
+  w->error = false;
+  memcpy(w->buff, header, sizeof(header));
+  w->used = sizeof(header);
+  return f != NULL;
+}
+
+// Dev Note: Records are encoded straight into the block, so logging a packet
+//           costs a few stores and the file is only touched once per block
+void gbp_log_write(gbp_log_writer_t *w, const gbp_log_record_t *rec)
+{
+  if ((w->f == NULL) || w->error)
+    return;
+  if ((w->used + GBP_LOG_RECORD_MAX) > sizeof(w->buff))
+    gbp_log_flush(w);
+  w->used += gbp_log_encode(rec, &w->buff[w->used]);
+}
+
+bool gbp_log_flush(gbp_log_writer_t *w)
+{
+  if ((w->f == NULL) || w->error)
+    return false;
+  if ((w->used > 0) && (fwrite(w->buff, 1, w->used, w->f) != w->used))
+    w->error = true;
+  w->used = 0;
+  if (fflush(w->f) != 0)
+    w->error = true;
+  return !w->error;
+}
+
+/*******************************************************************************
+ * Reader
+*******************************************************************************/
+
+bool gbp_log_readHeader(FILE *f)
+{
+  uint8_t header[GBP_LOG_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), f) != sizeof(header))
+    return false;
+  return (memcmp(header, GBP_LOG_MAGIC, 4) == 0) && (header[4] == GBP_LOG_VERSION);
+}
+
+bool gbp_log_read(FILE *f, gbp_log_record_t *rec)
+{
+  uint8_t record[GBP_LOG_RECORD_MAX];
+  while (fread(record, 1, 2, f) == 2)
+  {
+    if (fread(&record[2], 1, record[1], f) != record[1])
+      return false;  // Truncated, e.g. decoder still running
+    if (gbp_log_decode(rec, record, 2 + record[1]))
+      return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ * Rendering
+*******************************************************************************/
+
+static const char gbp_log_hexDigits[] = "0123456789ABCDEF";
+
+// Payload as `XX XX ...`, one string rather than a call per byte
+static void gbp_log_payloadHex(char *out, const gbp_log_packet_t *pkt, bool spaced)
+{
+  for (int i = 0; i < pkt->payloadSize; i++)
+  {
+    *out++ = gbp_log_hexDigits[pkt->payload[i] >> 4];
+    *out++ = gbp_log_hexDigits[pkt->payload[i] & 0xF];
+    if (spaced)
+      *out++ = ' ';
+  }
+  *out = '\0';
+}
+
+void gbp_log_printText(FILE *out, const gbp_log_record_t *rec)
+{
+  char hex[GBP_LOG_PAYLOAD_MAX * 3 + 1];
+  switch (rec->type)
+  {
+    case GBP_LOG_REC_PACKET:
+    {
+      const gbp_log_packet_t *pkt = &rec->packet;
+      char checksum[32] = "ok";
+      if (!gbp_log_checksumOk(pkt))
+        snprintf(checksum, sizeof(checksum), "0x%04X != 0x%04X", (unsigned)pkt->checksum, (unsigned)pkt->checksumCalc);
+      gbp_log_payloadHex(hex, pkt, true);
+      fprintf(out, "// %s | compression: %1u, dlength: %3u, printerID: 0x%02X, status: %u, checksum: %s | %u @ %u | %s\r\n",
+          gbp_log_commandToStr(pkt->command),
+          (unsigned) pkt->compression,
+          (unsigned) pkt->dataLength,
+          (unsigned) pkt->printerID,
+          (unsigned) pkt->status,
+          checksum,
+          (unsigned) pkt->index,
+          (unsigned) pkt->offset,
+          hex
+        );
+      break;
+    }
+    case GBP_LOG_REC_PRINT_END:
+      fprintf(out, "// print end | lines: %u, cut: %u\r\n", (unsigned)rec->printEnd.lines, (unsigned)rec->printEnd.cutPaper);
+      break;
+    case GBP_LOG_REC_END:
+      fprintf(out, "// end | packets: %u, checksum errors: %u, cuts: %u\r\n",
+          (unsigned)rec->end.packets, (unsigned)rec->end.checksumErrors, (unsigned)rec->end.cuts);
+      break;
+    case GBP_LOG_REC_IMAGE:
+      fprintf(out, "// image | index: %u, lines: %u, phash: %016llX\r\n",
+          (unsigned)rec->image.index, (unsigned)rec->image.lines, (unsigned long long)rec->image.phash);
+      break;
+    default:
+      break;
+  }
+}
+
+void gbp_log_printJson(FILE *out, const gbp_log_record_t *rec)
+{
+  char hex[GBP_LOG_PAYLOAD_MAX * 2 + 1];
+  switch (rec->type)
+  {
+    case GBP_LOG_REC_PACKET:
+    {
+      const gbp_log_packet_t *pkt = &rec->packet;
+      gbp_log_payloadHex(hex, pkt, false);
+      fprintf(out, "{\"type\":\"packet\",\"offset\":%u,\"index\":%u,\"command\":\"%s\",\"compression\":%u,\"dataLength\":%u,"
+          "\"printerID\":%u,\"status\":%u,\"checksum\":%u,\"checksumCalc\":%u,\"checksumOk\":%s,\"payload\":\"%s\"}\n",
+          (unsigned) pkt->offset,
+          (unsigned) pkt->index,
+          gbp_log_commandToStr(pkt->command),
+          (unsigned) pkt->compression,
+          (unsigned) pkt->dataLength,
+          (unsigned) pkt->printerID,
+          (unsigned) pkt->status,
+          (unsigned) pkt->checksum,
+          (unsigned) pkt->checksumCalc,
+          gbp_log_checksumOk(pkt) ? "true" : "false",
+          hex
+        );
+      break;
+    }
+    case GBP_LOG_REC_PRINT_END:
+      fprintf(out, "{\"type\":\"printEnd\",\"lines\":%u,\"cut\":%s}\n",
+          (unsigned)rec->printEnd.lines, rec->printEnd.cutPaper ? "true" : "false");
+      break;
+    case GBP_LOG_REC_END:
+      fprintf(out, "{\"type\":\"end\",\"packets\":%u,\"checksumErrors\":%u,\"cuts\":%u}\n",
+          (unsigned)rec->end.packets, (unsigned)rec->end.checksumErrors, (unsigned)rec->end.cuts);
+      break;
+    case GBP_LOG_REC_IMAGE:
+      // Hex string, as JSON numbers lose precision past 53 bits
+      fprintf(out, "{\"type\":\"image\",\"index\":%u,\"lines\":%u,\"phash\":\"%016llX\"}\n",
+          (unsigned)rec->image.index, (unsigned)rec->image.lines, (unsigned long long)rec->image.phash);
+      break;
+    default:
+      break;
+  }
+}
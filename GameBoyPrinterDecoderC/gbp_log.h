@@ -0,0 +1,148 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Decoder Event Log
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Compact binary log of decoder events, rendered to text or JSONL on demand
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Log File
+
+    [MAGIC "GBPL"][VERSION u8][RESERVED u8 x3] then records until end of file
+
+  ## Record
+
+    [TYPE u8][LENGTH u8][BODY (LENGTH bytes)]
+
+    PACKET    : [OFFSET u32][INDEX u32][COMMAND u8][COMPRESSION u8][DLENGTH u16]
+                [PRINTER_ID u8][STATUS u8][CHECKSUM u16][CHECKSUM_CALC u16]
+                [PAYLOAD (rest of body)]
+    PRINT_END : [CUT u8][LINES u16]
+    END       : [PACKETS u32][CHECKSUM_ERRORS u32][CUTS u32]
+    IMAGE     : [INDEX u32][LINES u16][PHASH u64]
+
+  * Values are little endian
+  * PAYLOAD is only kept for packets whose payload fits the packet buffer
+    (e.g. print instruction), data packets are logged without it
+  * IMAGE follows the PRINT_END of each cut. INDEX is the image number (the
+    number in the output filename), PHASH is its gbp_phash.h hash
+  * A reader skips record types it does not know, and ignores body bytes past
+    the fields it knows, so newer versions only add types or append fields
+*******************************************************************************/
+#ifndef GBP_LOG_H
+#define GBP_LOG_H
+#include <stdio.h>    // FILE
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#define GBP_LOG_MAGIC         "GBPL"
+#define GBP_LOG_VERSION       1
+#define GBP_LOG_HEADER_SIZE   8
+#define GBP_LOG_PAYLOAD_MAX   16
+#define GBP_LOG_RECORD_MAX    (2 + 255)
+#define GBP_LOG_BUFFER_SIZE   (64 * 1024)  ///< Records are written out in blocks of this size
+
+typedef enum
+{
+  GBP_LOG_REC_PACKET    = 1,  ///< Complete packet
+  GBP_LOG_REC_PRINT_END = 2,  ///< All lines of a print instruction decoded
+  GBP_LOG_REC_END       = 3,  ///< End of input, with totals
+  GBP_LOG_REC_IMAGE     = 4,  ///< Picture complete (cut), with its perceptual hash
+} gbp_log_rec_type_t;
+
+typedef struct
+{
+  uint32_t offset;        ///< Input byte offset of the packet's first sync byte
+  uint32_t index;         ///< Packets so far, this one included
+  uint8_t command;
+  uint8_t compression;
+  uint16_t dataLength;
+  uint8_t printerID;
+  uint8_t status;
+  uint16_t checksum;      ///< As received
+  uint16_t checksumCalc;  ///< Sum of command to the end of the payload
+  uint8_t payloadSize;
+  uint8_t payload[GBP_LOG_PAYLOAD_MAX];
+} gbp_log_packet_t;
+
+typedef struct
+{
+  uint8_t cutPaper;
+  uint16_t lines;  ///< Lines of tiles output since the previous print end
+} gbp_log_printEnd_t;
+
+typedef struct
+{
+  uint32_t packets;
+  uint32_t checksumErrors;
+  uint32_t cuts;
+} gbp_log_end_t;
+
+typedef struct
+{
+  uint32_t index;  ///< Pictures before this one
+  uint16_t lines;  ///< Lines of tiles in the picture
+  uint64_t phash;
+} gbp_log_image_t;
+
+typedef struct
+{
+  uint8_t type;  ///< gbp_log_rec_type_t
+  union
+  {
+    gbp_log_packet_t packet;
+    gbp_log_printEnd_t printEnd;
+    gbp_log_end_t end;
+    gbp_log_image_t image;
+  };
+} gbp_log_record_t;
+
+typedef struct
+{
+  FILE *f;
+  size_t used;
+  bool error;  ///< A write failed, later records are dropped
+  uint8_t buff[GBP_LOG_BUFFER_SIZE];
+} gbp_log_writer_t;
+
+static inline bool gbp_log_checksumOk(const gbp_log_packet_t *pkt)
+{
+  return pkt->checksum == pkt->checksumCalc;
+}
+
+/* Writer */
+bool gbp_log_open(gbp_log_writer_t *w, FILE *f);  ///< Writes the file header
+void gbp_log_write(gbp_log_writer_t *w, const gbp_log_record_t *rec);
+bool gbp_log_flush(gbp_log_writer_t *w);  ///< False if any write failed
+
+/* Records */
+size_t gbp_log_encode(const gbp_log_record_t *rec, uint8_t out[GBP_LOG_RECORD_MAX]);
+bool gbp_log_decode(gbp_log_record_t *rec, const uint8_t *record, size_t size);  ///< False if the type is unknown or the body is short
+
+/* Reader */
+bool gbp_log_readHeader(FILE *f);
+bool gbp_log_read(FILE *f, gbp_log_record_t *rec);  ///< Next known record. False at the end of the log
+
+/* Rendering */
+const char *gbp_log_commandToStr(uint8_t command);
+void gbp_log_printText(FILE *out, const gbp_log_record_t *rec);
+void gbp_log_printJson(FILE *out, const gbp_log_record_t *rec);  ///< One JSON object per line
+
+#endif
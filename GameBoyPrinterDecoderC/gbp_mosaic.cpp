@@ -0,0 +1,356 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Mosaic
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Contact sheets of many captures, decoded in parallel and written a row at a time
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_tiles.h"
+#include "gbp_decode.h"
+#include "gbp_mosaic.h"
+#include "./image/bmp_FixedWidthStream.h"
+
+#define GBP_MOSAIC_PRINT_WIDTH (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE)
+
+typedef struct
+{
+  const char *capture;
+  const char *error;  ///< Set if the capture could not be read to its end
+  uint16_t thumbCount;
+  uint16_t thumbMax;
+  gbp_mosaic_thumb_t *thumbs;
+} gbp_mosaic_job_t;
+
+// One capture's thumbnails, per worker (sink of its gbp_decode_t)
+typedef struct
+{
+  gbp_decode_t decode;
+
+  /* Thumbnail of the picture being printed */
+  const gbp_mosaic_t *m;
+  gbp_mosaic_job_t *job;
+  gbp_mosaic_thumb_t thumb;
+  size_t thumbMax;  ///< Bytes allocated for thumb.pixels
+  uint8_t accRows;
+  uint32_t acc[GBP_MOSAIC_PRINT_WIDTH][3];  ///< Colour sums of the thumbnail row being built
+} gbp_mosaic_decoder_t;
+
+typedef struct
+{
+  const gbp_mosaic_t *m;
+  gbp_mosaic_job_t *jobs;
+  int count;
+  int next;  ///< Next job to take, shared by the workers
+} gbp_mosaic_batch_t;
+
+/*******************************************************************************
+ * Thumbnails
+*******************************************************************************/
+
+static void gbp_mosaic_thumbRow(gbp_mosaic_decoder_t *dec)
+{
+  if (dec->accRows == 0)
+    return;
+  gbp_mosaic_thumb_t *thumb = &dec->thumb;
+  const size_t rowSize = (size_t)thumb->width * 3;
+  const size_t needed  = ((size_t)thumb->height + 1) * rowSize;
+  if (needed > dec->thumbMax)
+  {
+    dec->thumbMax = needed * 2;
+    thumb->pixels = (uint8_t *)realloc(thumb->pixels, dec->thumbMax);
+  }
+  uint8_t *row = &thumb->pixels[thumb->height * rowSize];
+  const uint32_t area = (uint32_t)dec->accRows * dec->m->scale;
+  for (uint16_t x = 0; x < thumb->width; x++)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      row[3 * x + k] = (uint8_t)(dec->acc[x][k] / area);
+      dec->acc[x][k] = 0;
+    }
+  }
+  thumb->height++;
+  dec->accRows = 0;
+}
+
+// One pixel row of the print, 2bit packed with the print palette applied
+static void gbp_mosaic_addRow(gbp_mosaic_decoder_t *dec, const uint8_t *row)
+{
+  const uint8_t scale = dec->m->scale;
+  const uint32_t *palette = dec->m->palette;
+  for (int x = 0; x < (dec->thumb.width * scale); x++)
+  {
+    const int pixel = 0b11 & (row[GBP_TILE_2BIT_LINEPACK_INDEX(x)] >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(x));
+    const uint32_t color = palette[pixel];
+    uint32_t *acc = dec->acc[x / scale];
+    acc[0] += (color >> 0) & 0xFF;  // bmp byte order, as bmp_set()
+    acc[1] += (color >> 8) & 0xFF;
+    acc[2] += (color >> 16) & 0xFF;
+  }
+  if (++dec->accRows == scale)
+    gbp_mosaic_thumbRow(dec);
+}
+
+static void gbp_mosaic_cut(void *ctx)
+{
+  gbp_mosaic_decoder_t *dec = (gbp_mosaic_decoder_t *)ctx;
+  gbp_mosaic_thumbRow(dec);  // Partial last row
+  if (dec->thumb.height == 0)
+    return;
+  gbp_mosaic_job_t *job = dec->job;
+  if (job->thumbCount == job->thumbMax)
+  {
+    job->thumbMax = job->thumbMax ? (job->thumbMax * 2) : 4;
+    job->thumbs   = (gbp_mosaic_thumb_t *)realloc(job->thumbs, job->thumbMax * sizeof(job->thumbs[0]));
+  }
+  job->thumbs[job->thumbCount++] = dec->thumb;
+  dec->thumb.pixels = NULL;
+  dec->thumb.height = 0;
+  dec->thumbMax     = 0;
+}
+
+static void gbp_mosaic_print(void *ctx, const gbp_tile_t *tiles)
+{
+  gbp_mosaic_decoder_t *dec = (gbp_mosaic_decoder_t *)ctx;
+  for (int y = 0; y < (GBP_TILE_PIXEL_HEIGHT * tiles->tileRowOffset); y++)
+    gbp_mosaic_addRow(dec, tiles->bmpLineBuffer[y]);
+}
+
+/*******************************************************************************
+ * Decoding
+*******************************************************************************/
+
+static void gbp_mosaic_decodeJob(gbp_mosaic_decoder_t *dec, gbp_mosaic_job_t *job)
+{
+  const gbp_decode_sink_t sink = {dec, NULL, gbp_mosaic_print, gbp_mosaic_cut};
+  dec->job          = job;
+  dec->accRows      = 0;
+  memset(dec->acc, 0, sizeof(dec->acc));
+  dec->thumb.width  = GBP_MOSAIC_PRINT_WIDTH / dec->m->scale;
+  dec->thumb.height = 0;
+  dec->thumb.pixels = NULL;
+  dec->thumbMax     = 0;
+  job->error = gbp_decode_file(&dec->decode, job->capture, &sink);
+  free(dec->thumb.pixels);
+}
+
+static void *gbp_mosaic_worker(void *arg)
+{
+  gbp_mosaic_batch_t *batch = (gbp_mosaic_batch_t *)arg;
+  gbp_mosaic_decoder_t *dec = (gbp_mosaic_decoder_t *)malloc(sizeof(gbp_mosaic_decoder_t));
+  if (dec == NULL)
+    return NULL;
+  dec->m = batch->m;
+  int j;
+  while ((j = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->count)
+    gbp_mosaic_decodeJob(dec, &batch->jobs[j]);
+  free(dec);
+  return NULL;
+}
+
+// Dev Note: Workers are started per batch so a batch is complete (in capture
+//           order) before its thumbnails are placed. The calling thread decodes too
+static void gbp_mosaic_decodeBatch(gbp_mosaic_t *m, gbp_mosaic_job_t *jobs, int count)
+{
+  gbp_mosaic_batch_t batch = {m, jobs, count, 0};
+  pthread_t threads[64];
+  int started = 0;
+  const int workers = (m->threads < count) ? m->threads : count;
+  while ((started < (workers - 1)) && (started < (int)(sizeof(threads) / sizeof(threads[0]))))
+  {
+    if (pthread_create(&threads[started], NULL, gbp_mosaic_worker, &batch) != 0)
+      break;
+    started++;
+  }
+  gbp_mosaic_worker(&batch);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+}
+
+/*******************************************************************************
+ * Sheet
+*******************************************************************************/
+
+static void gbp_mosaic_writeRow(gbp_mosaic_t *m)
+{
+  if ((m->sheet != NULL) && (fwrite(m->rowBuff, BMP_PIXEL_BUFF_SIZE(m->sheetWidth, 1), 1, m->sheet) != 1))
+    m->writeError = true;
+  m->sheetHeight++;
+}
+
+static void gbp_mosaic_backgroundRow(gbp_mosaic_t *m)
+{
+  for (uint32_t x = 0; x < m->sheetWidth; x++)
+    bmp_set(m->rowBuff, m->sheetWidth, x, 0, GBP_MOSAIC_BACKGROUND);
+}
+
+static void gbp_mosaic_closeSheet(gbp_mosaic_t *m)
+{
+  if (m->sheet == NULL)
+    return;
+  gbp_mosaic_backgroundRow(m);
+  for (int i = 0; i < GBP_MOSAIC_GAP; i++)
+    gbp_mosaic_writeRow(m);
+
+  // Rewind and write header with the now known sheet size
+  uint8_t header[BMP_PIXEL_START_OFFSET];
+  bmp_header(header, m->sheetWidth, m->sheetHeight);
+  if ((fseek(m->sheet, 0, SEEK_SET) != 0) || (fwrite(header, sizeof(header), 1, m->sheet) != 1))
+    m->writeError = true;
+  if (fclose(m->sheet) != 0)
+    m->writeError = true;
+  m->sheet = NULL;
+  m->sheetCounter++;
+}
+
+static void gbp_mosaic_openSheet(gbp_mosaic_t *m)
+{
+  char filename[400];
+  snprintf(filename, sizeof(filename), "%s%X.bmp", m->sheetPrefix, m->sheetCounter);
+  m->sheet = fopen(filename, "wb");
+  if ((m->sheet == NULL) || (fseek(m->sheet, BMP_PIXEL_START_OFFSET, SEEK_SET) != 0))
+    m->writeError = true;
+  m->sheetHeight = 0;
+  m->sheetRows   = 0;
+}
+
+// The pending cells as one row of cells, then frees them
+static void gbp_mosaic_placeRow(gbp_mosaic_t *m)
+{
+  if (m->cellCount == 0)
+    return;
+  if (m->sheet == NULL)
+    gbp_mosaic_openSheet(m);
+
+  const uint32_t cellWidth = GBP_MOSAIC_PRINT_WIDTH / m->scale;
+  uint16_t rowHeight = 0;
+  for (int c = 0; c < m->cellCount; c++)
+    if (m->cells[c].thumb.height > rowHeight)
+      rowHeight = m->cells[c].thumb.height;
+
+  gbp_mosaic_backgroundRow(m);
+  for (int i = 0; i < GBP_MOSAIC_GAP; i++)
+    gbp_mosaic_writeRow(m);
+
+  for (int c = 0; (c < m->cellCount) && m->index; c++)
+  {
+    const gbp_mosaic_cell_t *cell = &m->cells[c];
+    fprintf(m->index, "%d %u %u %u %u %u %s\n", m->sheetCounter,
+        (unsigned)(GBP_MOSAIC_GAP + c * (cellWidth + GBP_MOSAIC_GAP)), (unsigned)m->sheetHeight,
+        (unsigned)cell->thumb.width, (unsigned)cell->thumb.height, (unsigned)cell->picture, cell->capture);
+  }
+
+  for (uint16_t y = 0; y < rowHeight; y++)
+  {
+    for (int c = 0; c < m->cellCount; c++)
+    {
+      const gbp_mosaic_thumb_t *thumb = &m->cells[c].thumb;
+      const uint32_t x0 = GBP_MOSAIC_GAP + c * (cellWidth + GBP_MOSAIC_GAP);
+      if (y < thumb->height)
+        memcpy(&m->rowBuff[3 * x0], &thumb->pixels[(size_t)y * thumb->width * 3], (size_t)thumb->width * 3);
+      else if (y == thumb->height)
+        for (uint32_t x = x0; x < (x0 + cellWidth); x++)
+          bmp_set(m->rowBuff, m->sheetWidth, x, 0, GBP_MOSAIC_BACKGROUND);
+    }
+    gbp_mosaic_writeRow(m);
+  }
+
+  for (int c = 0; c < m->cellCount; c++)
+    free(m->cells[c].thumb.pixels);
+  m->cellCount = 0;
+
+  if (++m->sheetRows >= m->rowsPerSheet)
+    gbp_mosaic_closeSheet(m);
+}
+
+// Thumbnails move to the pending cells in order, full rows are written out
+static void gbp_mosaic_placeJob(gbp_mosaic_t *m, gbp_mosaic_job_t *job)
+{
+  if (job->error && m->index)
+    fprintf(m->index, "// error: %s: %s\n", job->capture, job->error);
+  if (job->error && (job->thumbCount == 0))
+    m->failedCaptures++;
+  for (uint16_t i = 0; i < job->thumbCount; i++)
+  {
+    gbp_mosaic_cell_t *cell = &m->cells[m->cellCount++];
+    cell->thumb   = job->thumbs[i];
+    cell->capture = job->capture;
+    cell->picture = i;
+    m->pictures++;
+    if (m->cellCount == m->columns)
+      gbp_mosaic_placeRow(m);
+  }
+  free(job->thumbs);
+}
+
+bool gbp_mosaic_run(gbp_mosaic_t *m, const char *const captures[], int count)
+{
+  if ((m->scale < 1) || (m->scale > GBP_MOSAIC_SCALE_MAX) || (m->columns < 1) || (m->rowsPerSheet < 1) || (m->threads < 1))
+    return false;
+
+  m->pictures       = 0;
+  m->failedCaptures = 0;
+  m->sheet          = NULL;
+  m->sheetCounter   = 0;
+  m->writeError     = false;
+  m->cellCount      = 0;
+  m->sheetWidth     = GBP_MOSAIC_GAP + m->columns * (GBP_MOSAIC_PRINT_WIDTH / m->scale + GBP_MOSAIC_GAP);
+  m->rowBuff        = (uint8_t *)calloc(1, BMP_PIXEL_BUFF_SIZE(m->sheetWidth, 1));
+  m->cells          = (gbp_mosaic_cell_t *)malloc(m->columns * sizeof(m->cells[0]));
+  const int batchSize = m->threads * GBP_MOSAIC_BATCH_PER_THREAD;
+  gbp_mosaic_job_t *jobs = (gbp_mosaic_job_t *)malloc(batchSize * sizeof(jobs[0]));
+  if (!m->rowBuff || !m->cells || !jobs)
+  {
+    free(m->rowBuff);
+    free(m->cells);
+    free(jobs);
+    return false;
+  }
+  if (m->index)
+    fprintf(m->index, "// sheet x y width height picture capture\n");
+
+  for (int first = 0; first < count; first += batchSize)
+  {
+    const int n = ((count - first) < batchSize) ? (count - first) : batchSize;
+    memset(jobs, 0, n * sizeof(jobs[0]));
+    for (int j = 0; j < n; j++)
+      jobs[j].capture = captures[first + j];
+    gbp_mosaic_decodeBatch(m, jobs, n);
+    for (int j = 0; j < n; j++)
+      gbp_mosaic_placeJob(m, &jobs[j]);
+  }
+  gbp_mosaic_placeRow(m);  // Last row, may not be full
+  gbp_mosaic_closeSheet(m);
+
+  free(jobs);
+  free(m->cells);
+  free(m->rowBuff);
+  m->cells   = NULL;
+  m->rowBuff = NULL;
+  return !m->writeError;
+}
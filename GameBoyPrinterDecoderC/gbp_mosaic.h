@@ -0,0 +1,108 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Mosaic
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Contact sheets of many captures, decoded in parallel and written a row at a time
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Sheet
+
+  Each capture (job) is decoded on one of the worker threads and each of its
+  pictures (up to a cut) is downscaled to a thumbnail. Thumbnails are placed
+  left to right then top to bottom, in capture order then picture order:
+
+    [GAP][CELL][GAP][CELL]...[GAP]   one row of cells, GAP rows above it
+
+  * A cell is 160/scale pixels wide, a row of cells is as tall as its tallest
+    thumbnail. Space around thumbnails is GBP_MOSAIC_BACKGROUND
+  * Captures are decoded in batches of GBP_MOSAIC_BATCH_PER_THREAD per thread.
+    A row of cells is written out as soon as it is full, so only thumbnails
+    not yet written are held, never the sheet
+  * A sheet ends after rowsPerSheet rows of cells, the next row starts a new
+    sheet (sheetPrefix0.bmp, sheetPrefix1.bmp, ...)
+  * A picture still being printed when its capture ends is placed as if cut
+
+  ## Index
+
+  One line per thumbnail, written with its row of cells:
+
+    // sheet x y width height picture capture
+    0 4 4 80 72 0 ./captures/2020-08-10.txt
+
+  * picture is the number of the picture within its capture, from 0
+  * Captures that could not be read are listed as `// error: CAPTURE: REASON`
+*******************************************************************************/
+#ifndef GBP_MOSAIC_H
+#define GBP_MOSAIC_H
+#include <stdio.h>    // FILE
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#define GBP_MOSAIC_GAP              4         // Pixels between cells and around the sheet
+#define GBP_MOSAIC_BACKGROUND       0x404040  // Sheet colour around thumbnails
+#define GBP_MOSAIC_SCALE_MAX        8         // Most pixels to one thumbnail pixel (each way)
+#define GBP_MOSAIC_BATCH_PER_THREAD 4         // Captures decoded per thread before writing
+
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  uint8_t *pixels;  ///< 24bit in bmp byte order, rows of width*3 bytes
+} gbp_mosaic_thumb_t;
+
+typedef struct
+{
+  gbp_mosaic_thumb_t thumb;
+  const char *capture;
+  uint16_t picture;
+} gbp_mosaic_cell_t;
+
+typedef struct
+{
+  /* Settings */
+  const char *sheetPrefix;  ///< Sheets are named sheetPrefix%X.bmp
+  FILE *index;              ///< Thumbnail positions, NULL for none
+  uint32_t palette[4];
+  uint8_t scale;            ///< 1 to GBP_MOSAIC_SCALE_MAX
+  uint16_t columns;
+  uint16_t rowsPerSheet;
+  int threads;
+
+  /* Totals */
+  uint32_t pictures;
+  uint32_t failedCaptures;
+
+  /* Sheet being written */
+  FILE *sheet;
+  int sheetCounter;  ///< Sheets finished
+  uint32_t sheetWidth;
+  uint32_t sheetHeight;
+  uint16_t sheetRows;
+  bool writeError;
+  uint8_t *rowBuff;  ///< One pixel row of the sheet
+
+  /* Thumbnails not written yet, up to a row of cells */
+  uint16_t cellCount;
+  gbp_mosaic_cell_t *cells;
+} gbp_mosaic_t;
+
+bool gbp_mosaic_run(gbp_mosaic_t *m, const char *const captures[], int count);  ///< False if a sheet could not be written
+
+#endif
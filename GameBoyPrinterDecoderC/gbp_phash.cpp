@@ -0,0 +1,129 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Perceptual Hash
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: 64bit difference hash of a print, built from tiles as they are decoded
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_tiles.h"
+#include "gbp_phash.h"
+
+#define GBP_PHASH_PIXEL_WIDTH (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE)
+
+// Column band of a pixel column
+#define GBP_PHASH_BAND(x) (((x) * GBP_PHASH_COLS) / GBP_PHASH_PIXEL_WIDTH)
+
+void gbp_phash_reset(gbp_phash_t *ph)
+{
+  memset(ph, 0, sizeof(*ph));
+  ph->slotLines = 1;
+}
+
+// Halves the slots in use, each now holding twice the lines
+static void gbp_phash_merge(gbp_phash_t *ph)
+{
+  for (int i = 0; i < (GBP_PHASH_SLOTS / 2); i++)
+    for (int c = 0; c < GBP_PHASH_COLS; c++)
+      ph->sums[i][c] = ph->sums[2 * i][c] + ph->sums[2 * i + 1][c];
+  ph->slotCount = GBP_PHASH_SLOTS / 2;
+  ph->slotLines *= 2;
+  ph->slotFill   = ph->slotLines;
+}
+
+static void gbp_phash_newLine(gbp_phash_t *ph)
+{
+  ph->lines++;
+  if ((ph->slotCount == 0) || (ph->slotFill >= ph->slotLines))
+  {
+    if (ph->slotCount == GBP_PHASH_SLOTS)
+      gbp_phash_merge(ph);
+    memset(ph->sums[ph->slotCount], 0, sizeof(ph->sums[0]));
+    ph->slotCount++;
+    ph->slotFill = 0;
+  }
+  ph->slotFill++;
+}
+
+void gbp_phash_addTile(gbp_phash_t *ph, const uint8_t tile[GBP_TILE_SIZE_IN_BYTE])
+{
+  if (ph->slotLines == 0)
+    gbp_phash_reset(ph);  // Zero initialised
+  if (ph->tileIndex == 0)
+    gbp_phash_newLine(ph);
+
+  // Tone sum of each pixel column of the tile (Low bit plane then high bit plane per row)
+  uint16_t columns[GBP_TILE_PIXEL_WIDTH] = {0};
+  for (int row = 0; row < GBP_TILE_PIXEL_HEIGHT; row++)
+  {
+    const uint8_t lo = tile[2 * row];
+    const uint8_t hi = tile[2 * row + 1];
+    for (int px = 0; px < GBP_TILE_PIXEL_WIDTH; px++)
+    {
+      const int bit = 7 - px;
+      columns[px] += ((lo >> bit) & 1) + (((hi >> bit) & 1) << 1);
+    }
+  }
+
+  uint32_t *sums = ph->sums[ph->slotCount - 1];
+  const int x0 = ph->tileIndex * GBP_TILE_PIXEL_WIDTH;
+  for (int px = 0; px < GBP_TILE_PIXEL_WIDTH; px++)
+    sums[GBP_PHASH_BAND(x0 + px)] += columns[px];
+
+  ph->tileIndex = (ph->tileIndex + 1) % GBP_TILES_PER_LINE;
+}
+
+uint64_t gbp_phash_final(gbp_phash_t *ph)
+{
+  // Pixel columns per band, bands are compared by their mean tone
+  uint32_t width[GBP_PHASH_COLS] = {0};
+  for (int x = 0; x < GBP_PHASH_PIXEL_WIDTH; x++)
+    width[GBP_PHASH_BAND(x)]++;
+
+  uint64_t hash = 0;
+  const int slots = ph->slotCount;
+  for (int r = 0; (slots > 0) && (r < GBP_PHASH_ROWS); r++)
+  {
+    // Slots of this row. A short print repeats slots over rows
+    const int s0 = (r * slots) / GBP_PHASH_ROWS;
+    int s1 = ((r + 1) * slots) / GBP_PHASH_ROWS;
+    if (s1 <= s0)
+      s1 = s0 + 1;
+
+    uint64_t cells[GBP_PHASH_COLS] = {0};
+    for (int s = s0; s < s1; s++)
+      for (int c = 0; c < GBP_PHASH_COLS; c++)
+        cells[c] += ph->sums[s][c];
+
+    // Only cells of the same row are compared, so rows need no weighting
+    for (int c = 0; c < (GBP_PHASH_COLS - 1); c++)
+    {
+      hash <<= 1;
+      if ((cells[c] * width[c + 1]) > (cells[c + 1] * width[c]))
+        hash |= 1;
+    }
+  }
+
+  gbp_phash_reset(ph);
+  return hash;
+}
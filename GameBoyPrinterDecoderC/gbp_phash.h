@@ -0,0 +1,71 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Perceptual Hash
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: 64bit difference hash of a print, built from tiles as they are decoded
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Hash
+
+  The print is split into a grid of 8 rows by 9 columns. Each bit is set if a
+  cell is darker than the cell to its right (8 rows x 8 pairs = 64 bits, row 0
+  in the top bits).
+
+  * Tones are the 2bit values as sent by the gameboy, before the print
+    instruction's palette is applied. The same picture printed with another
+    palette has the same hash
+  * Each tile adds its tone sums to the column bands of its line of tiles, so
+    there is no pass over the picture once it is printed
+  * Long prints keep fixed memory. Once GBP_PHASH_SLOTS lines of tiles are
+    held, neighbouring slots are merged and each slot holds twice the lines
+  * Hamming distance between two hashes (gbp_phash_distance()) is small for
+    similar pictures. A small crop or border shifts the grid, which costs a
+    few bits rather than a mismatch
+*******************************************************************************/
+#ifndef GBP_PHASH_H
+#define GBP_PHASH_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+#include "gameboy_printer_protocol.h"
+
+#define GBP_PHASH_ROWS   8
+#define GBP_PHASH_COLS   9   // One more than the bits per row
+#define GBP_PHASH_SLOTS  64  // Lines of tiles held before merging (Power of two, GBP_PHASH_ROWS or more)
+
+typedef struct
+{
+  uint8_t tileIndex;    ///< Tile within the current line of tiles
+  uint16_t slotCount;   ///< Slots in use, the last may be partly filled
+  uint16_t slotLines;   ///< Lines of tiles per slot
+  uint16_t slotFill;    ///< Lines of tiles in the last slot
+  uint32_t lines;       ///< Lines of tiles hashed, the last may be partial
+  uint32_t sums[GBP_PHASH_SLOTS][GBP_PHASH_COLS];  ///< Tone sum per column band
+} gbp_phash_t;
+
+void gbp_phash_reset(gbp_phash_t *ph);
+void gbp_phash_addTile(gbp_phash_t *ph, const uint8_t tile[GBP_TILE_SIZE_IN_BYTE]);  ///< Tiles in print order, GBP_TILES_PER_LINE to a line
+uint64_t gbp_phash_final(gbp_phash_t *ph);  ///< Hash of the tiles so far, then resets for the next print
+
+static inline int gbp_phash_distance(uint64_t a, uint64_t b)
+{
+  return __builtin_popcountll(a ^ b);
+}
+
+#endif
@@ -256,3 +256,25 @@ bool gbp_pkt_decompressor(gbp_pkt_t *_pkt, const uint8_t buff[], const size_t bu
   }
   return false;
 }
+
+// Same tiles as gbp_pkt_decompressor() with gbp_pkt_tileAccu_tileReadyCheck()
+// Dev Note: An uncompressed tile that lies whole in buff is returned in place,
+//           so it is not copied byte by byte into the accumulator. Only tiles
+//           split across two buffers, and compressed payloads, go through it.
+//           The pointer is valid until buff or tileBuff is next written.
+const uint8_t *gbp_pkt_tileNext(gbp_pkt_t *_pkt, const uint8_t buff[], const size_t buffSize, gbp_pkt_tileAcc_t *tileBuff)
+{
+  if (!_pkt->compression && (tileBuff->count == 0) && ((_pkt->buffIndex + GBP_TILE_SIZE_IN_BYTE) <= buffSize))
+  {
+    const uint8_t *tile = &buff[_pkt->buffIndex];
+    _pkt->buffIndex += GBP_TILE_SIZE_IN_BYTE;
+    return tile;
+  }
+
+  while (gbp_pkt_decompressor(_pkt, buff, buffSize, tileBuff))
+  {
+    if (gbp_pkt_tileAccu_tileReadyCheck(tileBuff))
+      return tileBuff->tile;
+  }
+  return NULL;
+}
@@ -22,6 +22,8 @@
  *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef GBP_PKT_H
+#define GBP_PKT_H
 #include <stdint.h> // uint8_t
 #include <stddef.h> // size_t
 #include <stdbool.h> // bool
@@ -72,6 +74,7 @@ bool gbp_pkt_reset(gbp_pkt_t *_pkt);
 bool gbp_pkt_processByte(gbp_pkt_t *_pkt,  const uint8_t _byte, uint8_t buffer[], uint8_t *bufferSize, const size_t bufferMax);
 bool gbp_pkt_decompressor(gbp_pkt_t *_pkt, const uint8_t buff[], const size_t buffSize, gbp_pkt_tileAcc_t *tileBuff);
 bool gbp_pkt_tileAccu_tileReadyCheck(gbp_pkt_tileAcc_t *tileBuff);
+const uint8_t *gbp_pkt_tileNext(gbp_pkt_t *_pkt, const uint8_t buff[], const size_t buffSize, gbp_pkt_tileAcc_t *tileBuff); ///< Next tile, NULL once buff is used up
 
 /*******************************************************************************
  * Print Instruction
@@ -101,3 +104,5 @@ static inline int gbp_pkt_printInstruction_print_density(uint8_t payloadBuff[GBP
 {
   return (payloadBuff[GBP_PRINT_INSTRUCT_INDEX_PRINT_DENSITY  ]);
 }
+
+#endif
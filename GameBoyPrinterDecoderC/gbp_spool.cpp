@@ -0,0 +1,655 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Spool Service
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Decodes captures dropped into a spool directory, on a pool of workers
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_tiles.h"
+#include "gbp_bmp.h"
+#include "gbp_decode.h"
+#include "gbp_phash.h"
+#include "gbp_spool.h"
+
+#define GBP_SPOOL_PATH_MAX (2 * GBP_SPOOL_NAME_MAX + 1024)
+
+typedef char gbp_spool_name_t[GBP_SPOOL_NAME_MAX + 1];
+
+// This service's claim directories, each locked while the service runs (See Claims in gbp_spool.h)
+typedef struct
+{
+  char name[GBP_SPOOL_OWNER_MAX];    ///< HOST.PID
+  char claimed[GBP_SPOOL_PATH_MAX];  ///< SPOOL/.claimed/OWNER
+  char partial[GBP_SPOOL_PATH_MAX];  ///< OUTPUT/.partial/OWNER
+  int claimedLock;
+  int partialLock;
+} gbp_spool_owner_t;
+
+// One capture's pictures, per worker (sink of its gbp_decode_t)
+typedef struct
+{
+  gbp_decode_t decode;
+  gbp_phash_t phash;
+
+  /* Pictures */
+  const uint32_t *palette;
+  const char *prefix;  ///< Pictures are named prefix%X.bmp
+  const char *stem;    ///< Prefix without its directory, for the hash index
+  gbp_bmp_t bmp;
+  FILE *hashIndex;
+  bool writeFailed;
+} gbp_spool_decoder_t;
+
+// Claimed captures waiting for a worker
+typedef struct
+{
+  gbp_spool_t *sp;
+  const gbp_spool_owner_t *owner;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  int capacity;
+  int head;
+  int count;
+  int busy;      ///< Being decoded
+  bool closed;   ///< Workers exit once the queue is empty
+  gbp_spool_name_t *names;
+  int wakeFd[2]; ///< Workers write a byte when done, to wake the service
+} gbp_spool_pool_t;
+
+static volatile sig_atomic_t gbp_spool_stop = 0;
+static volatile sig_atomic_t gbp_spool_reportWanted = 0;
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static double gbp_spool_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void gbp_spool_path(char path[GBP_SPOOL_PATH_MAX], const char *dir, const char *sub, const char *name)
+{
+  if (sub)
+    snprintf(path, GBP_SPOOL_PATH_MAX, "%s/%s/%s", dir, sub, name);
+  else
+    snprintf(path, GBP_SPOOL_PATH_MAX, "%s/%s", dir, name);
+}
+
+static bool gbp_spool_mkdir(const char *path)
+{
+  return (mkdir(path, 0777) == 0) || (errno == EEXIST);
+}
+
+// Files in a directory then the directory. Results are files only
+static void gbp_spool_removeDir(const char *dir)
+{
+  DIR *d = opendir(dir);
+  if (d)
+  {
+    struct dirent *e;
+    char path[GBP_SPOOL_PATH_MAX];
+    while ((e = readdir(d)) != NULL)
+    {
+      if ((strcmp(e->d_name, ".") == 0) || (strcmp(e->d_name, "..") == 0))
+        continue;
+      gbp_spool_path(path, dir, NULL, e->d_name);
+      unlink(path);
+    }
+    closedir(d);
+  }
+  rmdir(dir);
+}
+
+static void gbp_spool_signal(int sig)
+{
+  if (sig == SIGUSR1)
+    gbp_spool_reportWanted = 1;
+  else
+    gbp_spool_stop = 1;
+}
+
+/*******************************************************************************
+ * Decoding
+*******************************************************************************/
+
+static void gbp_spool_tile(void *ctx, const uint8_t tile[GBP_TILE_SIZE_IN_BYTE])
+{
+  gbp_phash_addTile(&((gbp_spool_decoder_t *)ctx)->phash, tile);
+}
+
+static void gbp_spool_print(void *ctx, const gbp_tile_t *tiles)
+{
+  gbp_spool_decoder_t *dec = (gbp_spool_decoder_t *)ctx;
+  if (!gbp_bmp_isopen(&dec->bmp))
+  {
+    gbp_bmp_open(&dec->bmp, dec->prefix, GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE);
+    dec->writeFailed |= !gbp_bmp_isopen(&dec->bmp);
+  }
+  for (int line = 0; line < tiles->tileRowOffset; line++)
+    gbp_bmp_add(&dec->bmp, tiles->bmpLineBuffer[GBP_TILE_PIXEL_HEIGHT * line], GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE, GBP_TILE_PIXEL_HEIGHT, dec->palette);
+}
+
+static void gbp_spool_cut(void *ctx)
+{
+  gbp_spool_decoder_t *dec = (gbp_spool_decoder_t *)ctx;
+  if (!gbp_bmp_isopen(&dec->bmp))
+    return;
+  const uint64_t hash = gbp_phash_final(&dec->phash);
+  if (dec->hashIndex)
+    fprintf(dec->hashIndex, "%016llX %s%X.bmp\n", (unsigned long long)hash, dec->stem, dec->bmp.fileCounter - 1);
+  gbp_bmp_render(&dec->bmp);
+}
+
+// Returns NULL, or why the capture could not be decoded
+static const char *gbp_spool_decode(gbp_spool_decoder_t *dec, const char *capture, const char *dir, const char *stem, uint32_t *pictures)
+{
+  const gbp_decode_sink_t sink = {dec, gbp_spool_tile, gbp_spool_print, gbp_spool_cut};
+  char path[GBP_SPOOL_PATH_MAX];
+  snprintf(path, GBP_SPOOL_PATH_MAX, "%s/%s.gbphash", dir, stem);
+  dec->hashIndex = fopen(path, "w");
+  snprintf(path, GBP_SPOOL_PATH_MAX, "%s/%s", dir, stem);
+
+  dec->prefix      = path;
+  dec->stem        = stem;
+  dec->writeFailed = false;
+  memset(&dec->bmp, 0, sizeof(dec->bmp));
+  gbp_phash_reset(&dec->phash);
+
+  const char *error = gbp_decode_file(&dec->decode, capture, &sink);
+  if ((dec->hashIndex == NULL) || (fclose(dec->hashIndex) != 0) || dec->writeFailed)
+    error = error ? error : "could not write results";
+  *pictures = dec->bmp.fileCounter;
+  return error;
+}
+
+/*******************************************************************************
+ * Claims
+*******************************************************************************/
+
+// Capture (from .claimed) to .failed, with the reason alongside
+static void gbp_spool_fail(gbp_spool_t *sp, const char *from, const char *name, const char *error)
+{
+  char path[GBP_SPOOL_PATH_MAX];
+  gbp_spool_path(path, sp->spoolDir, GBP_SPOOL_FAILED_DIR, name);
+  rename(from, path);
+  strncat(path, ".error", GBP_SPOOL_PATH_MAX - strlen(path) - 1);
+  FILE *f = fopen(path, "w");
+  if (f)
+  {
+    fprintf(f, "%s\n", error);
+    fclose(f);
+  }
+  printf("spool: `%s' failed: %s\n", name, error);
+}
+
+// Decodes one claimed capture to its output directory. Returns pictures, or -1 if it failed
+static int gbp_spool_process(gbp_spool_t *sp, const gbp_spool_owner_t *owner, gbp_spool_decoder_t *dec, const char *name)
+{
+  char claimed[GBP_SPOOL_PATH_MAX];
+  char partial[GBP_SPOOL_PATH_MAX];
+  char moved[GBP_SPOOL_PATH_MAX];
+  char done[GBP_SPOOL_PATH_MAX];
+  gbp_spool_name_t stem;
+  snprintf(stem, sizeof(stem), "%s", name);
+  char *ext = strrchr(stem, '.');
+  if (ext && (ext != stem))
+    *ext = '\0';
+  gbp_spool_path(claimed, owner->claimed, NULL, name);
+  gbp_spool_path(partial, owner->partial, NULL, name);
+  gbp_spool_path(moved, partial, NULL, name);
+
+  uint32_t pictures = 0;
+  const char *error = NULL;
+  if (mkdir(partial, 0777) != 0)
+    error = strerror(errno);
+  if (!error)
+    error = gbp_spool_decode(dec, claimed, partial, stem, &pictures);
+  if (!error && (rename(claimed, moved) != 0))
+    error = strerror(errno);
+  if (error)
+  {
+    gbp_spool_removeDir(partial);
+    gbp_spool_fail(sp, claimed, name, error);
+    return -1;
+  }
+
+  // Results appear all at once. A taken name gets the next free suffix
+  gbp_spool_path(done, sp->outputDir, NULL, stem);
+  for (int suffix = 1; rename(partial, done) != 0; suffix++)
+  {
+    if (((errno != EEXIST) && (errno != ENOTEMPTY)) || (suffix > GBP_SPOOL_SUFFIX_MAX))
+    {
+      error = strerror(errno);
+      rename(moved, claimed);
+      gbp_spool_removeDir(partial);
+      gbp_spool_fail(sp, claimed, name, error);
+      return -1;
+    }
+    snprintf(done, GBP_SPOOL_PATH_MAX, "%s/%s-%d", sp->outputDir, stem, suffix);
+  }
+  return (int)pictures;
+}
+
+// Claim directory locked for as long as the service runs. Returns the lock, or -1
+static int gbp_spool_ownDir(const char *dir)
+{
+  char lock[GBP_SPOOL_PATH_MAX];
+  char fresh[GBP_SPOOL_PATH_MAX];
+  if (!gbp_spool_mkdir(dir))
+    return -1;
+  gbp_spool_path(lock, dir, NULL, GBP_SPOOL_LOCK_FILE);
+  snprintf(fresh, GBP_SPOOL_PATH_MAX, "%s.%d", lock, (int)getpid());
+
+  // Locked before it is named, so a starting service never finds it unlocked
+  const int fd = open(fresh, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return -1;
+  if ((flock(fd, LOCK_EX | LOCK_NB) != 0) || (rename(fresh, lock) != 0))
+  {
+    unlink(fresh);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Lock taken and the lock file is still the one locked (not removed by a service recovering it)
+static bool gbp_spool_lockDir(const char *dir, int *fd)
+{
+  char lock[GBP_SPOOL_PATH_MAX];
+  struct stat held;
+  struct stat named;
+  gbp_spool_path(lock, dir, NULL, GBP_SPOOL_LOCK_FILE);
+  *fd = open(lock, O_RDWR | O_CLOEXEC);
+  if (*fd < 0)
+    return false; // Being set up, or removed by its service on exit
+  return (flock(*fd, LOCK_EX | LOCK_NB) == 0) && (fstat(*fd, &held) == 0) && (stat(lock, &named) == 0) &&
+         (held.st_dev == named.st_dev) && (held.st_ino == named.st_ino);
+}
+
+// Lock and directory removed, once the claims in it are gone
+static void gbp_spool_releaseDir(const char *dir, int fd)
+{
+  char lock[GBP_SPOOL_PATH_MAX];
+  gbp_spool_path(lock, dir, NULL, GBP_SPOOL_LOCK_FILE);
+  unlink(lock);
+  rmdir(dir);
+  close(fd);
+}
+
+// Captures in a claim directory whose service stopped mid decode go back to the spool
+static void gbp_spool_recoverDir(gbp_spool_t *sp, const char *dir, bool partials)
+{
+  char from[GBP_SPOOL_PATH_MAX];
+  char to[GBP_SPOOL_PATH_MAX];
+  struct dirent *e;
+  DIR *d = opendir(dir);
+  while (d && ((e = readdir(d)) != NULL))
+  {
+    if (e->d_name[0] == '.')
+      continue;
+    gbp_spool_path(to, sp->spoolDir, NULL, e->d_name);
+    if (!partials)
+    {
+      gbp_spool_path(from, dir, NULL, e->d_name);
+      if (rename(from, to) == 0)
+        printf("spool: `%s' was claimed but not finished, returned to the spool\n", e->d_name);
+      continue;
+    }
+    char partial[GBP_SPOOL_PATH_MAX];
+    gbp_spool_path(partial, dir, NULL, e->d_name);
+    gbp_spool_path(from, partial, NULL, e->d_name);
+    if (rename(from, to) == 0)
+      printf("spool: `%s' was decoded but not moved to the output, returned to the spool\n", e->d_name);
+    gbp_spool_removeDir(partial);
+  }
+  if (d)
+    closedir(d);
+}
+
+// Claim directories of other services. Only those whose lock is free (the service is gone) are recovered
+static void gbp_spool_recover(gbp_spool_t *sp, const gbp_spool_owner_t *owner, const char *base, bool partials)
+{
+  char dir[GBP_SPOOL_PATH_MAX];
+  struct dirent *e;
+  DIR *d = opendir(base);
+  while (d && ((e = readdir(d)) != NULL))
+  {
+    if ((e->d_name[0] == '.') || (strcmp(e->d_name, owner->name) == 0))
+      continue;
+    gbp_spool_path(dir, base, NULL, e->d_name);
+    int fd = -1;
+    if (gbp_spool_lockDir(dir, &fd))
+    {
+      gbp_spool_recoverDir(sp, dir, partials);
+      gbp_spool_releaseDir(dir, fd);
+    }
+    else if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+  if (d)
+    closedir(d);
+}
+
+// Takes this service's claim directories, then returns captures left by services that are gone
+static bool gbp_spool_own(gbp_spool_t *sp, gbp_spool_owner_t *owner)
+{
+  char host[GBP_SPOOL_OWNER_MAX - 16] = "localhost";
+  char base[GBP_SPOOL_PATH_MAX];
+  gethostname(host, sizeof(host) - 1);
+  for (char *c = host; *c; c++)
+    *c = ((*c == '/') || (*c == '.')) ? '_' : *c;
+  snprintf(owner->name, sizeof(owner->name), "%s.%d", host, (int)getpid());
+  gbp_spool_path(owner->claimed, sp->spoolDir, GBP_SPOOL_CLAIMED_DIR, owner->name);
+  gbp_spool_path(owner->partial, sp->outputDir, GBP_SPOOL_PARTIAL_DIR, owner->name);
+  owner->claimedLock = gbp_spool_ownDir(owner->claimed);
+  owner->partialLock = gbp_spool_ownDir(owner->partial);
+  if ((owner->claimedLock < 0) || (owner->partialLock < 0))
+  {
+    if (owner->claimedLock >= 0)
+      gbp_spool_releaseDir(owner->claimed, owner->claimedLock);
+    if (owner->partialLock >= 0)
+      gbp_spool_releaseDir(owner->partial, owner->partialLock);
+    return false;
+  }
+
+  // Left by an earlier service with the same host and pid
+  gbp_spool_recoverDir(sp, owner->claimed, false);
+  gbp_spool_recoverDir(sp, owner->partial, true);
+
+  gbp_spool_path(base, sp->spoolDir, NULL, GBP_SPOOL_CLAIMED_DIR);
+  gbp_spool_recover(sp, owner, base, false);
+  gbp_spool_path(base, sp->outputDir, NULL, GBP_SPOOL_PARTIAL_DIR);
+  gbp_spool_recover(sp, owner, base, true);
+  return true;
+}
+
+// Claims waiting captures while there is room. Returns captures left waiting
+static int gbp_spool_claim(gbp_spool_pool_t *pool)
+{
+  gbp_spool_t *sp = pool->sp;
+  DIR *d = opendir(sp->spoolDir);
+  if (d == NULL)
+    return 0;
+
+  int waiting = 0;
+  struct dirent *e;
+  char from[GBP_SPOOL_PATH_MAX];
+  char to[GBP_SPOOL_PATH_MAX];
+  struct stat st;
+  while ((e = readdir(d)) != NULL)
+  {
+    if ((e->d_name[0] == '.') || (strlen(e->d_name) > GBP_SPOOL_NAME_MAX))
+      continue;
+    gbp_spool_path(from, sp->spoolDir, NULL, e->d_name);
+    if ((stat(from, &st) != 0) || !S_ISREG(st.st_mode))
+      continue;
+
+    pthread_mutex_lock(&pool->lock);
+    const bool room = (pool->count + pool->busy) < pool->capacity;
+    pthread_mutex_unlock(&pool->lock);
+    if (!room)
+    {
+      waiting++;
+      continue;
+    }
+
+    // Claimed by rename, so another service sharing the spool skips it
+    gbp_spool_path(to, pool->owner->claimed, NULL, e->d_name);
+    if (rename(from, to) != 0)
+      continue;
+    pthread_mutex_lock(&pool->lock);
+    snprintf(pool->names[(pool->head + pool->count) % pool->capacity], sizeof(gbp_spool_name_t), "%s", e->d_name);
+    pool->count++;
+    sp->bytes += (uint64_t)st.st_size;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  closedir(d);
+  return waiting;
+}
+
+/*******************************************************************************
+ * Service
+*******************************************************************************/
+
+static void *gbp_spool_worker(void *arg)
+{
+  gbp_spool_pool_t *pool = (gbp_spool_pool_t *)arg;
+  gbp_spool_t *sp = pool->sp;
+  gbp_spool_decoder_t *dec = (gbp_spool_decoder_t *)calloc(1, sizeof(gbp_spool_decoder_t));
+  if (dec == NULL)
+    return NULL;
+  dec->palette = sp->palette;
+
+  while (true)
+  {
+    pthread_mutex_lock(&pool->lock);
+    while ((pool->count == 0) && !pool->closed)
+      pthread_cond_wait(&pool->ready, &pool->lock);
+    if (pool->count == 0)
+    {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    gbp_spool_name_t name;
+    memcpy(name, pool->names[pool->head], sizeof(name));
+    pool->head = (pool->head + 1) % pool->capacity;
+    pool->count--;
+    pool->busy++;
+    pthread_mutex_unlock(&pool->lock);
+
+    const double start = gbp_spool_now();
+    const int pictures = gbp_spool_process(sp, pool->owner, dec, name);
+    const double seconds = gbp_spool_now() - start;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->busy--;
+    sp->captures++;
+    sp->failed   += (pictures < 0) ? 1 : 0;
+    sp->pictures += (pictures > 0) ? (uint32_t)pictures : 0;
+    sp->decodeSeconds += seconds;
+    pthread_mutex_unlock(&pool->lock);
+    const uint8_t wake = 1;
+    if (write(pool->wakeFd[1], &wake, 1) < 0)
+    {
+      // Pipe full, the service is awake already
+    }
+  }
+  free(dec);
+  return NULL;
+}
+
+static void gbp_spool_report(gbp_spool_pool_t *pool, double seconds)
+{
+  gbp_spool_t *sp = pool->sp;
+  pthread_mutex_lock(&pool->lock);
+  const double mb = (double)sp->bytes / (1024.0 * 1024.0);
+  const double t  = (seconds > 0) ? seconds : 1e-9;
+  printf("spool: %u captures (%u failed), %u pictures, %.2f MB in %.1f s: %.2f captures/s, %.2f MB/s, %d workers %.0f%% busy\n",
+         (unsigned)sp->captures, (unsigned)sp->failed, (unsigned)sp->pictures, mb, seconds,
+         sp->captures / t, mb / t, sp->workers, 100.0 * sp->decodeSeconds / (t * sp->workers));
+  pthread_mutex_unlock(&pool->lock);
+  fflush(stdout);
+}
+
+bool gbp_spool_run(gbp_spool_t *sp)
+{
+  char dir[GBP_SPOOL_PATH_MAX];
+  bool ok = gbp_spool_mkdir(sp->outputDir);
+  gbp_spool_path(dir, sp->spoolDir, NULL, GBP_SPOOL_CLAIMED_DIR);
+  ok = ok && gbp_spool_mkdir(dir);
+  gbp_spool_path(dir, sp->spoolDir, NULL, GBP_SPOOL_FAILED_DIR);
+  ok = ok && gbp_spool_mkdir(dir);
+  gbp_spool_path(dir, sp->outputDir, NULL, GBP_SPOOL_PARTIAL_DIR);
+  ok = ok && gbp_spool_mkdir(dir);
+  gbp_spool_owner_t owner;
+  ok = ok && gbp_spool_own(sp, &owner);
+  if (!ok)
+  {
+    printf("spool: could not use `%s' and `%s': %s\n", sp->spoolDir, sp->outputDir, strerror(errno));
+    return false;
+  }
+
+  gbp_spool_pool_t pool;
+  memset(&pool, 0, sizeof(pool));
+  pool.sp       = sp;
+  pool.owner    = &owner;
+  pool.capacity = sp->workers * GBP_SPOOL_QUEUE_PER_WORKER;
+  pool.names    = (gbp_spool_name_t *)calloc(pool.capacity, sizeof(gbp_spool_name_t));
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.ready, NULL);
+  if ((pool.names == NULL) || (pipe(pool.wakeFd) != 0))
+  {
+    free(pool.names);
+    gbp_spool_releaseDir(owner.claimed, owner.claimedLock);
+    gbp_spool_releaseDir(owner.partial, owner.partialLock);
+    printf("spool: out of resources\n");
+    return false;
+  }
+  fcntl(pool.wakeFd[0], F_SETFL, O_NONBLOCK);
+  fcntl(pool.wakeFd[1], F_SETFL, O_NONBLOCK);
+
+  // Signals go to this thread only, so they interrupt poll() below
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = gbp_spool_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGUSR1, &sa, NULL);
+  sigset_t blocked;
+  sigset_t previous;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGINT);
+  sigaddset(&blocked, SIGTERM);
+  sigaddset(&blocked, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+  pthread_t *threads = (pthread_t *)calloc(sp->workers, sizeof(pthread_t));
+  int started = 0;
+  for (int i = 0; threads && (i < sp->workers); i++)
+    started += (pthread_create(&threads[i], NULL, gbp_spool_worker, &pool) == 0) ? 1 : 0;
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  struct pollfd fds[2];
+  int nfds = 0;
+  fds[nfds].fd     = pool.wakeFd[0];
+  fds[nfds].events = POLLIN;
+  nfds++;
+#ifdef __linux__
+  const int watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if ((watch >= 0) && (inotify_add_watch(watch, sp->spoolDir, IN_MOVED_TO | IN_CLOSE_WRITE) >= 0))
+  {
+    fds[nfds].fd     = watch;
+    fds[nfds].events = POLLIN;
+    nfds++;
+  }
+#endif
+
+  printf("spool: watching `%s', output `%s', %d workers\n", sp->spoolDir, sp->outputDir, started);
+  fflush(stdout);
+  const double start = gbp_spool_now();
+  while (!gbp_spool_stop && (started > 0))
+  {
+    const int waiting = gbp_spool_claim(&pool);
+    if (sp->drain)
+    {
+      pthread_mutex_lock(&pool.lock);
+      const bool idle = (waiting == 0) && (pool.count == 0) && (pool.busy == 0);
+      pthread_mutex_unlock(&pool.lock);
+      if (idle)
+        break;
+    }
+
+    if (poll(fds, nfds, GBP_SPOOL_POLL_MS) > 0)
+    {
+      uint8_t events[4096];
+      for (int i = 0; i < nfds; i++)
+        if (fds[i].revents & POLLIN)
+          while (read(fds[i].fd, events, sizeof(events)) > 0)
+            ;
+    }
+    if (gbp_spool_reportWanted)
+    {
+      gbp_spool_reportWanted = 0;
+      gbp_spool_report(&pool, gbp_spool_now() - start);
+    }
+  }
+
+  // Claimed but not started goes back to the spool, started is finished
+  pthread_mutex_lock(&pool.lock);
+  pool.closed = true;
+  while (pool.count > 0)
+  {
+    char from[GBP_SPOOL_PATH_MAX];
+    char to[GBP_SPOOL_PATH_MAX];
+    gbp_spool_path(from, owner.claimed, NULL, pool.names[pool.head]);
+    gbp_spool_path(to, sp->spoolDir, NULL, pool.names[pool.head]);
+    rename(from, to);
+    pool.head = (pool.head + 1) % pool.capacity;
+    pool.count--;
+  }
+  pthread_cond_broadcast(&pool.ready);
+  pthread_mutex_unlock(&pool.lock);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  sp->seconds = gbp_spool_now() - start;
+  gbp_spool_report(&pool, sp->seconds);
+
+#ifdef __linux__
+  if (watch >= 0)
+    close(watch);
+#endif
+  close(pool.wakeFd[0]);
+  close(pool.wakeFd[1]);
+  pthread_cond_destroy(&pool.ready);
+  pthread_mutex_destroy(&pool.lock);
+  gbp_spool_releaseDir(owner.claimed, owner.claimedLock);
+  gbp_spool_releaseDir(owner.partial, owner.partialLock);
+  free(threads);
+  free(pool.names);
+  return started > 0;
+}
@@ -0,0 +1,101 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Spool Service
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Decodes captures dropped into a spool directory, on a pool of workers
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Directories
+
+    SPOOL/NAME                  waiting
+    SPOOL/.claimed/OWNER/NAME   being decoded by service OWNER
+    OUTPUT/.partial/OWNER/NAME/ results being written
+    OUTPUT/STEM/                done: STEM0.bmp, STEM1.bmp, ..., STEM.gbphash, NAME
+    SPOOL/.failed/NAME          could not be decoded, reason in NAME.error
+
+  * STEM is NAME without its extension. If OUTPUT/STEM is taken, the results
+    go to OUTPUT/STEM-1, OUTPUT/STEM-2, ...
+  * Files starting with '.' are not claimed, so an upload should be written
+    as .NAME (or elsewhere on the same filesystem) then renamed to NAME
+  * SPOOL and OUTPUT must be on one filesystem, as every move is a rename()
+  * STEM.gbphash is the hash index of the pictures (see gbphashfind)
+
+  ## Claims
+
+  A capture is claimed by renaming it into the service's own directory in
+  .claimed, so any number of services can share a spool. It is always in
+  exactly one of the places above, and its results only appear in
+  OUTPUT/STEM once all are written (the partial directory is renamed into
+  place after the capture is moved into it).
+
+  OWNER is HOST.PID. Each service holds an flock() on OWNER/.lock in both
+  .claimed and .partial while it runs, and removes its directories on exit.
+  On start, a service recovers only the OWNER directories whose lock it can
+  take, as their service is gone (killed, or its machine restarted): their
+  captures go back to the spool and partial results are removed, so each
+  capture is decoded to exactly one output directory. Claims of services
+  that are still running are left alone. Services on several machines need
+  a filesystem with working flock() between them (local, or NFS with locks).
+
+  ## Service
+
+  The spool is scanned when it changes (inotify on Linux), when a worker
+  finishes, and every GBP_SPOOL_POLL_MS. Claims are bounded to
+  GBP_SPOOL_QUEUE_PER_WORKER per worker, the rest wait in the spool.
+  SIGINT or SIGTERM stop claiming, put claimed captures that were not
+  started back, and wait for the workers to finish. SIGUSR1 prints the
+  throughput report, which is also printed on exit.
+*******************************************************************************/
+#ifndef GBP_SPOOL_H
+#define GBP_SPOOL_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#define GBP_SPOOL_CLAIMED_DIR       ".claimed"
+#define GBP_SPOOL_FAILED_DIR        ".failed"
+#define GBP_SPOOL_PARTIAL_DIR       ".partial"
+#define GBP_SPOOL_LOCK_FILE         ".lock"
+#define GBP_SPOOL_OWNER_MAX         96    // HOST.PID
+#define GBP_SPOOL_QUEUE_PER_WORKER  2
+#define GBP_SPOOL_POLL_MS           1000
+#define GBP_SPOOL_NAME_MAX          255   // Longest capture name
+#define GBP_SPOOL_SUFFIX_MAX        100   // Most OUTPUT/STEM-N tried before failing
+
+typedef struct
+{
+  /* Settings */
+  const char *spoolDir;
+  const char *outputDir;
+  uint32_t palette[4];
+  int workers;
+  bool drain;  ///< Exit once the spool is empty and every claim is done
+
+  /* Totals */
+  uint32_t captures;  ///< Decoded, failed included
+  uint32_t failed;
+  uint32_t pictures;
+  uint64_t bytes;        ///< Capture file sizes
+  double decodeSeconds;  ///< Summed over workers
+  double seconds;        ///< Service running time
+} gbp_spool_t;
+
+bool gbp_spool_run(gbp_spool_t *sp);  ///< Until SIGINT or SIGTERM (or drained). False if the directories could not be used
+
+#endif
@@ -0,0 +1,94 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Blocking Queue
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Waits on a gbp_spsc queue without spinning (host threads)
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: The lock free gbp_spsc push/pop is tried first. A thread only sleeps,
+//           on the condition variable, while the queue is full (producer) or
+//           empty (consumer), so an idle stage (e.g. waiting on a live stream)
+//           uses no CPU. Every push and pop signals under the lock, so a wakeup
+//           between a failed attempt and the wait is never lost.
+#ifndef GBP_SPSC_WAIT_H
+#define GBP_SPSC_WAIT_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include <pthread.h>
+
+#include "gbp_spsc.h"
+
+typedef struct
+{
+  gbp_spsc_t queue;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;  ///< An item was pushed or popped
+} gbp_spsc_wait_t;
+
+static inline bool gbp_spsc_wait_init(gbp_spsc_wait_t *w, uint8_t *buffPtr, size_t itemSize, size_t capacity)
+{
+  if (!gbp_spsc_init(&w->queue, buffPtr, itemSize, capacity))
+    return false;
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->changed, NULL);
+  return true;
+}
+
+// Once neither side is using it
+static inline void gbp_spsc_wait_destroy(gbp_spsc_wait_t *w)
+{
+  pthread_cond_destroy(&w->changed);
+  pthread_mutex_destroy(&w->lock);
+}
+
+static inline void gbp_spsc_wait_signal(gbp_spsc_wait_t *w)
+{
+  pthread_mutex_lock(&w->lock);
+  pthread_cond_signal(&w->changed);
+  pthread_mutex_unlock(&w->lock);
+}
+
+// Producer only. Sleeps while the queue is full
+static inline void gbp_spsc_wait_push(gbp_spsc_wait_t *w, const void *item)
+{
+  if (!gbp_spsc_push(&w->queue, item))
+  {
+    pthread_mutex_lock(&w->lock);
+    while (!gbp_spsc_push(&w->queue, item))
+      pthread_cond_wait(&w->changed, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+  }
+  gbp_spsc_wait_signal(w);
+}
+
+// Consumer only. Sleeps while the queue is empty
+static inline void gbp_spsc_wait_pop(gbp_spsc_wait_t *w, void *item)
+{
+  if (!gbp_spsc_pop(&w->queue, item))
+  {
+    pthread_mutex_lock(&w->lock);
+    while (!gbp_spsc_pop(&w->queue, item))
+      pthread_cond_wait(&w->changed, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+  }
+  gbp_spsc_wait_signal(w);
+}
+
+#endif  // GBP_SPSC_WAIT_H
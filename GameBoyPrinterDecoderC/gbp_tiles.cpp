@@ -25,6 +25,7 @@
 #include <stdint.h> // uint8_t
 #include <stddef.h> // size_t
 #include <stdbool.h> // bool
+#include <string.h> // memcpy
 #include "gameboy_printer_protocol.h"
 #include "gbp_tiles.h"
 
@@ -65,6 +66,10 @@ static void gbp_tiles_toBuff(
 
 bool gbp_tiles_line_decoder(gbp_tile_t *gbp_tiles, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE])
 {
+    // Guard: More lines than a real printer can buffer without a print instruction. Drop the extra tiles
+    if (gbp_tiles->tileRowOffset >= GBP_TILES_PER_ROW)
+        return false;
+
     gbp_tiles_toBuff(
                         (uint8_t *)gbp_tiles->bmpLineBuffer,
                         GBP_TILE_PIXEL_HEIGHT * GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE,
@@ -132,3 +137,176 @@ void gbp_tiles_print(gbp_tile_t *gbp_tiles, uint8_t sheet, uint8_t linefeed, uin
 }
 
 
+/*******************************************************************************
+  Tile-major layout
+*******************************************************************************/
+
+bool gbp_tilemajor_add(gbp_tilemajor_t *gbp_tiles, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE])
+{
+    // Guard: Same limit as gbp_tiles_line_decoder()
+    if (gbp_tiles->tileCount >= (GBP_TILES_PER_ROW * GBP_TILES_PER_LINE))
+        return false;
+
+    memcpy(gbp_tiles->tiles[gbp_tiles->tileCount], tileBuff, GBP_TILE_SIZE_IN_BYTE);
+    gbp_tiles->tileCount++;
+
+    // True when a line of tiles is complete
+    return (gbp_tiles->tileCount % GBP_TILES_PER_LINE) == 0;
+}
+
+void gbp_tilemajor_reset(gbp_tilemajor_t *gbp_tiles)
+{
+    gbp_tiles->tileCount = 0;
+    gbp_tiles->tileRowOffsetHarmonised = 0;
+}
+
+void gbp_tilemajor_print(gbp_tilemajor_t *gbp_tiles, uint8_t pallet)
+{
+    // Lines received since the last print use this palette (See gbp_tiles_print())
+    const uint16_t lines = gbp_tilemajor_lines(gbp_tiles);
+    for (uint16_t line = gbp_tiles->tileRowOffsetHarmonised; line < lines; line++)
+        gbp_tiles->rowPallet[line] = pallet;
+    gbp_tiles->tileRowOffsetHarmonised = lines;
+}
+
+uint16_t gbp_tilemajor_lines(const gbp_tilemajor_t *gbp_tiles)
+{
+    return gbp_tiles->tileCount / GBP_TILES_PER_LINE;
+}
+
+static void gbp_tilemajor_buildLut(gbp_tilemajor_t *gbp_tiles, uint8_t pallet)
+{
+    /* Harmonise Pallete */
+    // Palette 0x00 has the same effect than palette 0xE4 (See gbp_tiles_print())
+    const uint8_t harmonisedPallet = (pallet == 0x00) ? 0xE4 : pallet;
+
+    // Index is [hi nibble][lo nibble] of one tile row half. Leftmost pixel is the top bit
+    for (int index = 0; index < 256; index++)
+    {
+        const uint8_t hiNib = (index >> 4) & 0x0F;
+        const uint8_t loNib = (index >> 0) & 0x0F;
+        uint8_t packed = 0;
+        for (int i = 0; i < GBP_TILE_2BIT_LINEPACK_IN_BYTE_COUNT; i++)
+        {
+            const uint8_t hiBit = (hiNib >> (3 - i)) & 1;
+            const uint8_t loBit = (loNib >> (3 - i)) & 1;
+            const uint8_t value = (uint8_t)((hiBit << 1) | loBit); // 0-3
+            const uint8_t harmonised = (harmonisedPallet >> (value * 2)) & 0b11;
+            packed |= harmonised << GBP_TILE_2BIT_LINEPACK_BITOFFSET(i);
+        }
+        gbp_tiles->lut[index] = packed;
+    }
+    gbp_tiles->lutPallet = pallet;
+    gbp_tiles->lutValid  = true;
+}
+
+void gbp_tilemajor_toRows(gbp_tilemajor_t *gbp_tiles, uint16_t line, uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B])
+{
+    if (line >= gbp_tilemajor_lines(gbp_tiles))
+        return;
+
+    // Lines not yet printed are raw tones, as in gbp_tile_t before gbp_tiles_print()
+    const uint8_t pallet = (line < gbp_tiles->tileRowOffsetHarmonised) ? gbp_tiles->rowPallet[line] : 0xE4;
+    if (!gbp_tiles->lutValid || (gbp_tiles->lutPallet != pallet))
+        gbp_tilemajor_buildLut(gbp_tiles, pallet);
+
+    const uint8_t *lut = gbp_tiles->lut;
+    const uint8_t (*tiles)[GBP_TILE_SIZE_IN_BYTE] = &gbp_tiles->tiles[line * GBP_TILES_PER_LINE];
+    for (int t = 0; t < GBP_TILES_PER_LINE; t++)
+    {
+        const uint8_t *tile = tiles[t];
+        const int offset = t * GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH);
+        for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
+        {
+            const uint8_t loByte = tile[j*2    ];
+            const uint8_t hiByte = tile[j*2 + 1];
+            rows[j][offset + 0] = lut[(hiByte & 0xF0) | (loByte >> 4)];
+            rows[j][offset + 1] = lut[((hiByte & 0x0F) << 4) | (loByte & 0x0F)];
+        }
+    }
+}
+
+
+/*******************************************************************************
+  Strip layout
+*******************************************************************************/
+
+void gbp_tiles_strip_init(gbp_tiles_strip_t *strip, gbp_tiles_strip_sink_t sink, void *sinkCtx)
+{
+    strip->sink    = sink;
+    strip->sinkCtx = sinkCtx;
+    gbp_tiles_strip_reset(strip);
+}
+
+void gbp_tiles_strip_reset(gbp_tiles_strip_t *strip)
+{
+    strip->tileLineOffset  = 0;
+    strip->linesSincePrint = 0;
+}
+
+bool gbp_tiles_strip_addTile(gbp_tiles_strip_t *strip, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE])
+{
+    // Guard: Same limit as gbp_tiles_line_decoder()
+    if (strip->linesSincePrint >= GBP_TILES_PER_ROW)
+        return false;
+
+    // Each tile fills two bytes in each of the 8 rows, raw tones
+    const int offset = strip->tileLineOffset * GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH);
+    for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
+    {
+        const uint8_t loByte = tileBuff[j*2    ];
+        const uint8_t hiByte = tileBuff[j*2 + 1];
+        uint8_t packed[GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH)] = {0};
+        for (int i = 0; i < GBP_TILE_PIXEL_WIDTH; i++)
+        {
+            const uint8_t hiBit = (uint8_t)((hiByte >> (7 - i)) & 1);
+            const uint8_t loBit = (uint8_t)((loByte >> (7 - i)) & 1);
+            const uint8_t value = (hiBit << 1) | loBit;
+            packed[GBP_TILE_2BIT_LINEPACK_INDEX(i)] |= value << GBP_TILE_2BIT_LINEPACK_BITOFFSET(i);
+        }
+        strip->rows[j][offset + 0] = packed[0];
+        strip->rows[j][offset + 1] = packed[1];
+    }
+
+    strip->tileLineOffset++;
+    if (strip->tileLineOffset < GBP_TILES_PER_LINE)
+        return false;
+
+    // Line complete, rows are only valid until the next tile
+    strip->tileLineOffset = 0;
+    strip->linesSincePrint++;
+    if (strip->sink)
+        strip->sink(strip->sinkCtx, strip->rows);
+    return true;
+}
+
+void gbp_tiles_strip_print(gbp_tiles_strip_t *strip)
+{
+    gbp_tiles_strip_reset(strip); // Partial line is dropped, as gbp_tiles_reset() after a print
+}
+
+void gbp_tiles_strip_harmonise(uint8_t lines[][GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B], uint16_t lineCount, uint8_t pallet)
+{
+    /* Harmonise Pallete */
+    // Palette 0x00 has the same effect than palette 0xE4 (See gbp_tiles_print())
+    pallet = (pallet == 0x00) ? 0xE4 : pallet;
+    if (pallet == 0xE4)
+        return; // Each tone maps to itself
+
+    // Four packed pixels at a time
+    uint8_t lut[256];
+    for (int packed = 0; packed < 256; packed++)
+    {
+        uint8_t harmonised = 0;
+        for (int i = 0; i < GBP_TILE_2BIT_LINEPACK_IN_BYTE_COUNT; i++)
+        {
+            const uint8_t pixel = (packed >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(i)) & 0b11;
+            harmonised |= ((pallet >> (pixel * 2)) & 0b11) << GBP_TILE_2BIT_LINEPACK_BITOFFSET(i);
+        }
+        lut[packed] = harmonised;
+    }
+    for (uint16_t line = 0; line < lineCount; line++)
+        for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
+            for (int i = 0; i < GBP_TILEMAJOR_LINE_ROWSIZE_B; i++)
+                lines[line][j][i] = lut[lines[line][j][i]];
+}
@@ -22,6 +22,8 @@
  *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifndef GBP_TILES_H
+#define GBP_TILES_H
 #include <stdint.h> // uint8_t
 #include <stddef.h> // size_t
 #include <stdbool.h> // bool
@@ -69,4 +71,72 @@ typedef struct
 
 bool gbp_tiles_line_decoder(gbp_tile_t *gbp_tiles, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE]);
 void gbp_tiles_reset(gbp_tile_t *gbp_tiles);
-void gbp_tiles_print(gbp_tile_t *gbp_tiles, uint8_t sheet, uint8_t linefeed, uint8_t pallet, uint8_t density);
\ No newline at end of file
+void gbp_tiles_print(gbp_tile_t *gbp_tiles, uint8_t sheet, uint8_t linefeed, uint8_t pallet, uint8_t density);
+
+/*
+    Tile-major layout (alternative to gbp_tile_t)
+
+    gbp_tile_t decodes each tile into 8 rows of bmpLineBuffer as it arrives (8 strided
+    stores 40 bytes apart), then gbp_tiles_print() walks every pixel again to harmonise it.
+
+    gbp_tilemajor_t instead keeps tiles as received (16 contiguous bytes each) and converts
+    one line of 20 tiles at a time (320 bytes, stays in L1) to packed rows when it is
+    output. The conversion maps the palette in the same step with a nibble lookup table,
+    so each pixel is written once instead of three times.
+    Output is byte identical to gbp_tile_t rows after gbp_tiles_print().
+*/
+#define GBP_TILEMAJOR_LINE_ROWSIZE_B GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE) ///< 40
+
+typedef struct
+{
+    uint16_t tileCount;                         ///< Tiles stored since reset
+    uint16_t tileRowOffsetHarmonised;           ///< Lines that have been assigned a palette
+    uint8_t rowPallet[GBP_TILES_PER_ROW];       ///< Palette of each line
+
+    // Palette to packed byte lookup for a pair of tile nibbles (4 pixels)
+    bool lutValid;
+    uint8_t lutPallet;
+    uint8_t lut[256];
+
+    uint8_t tiles[GBP_TILES_PER_ROW * GBP_TILES_PER_LINE][GBP_TILE_SIZE_IN_BYTE];
+} gbp_tilemajor_t;
+
+bool gbp_tilemajor_add(gbp_tilemajor_t *gbp_tiles, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE]);
+void gbp_tilemajor_reset(gbp_tilemajor_t *gbp_tiles);
+void gbp_tilemajor_print(gbp_tilemajor_t *gbp_tiles, uint8_t pallet);
+uint16_t gbp_tilemajor_lines(const gbp_tilemajor_t *gbp_tiles);
+void gbp_tilemajor_toRows(gbp_tilemajor_t *gbp_tiles, uint16_t line, uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B]);
+
+/*
+    Strip layout (alternative to gbp_tile_t, for little RAM)
+
+    gbp_tiles_strip_t holds one line of 20 tiles as packed rows (320 bytes instead of the
+    ~8KB bmpLineBuffer) and hands each line to a sink as soon as its last tile arrives.
+    Same strip decoder as gbp_tiles_strip_t in GameBoyPrinterEmulator, with a sink.
+
+    The palette is only sent in the print instruction after the lines, so rows hold the
+    raw tones. Whoever consumes the lines keeps them until the print and harmonises them
+    with gbp_tiles_strip_harmonise(), which gives the same rows as gbp_tiles_print().
+    Lines past GBP_TILES_PER_ROW between prints are dropped, as gbp_tiles_line_decoder(),
+    so at most GBP_TILES_PER_ROW lines are waiting for a print.
+*/
+typedef void (*gbp_tiles_strip_sink_t)(void *ctx, const uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B]);
+
+typedef struct
+{
+    uint8_t tileLineOffset;
+    uint16_t linesSincePrint;
+
+    gbp_tiles_strip_sink_t sink;
+    void *sinkCtx;
+
+    uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B];
+} gbp_tiles_strip_t;
+
+void gbp_tiles_strip_init(gbp_tiles_strip_t *strip, gbp_tiles_strip_sink_t sink, void *sinkCtx);
+void gbp_tiles_strip_reset(gbp_tiles_strip_t *strip);
+bool gbp_tiles_strip_addTile(gbp_tiles_strip_t *strip, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE]);  ///< True if a line was sent to the sink
+void gbp_tiles_strip_print(gbp_tiles_strip_t *strip);  ///< Lines since the last print are printed, partial line is dropped
+void gbp_tiles_strip_harmonise(uint8_t lines[][GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B], uint16_t lineCount, uint8_t pallet);  ///< Raw tones of the print's lines to its palette
+
+#endif
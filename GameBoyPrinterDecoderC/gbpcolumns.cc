@@ -0,0 +1,312 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Packet Columns Export
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Converts captures to a columnar packet table (gbp_columns.h), and summarises one
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_input.h"
+#include "gbp_hexstream.h"
+#include "gbp_log.h"
+#include "gbp_columns.h"
+
+/* The official name of this program (e.g., no 'g' prefix).  */
+#define PROGRAM_NAME "gbpcolumns"
+
+// One capture's packets to rows. Same parsing as gpbdecoder
+typedef struct
+{
+  gbp_columns_writer_t *w;
+  gbp_columns_row_t row;  ///< Packet being received
+  gbp_input_t input;
+  uint8_t chunk[GBP_INPUT_BLOCK_SIZE];
+
+  gbp_hexstream_t hex;
+
+  /* Packets */
+  gbp_pkt_t pkt;
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktbuffSize;
+  gbp_pkt_tileAcc_t tileAcc;
+  uint32_t byteOffset;
+  uint16_t checksum;
+  uint16_t checksumCalc;
+} gbpcolumns_capture_t;
+
+static gbpcolumns_capture_t capture;
+
+void gbpcolumns_help(void)
+{
+  printf (
+      "Usage: gbpcolumns -o OUTPUT CAPTURE...\n"
+      "  or:  gbpcolumns COLUMNS\n"
+      "Converts captures to one columnar packet table, or summarises a table.\n"
+      "\n"
+      "Each packet is a row of job (capture), offset, command, compression, length,\n"
+      "status, checksum ok and tiles. Each column is one fixed width array (see\n"
+      "gbp_columns.h), capture names are kept apart in a dictionary.\n"
+      "gzip and zstd compressed captures are detected (if built with zlib and libzstd).\n"
+      "\n"
+      "-o, --output=OUTPUT  columns file to write\n"
+      "-h, --help           display this help and exit\n"
+      "\n"
+      "Examples:\n"
+      "  gbpcolumns -o captures.gbpcol ./captures/*.txt      one table of every session\n"
+      "  gbpcolumns captures.gbpcol                           command mix, status and compression\n"
+    );
+}
+
+/*******************************************************************************
+ * Capture To Rows
+*******************************************************************************/
+
+// Offset and checksum of the packet being received (See gbpdecoder_trackByte())
+static void gbpcolumns_trackByte(gbpcolumns_capture_t *cap, const uint8_t byte)
+{
+  const uint16_t i = cap->pkt.pktByteIndex;
+  const uint32_t payloadEnd = 6 + (uint32_t)cap->pkt.dataLength;
+  if (i == 0)
+  {
+    cap->row.offset = cap->byteOffset;
+    cap->row.tiles  = 0;
+  }
+  else if (i == 2)
+    cap->checksumCalc = byte;
+  else if ((i > 2) && (i < payloadEnd))
+    cap->checksumCalc += byte;
+  else if (i == payloadEnd)
+    cap->checksum = byte;
+  else if (i == payloadEnd + 1)
+    cap->checksum |= (uint16_t)byte << 8;
+  cap->byteOffset++;
+}
+
+static void gbpcolumns_gotByte(gbpcolumns_capture_t *cap, const uint8_t byte)
+{
+  gbpcolumns_trackByte(cap, byte);
+  if (!gbp_pkt_processByte(&cap->pkt, byte, cap->pktbuff, &cap->pktbuffSize, sizeof(cap->pktbuff)))
+    return;
+
+  if (cap->pkt.received == GBP_REC_GOT_PACKET)
+  {
+    // Streamed packets are added at their end, once the checksum is in
+    if (cap->pkt.dataLength >= sizeof(cap->pktbuff))
+      return;
+  }
+  else
+  {
+    while (gbp_pkt_tileNext(&cap->pkt, cap->pktbuff, cap->pktbuffSize, &cap->tileAcc) != NULL)
+      cap->row.tiles++;
+    if (cap->pkt.received != GBP_REC_GOT_PACKET_END)
+      return;
+  }
+
+  cap->row.command     = cap->pkt.command;
+  cap->row.compression = cap->pkt.compression;
+  cap->row.length      = cap->pkt.dataLength;
+  cap->row.status      = cap->pkt.status;
+  cap->row.checksumOk  = (cap->checksum == cap->checksumCalc);
+  gbp_columns_add(cap->w, &cap->row);
+}
+
+static void gbpcolumns_hexByte(void *ctx, uint8_t byte)
+{
+  gbpcolumns_gotByte((gbpcolumns_capture_t *)ctx, byte);
+}
+
+// Returns NULL, or why the capture could not be read to its end
+static const char *gbpcolumns_addCapture(gbpcolumns_capture_t *cap, const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return "file not found";
+
+  cap->row.job     = gbp_columns_addJob(cap->w, path);
+  cap->pktbuffSize = 0;
+  cap->byteOffset  = 0;
+  memset(&cap->tileAcc, 0, sizeof(cap->tileAcc));
+  gbp_pkt_init(&cap->pkt);
+  gbp_hexstream_init(&cap->hex, gbpcolumns_hexByte, cap, true);
+
+  const char *error = NULL;
+  if (gbp_input_open(&cap->input, f))
+  {
+    size_t size;
+    while ((size = gbp_input_read(&cap->input, cap->chunk, sizeof(cap->chunk))) > 0)
+      gbp_hexstream_parse(&cap->hex, cap->chunk, size);
+    gbp_hexstream_end(&cap->hex);
+  }
+  if (!gbp_input_close(&cap->input))
+    error = cap->input.error;
+  fclose(f);
+  return error;
+}
+
+/*******************************************************************************
+ * Summary
+*******************************************************************************/
+
+static void gbpcolumns_summary(const gbp_columns_t *c)
+{
+  uint8_t *mask = (uint8_t *)malloc(c->rows ? c->rows : 1);
+  uint32_t hist[256] = {0};
+
+  gbp_columns_maskEqU8(c->checksumOk, c->rows, 0, mask);
+  printf("// %u jobs, %u packets, %lu checksum errors\n", (unsigned)c->jobs, (unsigned)c->rows, (unsigned long)gbp_columns_maskCount(mask, c->rows));
+
+  printf("// command | packets\n");
+  gbp_columns_histogramU8(c->command, c->rows, NULL, hist);
+  for (int v = 0; v < 256; v++)
+    if (hist[v])
+      printf("%s %u\n", gbp_log_commandToStr((uint8_t)v), (unsigned)hist[v]);
+
+  printf("// status | packets\n");
+  memset(hist, 0, sizeof(hist));
+  gbp_columns_histogramU8(c->status, c->rows, NULL, hist);
+  for (int v = 0; v < 256; v++)
+    if (hist[v])
+      printf("%02X %u\n", v, (unsigned)hist[v]);
+
+  // Busy runs: consecutive busy replies within a job
+  uint32_t runs = 0;
+  uint32_t runLongest = 0;
+  uint32_t runTotal = 0;
+  uint32_t run = 0;
+  for (uint32_t r = 0; r <= c->rows; r++)
+  {
+    const bool busy = (r < c->rows) && (c->status[r] & GBP_STATUS_MASK_BUSY);
+    if (run && (!busy || (c->job[r] != c->job[r - 1])))
+    {
+      runs++;
+      runTotal += run;
+      runLongest = (run > runLongest) ? run : runLongest;
+      run = 0;
+    }
+    run += busy ? 1 : 0;
+  }
+  printf("// busy | runs: %u, mean: %.1f, longest: %u packets\n", (unsigned)runs, runs ? ((double)runTotal / runs) : 0.0, (unsigned)runLongest);
+
+  // Compression, of data packets that decoded
+  for (int compression = 0; compression <= 1; compression++)
+  {
+    gbp_columns_maskEqU8(c->command, c->rows, GBP_COMMAND_DATA, mask);
+    gbp_columns_maskAndU8(c->checksumOk, c->rows, mask);
+    gbp_columns_maskAndEqU8(c->compression, c->rows, (uint8_t)compression, mask);
+    const size_t packets = gbp_columns_maskCount(mask, c->rows);
+    const uint64_t sent  = gbp_columns_maskSumU16(c->length, c->rows, mask);
+    const uint64_t raw   = gbp_columns_maskSumU16(c->tiles, c->rows, mask) * GBP_TILE_SIZE_IN_BYTE;
+    printf("// data %s | packets: %lu, bytes sent: %llu, tile bytes: %llu, ratio: %.3f\n", compression ? "compressed" : "uncompressed",
+           (unsigned long)packets, (unsigned long long)sent, (unsigned long long)raw, raw ? ((double)sent / raw) : 0.0);
+  }
+  free(mask);
+}
+
+int
+main (int argc, char **argv)
+{
+  int c;
+  const char *outputFilename = NULL;
+  static struct option const long_options[] =
+  {
+    {"output", required_argument, NULL, 'o'},
+    {"help",   no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((c = getopt_long (argc, argv, "o:h", long_options, NULL))
+         != -1)
+  {
+    switch (c)
+    {
+        case 'o':
+          outputFilename = optarg;
+          break;
+
+        case 'h':
+        default:
+          gbpcolumns_help();
+          return (c == 'h') ? 0 : 1;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    gbpcolumns_help();
+    return 1;
+  }
+
+  if (outputFilename == NULL)
+  {
+    FILE *f = fopen(argv[optind], "rb");
+    if (f == NULL)
+    {
+      fprintf(stderr, "file not found\n");
+      return 1;
+    }
+    gbp_columns_t columns;
+    const bool loaded = gbp_columns_load(&columns, f);
+    fclose(f);
+    if (!loaded)
+    {
+      fprintf(stderr, "`%s': %s\n", argv[optind], columns.error);
+      return 1;
+    }
+    gbpcolumns_summary(&columns);
+    gbp_columns_free(&columns);
+    return 0;
+  }
+
+  gbp_columns_writer_t w;
+  memset(&w, 0, sizeof(w));
+  capture.w = &w;
+  int failed = 0;
+  for (int a = optind; a < argc; a++)
+  {
+    const char *error = gbpcolumns_addCapture(&capture, argv[a]);
+    if (error)
+    {
+      fprintf(stderr, "`%s': %s\n", argv[a], error);
+      failed++;
+    }
+  }
+
+  FILE *f = fopen(outputFilename, "wb");
+  const bool written = f && gbp_columns_write(&w, f);
+  if (f)
+    fclose(f);
+  if (!written)
+  {
+    fprintf(stderr, "could not write `%s'\n", outputFilename);
+    gbp_columns_writerFree(&w);
+    return 1;
+  }
+  printf("%u packets from %u captures to `%s'\n", (unsigned)w.rows, (unsigned)w.jobs, outputFilename);
+  gbp_columns_writerFree(&w);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Similar Picture Search
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Hamming distance search over a gpbdecoder --hash-index file
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Hash Index
+
+  One line per picture, appended by each gpbdecoder run:
+
+    0123456789ABCDEF ./captures/session0.bmp
+
+  * Hash is gbp_phash.h, 16 hex digits. The rest of the line is the name
+  * Lines that do not start with a hash are skipped (e.g. comments)
+
+  ## Search
+
+  Hashes are held in one array apart from the names, so a query is a linear
+  scan of 8 bytes per picture with an xor and a popcount each.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "gbp_phash.h"
+
+/* The official name of this program (e.g., no 'g' prefix).  */
+#define PROGRAM_NAME "gbphashfind"
+
+#define GBPHASHFIND_DISTANCE_DEFAULT 10
+#define GBPHASHFIND_LINE_MAX         1024
+
+typedef struct
+{
+  size_t count;
+  size_t max;
+  uint64_t *hashes;
+  char **names;
+} gbphashfind_index_t;
+
+typedef struct
+{
+  int distance;
+  size_t entry;
+} gbphashfind_match_t;
+
+static int maxDistance = GBPHASHFIND_DISTANCE_DEFAULT;
+
+void gbphashfind_help(void)
+{
+  printf (
+      "Usage: gbphashfind [OPTION]... INDEX [QUERY]...\n"
+      "Finds similar pictures in a hash index (gpbdecoder --hash-index=INDEX)\n"
+      "\n"
+      "QUERY is a 16 digit hex hash or the name of a picture in the index.\n"
+      "Matches are listed as `DISTANCE HASH NAME', closest first.\n"
+      "With no QUERY, list every similar pair as `DISTANCE NAME NAME'.\n"
+      "\n"
+      "-d, --distance=N     most bits that may differ (default %d, of 64)\n"
+      "-h, --help           display this help and exit\n"
+      "\n"
+      "Examples:\n"
+      "  gbphashfind ./test/test.gbphash ./test/test0.bmp        pictures like test0.bmp\n"
+      "  gbphashfind -d 4 captures.gbphash                      near duplicates in a collection\n",
+      GBPHASHFIND_DISTANCE_DEFAULT
+    );
+}
+
+/*******************************************************************************
+ * Index
+*******************************************************************************/
+
+// Parses `HASH NAME`, false if the line does not start with a hash
+static bool gbphashfind_parseLine(char *line, uint64_t *hash, char **name)
+{
+  char *end = NULL;
+  *hash = strtoull(line, &end, 16);
+  if ((end != &line[16]) || (*end != ' '))
+    return false;
+  *name = end + 1;
+  (*name)[strcspn(*name, "\r\n")] = '\0';
+  return true;
+}
+
+static bool gbphashfind_load(gbphashfind_index_t *idx, FILE *f)
+{
+  char line[GBPHASHFIND_LINE_MAX];
+  while (fgets(line, sizeof(line), f))
+  {
+    uint64_t hash;
+    char *name;
+    if (!gbphashfind_parseLine(line, &hash, &name))
+      continue;
+    if (idx->count == idx->max)
+    {
+      idx->max    = idx->max ? (idx->max * 2) : 1024;
+      idx->hashes = (uint64_t *)realloc(idx->hashes, idx->max * sizeof(idx->hashes[0]));
+      idx->names  = (char **)realloc(idx->names, idx->max * sizeof(idx->names[0]));
+      if (!idx->hashes || !idx->names)
+        return false;
+    }
+    idx->hashes[idx->count] = hash;
+    idx->names[idx->count]  = strdup(name);
+    idx->count++;
+  }
+  return true;
+}
+
+static void gbphashfind_free(gbphashfind_index_t *idx)
+{
+  for (size_t i = 0; i < idx->count; i++)
+    free(idx->names[i]);
+  free(idx->names);
+  free(idx->hashes);
+}
+
+/*******************************************************************************
+ * Search
+*******************************************************************************/
+
+static int gbphashfind_matchCompare(const void *a, const void *b)
+{
+  const gbphashfind_match_t *ma = (const gbphashfind_match_t *)a;
+  const gbphashfind_match_t *mb = (const gbphashfind_match_t *)b;
+  if (ma->distance != mb->distance)
+    return ma->distance - mb->distance;
+  return (ma->entry < mb->entry) ? -1 : (ma->entry > mb->entry);
+}
+
+// Hash of a query, from the index if it is a name there. Skip is that entry, so it is not its own match
+static bool gbphashfind_queryHash(const gbphashfind_index_t *idx, const char *query, uint64_t *hash, size_t *skip)
+{
+  *skip = idx->count;
+  for (size_t i = 0; i < idx->count; i++)
+  {
+    if (strcmp(idx->names[i], query) == 0)
+    {
+      *hash = idx->hashes[i];
+      *skip = i;
+      return true;
+    }
+  }
+  char *end = NULL;
+  *hash = strtoull(query, &end, 16);
+  return (end == &query[16]) && (*end == '\0');
+}
+
+static void gbphashfind_query(const gbphashfind_index_t *idx, uint64_t hash, size_t skip, gbphashfind_match_t *matches)
+{
+  size_t found = 0;
+  for (size_t i = 0; i < idx->count; i++)
+  {
+    const int d = gbp_phash_distance(hash, idx->hashes[i]);
+    if ((d <= maxDistance) && (i != skip))
+    {
+      matches[found].distance = d;
+      matches[found].entry    = i;
+      found++;
+    }
+  }
+  qsort(matches, found, sizeof(matches[0]), gbphashfind_matchCompare);
+  for (size_t i = 0; i < found; i++)
+    printf("%d %016llX %s\n", matches[i].distance, (unsigned long long)idx->hashes[matches[i].entry], idx->names[matches[i].entry]);
+}
+
+// Every pair once, each entry against the ones after it
+static void gbphashfind_pairs(const gbphashfind_index_t *idx)
+{
+  for (size_t i = 0; i < idx->count; i++)
+  {
+    const uint64_t hash = idx->hashes[i];
+    for (size_t j = i + 1; j < idx->count; j++)
+    {
+      const int d = gbp_phash_distance(hash, idx->hashes[j]);
+      if (d <= maxDistance)
+        printf("%d %s %s\n", d, idx->names[i], idx->names[j]);
+    }
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  int c;
+  static struct option const long_options[] =
+  {
+    {"distance", required_argument, NULL, 'd'},
+    {"help",     no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((c = getopt_long (argc, argv, "d:h", long_options, NULL))
+         != -1)
+  {
+    switch (c)
+    {
+        case 'd':
+          maxDistance = atoi(optarg);
+          break;
+
+        case 'h':
+        default:
+          gbphashfind_help();
+          return (c == 'h') ? 0 : 1;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    gbphashfind_help();
+    return 1;
+  }
+
+  FILE *f = fopen(argv[optind], "r");
+  if (f == NULL)
+  {
+    fprintf(stderr, "file not found\n");
+    return 1;
+  }
+  gbphashfind_index_t idx = {0};
+  const bool loaded = gbphashfind_load(&idx, f);
+  fclose(f);
+  if (!loaded)
+  {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  int ret = 0;
+  if ((optind + 1) >= argc)
+  {
+    gbphashfind_pairs(&idx);
+  }
+  else
+  {
+    gbphashfind_match_t *matches = (gbphashfind_match_t *)malloc((idx.count + 1) * sizeof(matches[0]));
+    for (int q = optind + 1; q < argc; q++)
+    {
+      uint64_t hash;
+      size_t skip;
+      if (!gbphashfind_queryHash(&idx, argv[q], &hash, &skip))
+      {
+        fprintf(stderr, "`%s' is not a hash or a name in the index\n", argv[q]);
+        ret = 1;
+        continue;
+      }
+      if ((argc - optind) > 2)
+        printf("// %s\n", argv[q]);
+      gbphashfind_query(&idx, hash, skip, matches);
+    }
+    free(matches);
+  }
+
+  gbphashfind_free(&idx);
+  return ret;
+}
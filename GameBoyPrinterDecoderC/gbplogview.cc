@@ -0,0 +1,110 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Decoder Event Log Viewer
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Renders a gpbdecoder --log file as text or JSONL
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+#include "gbp_log.h"
+
+/* The official name of this program (e.g., no 'g' prefix).  */
+#define PROGRAM_NAME "gbplogview"
+
+static bool json_flag = false;
+
+void gbplogview_help(void)
+{
+  printf (
+      "Usage: gbplogview [OPTION]... [LOGFILE]\n"
+      "Renders a gpbdecoder event log (gpbdecoder --log=LOGFILE)\n"
+      "\n"
+      "With no LOGFILE, read standard input.\n"
+      "\n"
+      "-j, --jsonl          one JSON object per record\n"
+      "-h, --help           display this help and exit\n"
+      "\n"
+      "Examples:\n"
+      "  gbplogview ./test/test.gbplog                          same text as gpbdecoder -v\n"
+      "  gbplogview --jsonl ./test/test.gbplog > events.jsonl\n"
+    );
+}
+
+int
+main (int argc, char **argv)
+{
+  int c;
+  static struct option const long_options[] =
+  {
+    {"jsonl",   no_argument,       NULL, 'j'},
+    {"help",    no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((c = getopt_long (argc, argv, "jh", long_options, NULL))
+         != -1)
+  {
+    switch (c)
+    {
+        case 'j':
+          json_flag = true;
+          break;
+
+        case 'h':
+        default:
+          gbplogview_help();
+          return (c == 'h') ? 0 : 1;
+    }
+  }
+
+  FILE *f = stdin;
+  if (optind < argc)
+  {
+    f = fopen(argv[optind], "rb");
+    if (f == NULL)
+    {
+      fprintf(stderr, "file not found\n");
+      return 1;
+    }
+  }
+
+  if (!gbp_log_readHeader(f))
+  {
+    fprintf(stderr, "not a gpbdecoder log (or a newer version)\n");
+    return 1;
+  }
+
+  gbp_log_record_t rec;
+  while (gbp_log_read(f, &rec))
+  {
+    if (json_flag)
+      gbp_log_printJson(stdout, &rec);
+    else
+      gbp_log_printText(stdout, &rec);
+  }
+
+  if (f != stdin)
+    fclose(f);
+  return 0;
+}
@@ -0,0 +1,361 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Slicer
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Splits a capture into one capture per print job, without decoding
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Jobs
+
+  A job is one picture: everything up to and including a print instruction
+  that cuts the paper (lower margin not zero, as gpbdecoder), then the
+  inquiries while it prints. The next job starts at the first INIT after the
+  cut. Job N decodes to the picture gpbdecoder names N (e.g. test3.bmp).
+
+  ## Slices
+
+  Each job is copied from the capture text as is (comments included), so a
+  slice is a capture in the original format. Text is split on line ends:
+
+  * The rest of the line a packet (or `// INQY` summary) ends on belongs to
+    that packet's job
+  * Lines after it (e.g. `// 12 : INIT`) are held until the next packet shows
+    which job they lead into
+  * Held text is capped at GBPSLICE_HELD_MAX. Past that it goes to the
+    current job
+
+  Packets are only framed (gbp_pkt_processByte()). Nothing is decompressed or
+  decoded, so slicing runs at hex parse speed.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_input.h"
+#include "gbp_hexstream.h"
+
+/* The official name of this program (e.g., no 'g' prefix).  */
+#define PROGRAM_NAME "gbpslice"
+
+#define GBPSLICE_HELD_MAX   (64 * 1024)   ///< Text between jobs held before it is given to the current job
+#define GBPSLICE_WRITE_BUFF (1024 * 1024)
+#define GBPSLICE_NAME_MAX   255
+
+typedef struct
+{
+  /* Settings */
+  const char *prefix;  ///< Slices are named prefix%X.txt
+  uint32_t first;      ///< Jobs to write
+  uint32_t last;
+  bool list;           ///< List jobs, write nothing
+
+  gbp_hexstream_t hex;
+
+  /* Packets */
+  gbp_pkt_t pkt;
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktbuffSize;
+  bool lineOwned;  ///< A packet ended on this line, so the line is its job's
+  bool cut;        ///< Current job has printed its cut, the next INIT starts a new job
+
+  /* Current job */
+  uint32_t job;
+  uint64_t jobOffset;  ///< Text offset of the job's first byte
+  uint64_t jobSize;
+  uint32_t jobPackets;
+  uint32_t jobPrints;
+  FILE *out;
+  char *outBuff;
+  bool writeError;
+
+  /* Text not yet given to a job */
+  uint64_t textOffset;  ///< Of the next character
+  size_t heldSize;
+  char held[GBPSLICE_HELD_MAX];
+} gbpslice_t;
+
+static gbpslice_t slice;
+
+void gbpslice_help(void)
+{
+  printf (
+      "Usage: gbpslice [OPTION]... CAPTURE\n"
+      "Splits a capture into one capture per print job, in the original hex text\n"
+      "format, without decoding. A job ends at a print instruction that cuts the\n"
+      "paper, and the inquiries after it, so job N is gpbdecoder's picture N.\n"
+      "gzip and zstd compressed captures are detected (if built with zlib and libzstd).\n"
+      "\n"
+      "-o, --output=PREFIX  slices are named PREFIX0.txt, PREFIX1.txt, ...\n"
+      "                     (default CAPTURE without its extension then `_job')\n"
+      "-j, --jobs=N[-M]     only write job N (to M). Numbers are hex, as in the names\n"
+      "-l, --list           list each job's offset, size, packets and prints\n"
+      "-h, --help           display this help and exit\n"
+      "\n"
+      "Examples:\n"
+      "  gbpslice -l session.txt                          jobs in a session\n"
+      "  gbpslice -j 3 -o ./bug session.txt               picture 3 alone as ./bug3.txt\n"
+    );
+}
+
+/*******************************************************************************
+ * Jobs
+*******************************************************************************/
+
+static bool gbpslice_selected(const gbpslice_t *s)
+{
+  return (s->first <= s->job) && (s->job <= s->last);
+}
+
+static void gbpslice_write(gbpslice_t *s, const char *text, size_t size)
+{
+  if (size == 0)
+    return;
+  if (s->jobSize == 0)
+    s->jobOffset = s->textOffset - size; // Text is always the latest read
+  s->jobSize += size;
+
+  if (s->list || !gbpslice_selected(s) || s->writeError)
+    return;
+  if (s->out == NULL)
+  {
+    char name[GBPSLICE_NAME_MAX + 16];
+    snprintf(name, sizeof(name), "%s%X.txt", s->prefix, (unsigned)s->job);
+    s->out = fopen(name, "wb");
+    if (s->out == NULL)
+    {
+      fprintf(stderr, "could not write `%s'\n", name);
+      s->writeError = true;
+      return;
+    }
+    setvbuf(s->out, s->outBuff, _IOFBF, GBPSLICE_WRITE_BUFF);
+  }
+  s->writeError |= fwrite(text, 1, size, s->out) != size;
+}
+
+// Held text goes to the current job
+static void gbpslice_giveHeld(gbpslice_t *s)
+{
+  const size_t size = s->heldSize;
+  s->heldSize = 0;
+  gbpslice_write(s, s->held, size);
+}
+
+static void gbpslice_endJob(gbpslice_t *s)
+{
+  if (s->list && s->jobSize)
+    printf("%X offset: %llu, size: %llu, packets: %u, prints: %u\n", (unsigned)s->job,
+           (unsigned long long)s->jobOffset, (unsigned long long)s->jobSize, (unsigned)s->jobPackets, (unsigned)s->jobPrints);
+  if (s->out)
+  {
+    s->writeError |= fclose(s->out) != 0;
+    s->out = NULL;
+  }
+  s->job++;
+  s->jobSize    = 0;
+  s->jobPackets = 0;
+  s->jobPrints  = 0;
+  s->cut        = false;
+}
+
+/*******************************************************************************
+ * Capture Text
+*******************************************************************************/
+
+static void gbpslice_gotByte(gbpslice_t *s, const uint8_t byte)
+{
+  // Command byte of an INIT after a cut: held text leads into the next job
+  if ((s->pkt.pktByteIndex == 2) && (byte == GBP_COMMAND_INIT) && s->cut)
+    gbpslice_endJob(s);
+
+  if (!gbp_pkt_processByte(&s->pkt, byte, s->pktbuff, &s->pktbuffSize, sizeof(s->pktbuff)))
+    return;
+
+  // Only whole packets. Streamed payload is not needed
+  const bool streamed = s->pkt.dataLength >= sizeof(s->pktbuff);
+  if ((s->pkt.received == GBP_REC_GOT_PACKET) ? streamed : (s->pkt.received != GBP_REC_GOT_PACKET_END))
+    return;
+
+  s->jobPackets++;
+  s->lineOwned = true;
+  if ((s->pkt.command == GBP_COMMAND_PRINT) && !streamed && (s->pktbuffSize > GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED))
+  {
+    s->jobPrints++;
+    if ((s->pktbuff[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED] & 0xF) != 0)
+      s->cut = true;
+  }
+}
+
+static void gbpslice_hexByte(void *ctx, uint8_t byte)
+{
+  gbpslice_gotByte((gbpslice_t *)ctx, byte);
+}
+
+static void gbpslice_text(gbpslice_t *s, const uint8_t *text, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    const unsigned char ch = text[i];
+    const uint32_t inquiryLines = s->hex.inquiryLines;
+    gbp_hexstream_char(&s->hex, ch);
+    // An inquiry summary stands for packets, so its line is owned
+    s->lineOwned |= (s->hex.inquiryLines != inquiryLines);
+    s->textOffset++;
+    s->held[s->heldSize++] = (char)ch;
+    if (((ch == '\n') && s->lineOwned) || (s->heldSize == sizeof(s->held)))
+    {
+      s->lineOwned = (ch != '\n') && s->lineOwned;
+      gbpslice_giveHeld(s);
+    }
+  }
+}
+
+/*******************************************************************************
+ * Main
+*******************************************************************************/
+
+// Parses N or N-M (hex)
+static bool gbpslice_parseJobs(const char *arg, uint32_t *first, uint32_t *last)
+{
+  char *end = NULL;
+  *first = (uint32_t)strtoul(arg, &end, 16);
+  if (end == arg)
+    return false;
+  *last = *first;
+  if (*end == '-')
+  {
+    const char *m = end + 1;
+    *last = (uint32_t)strtoul(m, &end, 16);
+    if (end == m)
+      return false;
+  }
+  return (*end == '\0') && (*first <= *last);
+}
+
+int
+main (int argc, char **argv)
+{
+  int c;
+  gbpslice_t *s = &slice;
+  const char *outputPrefix = NULL;
+  s->first = 0;
+  s->last  = UINT32_MAX;
+  static struct option const long_options[] =
+  {
+    {"output", required_argument, NULL, 'o'},
+    {"jobs",   required_argument, NULL, 'j'},
+    {"list",   no_argument,       NULL, 'l'},
+    {"help",   no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((c = getopt_long (argc, argv, "o:j:lh", long_options, NULL))
+         != -1)
+  {
+    switch (c)
+    {
+        case 'o':
+          outputPrefix = optarg;
+          break;
+
+        case 'j':
+          if (!gbpslice_parseJobs(optarg, &s->first, &s->last))
+          {
+            fprintf(stderr, "jobs `%s' is not N or N-M\n", optarg);
+            return 1;
+          }
+          break;
+
+        case 'l':
+          s->list = true;
+          break;
+
+        case 'h':
+        default:
+          gbpslice_help();
+          return (c == 'h') ? 0 : 1;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    gbpslice_help();
+    return 1;
+  }
+  const char *capture = argv[optind];
+
+  // Output prefix, the capture name without its extension by default
+  char prefix[GBPSLICE_NAME_MAX];
+  if (outputPrefix)
+  {
+    snprintf(prefix, sizeof(prefix), "%s", outputPrefix);
+  }
+  else
+  {
+    snprintf(prefix, sizeof(prefix), "%s", capture);
+    char *ext = strrchr(prefix, '.');
+    if (ext && !strchr(ext, '/'))
+      *ext = '\0';
+    strncat(prefix, "_job", sizeof(prefix) - strlen(prefix) - 1);
+  }
+  s->prefix = prefix;
+
+  FILE *f = fopen(capture, "rb");
+  if (f == NULL)
+  {
+    fprintf(stderr, "file not found\n");
+    return 1;
+  }
+
+  static gbp_input_t input;
+  static uint8_t chunk[GBP_INPUT_BLOCK_SIZE];
+  s->outBuff = (char *)malloc(GBPSLICE_WRITE_BUFF);
+  gbp_pkt_init(&s->pkt);
+  gbp_hexstream_init(&s->hex, gbpslice_hexByte, s, false); // Summaries are copied as text, not decoded
+  if (gbp_input_open(&input, f))
+  {
+    size_t size;
+    while ((size = gbp_input_read(&input, chunk, sizeof(chunk))) > 0)
+    {
+      gbpslice_text(s, chunk, size);
+      if (!s->list && (s->job > s->last))
+        break; // Past the last job wanted
+    }
+  }
+  gbpslice_giveHeld(s); // Capture ends in the current job
+  gbpslice_endJob(s);
+
+  int ret = 0;
+  if (!gbp_input_close(&input))
+  {
+    fprintf(stderr, "input error: %s\n", input.error);
+    ret = 1;
+  }
+  fclose(f);
+  free(s->outBuff);
+  if (s->writeError)
+    ret = 1;
+  return ret;
+}
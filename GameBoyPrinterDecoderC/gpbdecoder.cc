@@ -25,8 +25,11 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <getopt.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include <stdlib.h>
 
@@ -34,6 +37,13 @@
 #include "gbp_pkt.h"
 #include "gbp_tiles.h"
 #include "gbp_bmp.h"
+#include "gbp_spsc_wait.h"
+#include "gbp_log.h"
+#include "gbp_input.h"
+#include "gbp_phash.h"
+#include "gbp_hexstream.h"
+#include "gbp_mosaic.h"
+#include "gbp_spool.h"
 
 
 /* The official name of this program (e.g., no 'g' prefix).  */
@@ -43,6 +53,9 @@
 
 static bool verbose_flag = false;
 static bool display_flag = false;
+static bool tilemajor_flag = false;
+static bool strips_flag = false;
+static bool threads_flag = false;
 
 /******************************************************************************/
 
@@ -50,8 +63,14 @@ static bool display_flag = false;
 const char * ifilename = NULL;
 const char * ofilename = NULL;
 FILE * ifilePtr = NULL;
+static gbp_input_t gbp_input; ///< ifilePtr, decompressed if needed
 char ofilenameBuf[255] = {0};
 char ofilenameExt[50]  = {0};
+const char * logfilename = NULL;
+FILE * logfilePtr = NULL;
+const char * hashIndexFilename = NULL;
+FILE * hashIndexPtr = NULL;
+const char * mosaicFilename = NULL;
 
 /******************************************************************************/
 
@@ -61,36 +80,225 @@ uint32_t palletColor[4] = {0};
 
 /******************************************************************************/
 
+// Mosaic (--mosaic)
+gbp_mosaic_t gbp_mosaic = {0};
+
+// Spool service (--spool)
+gbp_spool_t gbp_spool = {0};
+
+/******************************************************************************/
+
 // Other Variables
-uint8_t pktCounter = 0; // Dev Varible
+uint32_t pktCounter = 0; // Dev Varible
 gbp_pkt_t gbp_pktBuff = {GBP_REC_NONE, 0};
 uint8_t gbp_pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE] = {0};
+static_assert(sizeof(gbp_pktbuff) <= GBP_LOG_PAYLOAD_MAX, "packet payload must fit a log record");
 uint8_t gbp_pktbuffSize = 0;
 gbp_pkt_tileAcc_t tileBuff = {0};
 gbp_tile_t gbp_tiles = {0};
+gbp_tilemajor_t gbp_tilemajor = {0}; ///< Used instead of gbp_tiles with --tilemajor
+gbp_tiles_strip_t gbp_strip = {0};   ///< Used instead of gbp_tiles with --strips
 gbp_bmp_t  gbp_bmp = {0};
+gbp_phash_t gbp_phash = {0}; ///< Tile stage, hash of the picture so far
 
 /******************************************************************************/
 
-static void gbpdecoder_gotByte(const uint8_t byte);
+// Event log (--log and --verbose)
+typedef struct
+{
+  uint32_t byteOffset;    ///< Input bytes so far
+  uint32_t pktOffset;     ///< Input offset of the packet being received
+  uint16_t checksum;      ///< As received
+  uint16_t checksumCalc;  ///< Sum of command to the end of the payload
+} gbpdecoder_pktTrack_t;
+
+gbpdecoder_pktTrack_t pktTrack = {0}; ///< Packet stage
+gbp_log_end_t logTotals = {0};        ///< Output stage
+uint16_t logPrintLines = 0;           ///< Output stage
+
+// --strips lines since the last print, raw tones until the print instruction gives their palette (Output stage)
+typedef struct
+{
+  uint16_t lineCount;
+  uint8_t lines[GBP_TILES_PER_ROW][GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B];
+} gbpdecoder_stripHeld_t;
+
+gbpdecoder_stripHeld_t stripHeld = {0};
+static gbp_log_writer_t gbp_log;
+
+/******************************************************************************/
 
 /*******************************************************************************
- * Utilites
+ * Decode Stages
+ *
+ *   input (hex) -> gbpdecoder_gotByte() -> gbpdecoder_tileStage() -> gbpdecoder_outputStage()
+ *
+ * Each stage hands events to the next. By default the next stage is called directly.
+ * With --threads each stage runs on its own thread and events are passed in batches
+ * through gbp_spsc queues. A stage sleeps while the queue to the next stage is full,
+ * or while the queue from the previous stage is empty.
 *******************************************************************************/
 
-const char *gbpCommand_toStr(int val)
+typedef enum
 {
-  switch (val)
+  GBPDECODER_EVT_PACKET,    ///< Complete packet and its small payload (e.g. print instruction)
+  GBPDECODER_EVT_TILE,      ///< Decompressed tile
+  GBPDECODER_EVT_LINE,      ///< Packed pixel rows of a printed line of tiles
+  GBPDECODER_EVT_PRINT_END, ///< All lines of a print instruction sent
+  GBPDECODER_EVT_END        ///< End of input
+} gbpdecoder_event_type_t;
+
+typedef struct
+{
+  uint8_t type;         ///< gbpdecoder_event_type_t
+  bool cutPaper;        ///< PRINT_END
+  union
   {
-    case GBP_COMMAND_INIT    : return "INIT";
-    case GBP_COMMAND_PRINT   : return "PRNT";
-    case GBP_COMMAND_DATA    : return "DATA";
-    case GBP_COMMAND_BREAK   : return "BREK";
-    case GBP_COMMAND_INQUIRY : return "INQY";
-    default: return "?";
+    gbp_log_packet_t packet;                                            ///< PACKET
+    uint8_t tile[GBP_TILE_SIZE_IN_BYTE];                                ///< TILE
+    uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B];  ///< LINE
+    gbp_log_image_t image;                                              ///< PRINT_END with cutPaper (index set by the output stage)
+  };
+} gbpdecoder_event_t;
+
+#define GBPDECODER_BYTE_BATCH  4096 // Input bytes per batch
+#define GBPDECODER_EVENT_BATCH 32   // Events per batch
+#define GBPDECODER_QUEUE_LEN   8    // Batches in flight between two stages (Power of two)
+
+typedef struct
+{
+  uint16_t count;
+  bool end;
+  uint8_t bytes[GBPDECODER_BYTE_BATCH];
+} gbpdecoder_byteBatch_t;
+
+typedef struct
+{
+  uint16_t count;
+  gbpdecoder_event_t events[GBPDECODER_EVENT_BATCH];
+} gbpdecoder_eventBatch_t;
+
+// Queues between stages and the batch each producer is filling (--threads)
+static gbp_spsc_wait_t byteQueue;   ///< input -> packet stage
+static gbp_spsc_wait_t packetQueue; ///< packet stage -> tile stage
+static gbp_spsc_wait_t lineQueue;   ///< tile stage -> output stage
+static gbpdecoder_byteBatch_t byteBatch;
+static gbpdecoder_eventBatch_t packetBatch;
+static gbpdecoder_eventBatch_t lineBatch;
+
+static void gbpdecoder_gotByte(const uint8_t byte);
+static void gbpdecoder_tileStage(const gbpdecoder_event_t *evt);
+static void gbpdecoder_tileStageTile(const uint8_t tile[GBP_TILE_SIZE_IN_BYTE]);
+static void gbpdecoder_outputStage(const gbpdecoder_event_t *evt);
+static bool gbpdecoder_runThreads(gbp_input_t *in);
+
+static void gbpdecoder_flushBytes(bool end)
+{
+  if ((byteBatch.count == 0) && !end)
+    return;
+  byteBatch.end = end;
+  gbp_spsc_wait_push(&byteQueue, &byteBatch);
+  byteBatch.count = 0;
+}
+
+static void gbpdecoder_flushEvents(gbp_spsc_wait_t *q, gbpdecoder_eventBatch_t *batch)
+{
+  if (batch->count == 0)
+    return;
+  gbp_spsc_wait_push(q, batch);
+  batch->count = 0;
+}
+
+static void gbpdecoder_emitByte(const uint8_t byte)
+{
+  if (!threads_flag)
+  {
+    gbpdecoder_gotByte(byte);
+    return;
   }
+  byteBatch.bytes[byteBatch.count++] = byte;
+  if (byteBatch.count == GBPDECODER_BYTE_BATCH)
+    gbpdecoder_flushBytes(false);
 }
 
+static void gbpdecoder_emitEvent(gbp_spsc_wait_t *q, gbpdecoder_eventBatch_t *batch, void (*nextStage)(const gbpdecoder_event_t *), const gbpdecoder_event_t *evt)
+{
+  if (!threads_flag)
+  {
+    nextStage(evt);
+    return;
+  }
+  batch->events[batch->count++] = *evt;
+  if ((batch->count == GBPDECODER_EVENT_BATCH) || (evt->type == GBPDECODER_EVT_END))
+    gbpdecoder_flushEvents(q, batch);
+}
+
+static void gbpdecoder_emitToTileStage(const gbpdecoder_event_t *evt)
+{
+  gbpdecoder_emitEvent(&packetQueue, &packetBatch, gbpdecoder_tileStage, evt);
+}
+
+// Without threads the tile is decoded where it lies (e.g. in the packet buffer)
+static void gbpdecoder_emitTileToTileStage(const uint8_t tile[GBP_TILE_SIZE_IN_BYTE])
+{
+  if (!threads_flag)
+  {
+    gbpdecoder_tileStageTile(tile);
+    return;
+  }
+  gbpdecoder_event_t evt;
+  evt.type = GBPDECODER_EVT_TILE;
+  memcpy(evt.tile, tile, GBP_TILE_SIZE_IN_BYTE);
+  gbpdecoder_emitToTileStage(&evt);
+}
+
+static void gbpdecoder_emitToOutputStage(const gbpdecoder_event_t *evt)
+{
+  gbpdecoder_emitEvent(&lineQueue, &lineBatch, gbpdecoder_outputStage, evt);
+}
+
+/*******************************************************************************
+ * Decoded Lines (Either tile layout)
+*******************************************************************************/
+
+static int gbpdecoder_lineCount(void)
+{
+  if (strips_flag)
+    return 0; // Sent as they were decoded (gbpdecoder_stripSink())
+  return tilemajor_flag ? gbp_tilemajor_lines(&gbp_tilemajor) : gbp_tiles.tileRowOffset;
+}
+
+// Packed rows of a line of tiles
+static void gbpdecoder_lineRows(int line, uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B])
+{
+  if (tilemajor_flag)
+    gbp_tilemajor_toRows(&gbp_tilemajor, line, rows);
+  else
+    memcpy(rows, &gbp_tiles.bmpLineBuffer[GBP_TILE_PIXEL_HEIGHT*line][0], GBP_TILE_PIXEL_HEIGHT * GBP_TILEMAJOR_LINE_ROWSIZE_B);
+}
+
+static void gbpdecoder_linesReset(void)
+{
+  if (tilemajor_flag)
+    gbp_tilemajor_reset(&gbp_tilemajor);
+  else if (!strips_flag)
+    gbp_tiles_reset(&gbp_tiles);
+}
+
+// --strips: each line goes to the output stage as soon as its last tile is decoded, and is held there until its print
+static void gbpdecoder_stripSink(void *ctx, const uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B])
+{
+  (void)ctx;
+  gbpdecoder_event_t lineEvt;
+  lineEvt.type = GBPDECODER_EVT_LINE;
+  memcpy(lineEvt.rows, rows, sizeof(lineEvt.rows));
+  gbpdecoder_emitToOutputStage(&lineEvt);
+}
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
 static void filenameExtractPathAndExtention(const char *fname,
                         char *pathBuff, int pathSize,
                         char *extBuff, int extSize)
@@ -194,6 +402,30 @@ int palletColorParse(uint32_t *palletColor, const int palletColorSize, const cha
   return palletCounter;
 }
 
+static void gbpdecoder_hexByte(void *ctx, uint8_t byte)
+{
+  (void)ctx;
+  gbpdecoder_emitByte(byte);
+}
+
+// Hex text (with `//` comment lines) to the packet stage. Returns number of bytes decoded
+static unsigned int gbpdecoder_parseHexStream(gbp_input_t *in)
+{
+  static uint8_t chunk[64 * 1024];
+  size_t chunkSize = 0;
+  gbp_hexstream_t hs;
+  gbp_hexstream_init(&hs, gbpdecoder_hexByte, NULL, true);
+  while ((chunkSize = gbp_input_read(in, chunk, sizeof(chunk))) > 0)
+  {
+    gbp_hexstream_parse(&hs, chunk, chunkSize);
+    // Pass on what has been read so far
+    if (threads_flag)
+      gbpdecoder_flushBytes(false);
+  }
+  gbp_hexstream_end(&hs);
+  return hs.bytes;
+}
+
 /*******************************************************************************
  * Main Test Routine
 *******************************************************************************/
@@ -203,7 +435,8 @@ void gpbdecoder_help(void)
       "Usage: gpbdecoder [OPTION]...\n"
       "This program allows for decoding raw hex packets into bmp\n"
       "\n"
-      "With no FILE, read standard input.\n"
+      "With no FILE, read standard input. gzip and zstd compressed input is detected\n"
+      "and decompressed while decoding (if built with zlib and libzstd).\n"
       "\n"
       "-i, --input=FILE     input hexfile in ascii format\n"
       "-o, --output=OUTFILE output bmp filename\n"
@@ -211,13 +444,116 @@ void gpbdecoder_help(void)
       "-h, --help           display this help and exit\n"
       "-d, --display        preview image via vt100 output\n"
       "-v, --verbose        verbose print\n"
+      "-l, --log=LOGFILE    binary event log (view with gbplogview)\n"
+      "    --hash-index=FILE append a perceptual hash line per output bmp (search with gbphashfind)\n"
+      "    --tilemajor      keep tiles as received and convert at output (same output)\n"
+      "    --strips         decode one line of tiles at a time, raw lines wait for their\n"
+      "                     print's palette (same output, see gbp_tiles.h)\n"
+      "-t, --threads        decode stages on separate threads (same output)\n"
+      "\n"
+      "    --mosaic=SHEET   contact sheets of every CAPTURE given after the options\n"
+      "                     (and -i), decoded in parallel. Thumbnail positions go to\n"
+      "                     SHEET_index.txt\n"
+      "    --mosaic-columns=N  thumbnails per row (default 10)\n"
+      "    --mosaic-rows=N     rows per sheet (default 50)\n"
+      "    --mosaic-scale=N    print pixels per thumbnail pixel, 1 to 8 (default 2)\n"
+      "\n"
+      "    --spool=DIR      service: decode every capture put in DIR, until SIGINT or\n"
+      "                     SIGTERM. SIGUSR1 prints the throughput (see gbp_spool.h)\n"
+      "    --spool-out=DIR  a directory of results per capture (required with --spool)\n"
+      "    --spool-workers=N   captures decoded at once (default CPU count)\n"
+      "    --spool-drain       exit once DIR is empty\n"
       "\n"
       "Examples:\n"
       "  cat ./test/test.txt | gpbdecoder -p \"#ffffff#ffad63#833100#000000\" -o ./test/test.bmp    stdin based input, with a defined output filename\n"
       "-p \"#dbf4b4#abc396#7b9278#4c625a#FFFFFF00\" -i ./test/test.txt                              input file used. Output file has similar name to input file\n"
+      "  gpbdecoder --mosaic=./sheet.bmp ./captures/*.txt                                         sheet0.bmp, sheet1.bmp ... and sheet_index.txt\n"
+      "  gpbdecoder --spool=./inbox --spool-out=./decoded                                         ./decoded/NAME/NAME0.bmp ... per capture\n"
     );
 }
 
+#ifndef GPBDECODER_NO_MAIN // Defined by the fuzz targets, which drive the decoder themselves
+static void gbpdecoder_palletOrDefault(void)
+{
+  if (palletColorParse(palletColor, sizeof(palletColor)/sizeof(palletColor[0]), palletParameter) == 0)
+  {
+    palletColor[0] = 0xFFFFFF;
+    palletColor[1] = 0xAAAAAA;
+    palletColor[2] = 0x555555;
+    palletColor[3] = 0x000000;
+  }
+  printf("Pallet: 0x%06X, 0x%06X, 0x%06X, 0x%06X\n", palletColor[0], palletColor[1], palletColor[2], palletColor[3]);
+}
+
+// Captures are -i (if given) and the arguments after the options
+static int gbpdecoder_mosaic(int argc, char **argv)
+{
+  gbp_mosaic_t *m = &gbp_mosaic;
+  m->columns      = m->columns ? m->columns : 10;
+  m->rowsPerSheet = m->rowsPerSheet ? m->rowsPerSheet : 50;
+  m->scale        = m->scale ? m->scale : 2;
+  if (m->scale > GBP_MOSAIC_SCALE_MAX)
+  {
+    printf("mosaic scale must be 1 to %d\n", GBP_MOSAIC_SCALE_MAX);
+    return 1;
+  }
+
+  const char **captures = (const char **)malloc((argc + 1) * sizeof(captures[0]));
+  int count = 0;
+  if (ifilename)
+    captures[count++] = ifilename;
+  for (int i = optind; i < argc; i++)
+    captures[count++] = argv[i];
+
+  char indexFilename[300];
+  filenameExtractPathAndExtention(mosaicFilename, ofilenameBuf, sizeof(ofilenameBuf), ofilenameExt, sizeof(ofilenameExt));
+  snprintf(indexFilename, sizeof(indexFilename), "%s_index.txt", ofilenameBuf);
+  FILE *index = fopen(indexFilename, "w");
+  if (index == NULL)
+  {
+    printf("could not open mosaic index `%s'\n", indexFilename);
+    free(captures);
+    return 1;
+  }
+
+  gbpdecoder_palletOrDefault();
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  m->sheetPrefix  = ofilenameBuf;
+  m->index        = index;
+  m->threads      = (cpus > 0) ? (int)cpus : 1;
+  memcpy(m->palette, palletColor, sizeof(m->palette));
+  printf("mosaic `%s' of %d captures, %d threads\n", ofilenameBuf, count, m->threads);
+
+  const bool ok = gbp_mosaic_run(m, captures, count);
+  const bool indexOk = (fclose(index) == 0);
+  free(captures);
+  printf("mosaic: %u pictures on %d sheets, index `%s'", (unsigned)m->pictures, m->sheetCounter, indexFilename);
+  if (m->failedCaptures)
+    printf(", %u captures could not be read", (unsigned)m->failedCaptures);
+  printf("\n");
+  if (!ok || !indexOk)
+  {
+    printf("could not write mosaic `%s'\n", ofilenameBuf);
+    return 1;
+  }
+  return 0;
+}
+
+static int gbpdecoder_spool(void)
+{
+  gbp_spool_t *sp = &gbp_spool;
+  if (sp->outputDir == NULL)
+  {
+    printf("--spool needs --spool-out\n");
+    return 1;
+  }
+  gbpdecoder_palletOrDefault();
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  sp->workers = (sp->workers > 0) ? sp->workers : ((cpus > 0) ? (int)cpus : 1);
+  memcpy(sp->palette, palletColor, sizeof(sp->palette));
+  return gbp_spool_run(sp) ? 0 : 1;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -231,17 +567,30 @@ main (int argc, char **argv)
     {"display", no_argument,       (int*)&display_flag, 1},
     {"verbose", no_argument,       (int*)&verbose_flag, 1},
     {"brief",   no_argument,       (int*)&verbose_flag, 0},
+    {"tilemajor", no_argument,     (int*)&tilemajor_flag, 1},
+    {"strips",  no_argument,       (int*)&strips_flag, 1},
+    {"threads", no_argument,       NULL, 't'},
     /* These options don’t set a flag.
         We distinguish them by their indices. */
     {"input",   required_argument, NULL, 'i'},
     {"output",  required_argument, NULL, 'o'},
     {"pallet",  required_argument, NULL, 'p'},
+    {"log",     required_argument, NULL, 'l'},
+    {"hash-index", required_argument, NULL, 'H'},
+    {"mosaic",  required_argument, NULL, 'M'},
+    {"mosaic-columns", required_argument, NULL, 'C'},
+    {"mosaic-rows",    required_argument, NULL, 'R'},
+    {"mosaic-scale",   required_argument, NULL, 'S'},
+    {"spool",          required_argument, NULL, 'Q'},
+    {"spool-out",      required_argument, NULL, 'O'},
+    {"spool-workers",  required_argument, NULL, 'W'},
+    {"spool-drain",    no_argument,       NULL, 'D'},
     {"verbose", no_argument,       NULL, 'v'},
     {"help",    no_argument,       NULL, 'h'},
     {NULL, 0, NULL, 0}
   };
 
-  while ((c = getopt_long (argc, argv, "o:i:p:vd", long_options, NULL))
+  while ((c = getopt_long (argc, argv, "o:i:p:l:vdt", long_options, NULL))
          != -1)
   {
     switch (c)
@@ -258,6 +607,46 @@ main (int argc, char **argv)
           palletParameter = optarg;
           break;
 
+        case 'l':
+          logfilename = optarg;
+          break;
+
+        case 'H':
+          hashIndexFilename = optarg;
+          break;
+
+        case 'M':
+          mosaicFilename = optarg;
+          break;
+
+        case 'C':
+          gbp_mosaic.columns = atoi(optarg);
+          break;
+
+        case 'R':
+          gbp_mosaic.rowsPerSheet = atoi(optarg);
+          break;
+
+        case 'S':
+          gbp_mosaic.scale = atoi(optarg);
+          break;
+
+        case 'Q':
+          gbp_spool.spoolDir = optarg;
+          break;
+
+        case 'O':
+          gbp_spool.outputDir = optarg;
+          break;
+
+        case 'W':
+          gbp_spool.workers = atoi(optarg);
+          break;
+
+        case 'D':
+          gbp_spool.drain = true;
+          break;
+
         case 'v':
           verbose_flag = true;
           break;
@@ -266,6 +655,10 @@ main (int argc, char **argv)
           display_flag = true;
           break;
 
+        case 't':
+          threads_flag = true;
+          break;
+
         case 'h':
           gpbdecoder_help();
           return 0;
@@ -273,6 +666,14 @@ main (int argc, char **argv)
     }
   }
 
+  /* Mosaic of many captures, instead of the decode below */
+  if (mosaicFilename)
+    return gbpdecoder_mosaic(argc, argv);
+
+  /* Spool service, instead of the decode below */
+  if (gbp_spool.spoolDir)
+    return gbpdecoder_spool();
+
   /* Input File */
   if (ifilename)
   {
@@ -292,6 +693,14 @@ main (int argc, char **argv)
     printf("file input stdin\n");
   }
 
+  if (!gbp_input_open(&gbp_input, ifilePtr))
+  {
+    printf("%s\n", gbp_input.error);
+    return 1;
+  }
+  if (gbp_input.format != GBP_INPUT_PLAIN)
+    printf("input %s compressed\n", gbp_input_formatToStr(gbp_input.format));
+
   /* Output File */
   if (!ofilename)
   {
@@ -310,215 +719,462 @@ main (int argc, char **argv)
   printf("file requested output `%s' (%s)\n", ofilenameBuf, ofilenameExt);
 
   /* Custom Pallet */
-  if (palletColorParse(palletColor, sizeof(palletColor)/sizeof(palletColor[0]), palletParameter) == 0)
+  gbpdecoder_palletOrDefault();
+
+  /* Event Log */
+  if (logfilename)
   {
-    palletColor[0] = 0xFFFFFF;
-    palletColor[1] = 0xAAAAAA;
-    palletColor[2] = 0x555555;
-    palletColor[3] = 0x000000;
+    logfilePtr = fopen(logfilename, "wb");
+    if (!gbp_log_open(&gbp_log, logfilePtr))
+    {
+      printf("could not open log `%s'\n", logfilename);
+      return 1;
+    }
+    printf("file log `%s' open\n", logfilename);
+  }
+
+  /* Hash Index */
+  if (hashIndexFilename)
+  {
+    hashIndexPtr = fopen(hashIndexFilename, "a");
+    if (hashIndexPtr == NULL)
+    {
+      printf("could not open hash index `%s'\n", hashIndexFilename);
+      return 1;
+    }
+    printf("file hash index `%s' open\n", hashIndexFilename);
   }
-  printf("Pallet: 0x%06X, 0x%06X, 0x%06X, 0x%06X\n", palletColor[0], palletColor[1], palletColor[2], palletColor[3]);
 
   /****************************************************************************/
   gbp_pkt_init(&gbp_pktBuff);
+  gbp_tiles_strip_init(&gbp_strip, gbpdecoder_stripSink, NULL);
 
-  char ch = 0;
-  bool skipLine = false;
-  int  lowNibFound = 0;
-  uint8_t byte = 0;
-  unsigned int bytec = 0;
-  while ((ch = fgetc(ifilePtr)) != EOF)
+  if (threads_flag)
   {
-    // Skip Comments
-    if (ch == '/')
+    if (!gbpdecoder_runThreads(&gbp_input))
     {
-      // Might be `//` or `/*`
-      skipLine = true;
-      continue;
+      printf("could not start decode threads\n");
+      return 1;
     }
-    else if (skipLine)
+  }
+  else
+  {
+    gbpdecoder_parseHexStream(&gbp_input);
+    gbpdecoder_event_t evt;
+    evt.type = GBPDECODER_EVT_END;
+    gbpdecoder_emitToTileStage(&evt);
+  }
+
+  if (!gbp_input_close(&gbp_input))
+  {
+    printf("input error: %s\n", gbp_input.error);
+    return 1;
+  }
+
+  if (logfilePtr)
+  {
+    const bool logOk = gbp_log_flush(&gbp_log);
+    fclose(logfilePtr);
+    if (!logOk)
     {
-      // Discarding line
-      if (ch == '\n')
-        skipLine = false;
-      continue;
+      printf("could not write log `%s'\n", logfilename);
+      return 1;
     }
+  }
 
-    // Parse Nibble
-    char nib = -1;
-    if (('0' <= ch) && (ch <= '9'))
-      nib = ch - '0';
-    else if (('a' <= ch) && (ch <= 'f'))
-      nib = ch - 'a' + 10;
-    else if (('A' <= ch) && (ch <= 'F'))
-      nib = ch - 'A' + 10;
+  if (hashIndexPtr && (fclose(hashIndexPtr) != 0))
+  {
+    printf("could not write hash index `%s'\n", hashIndexFilename);
+    return 1;
+  }
+
+  return 0;
+}
+#endif
+
+
+/*******************************************************************************
+ * Packet Stage
+*******************************************************************************/
 
-    /* Parse As Byte */
-    bool byteFound = false;
-    // Hex Parse Edge Cases
-    if (lowNibFound)
+// Offset and checksum of the packet being received, for the event log
+// Dev Note: Uses the parser's byte index before it sees this byte. The header
+//           bytes are summed while dataLength is still being read, which is
+//           fine as the payload end is always past them
+static void gbpdecoder_trackByte(const uint8_t byte)
+{
+  const uint16_t i = gbp_pktBuff.pktByteIndex;
+  const uint32_t payloadEnd = 6 + (uint32_t)gbp_pktBuff.dataLength;
+  if (i == 0)
+    pktTrack.pktOffset = pktTrack.byteOffset;
+  else if (i == 2)
+    pktTrack.checksumCalc = byte;
+  else if ((i > 2) && (i < payloadEnd))
+    pktTrack.checksumCalc += byte;
+  else if (i == payloadEnd)
+    pktTrack.checksum = byte;
+  else if (i == payloadEnd + 1)
+    pktTrack.checksum |= (uint16_t)byte << 8;
+  pktTrack.byteOffset++;
+}
+
+static void gbpdecoder_emitPacket(bool streamed)
+{
+  gbpdecoder_event_t evt;
+  gbp_log_packet_t *pkt = &evt.packet;
+  pktCounter++;
+  evt.type          = GBPDECODER_EVT_PACKET;
+  pkt->offset       = pktTrack.pktOffset;
+  pkt->index        = pktCounter;
+  pkt->command      = gbp_pktBuff.command;
+  pkt->compression  = gbp_pktBuff.compression;
+  pkt->dataLength   = gbp_pktBuff.dataLength;
+  pkt->printerID    = gbp_pktBuff.printerID;
+  pkt->status       = gbp_pktBuff.status;
+  pkt->checksum     = pktTrack.checksum;
+  pkt->checksumCalc = pktTrack.checksumCalc;
+  pkt->payloadSize  = streamed ? 0 : gbp_pktbuffSize; // Streamed payload has gone to the decompressor
+  memcpy(pkt->payload, gbp_pktbuff, sizeof(gbp_pktbuff));
+  gbpdecoder_emitToTileStage(&evt);
+}
+
+void gbpdecoder_gotByte(const uint8_t byte)
+{
+  gbpdecoder_trackByte(byte);
+  if (!gbp_pkt_processByte(&gbp_pktBuff, byte, gbp_pktbuff, &gbp_pktbuffSize, sizeof(gbp_pktbuff)))
+    return;
+
+  const bool streamed = gbp_pktBuff.dataLength >= sizeof(gbp_pktbuff);
+  if (gbp_pktBuff.received == GBP_REC_GOT_PACKET)
+  {
+    // Streamed packets are passed on at their end, once the checksum is in
+    if (!streamed)
+      gbpdecoder_emitPacket(false);
+    return;
+  }
+
+  // Support compression payload. Uncompressed tiles are not copied
+  const uint8_t *tile;
+  while ((tile = gbp_pkt_tileNext(&gbp_pktBuff, gbp_pktbuff, gbp_pktbuffSize, &tileBuff)) != NULL)
+  {
+    // Got tile
+#if 0 // Output Tile As Hex For Debugging purpose
+    for (int i = 0 ; i < GBP_TILE_SIZE_IN_BYTE ; i++)
     {
-      // '0x' found. Ignore
-      if ((byte == 0) && (ch == 'x'))
-        lowNibFound = false;
-      // Not a hex digit pair. Ignore
-      if (nib == -1)
-        lowNibFound = false;
+      printf("%02X ", tile[i]);
     }
-    // Hex Byte Parsing
-    if (nib != -1)
+    printf("\r\n");
+#endif
+    gbpdecoder_emitTileToTileStage(tile);
+  }
+
+  if (gbp_pktBuff.received == GBP_REC_GOT_PACKET_END)
+    gbpdecoder_emitPacket(true);
+}
+
+/*******************************************************************************
+ * Tile Stage
+*******************************************************************************/
+
+static void gbpdecoder_tileStageTile(const uint8_t tile[GBP_TILE_SIZE_IN_BYTE])
+{
+  gbp_phash_addTile(&gbp_phash, tile); // Raw tones, before any palette
+  if (tilemajor_flag)
+  {
+    gbp_tilemajor_add(&gbp_tilemajor, tile); // Converted to rows at print
+  }
+  else if (strips_flag)
+  {
+    gbp_tiles_strip_addTile(&gbp_strip, tile); // Sent on once the line is complete
+  }
+  else if (gbp_tiles_line_decoder(&gbp_tiles, tile))
+  {
+    // Line Obtained
+#if 0 // Per Line Decoded (Pre Pallet Harmonisation)
+    for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
     {
-      if (!lowNibFound)
+      for (int i = 0; i < (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE); i++)
       {
-        lowNibFound = true;
-        byte = nib << 4;
-      }
-      else
-      {
-        lowNibFound = false;
-        byte |= nib << 0;
-        byteFound = true;
+        int pixel = 0b11 & (gbp_tiles.bmpLineBuffer[j+(gbp_tiles.tileRowOffset-1)*8][GBP_TILE_2BIT_LINEPACK_INDEX(i)] >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(i));;
+        int b = 0;
+        switch (pixel)
+        {
+          case 0: b = 0; break;
+          case 1: b = 64; break;
+          case 2: b = 130; break;
+          case 3: b = 255; break;
+        }
+        printf("\x1B[48;2;%d;%d;%dm \x1B[0m", b, b, b);
       }
+      printf("\r\n");
     }
+#endif
+  }
+}
 
-    // Byte Was Found, decoding...
-    if (byteFound)
+static void gbpdecoder_tileStage(const gbpdecoder_event_t *evt)
+{
+  if (evt->type == GBPDECODER_EVT_TILE)
+  {
+    gbpdecoder_tileStageTile(evt->tile);
+    return;
+  }
+
+  // Packets and end of input are passed on in order
+  gbpdecoder_emitToOutputStage(evt);
+  if ((evt->type != GBPDECODER_EVT_PACKET) || (evt->packet.command != GBP_COMMAND_PRINT))
+    return;
+
+  const uint8_t *payload = evt->packet.payload;
+  const bool cutPaper = ((payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED]&0xF) != 0) ? true : false;  ///< if lower margin is zero, then new pic
+  if (tilemajor_flag)
+  {
+    gbp_tilemajor_print(&gbp_tilemajor, payload[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE]);
+  }
+  else if (strips_flag)
+  {
+    gbp_tiles_strip_print(&gbp_strip);
+  }
+  else
+  {
+    gbp_tiles_print(&gbp_tiles,
+        payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_SHEETS],
+        payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED],
+        payload[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE],
+        payload[GBP_PRINT_INSTRUCT_INDEX_PRINT_DENSITY]);
+  }
+
+  // Display preview only shows a whole picture, so lines are kept until the cut
+  if (!display_flag || cutPaper)
+  {
+    gbpdecoder_event_t lineEvt;
+    lineEvt.type = GBPDECODER_EVT_LINE;
+    for (int j = 0; j < gbpdecoder_lineCount(); j++)
     {
-      bytec++;
-      gbpdecoder_gotByte(byte);
+      gbpdecoder_lineRows(j, lineEvt.rows);
+      gbpdecoder_emitToOutputStage(&lineEvt);
     }
+    gbpdecoder_linesReset(); ///< Sent to output, clear decoded tile line buffer
   }
 
-  return 0;
+  gbpdecoder_event_t endEvt;
+  endEvt.type     = GBPDECODER_EVT_PRINT_END;
+  endEvt.cutPaper = cutPaper;
+  if (cutPaper)
+  {
+    endEvt.image.lines = (gbp_phash.lines < UINT16_MAX) ? gbp_phash.lines : UINT16_MAX;
+    endEvt.image.phash = gbp_phash_final(&gbp_phash);
+  }
+  gbpdecoder_emitToOutputStage(&endEvt);
 }
 
+/*******************************************************************************
+ * Output Stage
+*******************************************************************************/
 
-void gbpdecoder_gotByte(const uint8_t byte)
+// Verbose print is the text rendering of the same records
+static void gbpdecoder_logRecord(const gbp_log_record_t *rec)
 {
-  if (gbp_pkt_processByte(&gbp_pktBuff, byte, gbp_pktbuff, &gbp_pktbuffSize, sizeof(gbp_pktbuff)))
+  if (verbose_flag)
+    gbp_log_printText(stdout, rec);
+  gbp_log_write(&gbp_log, rec);
+}
+
+// Line of packed rows (palette applied) to the preview or the bmp
+static void gbpdecoder_outputLine(const uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILEMAJOR_LINE_ROWSIZE_B])
+{
+  logPrintLines++;
+  if (display_flag)
   {
-    if (gbp_pktBuff.received == GBP_REC_GOT_PACKET)
+    // Display Preview
+    for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
     {
-      pktCounter++;
-      if (verbose_flag)
+      for (int i = 0; i < (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE); i++)
       {
-        printf("// %s | compression: %1u, dlength: %3u, printerID: 0x%02X, status: %u | %d | ",
-            gbpCommand_toStr(gbp_pktBuff.command),
-            (unsigned) gbp_pktBuff.compression,
-            (unsigned) gbp_pktBuff.dataLength,
-            (unsigned) gbp_pktBuff.printerID,
-            (unsigned) gbp_pktBuff.status,
-            (unsigned) pktCounter
-          );
-        for (int i = 0 ; i < gbp_pktbuffSize ; i++)
+        const int pixel = 0b11 & (rows[j][GBP_TILE_2BIT_LINEPACK_INDEX(i)] >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(i));
+        int b = 0;
+        switch (pixel)
         {
-          printf("%02X ", gbp_pktbuff[i]);
+          default:
+          case 3: b = 0; break;
+          case 2: b = 64; break;
+          case 1: b = 130; break;
+          case 0: b = 255; break;
         }
-        printf("\r\n");
+        printf("\x1B[48;2;%d;%d;%dm \x1B[0m", b, b, b);
       }
-      if (gbp_pktBuff.command == GBP_COMMAND_PRINT)
+      printf("\r\n");
+    }
+  }
+  else
+  {
+    // Write Decode Data Buffer Into BMP
+    const long int tileHeightIncrement = GBP_TILE_PIXEL_HEIGHT*GBP_BMP_MAX_TILE_HEIGHT;
+    gbp_bmp_add(&gbp_bmp, &rows[0][0], (GBP_TILE_PIXEL_WIDTH*GBP_TILES_PER_LINE), tileHeightIncrement, palletColor);
+  }
+}
+
+static void gbpdecoder_outputStage(const gbpdecoder_event_t *evt)
+{
+  gbp_log_record_t rec;
+  switch (evt->type)
+  {
+    case GBPDECODER_EVT_PACKET:
+    {
+      logTotals.packets++;
+      if (!gbp_log_checksumOk(&evt->packet))
+        logTotals.checksumErrors++;
+      rec.type   = GBP_LOG_REC_PACKET;
+      rec.packet = evt->packet;
+      gbpdecoder_logRecord(&rec);
+      // Streaming BMP Writer
+      // Dev Note: Done this way to allow for streaming writes to file without a large buffer
+      if ((evt->packet.command == GBP_COMMAND_PRINT) && !display_flag)
       {
-        const bool cutPaper = ((gbp_pktbuff[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED]&0xF) != 0) ? true : false;  ///< if lower margin is zero, then new pic
-        gbp_tiles_print(&gbp_tiles,
-            gbp_pktbuff[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_SHEETS],
-            gbp_pktbuff[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED],
-            gbp_pktbuff[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE],
-            gbp_pktbuff[GBP_PRINT_INSTRUCT_INDEX_PRINT_DENSITY]);
-
-        if (display_flag)
+        // Open New File
+        if (!gbp_bmp_isopen(&gbp_bmp))
         {
-          if (cutPaper)
-          {
-            // Display Preview
-            for (int j = 0; j < (GBP_TILE_PIXEL_HEIGHT * gbp_tiles.tileRowOffset); j++)
-            {
-              for (int i = 0; i < (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE); i++)
-              {
-                const int pixel = 0b11 & (gbp_tiles.bmpLineBuffer[j][GBP_TILE_2BIT_LINEPACK_INDEX(i)] >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(i));
-                int b = 0;
-                switch (pixel)
-                {
-                  default:
-                  case 3: b = 0; break;
-                  case 2: b = 64; break;
-                  case 1: b = 130; break;
-                  case 0: b = 255; break;
-                }
-                printf("\x1B[48;2;%d;%d;%dm \x1B[0m", b, b, b);
-              }
-              printf("\r\n");
-            }
-            gbp_tiles_reset(&gbp_tiles);
-          }
-        }
-        else
-        {
-          // Streaming BMP Writer
-          // Dev Note: Done this way to allow for streaming writes to file without a large buffer
-
-          // Open New File
-          if (!gbp_bmp_isopen(&gbp_bmp))
-          {
-            gbp_bmp_open(&gbp_bmp, ofilenameBuf, GBP_TILE_PIXEL_WIDTH*GBP_TILES_PER_LINE);
-          }
-
-          // Write Decode Data Buffer Into BMP
-          for (int j = 0; j < gbp_tiles.tileRowOffset; j++)
-          {
-            const long int tileHeightIncrement = GBP_TILE_PIXEL_HEIGHT*GBP_BMP_MAX_TILE_HEIGHT;
-            gbp_bmp_add(&gbp_bmp, (const uint8_t *) &gbp_tiles.bmpLineBuffer[tileHeightIncrement*j][0], (GBP_TILE_PIXEL_WIDTH*GBP_TILES_PER_LINE), tileHeightIncrement, palletColor);
-          }
-          gbp_tiles_reset(&gbp_tiles); ///< Written to file, clear decoded tile line buffer
-
-          // Print finished and cut requested
-          if (cutPaper)
-          {
-            gbp_bmp_render(&gbp_bmp);
-          }
+          gbp_bmp_open(&gbp_bmp, ofilenameBuf, GBP_TILE_PIXEL_WIDTH*GBP_TILES_PER_LINE);
         }
       }
+      // --strips lines held since the last print now have their palette
+      if ((evt->packet.command == GBP_COMMAND_PRINT) && strips_flag)
+      {
+        gbp_tiles_strip_harmonise(stripHeld.lines, stripHeld.lineCount, evt->packet.payload[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE]);
+        for (uint16_t line = 0; line < stripHeld.lineCount; line++)
+          gbpdecoder_outputLine(stripHeld.lines[line]);
+        stripHeld.lineCount = 0;
+      }
+      break;
     }
-    else
+    case GBPDECODER_EVT_LINE:
     {
-      // Support compression payload
-      while (gbp_pkt_decompressor(&gbp_pktBuff, gbp_pktbuff, gbp_pktbuffSize, &tileBuff))
+      if (!strips_flag)
+        gbpdecoder_outputLine(evt->rows);
+      else if (stripHeld.lineCount < GBP_TILES_PER_ROW)
+        memcpy(stripHeld.lines[stripHeld.lineCount++], evt->rows, sizeof(evt->rows));
+      break;
+    }
+    case GBPDECODER_EVT_PRINT_END:
+    {
+      if (evt->cutPaper)
+        logTotals.cuts++;
+      rec.type              = GBP_LOG_REC_PRINT_END;
+      rec.printEnd.cutPaper = evt->cutPaper;
+      rec.printEnd.lines    = logPrintLines;
+      gbpdecoder_logRecord(&rec);
+      logPrintLines = 0;
+      if (!evt->cutPaper)
+        break;
+      rec.type        = GBP_LOG_REC_IMAGE;
+      rec.image       = evt->image;
+      rec.image.index = logTotals.cuts - 1;
+      gbpdecoder_logRecord(&rec);
+      // Print finished and cut requested
+      if (!display_flag)
       {
-        if (gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
-        {
-          // Got tile
-#if 0     // Output Tile As Hex For Debugging purpose
-          for (int i = 0 ; i < GBP_TILE_SIZE_IN_BYTE ; i++)
-          {
-            printf("%02X ", tileBuff.tile[i]);
-          }
-          printf("\r\n");
-#endif
-          if (gbp_tiles_line_decoder(&gbp_tiles, tileBuff.tile))
-          {
-            // Line Obtained
-#if 0       // Per Line Decoded (Pre Pallet Harmonisation)
-            for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
-            {
-              for (int i = 0; i < (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE); i++)
-              {
-                int pixel = 0b11 & (gbp_tiles.bmpLineBuffer[j+(gbp_tiles.tileRowOffset-1)*8][GBP_TILE_2BIT_LINEPACK_INDEX(i)] >> GBP_TILE_2BIT_LINEPACK_BITOFFSET(i));;
-                int b = 0;
-                switch (pixel)
-                {
-                  case 0: b = 0; break;
-                  case 1: b = 64; break;
-                  case 2: b = 130; break;
-                  case 3: b = 255; break;
-                }
-                printf("\x1B[48;2;%d;%d;%dm \x1B[0m", b, b, b);
-              }
-              printf("\r\n");
-            }
-#endif
-          }
-        }
+        if (hashIndexPtr)
+          fprintf(hashIndexPtr, "%016llX %s%X.bmp\n", (unsigned long long)evt->image.phash, ofilenameBuf, gbp_bmp.fileCounter - 1);
+        gbp_bmp_render(&gbp_bmp);
       }
+      break;
+    }
+    case GBPDECODER_EVT_END:
+    {
+      rec.type = GBP_LOG_REC_END;
+      rec.end  = logTotals;
+      gbpdecoder_logRecord(&rec);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/*******************************************************************************
+ * Threaded Decode (--threads)
+*******************************************************************************/
+
+static void *gbpdecoder_inputThread(void *arg)
+{
+  gbpdecoder_parseHexStream((gbp_input_t *)arg);
+  gbpdecoder_flushBytes(true);
+  return NULL;
+}
+
+static void *gbpdecoder_packetThread(void *arg)
+{
+  (void)arg;
+  static gbpdecoder_byteBatch_t batch;
+  do
+  {
+    gbp_spsc_wait_pop(&byteQueue, &batch);
+    for (int i = 0; i < batch.count; i++)
+      gbpdecoder_gotByte(batch.bytes[i]);
+    // Nothing more to read yet (e.g. live stream), pass on what we have
+    if (gbp_spsc_isEmpty(&byteQueue.queue))
+      gbpdecoder_flushEvents(&packetQueue, &packetBatch);
+  } while (!batch.end);
+
+  gbpdecoder_event_t evt;
+  evt.type = GBPDECODER_EVT_END;
+  gbpdecoder_emitToTileStage(&evt);
+  return NULL;
+}
+
+static void *gbpdecoder_tileThread(void *arg)
+{
+  (void)arg;
+  static gbpdecoder_eventBatch_t batch;
+  bool end = false;
+  while (!end)
+  {
+    gbp_spsc_wait_pop(&packetQueue, &batch);
+    for (int i = 0; i < batch.count; i++)
+    {
+      gbpdecoder_tileStage(&batch.events[i]);
+      end = end || (batch.events[i].type == GBPDECODER_EVT_END);
     }
+    if (gbp_spsc_isEmpty(&packetQueue.queue))
+      gbpdecoder_flushEvents(&lineQueue, &lineBatch);
   }
+  return NULL;
 }
 
+// Input, packet and tile stages each get a thread. Output stays on the calling thread
+static bool gbpdecoder_runThreads(gbp_input_t *in)
+{
+  static gbpdecoder_byteBatch_t byteQueueBuff[GBPDECODER_QUEUE_LEN];
+  static gbpdecoder_eventBatch_t packetQueueBuff[GBPDECODER_QUEUE_LEN];
+  static gbpdecoder_eventBatch_t lineQueueBuff[GBPDECODER_QUEUE_LEN];
+  gbp_spsc_wait_init(&byteQueue, (uint8_t *)byteQueueBuff, sizeof(byteQueueBuff[0]), GBPDECODER_QUEUE_LEN);
+  gbp_spsc_wait_init(&packetQueue, (uint8_t *)packetQueueBuff, sizeof(packetQueueBuff[0]), GBPDECODER_QUEUE_LEN);
+  gbp_spsc_wait_init(&lineQueue, (uint8_t *)lineQueueBuff, sizeof(lineQueueBuff[0]), GBPDECODER_QUEUE_LEN);
+
+  pthread_t threads[3];
+  if (pthread_create(&threads[0], NULL, gbpdecoder_tileThread, NULL) != 0)
+    return false;
+  if (pthread_create(&threads[1], NULL, gbpdecoder_packetThread, NULL) != 0)
+    return false;
+  if (pthread_create(&threads[2], NULL, gbpdecoder_inputThread, in) != 0)
+    return false;
+
+  static gbpdecoder_eventBatch_t batch;
+  bool end = false;
+  while (!end)
+  {
+    gbp_spsc_wait_pop(&lineQueue, &batch);
+    for (int i = 0; i < batch.count; i++)
+    {
+      gbpdecoder_outputStage(&batch.events[i]);
+      end = end || (batch.events[i].type == GBPDECODER_EVT_END);
+    }
+  }
+
+  for (int i = 0; i < 3; i++)
+    pthread_join(threads[i], NULL);
+  gbp_spsc_wait_destroy(&byteQueue);
+  gbp_spsc_wait_destroy(&packetQueue);
+  gbp_spsc_wait_destroy(&lineQueue);
+  return true;
+}
@@ -35,26 +35,61 @@ WebUSB WebUSBSerial(1, "herrzatacke.github.io/gb-printer-web/#/webusb");
 #define GAME_BOY_PRINTER_MODE      true   // to use with https://github.com/Mraulio/GBCamera-Android-Manager and https://github.com/Raphael-Boichot/PC-to-Game-Boy-Printer-interface
 #define GBP_OUTPUT_RAW_PACKETS     true   // by default, packets are parsed. if enabled, output will change to raw data packets for parsing and decompressing later
 #define GBP_USE_PARSE_DECOMPRESSOR false  // embedded decompressor can be enabled for use with parse mode but it requires fast hardware (SAMD21, SAMD51, ESP8266, ESP32)
+#define GBP_USE_HW_SPI_LINK        false  // one interrupt per byte via the hardware SPI slave instead of one per clock edge (AVR only, needs the SPI pins. See gbp_link.h)
+#define GBP_USE_BYTE_GAP_RESYNC    false  // gpio link only. timestamps clock edges so a missed or extra edge is corrected at the gap before the next byte, instead of losing the packet (see gbp_serial_io.cpp)
+#define GBP_USE_SPOOL              false  // raw packet mode only. spool captures to an SD card while no host is listening, press 'r' to replay (needs an SD card module, not for nano)
+#define GBP_CAPTURE_INQY_SUMMARY   false  // raw packet mode only. a run of inquiries (sent while the printer is busy) is output as one '// INQY' line of replies and counts, expanded again by gpbdecoder and the python reader
+#define GBP_OUTPUT_PIXEL_ROWS      false  // parse mode with decompressor only, not for nano. each hex line is a 160 pixel row (40 bytes of packed 2bpp raw tones, first pixel in the low bits) instead of a tile
+#define GBP_PIXEL_ROWS_BINARY      false  // with GBP_OUTPUT_PIXEL_ROWS. each 8 row strip is sent as 320 raw bytes after a {"command":"ROWS"} line
+#define GBP_USE_PIPELINE           false  // parse mode only on dual core ESP32. capture, parsing and serial output run as separate tasks so output never delays the link core
+#define GBP_USE_SETTINGS           false  // settings console ('s') saved to EEPROM. raw/parse mode and decompressor above become defaults that can be changed without a reflash (needs EEPROM.h, not for nano)
 
 #include <stdint.h>  // uint8_t
 #include <stddef.h>  // size_t
 
 #include "gameboy_printer_protocol.h"
+#include "gbp_config.h"
 #include "gbp_serial_io.h"
 
-#if GBP_OUTPUT_RAW_PACKETS
-#define GBP_FEATURE_PACKET_CAPTURE_MODE
-#else
-#define GBP_FEATURE_PARSE_PACKET_MODE
-#if GBP_USE_PARSE_DECOMPRESSOR
-#define GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+#include "gbp_features.h"
+
+#ifdef GBP_FEATURE_SETTINGS
+#include "gbp_settings.h"
+#include "gbp_settings_eeprom.h"
 #endif
+
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+#include "gbp_capture.h"
 #endif
 
 #ifdef GBP_FEATURE_PARSE_PACKET_MODE
 #include "gbp_pkt.h"
 #endif
 
+#ifdef GBP_FEATURE_PIXEL_ROWS
+#include "gbp_tiles.h"
+#endif
+
+#ifdef GBP_FEATURE_PIPELINE
+#ifndef ESP32
+#error "GBP_USE_PIPELINE needs a dual core ESP32"
+#endif
+#include "gbp_pipeline.h"
+#endif
+
+#ifdef GBP_FEATURE_POOL
+#include "gbp_pipeline.h"
+#include "gbp_pool.h"
+#endif
+
+#ifdef GBP_FEATURE_SPOOL
+#ifdef ESP8266
+#error "GBP_USE_SPOOL needs the SPI bus for the SD card, but the ESP8266 link uses its pins (GPIO12/13/14)"
+#endif
+#include "gbp_spool.h"
+#include "gbp_spool_sd.h"
+#endif
+
 
 
 
@@ -76,6 +111,16 @@ WebUSB WebUSBSerial(1, "herrzatacke.github.io/gb-printer-web/#/webusb");
 #define GBP_SC_PIN       14       // Pin 5            : ESP-pin 5 CLK  (Serial Clock)  -> Arduino 14
 #define GBP_GND_PIN               // Pin 6            : GND (Attach to GND Pin)
 #define LED_STATUS_PIN    2       // Internal LED blink on packet reception
+#elif defined(GBP_FEATURE_LINK_HW_SPI)
+// Pin Setup for Arduinos using the hardware SPI slave (Fixed by the SPI peripheral)
+//                  | Arduino Pin | Gameboy Link Pin  |
+#define GBP_VCC_PIN               // Pin 1            : 5.0V (Unused)
+#define GBP_SO_PIN       11       // Pin 2            : Serial OUTPUT -> MOSI
+#define GBP_SI_PIN       12       // Pin 3            : Serial INPUT  -> MISO
+#define GBP_SD_PIN                // Pin 4            : Serial Data  (Unused)
+#define GBP_SC_PIN       13       // Pin 5            : Serial Clock  -> SCK
+#define GBP_GND_PIN               // Pin 6            : GND (Attach to GND Pin). Also tie SS (D10) to GND
+#define LED_STATUS_PIN    9       // External LED blink on packet reception (Internal LED is on SCK)
 #else
 // Pin Setup for Arduinos
 //                  | Arduino Pin | Gameboy Link Pin  |
@@ -89,15 +134,35 @@ WebUSB WebUSBSerial(1, "herrzatacke.github.io/gb-printer-web/#/webusb");
 #endif
 // clang-format on
 
+#include "gbp_link.h"
+#if GAME_BOY_PRINTER_MODE
+#include "gbp_bridge.h"
+#endif
+
 /*******************************************************************************
 *******************************************************************************/
 
-// Dev Note: Gamboy camera sends data payload of 640 bytes usually
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+#define GBP_BUFFER_SIZE GBP_BUFFER_SIZE_CAPTURE_MODE
+#else
+#define GBP_BUFFER_SIZE GBP_BUFFER_SIZE_PARSE_MODE
+#endif
 
-#ifdef GBP_FEATURE_PARSE_PACKET_MODE
-#define GBP_BUFFER_SIZE 400
+#ifdef GBP_FEATURE_SETTINGS
+/* Runtime Settings */
+gbp_settings_t gbp_settings;
+gbp_settings_console_t gbp_settingsConsole = { 0 };
+bool gbp_settingsLoaded                    = false;
+// Mode and decompressor are latched at boot, the rest apply straight away
+bool gbp_captureMode                       = false;
+bool gbp_useDecompressor                   = false;
+#define GBP_CAPTURE_MODE_ACTIVE gbp_captureMode
+#define GBP_DECOMPRESSOR_ACTIVE gbp_useDecompressor
+static void gbp_settings_applyLink(void);
+static void gbp_settings_console_run(void);
 #else
-#define GBP_BUFFER_SIZE 650
+#define GBP_CAPTURE_MODE_ACTIVE GBP_OUTPUT_RAW_PACKETS
+#define GBP_DECOMPRESSOR_ACTIVE true
 #endif
 
 /* Serial IO */
@@ -112,51 +177,73 @@ uint8_t gbp_pktbuffSize                                = 0;
 #ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
 gbp_pkt_tileAcc_t tileBuff = { 0 };
 #endif
+#ifdef GBP_FEATURE_PIXEL_ROWS
+/* Pixel Row Strip */
+gbp_tiles_strip_t tileStrip;
+inline void gbp_pixel_rows_output(gbp_tiles_strip_t *strip);
+#endif
 #endif
 
-#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
-inline void gbp_packet_capture_loop();
+#ifdef GBP_FEATURE_POOL
+/* Payload Pool */
+// Serial room to write into without waiting (e.g. a serial class without availableForWrite() can return 1)
+#ifndef GBP_POOL_SERIAL_ROOM
+#define GBP_POOL_SERIAL_ROOM() Serial.availableForWrite()
 #endif
-#ifdef GBP_FEATURE_PARSE_PACKET_MODE
-inline void gbp_parse_packet_loop();
+gbp_pool_t gbp_pool;
+static size_t gbp_pool_serialWrite(void *ctx, const char *text, size_t len);
+static void gbp_pool_drain(void);
 #endif
 
-/*******************************************************************************
-  Utility Functions
-*******************************************************************************/
-
-const char *gbpCommand_toStr(int val)
-{
-  switch (val)
-  {
-    case GBP_COMMAND_INIT: return "INIT";
-    case GBP_COMMAND_PRINT: return "PRNT";
-    case GBP_COMMAND_DATA: return "DATA";
-    case GBP_COMMAND_BREAK: return "BREK";
-    case GBP_COMMAND_INQUIRY: return "INQY";
-    default: return "?";
-  }
-}
+#ifdef GBP_FEATURE_SPOOL
+/* Capture Spool */
+// Captures are diverted here for the whole session if no host is listening when it starts (See gbp_spool.h)
+#ifndef GBP_SPOOL_HOST_LINK
+#if defined(USBCON) || defined(ARDUINO_ARCH_SAMD) || (defined(ARDUINO_USB_CDC_ON_BOOT) && ARDUINO_USB_CDC_ON_BOOT)
+// Native USB: true while a host has the port open (DTR)
+#define GBP_SPOOL_HOST_LINK() ((bool)Serial ? GBP_SPOOL_HOST_LINK_UP : GBP_SPOOL_HOST_LINK_DOWN)
+#else
+// UART: only the host's keep-alive tells
+#define GBP_SPOOL_HOST_LINK() GBP_SPOOL_HOST_LINK_UNKNOWN
+#endif
+#endif
+#ifndef GBP_SPOOL_SERIAL_ROOM
+#define GBP_SPOOL_SERIAL_ROOM() Serial.availableForWrite()
+#endif
+#define GBP_SPOOL_SERIAL_WAIT_MS 2000  // For a host at power on, before carrying on without one
+gbp_spool_storage_t gbp_spoolStorage = { 0 };
+gbp_spool_t gbp_spool                 = { 0 };
+gbp_spool_host_t gbp_spoolHost;
+bool gbp_spoolMounted                 = false;
+bool gbp_spoolSession                 = false;
+#endif
 
-/*******************************************************************************
-  Interrupt Service Routine
-*******************************************************************************/
+#ifdef GBP_FEATURE_PIPELINE
+/* Parse Pipeline */
+// Replaces gbp_parse_packet_loop(). The capture task also owns the link timeout
+gbp_pipeline_t gbp_pipeline;
+static size_t gbp_pipeline_read(void *ctx, uint8_t *data, size_t max, bool *sessionEnd);
+static void gbp_pipeline_write(void *ctx, const char *text, size_t len);
+static void gbp_pipeline_sessionEnd(void *ctx);
+#endif
 
-#ifdef ESP8266
-void ICACHE_RAM_ATTR serialClock_ISR(void)
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+/* Capture Output */
+gbp_capture_fmt_t gbp_captureFmt;
+#ifdef GBP_FEATURE_INQY_SUMMARY
+gbp_capture_inqy_t gbp_captureInqy;
+#define GBP_CAPTURE_INQY      (&gbp_captureInqy)
+#define GBP_CAPTURE_TEXT_SIZE GBP_CAPTURE_TEXT_MAX
 #else
-void serialClock_ISR(void)
+#define GBP_CAPTURE_INQY      NULL
+#define GBP_CAPTURE_TEXT_SIZE GBP_CAPTURE_TEXT_PLAIN_MAX
 #endif
-{
-  // Serial Clock (1 = Rising Edge) (0 = Falling Edge); Master Output Slave Input (This device is slave)
-#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
-  const bool txBit = gpb_serial_io_OnRising_ISR(digitalRead(GBP_SO_PIN));
-#else
-  const bool txBit = gpb_serial_io_OnChange_ISR(digitalRead(GBP_SC_PIN), digitalRead(GBP_SO_PIN));
+inline void gbp_packet_capture_loop();
+static void gbp_packet_capture_flush(void);
+#endif
+#ifdef GBP_FEATURE_POOL
+inline void gbp_parse_packet_loop();
 #endif
-  digitalWrite(GBP_SI_PIN, txBit ? HIGH : LOW);
-}
-
 
 /*******************************************************************************
   Main Setup and Loop
@@ -169,18 +256,15 @@ void setup(void)
   Serial.begin(115200);
 
   // Wait for Serial to be ready
+#ifdef GBP_FEATURE_SPOOL
+  // Captures are spooled if no host turns up
+  while (!Serial && (millis() < GBP_SPOOL_SERIAL_WAIT_MS)) { ; }
+#else
   while (!Serial) { ; }
+#endif
 
   Connect_to_printer();  //makes an attempt to switch in printer mode
 
-  /* Pins from gameboy link cable */
-  pinMode(GBP_SC_PIN, INPUT);
-  pinMode(GBP_SO_PIN, INPUT);
-  pinMode(GBP_SI_PIN, OUTPUT);
-
-  /* Default link serial out pin state */
-  digitalWrite(GBP_SI_PIN, LOW);
-
   /* LED Indicator */
   pinMode(LED_STATUS_PIN, OUTPUT);
   digitalWrite(LED_STATUS_PIN, LOW);
@@ -188,31 +272,82 @@ void setup(void)
   /* Setup */
   gpb_serial_io_init(sizeof(gbp_serialIO_raw_buffer), gbp_serialIO_raw_buffer);
 
-  /* Attach ISR */
-#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
-  attachInterrupt(digitalPinToInterrupt(GBP_SC_PIN), serialClock_ISR, RISING);  // attach interrupt handler
-#else
-  attachInterrupt(digitalPinToInterrupt(GBP_SC_PIN), serialClock_ISR, CHANGE);  // attach interrupt handler
+  /* Runtime Settings */
+#ifdef GBP_FEATURE_SETTINGS
+  gbp_settings_setBuildDefaults(GBP_OUTPUT_RAW_PACKETS ? GBP_SETTINGS_MODE_RAW : GBP_SETTINGS_MODE_PARSE, GBP_USE_PARSE_DECOMPRESSOR);
+  gbp_settingsLoaded = gbp_settings_eeprom_load(&gbp_settings);
+  gbp_captureMode    = (gbp_settings.mode == GBP_SETTINGS_MODE_RAW);
+#ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+  gbp_useDecompressor = (gbp_settings.decompressor != 0);
+#endif
+  gbp_settings_applyLink();
+#endif
+
+  /* Link Cable (Pins and ISR) */
+  gbp_link_init();
+
+  /* Packet Capture */
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+  gbp_capture_fmt_init(&gbp_captureFmt, GBP_CAPTURE_INQY);
 #endif
 
   /* Packet Parser */
 #ifdef GBP_FEATURE_PARSE_PACKET_MODE
   gbp_pkt_init(&gbp_pktState);
 #endif
+#ifdef GBP_FEATURE_PIXEL_ROWS
+  gbp_tiles_strip_init(&tileStrip);
+#endif
+#ifdef GBP_FEATURE_POOL
+  gbp_pool_init(&gbp_pool);
+#endif
+
+  /* Parse Pipeline */
+#ifdef GBP_FEATURE_PIPELINE
+  const gbp_pipeline_io_t pipelineIO = { NULL, gbp_pipeline_read, gbp_pipeline_write, gbp_pipeline_sessionEnd };
+  gbp_pipeline_init(&gbp_pipeline, &pipelineIO, GBP_USE_PARSE_DECOMPRESSOR);
+#endif
+
+  /* Capture Spool */
+#ifdef GBP_FEATURE_SPOOL
+  gbp_spoolMounted = gbp_spool_sd_begin(&gbp_spoolStorage) && gbp_spool_mount(&gbp_spool, &gbp_spoolStorage);
+  gbp_spool_host_init(&gbp_spoolHost, millis());
+#endif
 
 #define VERSION_STRING "V3.2.1 (Copyright (C) 2022 Brian Khuu)"
 
   /* Welcome Message */
 #ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
-  Serial.println(F("// GAMEBOY PRINTER Packet Capture " VERSION_STRING));
-  Serial.println(F("// Note: Each byte is from each GBP packet is from the gameboy"));
-  Serial.println(F("//       except for the last two bytes which is from the printer"));
-  Serial.println(F("// JS Raw Packet Decoder: https://mofosyne.github.io/arduino-gameboy-printer-emulator/GameBoyPrinterDecoderJS/gameboy_printer_js_raw_decoder.html"));
+  if (GBP_CAPTURE_MODE_ACTIVE)
+  {
+    Serial.println(F("// GAMEBOY PRINTER Packet Capture " VERSION_STRING));
+    Serial.println(F("// Note: Each byte is from each GBP packet is from the gameboy"));
+    Serial.println(F("//       except for the last two bytes which is from the printer"));
+#ifdef GBP_FEATURE_INQY_SUMMARY
+    Serial.println(F("// Note: A run of inquiries is one '// INQY ID STATUS *COUNT ...' line, each reply repeated COUNT times"));
+#endif
+    Serial.println(F("// JS Raw Packet Decoder: https://mofosyne.github.io/arduino-gameboy-printer-emulator/GameBoyPrinterDecoderJS/gameboy_printer_js_raw_decoder.html"));
+  }
 #endif
 #ifdef GBP_FEATURE_PARSE_PACKET_MODE
-  Serial.println(F("// GAMEBOY PRINTER Emulator " VERSION_STRING));
-  Serial.println(F("// Note: Each hex encoded line is a gameboy tile"));
-  Serial.println(F("// JS Decoder: https://mofosyne.github.io/arduino-gameboy-printer-emulator/GameBoyPrinterDecoderJS/gameboy_printer_js_decoder.html"));
+  if (!GBP_CAPTURE_MODE_ACTIVE)
+  {
+    Serial.println(F("// GAMEBOY PRINTER Emulator " VERSION_STRING));
+#if defined(GBP_FEATURE_PIXEL_ROWS_BINARY)
+    if (GBP_DECOMPRESSOR_ACTIVE)
+      Serial.println(F("// Note: Each ROWS line is followed by 8 rows of 160 pixels (40 bytes each, 2bpp packed raw tones, first pixel in the low bits, palette in the next PRNT line)"));
+    else
+#elif defined(GBP_FEATURE_PIXEL_ROWS)
+    if (GBP_DECOMPRESSOR_ACTIVE)
+      Serial.println(F("// Note: Each hex encoded line is a row of 160 pixels (2bpp packed raw tones, first pixel in the low bits, palette in the next PRNT line)"));
+    else
+#endif
+      Serial.println(F("// Note: Each hex encoded line is a gameboy tile"));
+    Serial.println(F("// JS Decoder: https://mofosyne.github.io/arduino-gameboy-printer-emulator/GameBoyPrinterDecoderJS/gameboy_printer_js_decoder.html"));
+  }
+#endif
+#ifdef GBP_FEATURE_SETTINGS
+  Serial.println(gbp_settingsLoaded ? F("// Settings: loaded from EEPROM, s to list") : F("// Settings: defaults, s to list"));
 #endif
   Serial.println(F("// --- GNU GENERAL PUBLIC LICENSE Version 3, 29 June 2007 ---"));
   Serial.println(F("// This program comes with ABSOLUTELY NO WARRANTY;"));
@@ -221,6 +356,14 @@ void setup(void)
   Serial.println(F("// ---"));
 
   Serial.flush();
+
+#ifdef GBP_FEATURE_PIPELINE
+  // Capture stays with the link ISR (attached on this core), parse and output move to the other core
+  const int linkCore                     = xPortGetCoreID();
+  const gbp_pipeline_cores_t pipelineCores = { linkCore, !linkCore, !linkCore };
+  if (!gbp_pipeline_start(&gbp_pipeline, &pipelineCores))
+    Serial.println(F("// Pipeline tasks failed to start"));
+#endif
 }  // setup()
 
 void loop()
@@ -228,12 +371,18 @@ void loop()
   static uint16_t sioWaterline = 0;
 
 #ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
-  gbp_packet_capture_loop();
+  if (GBP_CAPTURE_MODE_ACTIVE)
+    gbp_packet_capture_loop();
 #endif
-#ifdef GBP_FEATURE_PARSE_PACKET_MODE
-  gbp_parse_packet_loop();
+#if defined(GBP_FEATURE_PARSE_PACKET_MODE) && !defined(GBP_FEATURE_PIPELINE)
+  if (!GBP_CAPTURE_MODE_ACTIVE)
+  {
+    gbp_parse_packet_loop();
+    gbp_pool_outputStep(&gbp_pool, gbp_pool_serialWrite, NULL);
+  }
 #endif
 
+#ifndef GBP_FEATURE_PIPELINE
   // Trigger Timeout and reset the printer if byte stopped being received.
   static uint32_t last_millis = 0;
   uint32_t curr_millis        = millis();
@@ -242,13 +391,32 @@ void loop()
     uint32_t elapsed_ms = curr_millis - last_millis;
     if (gbp_serial_io_timeout_handler(elapsed_ms))
     {
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+      if (GBP_CAPTURE_MODE_ACTIVE)
+        gbp_packet_capture_flush();
+#endif
+#ifdef GBP_FEATURE_POOL
+      gbp_pool_drain();
+#endif
       Serial.println("");
-      Serial.print("// Completed ");
-      Serial.print("(Memory Waterline: ");
+      Serial.print(F("// Completed "));
+      Serial.print(F("(Memory Waterline: "));
       Serial.print(gbp_serial_io_dataBuff_waterline(false));
-      Serial.print("B out of ");
+      Serial.print(F("B out of "));
       Serial.print(gbp_serial_io_dataBuff_max());
-      Serial.println("B)");
+      Serial.println(F("B)"));
+#ifdef GBP_FEATURE_BYTE_GAP_RESYNC
+      Serial.print(F("// Link resyncs: "));
+      Serial.println(gbp_serial_io_resyncCount(true));
+#endif
+#ifdef GBP_FEATURE_SETTINGS
+      if ((gbp_settings.watermarkPercent > 0) && ((uint32_t)gbp_serial_io_dataBuff_waterline(false) * 100 >= (uint32_t)gbp_settings.watermarkPercent * gbp_serial_io_dataBuff_max()))
+      {
+        Serial.print(F("// Warning: buffer waterline is past the "));
+        Serial.print(gbp_settings.watermarkPercent);
+        Serial.println(F("% watermark, output may be too slow for this game"));
+      }
+#endif
       Serial.flush();
       digitalWrite(LED_STATUS_PIN, LOW);
 
@@ -257,227 +425,449 @@ void loop()
 #ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
       tileBuff.count = 0;
 #endif
+#ifdef GBP_FEATURE_PIXEL_ROWS
+      gbp_tiles_strip_reset(&tileStrip);
+#endif
+#endif
+
+#ifdef GBP_FEATURE_SPOOL
+      gbp_spool_sd_flush();
+      if (gbp_spoolSession)
+      {
+        gbp_spoolSession = false;
+        Serial.print(F("// Spooled ("));
+        Serial.print(gbp_spool.bytesSpooled);
+        Serial.println(F("B since power on) press r to replay"));
+        Serial.flush();
+      }
 #endif
     }
   }
   last_millis = curr_millis;
+#endif
+
+#ifdef GBP_FEATURE_SPOOL
+  gbp_spool_sd_poll();
+  gbp_spool_host_txRoom(&gbp_spoolHost, GBP_SPOOL_SERIAL_ROOM(), millis());
+#endif
 
   // Diagnostics Console
   while (Serial.available() > 0)
   {
-    switch (Serial.read())
+    const char ch = (char)Serial.read();
+#ifdef GBP_FEATURE_SPOOL
+    // Any byte is a keep-alive (e.g. a newline, which is not a command)
+    gbp_spool_host_heard(&gbp_spoolHost, millis());
+#endif
+#ifdef GBP_FEATURE_POOL
+    // Replies would otherwise land in the middle of a parsed line
+    gbp_pool_drain();
+#endif
+#ifdef GBP_FEATURE_SETTINGS
+    // Rest of an `s` command line
+    if (gbp_settingsConsole.active)
+    {
+      if (gbp_settings_console_byte(&gbp_settingsConsole, ch))
+        gbp_settings_console_run();
+      continue;
+    }
+#endif
+    switch (ch)
     {
       case '?':
-        Serial.println("d=debug, ?=help");
+#ifdef GBP_FEATURE_SPOOL
+        Serial.println(F("d=debug, r=replay spool, c=clear spool, ?=help"));
+#else
+        Serial.println(F("d=debug, ?=help"));
+#endif
+#ifdef GBP_FEATURE_SETTINGS
+        Serial.println(F("s=list settings, s KEY, s KEY=VALUE, s save, s load, s defaults (end each with a newline)"));
+#endif
         break;
 
       case 'd':
-        Serial.print("waterline: ");
+        Serial.print(F("waterline: "));
         Serial.print(gbp_serial_io_dataBuff_waterline(false));
-        Serial.print("B out of ");
+        Serial.print(F("B out of "));
         Serial.print(gbp_serial_io_dataBuff_max());
-        Serial.println("B");
+        Serial.println(F("B"));
+#ifdef GBP_FEATURE_POOL
+        Serial.print(F("pool: "));
+        Serial.print(GBP_POOL_SLOTS);
+        Serial.print(F(" slots, high water "));
+        Serial.print(gbp_pool.highWater);
+        Serial.print(F(", "));
+        Serial.print(gbp_pool.parserStalls);
+        Serial.print(F(" parser stalls, "));
+        Serial.print(gbp_pool.linesOutput);
+        Serial.println(F(" lines"));
+#endif
+#ifdef GBP_FEATURE_SPOOL
+        Serial.print(F("spool: "));
+        Serial.print(gbp_spoolMounted ? F("mounted, ") : F("no card, "));
+        Serial.print(gbp_spool.bytesSpooled);
+        Serial.print(F("B spooled, "));
+        Serial.print(gbp_spool.segmentsDropped);
+        Serial.println(F(" segments dropped"));
+#endif
+        break;
+
+#ifdef GBP_FEATURE_SPOOL
+      case 'r':
+        gbp_spool_replay_console();
+        break;
+
+      case 'c':
+        Serial.println(gbp_spool_clear(&gbp_spool) ? F("// Spool cleared") : F("// Spool clear failed"));
         break;
+#endif
+
+#ifdef GBP_FEATURE_SETTINGS
+      case 's':
+        gbp_settings_console_begin(&gbp_settingsConsole);
+        break;
+#endif
     }
   };
 }  // loop()
 
 /******************************************************************************/
 
-#ifdef GBP_FEATURE_PARSE_PACKET_MODE
+#ifdef GBP_FEATURE_POOL
+static void gbp_parse_event(gbp_pipeline_event_t *evt, gbp_pipeline_event_type_t type, const uint8_t *data, uint8_t size)
+{
+  evt->type        = type;
+  evt->command     = gbp_pktState.command;
+  evt->compression = gbp_pktState.compression;
+  evt->status      = gbp_pktState.status;
+  evt->dataLength  = gbp_pktState.dataLength;
+  evt->size        = size;
+  if (size > 0)
+    memcpy(evt->data, data, size);
+}
+
+#ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+// A payload is decompressed in one go, so its tiles wait for output to free a slot
+static gbp_pipeline_event_t *gbp_parse_waitSlot(void)
+{
+  gbp_pipeline_event_t *evt;
+  while ((evt = gbp_pool_acquire(&gbp_pool)) == NULL)
+    gbp_pool_outputStep(&gbp_pool, gbp_pool_serialWrite, NULL);
+  return evt;
+}
+#endif
+
 inline void gbp_parse_packet_loop(void)
 {
-  const char nibbleToCharLUT[] = "0123456789ABCDEF";
   for (int i = 0; i < gbp_serial_io_dataBuff_getByteCount(); i++)
   {
+    // Every slot is still waiting for output. Bytes stay in dataBuff until one frees
+    gbp_pipeline_event_t *evt = gbp_pool_acquire(&gbp_pool);
+    if (evt == NULL)
+      break;
+
     if (gbp_pkt_processByte(&gbp_pktState, (const uint8_t)gbp_serial_io_dataBuff_getByte(), gbp_pktbuff, &gbp_pktbuffSize, sizeof(gbp_pktbuff)))
     {
       if (gbp_pktState.received == GBP_REC_GOT_PACKET)
       {
         digitalWrite(LED_STATUS_PIN, HIGH);
-        Serial.print((char)'{');
-        Serial.print("\"command\":\"");
-        Serial.print(gbpCommand_toStr(gbp_pktState.command));
-        Serial.print("\"");
-        if (gbp_pktState.command == GBP_COMMAND_INQUIRY)
-        {
-          // !{"command":"INQY","status":{"lowbatt":0,"jam":0,"err":0,"pkterr":0,"unproc":1,"full":0,"bsy":0,"chk_err":0}}
-          Serial.print(", \"status\":{");
-          Serial.print("\"LowBat\":");
-          Serial.print(gpb_status_bit_getbit_low_battery(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"ER2\":");
-          Serial.print(gpb_status_bit_getbit_other_error(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"ER1\":");
-          Serial.print(gpb_status_bit_getbit_paper_jam(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"ER0\":");
-          Serial.print(gpb_status_bit_getbit_packet_error(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"Untran\":");
-          Serial.print(gpb_status_bit_getbit_unprocessed_data(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"Full\":");
-          Serial.print(gpb_status_bit_getbit_print_buffer_full(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"Busy\":");
-          Serial.print(gpb_status_bit_getbit_printer_busy(gbp_pktState.status) ? '1' : '0');
-          Serial.print(",\"Sum\":");
-          Serial.print(gpb_status_bit_getbit_checksum_error(gbp_pktState.status) ? '1' : '0');
-          Serial.print((char)'}');
-        }
-        if (gbp_pktState.command == GBP_COMMAND_PRINT)
-        {
-          //!{"command":"PRNT","sheets":1,"margin_upper":1,"margin_lower":3,"pallet":228,"density":64 }
-          Serial.print(", \"sheets\":");
-          Serial.print(gbp_pkt_printInstruction_num_of_sheets(gbp_pktbuff));
-          Serial.print(", \"margin_upper\":");
-          Serial.print(gbp_pkt_printInstruction_num_of_linefeed_before_print(gbp_pktbuff));
-          Serial.print(", \"margin_lower\":");
-          Serial.print(gbp_pkt_printInstruction_num_of_linefeed_after_print(gbp_pktbuff));
-          Serial.print(", \"pallet\":");
-          Serial.print(gbp_pkt_printInstruction_palette_value(gbp_pktbuff));
-          Serial.print(", \"density\":");
-          Serial.print(gbp_pkt_printInstruction_print_density(gbp_pktbuff));
-        }
-        if (gbp_pktState.command == GBP_COMMAND_DATA)
-        {
-          //!{"command":"DATA", "compressed":0, "more":0}
+        gbp_parse_event(evt, GBP_PIPELINE_EVENT_PACKET, gbp_pktbuff, gbp_pktbuffSize);
 #ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
-          Serial.print(", \"compressed\":0");  // Already decompressed by us, so no need to do so
-#else
-          Serial.print(", \"compressed\":");
-          Serial.print(gbp_pktState.compression);
+        if (GBP_DECOMPRESSOR_ACTIVE)
+          evt->compression = 0;  // Already decompressed by us, so no need to do so
 #endif
-          Serial.print(", \"more\":");
-          Serial.print((gbp_pktState.dataLength != 0) ? '1' : '0');
-        }
-        Serial.println((char)'}');
-        Serial.flush();
+        gbp_pool_commit(&gbp_pool);
       }
       else
       {
 #ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
-        // Required for more complex games with compression support
-        while (gbp_pkt_decompressor(&gbp_pktState, gbp_pktbuff, gbp_pktbuffSize, &tileBuff))
+        if (GBP_DECOMPRESSOR_ACTIVE)
         {
-          if (gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
+          // Required for more complex games with compression support
+          while (gbp_pkt_decompressor(&gbp_pktState, gbp_pktbuff, gbp_pktbuffSize, &tileBuff))
           {
-            // Got Tile
-            for (int i = 0; i < GBP_TILE_SIZE_IN_BYTE; i++)
+            if (gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
             {
-              const uint8_t data_8bit = tileBuff.tile[i];
-              if (i == GBP_TILE_SIZE_IN_BYTE - 1)
+#ifdef GBP_FEATURE_PIXEL_ROWS
+              // Got Tile. Output once a full line of tiles is decoded, after the lines already queued
+              if (gbp_tiles_strip_addTile(&tileStrip, tileBuff.tile))
               {
-                Serial.print((char)nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
-                Serial.println((char)nibbleToCharLUT[(data_8bit >> 0) & 0xF]);  // use println on last byte to reduce serial calls
-              }
-              else
-              {
-                Serial.print((char)nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
-                Serial.print((char)nibbleToCharLUT[(data_8bit >> 0) & 0xF]);
-                Serial.print((char)' ');
+                gbp_pool_drain();
+                gbp_pixel_rows_output(&tileStrip);
               }
+#else
+              // Got Tile
+              gbp_parse_event(gbp_parse_waitSlot(), GBP_PIPELINE_EVENT_DATA, tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+              gbp_pool_commit(&gbp_pool);
+#endif
             }
-            Serial.flush();
           }
         }
-#else
+        else
+#endif
         // Simplified support for gameboy camera only application
         // Dev Note: Good for checking if everything above decompressor is working
         if (gbp_pktbuffSize > 0)
         {
           // Got Tile
-          for (int i = 0; i < gbp_pktbuffSize; i++)
-          {
-            const uint8_t data_8bit = gbp_pktbuff[i];
-            if (i == gbp_pktbuffSize - 1)
-            {
-              Serial.print((char)nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
-              Serial.println((char)nibbleToCharLUT[(data_8bit >> 0) & 0xF]);  // use println on last byte to reduce serial calls
-            }
-            else
-            {
-              Serial.print((char)nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
-              Serial.print((char)nibbleToCharLUT[(data_8bit >> 0) & 0xF]);
-              Serial.print((char)' ');
-            }
-          }
-          Serial.flush();
+          gbp_parse_event(evt, GBP_PIPELINE_EVENT_DATA, gbp_pktbuff, gbp_pktbuffSize);
+          gbp_pool_commit(&gbp_pool);
         }
-#endif
       }
     }
   }
 }
+
+// Only what fits in the serial TX buffer, so the loop never waits on the UART
+static size_t gbp_pool_serialWrite(void *ctx, const char *text, size_t len)
+{
+  (void)ctx;
+  const int room = GBP_POOL_SERIAL_ROOM();
+  if (room <= 0)
+    return 0;
+  if (len > (size_t)room)
+    len = (size_t)room;
+  return Serial.write((const uint8_t *)text, len);
+}
+
+// Before printing anything that does not go through the pool
+static void gbp_pool_drain(void)
+{
+  while (!gbp_pool_isIdle(&gbp_pool))
+    gbp_pool_outputStep(&gbp_pool, gbp_pool_serialWrite, NULL);
+}
+#endif
+
+#ifdef GBP_FEATURE_PIXEL_ROWS
+inline void gbp_pixel_rows_output(gbp_tiles_strip_t *strip)
+{
+#ifdef GBP_FEATURE_PIXEL_ROWS_BINARY
+  // Binary rows, preceded by a line saying how many bytes follow
+  Serial.print(F("{\"command\":\"ROWS\", \"width\":"));
+  Serial.print(GBP_TILES_STRIP_PIXEL_WIDTH);
+  Serial.print(F(", \"height\":"));
+  Serial.print(GBP_TILE_PIXEL_HEIGHT);
+  Serial.print(F(", \"bytes\":"));
+  Serial.print(sizeof(strip->rows));
+  Serial.println((char)'}');
+  Serial.write((const uint8_t *)strip->rows, sizeof(strip->rows));
+#else
+  // One hex line per pixel row, written in one go to reduce serial calls
+  const char nibbleToCharLUT[] = "0123456789ABCDEF";
+  char line[GBP_TILES_STRIP_ROW_SIZE * 3 + 1];
+  for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
+  {
+    for (int i = 0; i < GBP_TILES_STRIP_ROW_SIZE; i++)
+    {
+      const uint8_t data_8bit = strip->rows[j][i];
+      line[i * 3 + 0]         = nibbleToCharLUT[(data_8bit >> 4) & 0xF];
+      line[i * 3 + 1]         = nibbleToCharLUT[(data_8bit >> 0) & 0xF];
+      line[i * 3 + 2]         = ' ';
+    }
+    line[GBP_TILES_STRIP_ROW_SIZE * 3 - 1] = '\r';
+    line[GBP_TILES_STRIP_ROW_SIZE * 3]     = '\n';
+    Serial.write(line, sizeof(line));
+  }
+#endif
+  Serial.flush();
+}
+#endif
+
+#ifdef GBP_FEATURE_SETTINGS
+static void gbp_settings_applyLink(void)
+{
+  gbp_serial_io_setTimeout(gbp_settings.timeoutMs);
+  gbp_serial_io_setBusyPacketCount(gbp_settings.busyPacketCount);
+}
+
+static void gbp_settings_serialWrite(void *ctx, const char *text)
+{
+  (void)ctx;
+  Serial.println(text);
+}
+
+static void gbp_settings_console_run(void)
+{
+  switch (gbp_settings_command(&gbp_settings, &gbp_settingsConsole, gbp_settings_serialWrite, NULL))
+  {
+    case GBP_SETTINGS_CMD_CHANGED:
+      gbp_settings_applyLink();
+      break;
+    case GBP_SETTINGS_CMD_SAVE:
+      gbp_settings_reply(gbp_settings_eeprom_save(&gbp_settings), GBP_PSTR("eeprom write failed"), gbp_settings_serialWrite, NULL);
+      break;
+    case GBP_SETTINGS_CMD_LOAD:
+      gbp_settings_reply(gbp_settings_eeprom_load(&gbp_settings), GBP_PSTR("no valid block, defaults loaded"), gbp_settings_serialWrite, NULL);
+      gbp_settings_applyLink();
+      break;
+    default:
+      break;
+  }
+  Serial.flush();
+}
+#endif
+
+#ifdef GBP_FEATURE_PIPELINE
+// Capture task
+static size_t gbp_pipeline_read(void *ctx, uint8_t *data, size_t max, bool *sessionEnd)
+{
+  static uint32_t last_millis = 0;
+  size_t count                = 0;
+  while ((count < max) && (gbp_serial_io_dataBuff_getByteCount() > 0))
+    data[count++] = gbp_serial_io_dataBuff_getByte();
+  // Trigger Timeout and reset the printer if byte stopped being received.
+  const uint32_t curr_millis = millis();
+  if (curr_millis > last_millis)
+    *sessionEnd = gbp_serial_io_timeout_handler(curr_millis - last_millis);
+  last_millis = curr_millis;
+  return count;
+}
+
+// Output task
+static void gbp_pipeline_write(void *ctx, const char *text, size_t len)
+{
+  digitalWrite(LED_STATUS_PIN, HIGH);
+  Serial.write(text, len);
+}
+
+// Output task
+static void gbp_pipeline_sessionEnd(void *ctx)
+{
+  Serial.println("");
+  Serial.print(F("// Completed "));
+  Serial.print(F("(Memory Waterline: "));
+  Serial.print(gbp_serial_io_dataBuff_waterline(false));
+  Serial.print(F("B out of "));
+  Serial.print(gbp_serial_io_dataBuff_max());
+  Serial.println(F("B)"));
+#ifdef GBP_FEATURE_BYTE_GAP_RESYNC
+  Serial.print(F("// Link resyncs: "));
+  Serial.println(gbp_serial_io_resyncCount(true));
+#endif
+  Serial.flush();
+  digitalWrite(LED_STATUS_PIN, LOW);
+}
 #endif
 
 #ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
 inline void gbp_packet_capture_loop()
 {
   /* tiles received */
-  static uint32_t byteTotal     = 0;
-  static uint32_t pktTotalCount = 0;
-  static uint32_t pktByteIndex  = 0;
-  static uint16_t pktDataLength = 0;
-  const size_t dataBuffCount    = gbp_serial_io_dataBuff_getByteCount();
-  if (
-    ((pktByteIndex != 0) && (dataBuffCount > 0)) || ((pktByteIndex == 0) && (dataBuffCount >= 6)))
+  const size_t dataBuffCount = gbp_serial_io_dataBuff_getByteCount();
+  if (dataBuffCount == 0)
+    return;
+
+#ifdef GBP_FEATURE_SPOOL
+  uint8_t spoolChunk[GBP_SPOOL_RECORD_MAX_SIZE];
+  size_t spoolChunkSize = 0;
+#endif
+  char text[GBP_CAPTURE_TEXT_SIZE];
+  for (size_t i = 0; i < dataBuffCount; i++)
   {
-    const char nibbleToCharLUT[] = "0123456789ABCDEF";
-    uint8_t data_8bit            = 0;
-    for (int i = 0; i < dataBuffCount; i++)
-    {  // Display the data payload encoded in hex
-      // Start of a new packet
-      if (pktByteIndex == 0)
-      {
-        pktDataLength = gbp_serial_io_dataBuff_getByte_Peek(4);
-        pktDataLength |= (gbp_serial_io_dataBuff_getByte_Peek(5) << 8) & 0xFF00;
-#if 0
-        Serial.print("// ");
-        Serial.print(pktTotalCount);
-        Serial.print(" : ");
-        Serial.println(gbpCommand_toStr(gbp_serial_io_dataBuff_getByte_Peek(2)));
+    // Start of a new packet
+    if (gbp_captureFmt.pktByteIndex == 0)
+    {
+      digitalWrite(LED_STATUS_PIN, HIGH);
+#ifdef GBP_FEATURE_SPOOL
+      // Sink only changes between packets, so a spooled session replays as whole packets
+      if (gbp_spoolMounted && !gbp_spoolSession
+          && !gbp_spool_host_ready(&gbp_spoolHost, GBP_SPOOL_HOST_LINK(), gbp_serial_io_dataBuff_getByteCount(), gbp_serial_io_dataBuff_max(), millis()))
+        gbp_spoolSession = true;
 #endif
-        digitalWrite(LED_STATUS_PIN, HIGH);
-      }
-      // Print Hex Byte
-      data_8bit = gbp_serial_io_dataBuff_getByte();
-      Serial.print((char)nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
-      Serial.print((char)nibbleToCharLUT[(data_8bit >> 0) & 0xF]);
-      // Splitting packets for convenience
-      if ((pktByteIndex > 5) && (pktByteIndex >= (9 + pktDataLength)))
-      {
-        digitalWrite(LED_STATUS_PIN, LOW);
-        Serial.println("");
-        pktByteIndex = 0;
-        pktTotalCount++;
-      }
-      else
+    }
+
+    const uint8_t data_8bit = gbp_serial_io_dataBuff_getByte();
+    const size_t textLen    = gbp_capture_fmt_byte(&gbp_captureFmt, data_8bit, text);
+#ifdef GBP_FEATURE_SPOOL
+    if (gbp_spoolSession)
+    {
+      spoolChunk[spoolChunkSize++] = data_8bit;
+      if (spoolChunkSize == sizeof(spoolChunk))
       {
-        Serial.print((char)' ');
-        pktByteIndex++;  // Byte hex split counter
-        byteTotal++;     // Byte total counter
+        gbp_spool_append(&gbp_spool, spoolChunk, spoolChunkSize);
+        spoolChunkSize = 0;
       }
     }
-    Serial.flush();
+    else
+#endif
+    {
+      // Print Hex Byte (Nothing while an inquiry is held for the summary)
+      Serial.write(text, textLen);
+    }
+
+    // End of packet
+    if (gbp_captureFmt.pktByteIndex == 0)
+      digitalWrite(LED_STATUS_PIN, LOW);
   }
+#ifdef GBP_FEATURE_SPOOL
+  if (spoolChunkSize > 0)
+    gbp_spool_append(&gbp_spool, spoolChunk, spoolChunkSize);
+#endif
+  Serial.flush();
+}
+
+// Inquiry summary held back at the end of a session
+static void gbp_packet_capture_flush(void)
+{
+  char text[GBP_CAPTURE_TEXT_SIZE];
+  const size_t textLen = gbp_capture_fmt_flush(&gbp_captureFmt, text);
+#ifdef GBP_FEATURE_SPOOL
+  if (gbp_spoolSession)
+    return;
+#endif
+  Serial.write(text, textLen);
 }
 #endif
 
-void Connect_to_printer()
+#ifdef GBP_FEATURE_SPOOL
+static void gbp_spool_replay_cb(void *ctx, const uint8_t *data, size_t len)
 {
-#if GAME_BOY_PRINTER_MODE  //Printer mode
-  pinMode(GBP_SC_PIN, OUTPUT);
-  pinMode(GBP_SO_PIN, INPUT_PULLUP);
-  pinMode(GBP_SI_PIN, OUTPUT);
-  pinMode(LED_STATUS_PIN, OUTPUT);
-  const char INIT[] = { 0x88, 0x33, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00 };  //INIT command
-  uint8_t junk, status;
-  for (uint8_t i = 0; i < 10; i++)
+  // Whole record per write call to keep up with the serial port
+  gbp_capture_fmt_t *fmt = (gbp_capture_fmt_t *)ctx;
+  char line[GBP_SPOOL_RECORD_MAX_SIZE * 4];
+  char text[GBP_CAPTURE_TEXT_SIZE];
+  size_t lineLen = 0;
+  for (size_t i = 0; i < len; i++)
   {
-    junk = (printing(INIT[i]));
-    if (i == 8)
+    const size_t textLen = gbp_capture_fmt_byte(fmt, data[i], text);
+    if ((lineLen + textLen) > sizeof(line))
     {
-      status = junk;
+      Serial.write(line, lineLen);
+      lineLen = 0;
     }
+    memcpy(&line[lineLen], text, textLen);
+    lineLen += textLen;
   }
-  if (status == 0X81)  //Printer connected !
+  Serial.write(line, lineLen);
+}
+
+void gbp_spool_replay_console(void)
+{
+  gbp_capture_fmt_t replayFmt;
+#ifdef GBP_FEATURE_INQY_SUMMARY
+  gbp_capture_inqy_t replayInqy;
+  gbp_capture_fmt_init(&replayFmt, &replayInqy);
+#else
+  gbp_capture_fmt_init(&replayFmt, NULL);
+#endif
+  Serial.println(F("// Spool Replay Start"));
+  const uint32_t byteCount = gbp_spool_replay(&gbp_spool, gbp_spool_replay_cb, &replayFmt);
+  char text[GBP_CAPTURE_TEXT_SIZE];
+  Serial.write(text, gbp_capture_fmt_flush(&replayFmt, text));
+  if (replayFmt.pktByteIndex != 0)
+    Serial.println("");
+  Serial.print(F("// Spool Replay End ("));
+  Serial.print(byteCount);
+  Serial.println(F("B)"));
+  Serial.flush();
+}
+#endif
+
+void Connect_to_printer()
+{
+#if GAME_BOY_PRINTER_MODE  //Printer mode
+  gbp_bridge_init();
+  if (gbp_bridge_probe())  //Printer connected !
   {
     digitalWrite(GBP_SC_PIN, HIGH);  //acts like a real Game Boy
     digitalWrite(GBP_SI_PIN, LOW);   //acts like a real Game Boy
@@ -497,33 +887,9 @@ void Connect_to_printer()
     {
       if (Serial.available() > 0)
       {
-        Serial.write(printing(Serial.read()));
+        Serial.write(gbp_bridge_transferByte(Serial.read()));
       }
     }
   }
 #endif
 }
-
-#if GAME_BOY_PRINTER_MODE      //Printer mode
-char printing(char byte_sent)  // this function prints bytes to the serial
-{
-  bool bit_sent, bit_read;
-  char byte_read;
-  for (int i = 0; i <= 7; i++)
-  {
-    bit_sent = bitRead(byte_sent, 7 - i);
-    digitalWrite(GBP_SC_PIN, LOW);
-    digitalWrite(GBP_SI_PIN, bit_sent);  //GBP_SI_PIN is SOUT for the printer
-    digitalWrite(LED_STATUS_PIN, bit_sent);
-    delayMicroseconds(30);  //double speed mode
-    digitalWrite(GBP_SC_PIN, HIGH);
-    bit_read = (digitalRead(GBP_SO_PIN));  //GBP_SO_PIN is SIN for the printer
-    bitWrite(byte_read, 7 - i, bit_read);
-    delayMicroseconds(30);  //double speed mode
-  }
-  delayMicroseconds(0);  //optionnal delay between bytes, may be less than 1490 µs
-  //  Serial.println(byte_sent, HEX);
-  //  Serial.println(byte_read, HEX);
-  return byte_read;
-}
-#endif
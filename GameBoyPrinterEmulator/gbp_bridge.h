@@ -0,0 +1,141 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Bridge
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Plays the gameboy side of the link, to drive a real printer
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Printer Bridge (GAME_BOY_PRINTER_MODE)
+
+  With a real printer on the link cable, the emulator drives the clock and
+  forwards each byte from the serial console to the printer, writing back the
+  byte the printer shifted out at the same time.
+
+  * (default) GPIO : digitalWrite()/digitalRead() and delayMicroseconds()
+  * GBP_FEATURE_LINK_SIM : No hardware. Each clock edge calls the printer in
+                     gbp_bridge_sim (e.g. test/gbp_printer_model.h), and
+                     delays advance gbp_bridge_sim.now_us instead of waiting,
+                     so host tests run faster than real time
+
+  Include this after the GBP_*_PIN definitions.
+*******************************************************************************/
+#ifndef GBP_BRIDGE_H
+#define GBP_BRIDGE_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#include "gameboy_printer_protocol.h"
+
+#define GBP_BRIDGE_HALF_BIT_US 30  // Double speed mode
+#define GBP_BRIDGE_BYTE_GAP_US 0   // Optional delay between bytes, may be less than 1490 us
+
+#if defined(GBP_FEATURE_LINK_SIM)
+/*******************************************************************************
+  Simulated Printer (Host Testing)
+*******************************************************************************/
+
+// Printer on the other end: called on every clock edge, returns its output level
+typedef bool (*gbp_bridge_sim_printer_t)(void *ctx, bool clock, bool bridgeOut, uint32_t now_us);
+
+typedef struct
+{
+  gbp_bridge_sim_printer_t printer;  ///< NULL is no printer (input pulled up)
+  void *ctx;
+  uint32_t now_us;  ///< Link time
+  bool clock;
+  bool out;         ///< Bridge to printer
+  bool in;          ///< Printer to bridge
+} gbp_bridge_sim_t;
+
+static gbp_bridge_sim_t gbp_bridge_sim = {NULL, NULL, 0, true, false, true};
+
+static inline void gbp_bridge_init(void)
+{
+  gbp_bridge_sim.clock = true;
+  gbp_bridge_sim.out   = false;
+  gbp_bridge_sim.in    = true;
+}
+static inline void gbp_bridge_setClock(const bool high)
+{
+  gbp_bridge_sim.clock = high;
+  gbp_bridge_sim.in    = gbp_bridge_sim.printer ? gbp_bridge_sim.printer(gbp_bridge_sim.ctx, high, gbp_bridge_sim.out, gbp_bridge_sim.now_us) : true;
+}
+static inline void gbp_bridge_setOut(const bool high) { gbp_bridge_sim.out = high; }
+static inline bool gbp_bridge_readIn(void) { return gbp_bridge_sim.in; }
+static inline void gbp_bridge_delayUs(const uint32_t us) { gbp_bridge_sim.now_us += us; }
+
+#else
+/*******************************************************************************
+  GPIO
+*******************************************************************************/
+
+static inline void gbp_bridge_init(void)
+{
+  pinMode(GBP_SC_PIN, OUTPUT);
+  pinMode(GBP_SO_PIN, INPUT_PULLUP);
+  pinMode(GBP_SI_PIN, OUTPUT);
+  pinMode(LED_STATUS_PIN, OUTPUT);
+}
+static inline void gbp_bridge_setClock(const bool high) { digitalWrite(GBP_SC_PIN, high ? HIGH : LOW); }
+static inline void gbp_bridge_setOut(const bool high)
+{
+  digitalWrite(GBP_SI_PIN, high ? HIGH : LOW);  // GBP_SI_PIN is SOUT for the printer
+  digitalWrite(LED_STATUS_PIN, high ? HIGH : LOW);
+}
+static inline bool gbp_bridge_readIn(void) { return digitalRead(GBP_SO_PIN) == HIGH; }  // GBP_SO_PIN is SIN for the printer
+static inline void gbp_bridge_delayUs(const uint32_t us) { if (us > 0) delayMicroseconds(us); }
+
+#endif
+
+/******************************************************************************/
+
+// Sends one byte to the printer, returns the byte it sent back at the same time
+static inline uint8_t gbp_bridge_transferByte(const uint8_t byteSent)
+{
+  uint8_t byteRead = 0;
+  for (int i = 0; i <= 7; i++)
+  {
+    gbp_bridge_setClock(false);
+    gbp_bridge_setOut(((byteSent >> (7 - i)) & 0x01) != 0);
+    gbp_bridge_delayUs(GBP_BRIDGE_HALF_BIT_US);
+    gbp_bridge_setClock(true);
+    byteRead |= (gbp_bridge_readIn() ? 1 : 0) << (7 - i);
+    gbp_bridge_delayUs(GBP_BRIDGE_HALF_BIT_US);
+  }
+  gbp_bridge_delayUs(GBP_BRIDGE_BYTE_GAP_US);
+  return byteRead;
+}
+
+// Sends an INIT packet. True if a printer answered with its device ID
+static inline bool gbp_bridge_probe(void)
+{
+  const uint8_t INIT[] = {GBP_SYNC_WORD_0, GBP_SYNC_WORD_1, GBP_COMMAND_INIT, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00};
+  uint8_t status = 0;
+  for (uint8_t i = 0; i < sizeof(INIT); i++)
+  {
+    const uint8_t reply = gbp_bridge_transferByte(INIT[i]);
+    if (i == 8)
+      status = reply;
+  }
+  return status == GBP_DEVICE_ID;
+}
+
+/******************************************************************************/
+#endif
@@ -0,0 +1,197 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Output
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Raw packet capture mode text, one packet per line, with optional inquiry summary
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_capture.h"
+
+static const uint8_t gbp_capture_inqyHeader[GBP_CAPTURE_INQY_HEADER_SIZE] = {0x88, 0x33, 0x0F, 0x00, 0x00, 0x00, 0x0F, 0x00};
+
+void gbp_capture_fmt_init(gbp_capture_fmt_t *fmt, gbp_capture_inqy_t *inqy)
+{
+  memset(fmt, 0, sizeof(*fmt));
+  fmt->inqy = inqy;
+  if (inqy)
+  {
+    memset(inqy, 0, sizeof(*inqy));
+    inqy->holding = true;
+  }
+}
+
+/*******************************************************************************
+  Text
+*******************************************************************************/
+
+static size_t gbp_capture_hex(const uint8_t b, char *out)
+{
+  const char nibbleToCharLUT[] = "0123456789ABCDEF";
+  out[0] = nibbleToCharLUT[(b >> 4) & 0xF];
+  out[1] = nibbleToCharLUT[(b >> 0) & 0xF];
+  return 2;
+}
+
+static size_t gbp_capture_decimal(uint16_t v, char *out)
+{
+  char digits[5];
+  size_t n = 0;
+  do
+  {
+    digits[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v > 0);
+  for (size_t i = 0; i < n; i++)
+    out[i] = digits[n - 1 - i];
+  return n;
+}
+
+// Summary line of the inquiry runs so far
+static size_t gbp_capture_inqyLine(gbp_capture_inqy_t *inqy, char *out)
+{
+  if (inqy->runCount == 0)
+    return 0;
+
+  size_t len = 0;
+  memcpy(&out[len], "// INQY", 7);
+  len += 7;
+  for (uint8_t i = 0; i < inqy->runCount; i++)
+  {
+    out[len++] = ' ';
+    len += gbp_capture_hex(inqy->runs[i].printerID, &out[len]);
+    out[len++] = ' ';
+    len += gbp_capture_hex(inqy->runs[i].status, &out[len]);
+    out[len++] = ' ';
+    out[len++] = '*';
+    len += gbp_capture_decimal(inqy->runs[i].count, &out[len]);
+  }
+  out[len++] = '\r';
+  out[len++] = '\n';
+  inqy->runCount = 0;
+  return len;
+}
+
+// Held bytes of this packet, as they would have been output
+static size_t gbp_capture_heldBytes(gbp_capture_fmt_t *fmt, char *out)
+{
+  size_t len = 0;
+  for (uint32_t i = 0; i < fmt->pktByteIndex; i++)
+  {
+    len += gbp_capture_hex((i < GBP_CAPTURE_INQY_HEADER_SIZE) ? gbp_capture_inqyHeader[i] : fmt->inqy->heldPrinterID, &out[len]);
+    out[len++] = ' ';
+  }
+  fmt->inqy->holding = false;
+  return len;
+}
+
+// Counts one more inquiry, outputs the summary line once it is full
+static size_t gbp_capture_inqyAdd(gbp_capture_inqy_t *inqy, const uint8_t status, char *out)
+{
+  const uint8_t printerID = inqy->heldPrinterID;
+  if (inqy->runCount > 0)
+  {
+    gbp_capture_inqyRun_t *last = &inqy->runs[inqy->runCount - 1];
+    if ((last->printerID == printerID) && (last->status == status) && (last->count < UINT16_MAX))
+    {
+      last->count++;
+      return 0;
+    }
+  }
+
+  const size_t len = (inqy->runCount == GBP_CAPTURE_INQY_RUNS_MAX) ? gbp_capture_inqyLine(inqy, out) : 0;
+  gbp_capture_inqyRun_t *run = &inqy->runs[inqy->runCount++];
+  run->printerID = printerID;
+  run->status    = status;
+  run->count     = 1;
+  return len;
+}
+
+/*******************************************************************************
+  Capture Output
+*******************************************************************************/
+
+size_t gbp_capture_fmt_byte(gbp_capture_fmt_t *fmt, const uint8_t data_8bit, char *out)
+{
+  size_t len = 0;
+
+  // Data length from packet header
+  if (fmt->pktByteIndex == 4)
+    fmt->pktDataLength = data_8bit;
+  if (fmt->pktByteIndex == 5)
+    fmt->pktDataLength |= ((uint16_t)data_8bit << 8) & 0xFF00;
+
+  gbp_capture_inqy_t *inqy = fmt->inqy;
+  if (inqy && inqy->holding)
+  {
+    if (fmt->pktByteIndex < GBP_CAPTURE_INQY_HEADER_SIZE)
+    {
+      if (data_8bit == gbp_capture_inqyHeader[fmt->pktByteIndex])
+      {
+        fmt->pktByteIndex++;
+        return 0;
+      }
+      // Not an inquiry. The run before it is over
+      len += gbp_capture_inqyLine(inqy, &out[len]);
+      len += gbp_capture_heldBytes(fmt, &out[len]);
+    }
+    else if (fmt->pktByteIndex == GBP_CAPTURE_INQY_HEADER_SIZE)
+    {
+      inqy->heldPrinterID = data_8bit;
+      fmt->pktByteIndex++;
+      return 0;
+    }
+    else
+    {
+      // Status, last byte of the inquiry
+      fmt->pktByteIndex = 0;
+      return gbp_capture_inqyAdd(inqy, data_8bit, out);
+    }
+  }
+
+  // Hex Byte
+  len += gbp_capture_hex(data_8bit, &out[len]);
+  // Splitting packets for convenience
+  if ((fmt->pktByteIndex > 5) && (fmt->pktByteIndex >= (9 + (uint32_t)fmt->pktDataLength)))
+  {
+    fmt->pktByteIndex = 0;
+    if (inqy)
+      inqy->holding = true;
+    out[len++] = '\r';
+    out[len++] = '\n';
+    return len;
+  }
+  fmt->pktByteIndex++;  // Byte hex split counter
+  out[len++] = ' ';
+  return len;
+}
+
+size_t gbp_capture_fmt_flush(gbp_capture_fmt_t *fmt, char *out)
+{
+  if (!fmt->inqy || !fmt->inqy->holding)
+    return 0;
+  size_t len = gbp_capture_inqyLine(fmt->inqy, out);
+  if (fmt->pktByteIndex > 0)
+    len += gbp_capture_heldBytes(fmt, &out[len]);  // Rest of the packet is output as it comes
+  return len;
+}
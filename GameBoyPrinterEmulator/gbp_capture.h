@@ -0,0 +1,83 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Output
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Raw packet capture mode text, one packet per line, with optional inquiry summary
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Inquiry Summary
+
+  While the printer is busy the gameboy sends INQUIRY packets back to back,
+  each one printed as a 30 character line:
+
+    88 33 0F 00 00 00 0F 00 81 06
+
+  With the summary on, a run of them is held back and output as one line once
+  the next packet starts (or the session ends), listing the printer's reply
+  (printer ID and status) and how many times in a row it was given:
+
+    // INQY 81 06 *40 81 04 *1 81 00 *3
+
+  * Counts are decimal, everything else is hex
+  * Expanding each `ID STATUS *N` into N packets `88 33 0F 00 00 00 0F 00 ID STATUS`
+    gives back the exact capture
+  * Only inquiries with the usual header and checksum are summarised, anything
+    else is output as is
+  * A line holds GBP_CAPTURE_INQY_RUNS_MAX replies, longer runs take more lines
+  * It is a comment line, so decoders that do not know it skip the inquiries
+*******************************************************************************/
+#ifndef GBP_CAPTURE_H
+#define GBP_CAPTURE_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#define GBP_CAPTURE_INQY_HEADER_SIZE  8   // Sync, command, compression, length and checksum
+#define GBP_CAPTURE_INQY_RUNS_MAX     4   // Replies per summary line
+#define GBP_CAPTURE_TEXT_MAX          96  // Most text output for one byte with the summary on (summary line, held bytes and the byte)
+#define GBP_CAPTURE_TEXT_PLAIN_MAX    4   // Most text output for one byte with the summary off
+
+typedef struct
+{
+  uint8_t printerID;
+  uint8_t status;
+  uint16_t count;
+} gbp_capture_inqyRun_t;
+
+typedef struct
+{
+  bool holding;  ///< Bytes of this packet so far are those of an inquiry, and have not been output
+  uint8_t heldPrinterID;
+  uint8_t runCount;
+  gbp_capture_inqyRun_t runs[GBP_CAPTURE_INQY_RUNS_MAX];
+} gbp_capture_inqy_t;
+
+typedef struct
+{
+  uint32_t pktByteIndex;
+  uint16_t pktDataLength;
+  gbp_capture_inqy_t *inqy;  ///< Inquiry summary, NULL to output inquiries as is
+} gbp_capture_fmt_t;
+
+void gbp_capture_fmt_init(gbp_capture_fmt_t *fmt, gbp_capture_inqy_t *inqy);
+size_t gbp_capture_fmt_byte(gbp_capture_fmt_t *fmt, const uint8_t data_8bit, char *out);  ///< Chars written to out, may be 0 while an inquiry is held
+size_t gbp_capture_fmt_flush(gbp_capture_fmt_t *fmt, char *out);  ///< Whatever is held back, e.g. at the end of a session
+
+#endif
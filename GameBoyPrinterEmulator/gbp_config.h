@@ -0,0 +1,38 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Emulator Configuration
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Buffer sizes shared by the sketch and the host RAM budget report
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Changing a size here changes the RAM footprint of every configuration.
+//           Run `make` to check each configuration still fits its target (test/gbp_budget.cc)
+#ifndef GBP_CONFIG_H
+#define GBP_CONFIG_H
+
+/* Serial IO Raw Packet Buffer */
+// Dev Note: Gamboy camera sends data payload of 640 bytes usually
+#define GBP_BUFFER_SIZE_PARSE_MODE   400  // Parsed as it arrives, so only needs to cover output delays
+#define GBP_BUFFER_SIZE_CAPTURE_MODE 650  // Holds a whole camera data packet while it is hex printed
+
+/* Parse Mode Payload Pool (gbp_pool.h) */
+// Dev Note: A slot is a packet or tile the parser can get ahead of serial output by
+#define GBP_POOL_SLOTS 4  // Power of two
+
+#endif
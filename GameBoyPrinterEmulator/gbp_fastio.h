@@ -0,0 +1,265 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Fast Link Pin Access
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Link cable pin reads and writes for the clock ISR, without digitalRead()/digitalWrite()
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Pin Access per Board
+
+  * ATmega328P/168 (Uno, Nano) : Port register and bit picked at compile time
+                                 from the pin number. Reads are one `in`, writes
+                                 one `sbi`/`cbi`
+  * Other AVR, SAMD            : Port register and mask looked up once by
+                                 gbp_fastio_init(), then one load per access
+  * ESP8266                     : GPI/GPOS/GPOC registers (pins 0 to 15)
+  * ESP32                       : GPIO_IN/GPIO_OUT_W1TS/W1TC registers
+  * Host (GBP_FEATURE_LINK_SIM) : Mock pin levels in gbp_fastio_mock, with
+                                 access counters for tests
+  * Anything else               : digitalRead()/digitalWrite()
+
+  ## Estimated Cycles per Rising Edge (One SO read and one SI write)
+
+    | Board                  | Clock   | digitalRead/Write | gbp_fastio | 16384Hz edge budget |
+    |------------------------|---------|-------------------|------------|---------------------|
+    | ATmega328P (Nano, Uno) | 16MHz   | ~110              | ~4         | 976                 |
+    | ATmega2560, 32U4       | 16MHz   | ~110              | ~14        | 976                 |
+    | SAMD21                 | 48MHz   | ~80               | ~8         | 2929                |
+    | ESP8266                | 80MHz   | ~40               | ~8         | 4882                |
+    | ESP32                  | 240MHz  | ~100              | ~20        | 14648               |
+
+  Estimated from the instructions each Arduino core runs per call (pin table
+  lookups, PWM timer check, interrupt disable), not measured. Budget is the
+  cycles between two rising edges of a 16384Hz (double speed) link clock. The
+  AVR interrupt entry via attachInterrupt() costs ~80 more cycles either way.
+
+  Include this after the GBP_*_PIN definitions. SI writes from the ISR only,
+  the rest of the sketch must keep using digitalWrite() on the link pins.
+*******************************************************************************/
+#ifndef GBP_FASTIO_H
+#define GBP_FASTIO_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#define GBP_FASTIO_INLINE static inline __attribute__((always_inline))
+
+#if defined(GBP_FEATURE_LINK_SIM)
+/*******************************************************************************
+  Host Mock
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "mock"
+
+typedef struct
+{
+  bool sc;          ///< Serial Clock, driven by the gameboy
+  bool so;          ///< Serial OUTPUT of the gameboy
+  bool si;          ///< Serial INPUT of the gameboy, driven by the printer
+  uint32_t reads;   ///< Pin reads so far
+  uint32_t writes;  ///< Pin writes so far
+} gbp_fastio_mock_t;
+
+static gbp_fastio_mock_t gbp_fastio_mock = {true, false, false, 0, 0};
+
+static inline void gbp_fastio_init(void)
+{
+  gbp_fastio_mock.sc     = true;  // Clock idles high
+  gbp_fastio_mock.so     = false;
+  gbp_fastio_mock.si     = false;
+  gbp_fastio_mock.reads  = 0;
+  gbp_fastio_mock.writes = 0;
+}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { gbp_fastio_mock.reads++; return gbp_fastio_mock.sc; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { gbp_fastio_mock.reads++; return gbp_fastio_mock.so; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high) { gbp_fastio_mock.writes++; gbp_fastio_mock.si = high; }
+
+#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+/*******************************************************************************
+  ATmega328P/168: D0-D7 on PORTD, D8-D13 on PORTB, A0-A5 (D14-D19) on PORTC
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "avr port (constant)"
+
+#if (GBP_SC_PIN) < 8
+#define GBP_FASTIO_SC_IN  PIND
+#define GBP_FASTIO_SC_BIT (GBP_SC_PIN)
+#elif (GBP_SC_PIN) < 14
+#define GBP_FASTIO_SC_IN  PINB
+#define GBP_FASTIO_SC_BIT ((GBP_SC_PIN) - 8)
+#elif (GBP_SC_PIN) < 20
+#define GBP_FASTIO_SC_IN  PINC
+#define GBP_FASTIO_SC_BIT ((GBP_SC_PIN) - 14)
+#else
+#error "GBP_SC_PIN is not a digital pin of this board"
+#endif
+
+#if (GBP_SO_PIN) < 8
+#define GBP_FASTIO_SO_IN  PIND
+#define GBP_FASTIO_SO_BIT (GBP_SO_PIN)
+#elif (GBP_SO_PIN) < 14
+#define GBP_FASTIO_SO_IN  PINB
+#define GBP_FASTIO_SO_BIT ((GBP_SO_PIN) - 8)
+#elif (GBP_SO_PIN) < 20
+#define GBP_FASTIO_SO_IN  PINC
+#define GBP_FASTIO_SO_BIT ((GBP_SO_PIN) - 14)
+#else
+#error "GBP_SO_PIN is not a digital pin of this board"
+#endif
+
+#if (GBP_SI_PIN) < 8
+#define GBP_FASTIO_SI_OUT PORTD
+#define GBP_FASTIO_SI_BIT (GBP_SI_PIN)
+#elif (GBP_SI_PIN) < 14
+#define GBP_FASTIO_SI_OUT PORTB
+#define GBP_FASTIO_SI_BIT ((GBP_SI_PIN) - 8)
+#elif (GBP_SI_PIN) < 20
+#define GBP_FASTIO_SI_OUT PORTC
+#define GBP_FASTIO_SI_BIT ((GBP_SI_PIN) - 14)
+#else
+#error "GBP_SI_PIN is not a digital pin of this board"
+#endif
+
+static inline void gbp_fastio_init(void) {}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return (GBP_FASTIO_SC_IN & _BV(GBP_FASTIO_SC_BIT)) != 0; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return (GBP_FASTIO_SO_IN & _BV(GBP_FASTIO_SO_BIT)) != 0; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high)
+{
+  if (high)
+    GBP_FASTIO_SI_OUT |= _BV(GBP_FASTIO_SI_BIT);  // sbi
+  else
+    GBP_FASTIO_SI_OUT &= ~_BV(GBP_FASTIO_SI_BIT); // cbi
+}
+
+#elif defined(__AVR__)
+/*******************************************************************************
+  Other AVR: Registers looked up once from the core's pin tables
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "avr port (cached)"
+
+static volatile uint8_t *gbp_fastio_scIn;
+static volatile uint8_t *gbp_fastio_soIn;
+static volatile uint8_t *gbp_fastio_siOut;
+static uint8_t gbp_fastio_scMask;
+static uint8_t gbp_fastio_soMask;
+static uint8_t gbp_fastio_siMask;
+
+static inline void gbp_fastio_init(void)
+{
+  gbp_fastio_scIn   = portInputRegister(digitalPinToPort(GBP_SC_PIN));
+  gbp_fastio_soIn   = portInputRegister(digitalPinToPort(GBP_SO_PIN));
+  gbp_fastio_siOut  = portOutputRegister(digitalPinToPort(GBP_SI_PIN));
+  gbp_fastio_scMask = digitalPinToBitMask(GBP_SC_PIN);
+  gbp_fastio_soMask = digitalPinToBitMask(GBP_SO_PIN);
+  gbp_fastio_siMask = digitalPinToBitMask(GBP_SI_PIN);
+}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return (*gbp_fastio_scIn & gbp_fastio_scMask) != 0; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return (*gbp_fastio_soIn & gbp_fastio_soMask) != 0; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high)
+{
+  // Read modify write is safe here as AVR interrupts do not nest, and
+  // digitalWrite() in the sketch disables interrupts around its own
+  if (high)
+    *gbp_fastio_siOut |= gbp_fastio_siMask;
+  else
+    *gbp_fastio_siOut &= ~gbp_fastio_siMask;
+}
+
+#elif defined(ARDUINO_ARCH_SAMD)
+/*******************************************************************************
+  SAMD: Registers looked up once from g_APinDescription
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "samd port (cached)"
+
+static volatile uint32_t *gbp_fastio_scIn;
+static volatile uint32_t *gbp_fastio_soIn;
+static volatile uint32_t *gbp_fastio_siSet;
+static volatile uint32_t *gbp_fastio_siClr;
+static uint32_t gbp_fastio_scMask;
+static uint32_t gbp_fastio_soMask;
+static uint32_t gbp_fastio_siMask;
+
+static inline void gbp_fastio_init(void)
+{
+  gbp_fastio_scIn   = &PORT->Group[g_APinDescription[GBP_SC_PIN].ulPort].IN.reg;
+  gbp_fastio_soIn   = &PORT->Group[g_APinDescription[GBP_SO_PIN].ulPort].IN.reg;
+  gbp_fastio_siSet  = &PORT->Group[g_APinDescription[GBP_SI_PIN].ulPort].OUTSET.reg;
+  gbp_fastio_siClr  = &PORT->Group[g_APinDescription[GBP_SI_PIN].ulPort].OUTCLR.reg;
+  gbp_fastio_scMask = 1ul << g_APinDescription[GBP_SC_PIN].ulPin;
+  gbp_fastio_soMask = 1ul << g_APinDescription[GBP_SO_PIN].ulPin;
+  gbp_fastio_siMask = 1ul << g_APinDescription[GBP_SI_PIN].ulPin;
+}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return (*gbp_fastio_scIn & gbp_fastio_scMask) != 0; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return (*gbp_fastio_soIn & gbp_fastio_soMask) != 0; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high) { *(high ? gbp_fastio_siSet : gbp_fastio_siClr) = gbp_fastio_siMask; }
+
+#elif defined(ESP8266)
+/*******************************************************************************
+  ESP8266: GPIO 0 to 15
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "esp8266 gpio"
+
+#if ((GBP_SC_PIN) > 15) || ((GBP_SO_PIN) > 15) || ((GBP_SI_PIN) > 15)
+#error "gbp_fastio supports GPIO 0 to 15 on ESP8266 (GPIO16 is on the RTC block)"
+#endif
+
+static inline void gbp_fastio_init(void) {}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return (GPI & (1ul << (GBP_SC_PIN))) != 0; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return (GPI & (1ul << (GBP_SO_PIN))) != 0; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high)
+{
+  if (high)
+    GPOS = (1ul << (GBP_SI_PIN));
+  else
+    GPOC = (1ul << (GBP_SI_PIN));
+}
+
+#elif defined(ESP32)
+/*******************************************************************************
+  ESP32: GPIO 0 to 31 in the first register bank, 32 and up in the second
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "esp32 gpio"
+
+#define GBP_FASTIO_ESP32_IN(P)  (((P) < 32) ? ((REG_READ(GPIO_IN_REG) >> (P)) & 1) : ((REG_READ(GPIO_IN1_REG) >> ((P) - 32)) & 1))
+
+static inline void gbp_fastio_init(void) {}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return GBP_FASTIO_ESP32_IN(GBP_SC_PIN) != 0; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return GBP_FASTIO_ESP32_IN(GBP_SO_PIN) != 0; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high)
+{
+#if (GBP_SI_PIN) < 32
+  REG_WRITE(high ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1ul << (GBP_SI_PIN));
+#else
+  REG_WRITE(high ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, 1ul << ((GBP_SI_PIN) - 32));
+#endif
+}
+
+#else
+/*******************************************************************************
+  Fallback: Arduino API
+*******************************************************************************/
+#define GBP_FASTIO_BACKEND "digitalRead/digitalWrite"
+
+static inline void gbp_fastio_init(void) {}
+GBP_FASTIO_INLINE bool gbp_fastio_readSC(void) { return digitalRead(GBP_SC_PIN) == HIGH; }
+GBP_FASTIO_INLINE bool gbp_fastio_readSO(void) { return digitalRead(GBP_SO_PIN) == HIGH; }
+GBP_FASTIO_INLINE void gbp_fastio_writeSI(const bool high) { digitalWrite(GBP_SI_PIN, high ? HIGH : LOW); }
+
+#endif
+
+/******************************************************************************/
+#endif
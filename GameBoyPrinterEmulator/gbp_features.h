@@ -0,0 +1,105 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Emulator Features
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Sketch options (GBP_USE_*) to the GBP_FEATURE_* they build in
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: The sketch includes this once, after its options. test/gbp_budget.cc
+//           includes it again for every configuration it reports, so there is no
+//           include guard and every feature starts undefined. Only combinations
+//           that are invalid on every board are rejected here, board specific
+//           checks stay in the sketch. An option that is not defined is false.
+#undef GBP_FEATURE_SETTINGS
+#undef GBP_FEATURE_PACKET_CAPTURE_MODE
+#undef GBP_FEATURE_PARSE_PACKET_MODE
+#undef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+#undef GBP_FEATURE_INQY_SUMMARY
+#undef GBP_FEATURE_PIXEL_ROWS
+#undef GBP_FEATURE_PIXEL_ROWS_BINARY
+#undef GBP_FEATURE_PIPELINE
+#undef GBP_FEATURE_POOL
+#undef GBP_FEATURE_LINK_HW_SPI
+#undef GBP_FEATURE_BYTE_GAP_RESYNC
+#undef GBP_FEATURE_SPOOL
+
+#if GBP_USE_SETTINGS
+// Both modes are built in, the settings pick one at boot
+#define GBP_FEATURE_SETTINGS
+#define GBP_FEATURE_PACKET_CAPTURE_MODE
+#define GBP_FEATURE_PARSE_PACKET_MODE
+#if GBP_USE_PARSE_DECOMPRESSOR
+#define GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+#endif
+#elif GBP_OUTPUT_RAW_PACKETS
+#define GBP_FEATURE_PACKET_CAPTURE_MODE
+#else
+#define GBP_FEATURE_PARSE_PACKET_MODE
+#if GBP_USE_PARSE_DECOMPRESSOR
+#define GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+#endif
+#endif
+
+#if GBP_CAPTURE_INQY_SUMMARY && defined(GBP_FEATURE_PACKET_CAPTURE_MODE)
+#define GBP_FEATURE_INQY_SUMMARY
+#endif
+
+#if GBP_OUTPUT_PIXEL_ROWS && defined(GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR)
+#define GBP_FEATURE_PIXEL_ROWS
+#if GBP_PIXEL_ROWS_BINARY
+#define GBP_FEATURE_PIXEL_ROWS_BINARY
+#endif
+#endif
+
+#if GBP_USE_PIPELINE && defined(GBP_FEATURE_PARSE_PACKET_MODE)
+#define GBP_FEATURE_PIPELINE
+#endif
+
+#if defined(GBP_FEATURE_PARSE_PACKET_MODE) && !defined(GBP_FEATURE_PIPELINE)
+// Parsing carries on while earlier lines are still going out over serial
+#define GBP_FEATURE_POOL
+#endif
+
+#if defined(GBP_FEATURE_PIXEL_ROWS) && defined(GBP_FEATURE_PIPELINE)
+#error "GBP_OUTPUT_PIXEL_ROWS is not supported by GBP_USE_PIPELINE yet"
+#endif
+
+#if defined(GBP_FEATURE_SETTINGS) && defined(GBP_FEATURE_PIPELINE)
+#error "GBP_USE_SETTINGS cannot switch the mode of GBP_USE_PIPELINE yet"
+#endif
+
+#if GBP_USE_HW_SPI_LINK
+#define GBP_FEATURE_LINK_HW_SPI
+#endif
+
+#if GBP_USE_BYTE_GAP_RESYNC
+#define GBP_FEATURE_BYTE_GAP_RESYNC
+#endif
+
+#if defined(GBP_FEATURE_BYTE_GAP_RESYNC) && defined(GBP_FEATURE_LINK_HW_SPI)
+#error "GBP_USE_BYTE_GAP_RESYNC times each clock edge, but GBP_USE_HW_SPI_LINK only interrupts per byte (and is byte aligned by the gap already)"
+#endif
+
+#if GBP_USE_SPOOL && defined(GBP_FEATURE_PACKET_CAPTURE_MODE)
+#define GBP_FEATURE_SPOOL
+#endif
+
+#if defined(GBP_FEATURE_SPOOL) && defined(GBP_FEATURE_LINK_HW_SPI)
+#error "GBP_USE_SPOOL needs the SPI bus for the SD card, so it cannot be used with GBP_USE_HW_SPI_LINK"
+#endif
@@ -0,0 +1,203 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Link HAL
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Selects how link cable bits are delivered to gbp_serial_io
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Link Backends
+
+  * (default) GPIO ISR : One interrupt per clock edge. Works on any board with
+                         an interrupt capable pin. (GBP_SC_PIN, GBP_SO_PIN, GBP_SI_PIN)
+  * GBP_FEATURE_LINK_HW_SPI : Hardware SPI slave in mode 3 (CPOL=1, CPHA=1), one
+                         interrupt per byte. The protocol state machine then runs
+                         per byte via gpb_serial_io_OnByte_ISR(). (AVR only)
+                         Must be wired to the SPI pins and SS held low.
+                         Byte alignment relies on the idle gap the gameboy leaves
+                         between each byte, so the emulator must be powered up
+                         before the gameboy starts sending.
+  * GBP_FEATURE_LINK_SIM : No hardware. Host tests clock bytes in with
+                         gbp_link_sim_transferByte() (byte engine),
+                         gbp_link_sim_transferBits() (bit engine) or
+                         gbp_link_sim_transferPins() (GPIO ISR on mock pins)
+
+  The GPIO ISR reads and writes the link pins through gbp_fastio.h
+
+  With GBP_FEATURE_BYTE_GAP_RESYNC the GPIO ISR also passes micros() of each
+  edge to gpb_serial_io_OnEdgeTime_ISR(), so a missed or extra clock edge is
+  corrected at the next gap between bytes (see gbp_serial_io.cpp). The
+  simulated link takes the time from gbp_link_sim_us instead.
+
+  Include this after the GBP_*_PIN definitions.
+*******************************************************************************/
+#ifndef GBP_LINK_H
+#define GBP_LINK_H
+#include <stdint.h>   // uint8_t
+#include <stdbool.h>  // bool
+
+#include "gbp_serial_io.h"
+
+#if !defined(GBP_FEATURE_LINK_HW_SPI)
+#include "gbp_fastio.h"
+
+#ifdef GBP_FEATURE_BYTE_GAP_RESYNC
+#if defined(GBP_FEATURE_LINK_SIM)
+static uint32_t gbp_link_sim_us = 0;  ///< Edge time, advanced by the test
+#define gbp_link_micros() (gbp_link_sim_us)
+#else
+#define gbp_link_micros() micros()
+#endif
+#endif
+
+// One link clock edge as seen by the GPIO ISR
+GBP_FASTIO_INLINE void gbp_link_clockEdge(void)
+{
+#ifdef GBP_FEATURE_BYTE_GAP_RESYNC
+  gpb_serial_io_OnEdgeTime_ISR(gbp_link_micros());
+#endif
+  // Serial Clock (1 = Rising Edge) (0 = Falling Edge); Master Output Slave Input (This device is slave)
+#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+  const bool txBit = gpb_serial_io_OnRising_ISR(gbp_fastio_readSO());
+#else
+  const bool txBit = gpb_serial_io_OnChange_ISR(gbp_fastio_readSC(), gbp_fastio_readSO());
+#endif
+  gbp_fastio_writeSI(txBit);
+}
+#endif
+
+#if defined(GBP_FEATURE_LINK_SIM)
+/*******************************************************************************
+  Simulated Link (Host Testing)
+*******************************************************************************/
+
+static inline void gbp_link_init(void)
+{
+  gbp_fastio_init();
+}
+
+// Gameboy sends one byte, returns the byte the printer shifted back at the same time
+static inline uint8_t gbp_link_sim_transferByte(const uint8_t gbOut)
+{
+  // Like a real SPI slave, the reply is whatever was preloaded after the previous byte
+  static uint8_t txPreload = 0x00;
+  const uint8_t rx         = txPreload;
+  txPreload                = gpb_serial_io_OnByte_ISR(gbOut);
+  return rx;
+}
+
+#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+// Same as above, but clocked one bit at a time through the GPIO ISR engine
+static inline uint8_t gbp_link_sim_transferBits(const uint8_t gbOut)
+{
+  // Gameboy samples the printer bit on the rising edge, before the printer updates it
+  static bool txBit = false;
+  uint8_t rx        = 0;
+  for (int bi = 7; bi >= 0; bi--)
+  {
+    rx |= (txBit ? 1 : 0) << bi;
+    txBit = gpb_serial_io_OnRising_ISR((gbOut >> bi) & 0x01);
+  }
+  return rx;
+}
+#endif
+
+// Same again, but as pin levels clocked through the GPIO ISR code (gbp_fastio mock)
+static inline uint8_t gbp_link_sim_transferPins(const uint8_t gbOut)
+{
+  uint8_t rx = 0;
+  for (int bi = 7; bi >= 0; bi--)
+  {
+    // Falling edge, gameboy puts out its bit
+    gbp_fastio_mock.sc = false;
+    gbp_fastio_mock.so = ((gbOut >> bi) & 0x01) != 0;
+#ifndef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+    gbp_link_clockEdge();
+#endif
+    // Rising edge, gameboy samples the printer bit before the printer updates it
+    gbp_fastio_mock.sc = true;
+    rx |= (gbp_fastio_mock.si ? 1 : 0) << bi;
+    gbp_link_clockEdge();
+  }
+  return rx;
+}
+
+#elif defined(GBP_FEATURE_LINK_HW_SPI)
+/*******************************************************************************
+  Hardware SPI Slave (One interrupt per byte)
+*******************************************************************************/
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega2560__)
+ISR(SPI_STC_vect)
+{
+  // Byte received, preload the reply for the next byte
+  SPDR = gpb_serial_io_OnByte_ISR(SPDR);
+}
+
+static inline void gbp_link_init(void)
+{
+  pinMode(MISO, OUTPUT);  // GBP_SI_PIN
+  pinMode(MOSI, INPUT);   // GBP_SO_PIN
+  pinMode(SCK, INPUT);    // GBP_SC_PIN
+  pinMode(SS, INPUT);     // Must be held low (Tie to GND)
+  SPDR = 0x00;
+  // Slave, SPI Mode 3 (CPOL=1, CPHA=1), MSB first, Interrupt on byte complete
+  SPCR = _BV(SPE) | _BV(SPIE) | _BV(CPOL) | _BV(CPHA);
+}
+#else
+#error "GBP_FEATURE_LINK_HW_SPI is only implemented for AVR. Use the GPIO ISR link instead"
+#endif
+
+#else
+/*******************************************************************************
+  GPIO Interrupt (One interrupt per clock edge)
+*******************************************************************************/
+
+#ifdef ESP8266
+void ICACHE_RAM_ATTR gbp_link_serialClock_ISR(void)
+#else
+void gbp_link_serialClock_ISR(void)
+#endif
+{
+  gbp_link_clockEdge();
+}
+
+static inline void gbp_link_init(void)
+{
+  /* Pins from gameboy link cable */
+  pinMode(GBP_SC_PIN, INPUT);
+  pinMode(GBP_SO_PIN, INPUT);
+  pinMode(GBP_SI_PIN, OUTPUT);
+
+  /* Default link serial out pin state */
+  digitalWrite(GBP_SI_PIN, LOW);
+  gbp_fastio_init();
+
+  /* Attach ISR */
+#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+  attachInterrupt(digitalPinToInterrupt(GBP_SC_PIN), gbp_link_serialClock_ISR, RISING);  // attach interrupt handler
+#else
+  attachInterrupt(digitalPinToInterrupt(GBP_SC_PIN), gbp_link_serialClock_ISR, CHANGE);  // attach interrupt handler
+#endif
+}
+
+#endif
+
+/******************************************************************************/
+#endif
@@ -0,0 +1,70 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Flash Constants
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Keeps constant strings and tables out of SRAM on AVR, plain C elsewhere
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: AVR copies every initialised constant into SRAM at boot unless it is
+//           PROGMEM, and PROGMEM can only be read with the *_P functions.
+//           Other targets (and the host tests) read constants in place, so these
+//           are the plain C functions there. Only pass GBP_PSTR()/GBP_PROGMEM data
+//           where a gbp_pgm_* function expects it.
+#ifndef GBP_PGMSPACE_H
+#define GBP_PGMSPACE_H
+#include <stdint.h>  // uint8_t
+#include <stdio.h>   // snprintf
+#include <string.h>  // memcpy
+
+#if defined(GBP_PGMSPACE_SECTION)
+// gbp_budget build of the modules (see Makefile). Flash constants get a section of
+// their own, so the constants left in .rodata are the ones AVR keeps in SRAM
+#define GBP_PROGMEM                        __attribute__((section(GBP_PGMSPACE_SECTION)))
+#define GBP_PSTR(S)                        (__extension__({ static const char gbp_pstr[] GBP_PROGMEM = (S); &gbp_pstr[0]; }))
+#define gbp_pgm_readByte(PGM)              (*(const uint8_t *)(PGM))
+#define gbp_pgm_memcpy(DST, SRC, N)        memcpy(DST, SRC, N)
+#define gbp_pgm_strcmp(RAM, PGM)           strcmp(RAM, PGM)
+#define gbp_pgm_strlen(PGM)                strlen(PGM)
+#define gbp_pgm_strncmp(RAM, PGM, N)       strncmp(RAM, PGM, N)
+#define gbp_pgm_strlcpy(DST, PGM, N)       snprintf(DST, N, "%s", PGM)
+#define gbp_pgm_snprintf(DST, N, FMT, ...) snprintf(DST, N, FMT, __VA_ARGS__)
+#elif defined(__AVR__)
+#include <avr/pgmspace.h>
+#define GBP_PROGMEM                        PROGMEM
+#define GBP_PSTR(S)                        PSTR(S)
+#define gbp_pgm_readByte(PGM)              pgm_read_byte(PGM)
+#define gbp_pgm_memcpy(DST, SRC, N)        memcpy_P(DST, SRC, N)
+#define gbp_pgm_strcmp(RAM, PGM)           strcmp_P(RAM, PGM)
+#define gbp_pgm_strlen(PGM)                strlen_P(PGM)
+#define gbp_pgm_strncmp(RAM, PGM, N)       strncmp_P(RAM, PGM, N)
+#define gbp_pgm_strlcpy(DST, PGM, N)       strlcpy_P(DST, PGM, N)
+#define gbp_pgm_snprintf(DST, N, FMT, ...) snprintf_P(DST, N, FMT, __VA_ARGS__)
+#else
+#define GBP_PROGMEM
+#define GBP_PSTR(S)                        (S)
+#define gbp_pgm_readByte(PGM)              (*(const uint8_t *)(PGM))
+#define gbp_pgm_memcpy(DST, SRC, N)        memcpy(DST, SRC, N)
+#define gbp_pgm_strcmp(RAM, PGM)           strcmp(RAM, PGM)
+#define gbp_pgm_strlen(PGM)                strlen(PGM)
+#define gbp_pgm_strncmp(RAM, PGM, N)       strncmp(RAM, PGM, N)
+#define gbp_pgm_strlcpy(DST, PGM, N)       snprintf(DST, N, "%s", PGM)
+#define gbp_pgm_snprintf(DST, N, FMT, ...) snprintf(DST, N, FMT, __VA_ARGS__)
+#endif
+
+#endif
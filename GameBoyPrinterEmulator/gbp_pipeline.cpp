@@ -0,0 +1,420 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Parse Pipeline
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Splits parse mode into capture, parse and output stages that can run on separate cores
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pgmspace.h"
+#include "gbp_pkt.h"
+#include "gbp_spsc.h"
+#include "gbp_pipeline.h"
+
+/*******************************************************************************
+  Formatting
+*******************************************************************************/
+
+// Dev Note: Built for every target, parse mode on AVR formats its payload pool slots with it (see gbp_pool.h)
+
+static const char *gbp_pipeline_commandStr(int val)
+{
+  switch (val)
+  {
+    case GBP_COMMAND_INIT: return GBP_PSTR("INIT");
+    case GBP_COMMAND_PRINT: return GBP_PSTR("PRNT");
+    case GBP_COMMAND_DATA: return GBP_PSTR("DATA");
+    case GBP_COMMAND_BREAK: return GBP_PSTR("BREK");
+    case GBP_COMMAND_INQUIRY: return GBP_PSTR("INQY");
+    default: return GBP_PSTR("?");
+  }
+}
+
+typedef struct
+{
+  char *text;
+  size_t len;
+  size_t max;
+} gbp_pipeline_text_t;
+
+// str is a GBP_PSTR() string
+static void gbp_pipeline_textStr(gbp_pipeline_text_t *t, const char *str)
+{
+  char c;
+  while (((c = (char)gbp_pgm_readByte(str++)) != '\0') && (t->len < t->max))
+    t->text[t->len++] = c;
+}
+
+static void gbp_pipeline_textUInt(gbp_pipeline_text_t *t, unsigned int val)
+{
+  char digits[6];
+  int n = 0;
+  do
+  {
+    digits[n++] = '0' + (val % 10);
+    val /= 10;
+  } while ((val > 0) && (n < (int)sizeof(digits)));
+  while ((n > 0) && (t->len < t->max))
+    t->text[t->len++] = digits[--n];
+}
+
+static void gbp_pipeline_textBit(gbp_pipeline_text_t *t, const char *key, bool bit)
+{
+  gbp_pipeline_textStr(t, key);
+  gbp_pipeline_textStr(t, bit ? GBP_PSTR("1") : GBP_PSTR("0"));
+}
+
+// Parse mode text. Also used by gbp_parse_packet_loop() in GameBoyPrinterEmulator.ino
+size_t gbp_pipeline_formatEvent(const gbp_pipeline_event_t *evt, bool decompressed, char *text, size_t textMax)
+{
+  static const char nibbleToCharLUT[] GBP_PROGMEM = "0123456789ABCDEF";
+  gbp_pipeline_text_t t                           = { text, 0, textMax };
+  if (evt->type == GBP_PIPELINE_EVENT_PACKET)
+  {
+    gbp_pipeline_textStr(&t, GBP_PSTR("{\"command\":\""));
+    gbp_pipeline_textStr(&t, gbp_pipeline_commandStr(evt->command));
+    gbp_pipeline_textStr(&t, GBP_PSTR("\""));
+    if (evt->command == GBP_COMMAND_INQUIRY)
+    {
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"status\":{"));
+      gbp_pipeline_textBit(&t, GBP_PSTR("\"LowBat\":"), gpb_status_bit_getbit_low_battery(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"ER2\":"), gpb_status_bit_getbit_other_error(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"ER1\":"), gpb_status_bit_getbit_paper_jam(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"ER0\":"), gpb_status_bit_getbit_packet_error(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"Untran\":"), gpb_status_bit_getbit_unprocessed_data(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"Full\":"), gpb_status_bit_getbit_print_buffer_full(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"Busy\":"), gpb_status_bit_getbit_printer_busy(evt->status));
+      gbp_pipeline_textBit(&t, GBP_PSTR(",\"Sum\":"), gpb_status_bit_getbit_checksum_error(evt->status));
+      gbp_pipeline_textStr(&t, GBP_PSTR("}"));
+    }
+    if ((evt->command == GBP_COMMAND_PRINT) && (evt->size >= GBP_PRINT_INSTRUCT_PAYLOAD_SIZE))
+    {
+      uint8_t payload[GBP_PRINT_INSTRUCT_PAYLOAD_SIZE];
+      memcpy(payload, evt->data, sizeof(payload));
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"sheets\":"));
+      gbp_pipeline_textUInt(&t, gbp_pkt_printInstruction_num_of_sheets(payload));
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"margin_upper\":"));
+      gbp_pipeline_textUInt(&t, gbp_pkt_printInstruction_num_of_linefeed_before_print(payload));
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"margin_lower\":"));
+      gbp_pipeline_textUInt(&t, gbp_pkt_printInstruction_num_of_linefeed_after_print(payload));
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"pallet\":"));
+      gbp_pipeline_textUInt(&t, gbp_pkt_printInstruction_palette_value(payload));
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"density\":"));
+      gbp_pipeline_textUInt(&t, gbp_pkt_printInstruction_print_density(payload));
+    }
+    if (evt->command == GBP_COMMAND_DATA)
+    {
+      gbp_pipeline_textStr(&t, GBP_PSTR(", \"compressed\":"));
+      gbp_pipeline_textUInt(&t, decompressed ? 0 : evt->compression);  // Already decompressed by us, so no need to do so
+      gbp_pipeline_textBit(&t, GBP_PSTR(", \"more\":"), evt->dataLength != 0);
+    }
+    gbp_pipeline_textStr(&t, GBP_PSTR("}\r\n"));
+  }
+  else if (evt->type == GBP_PIPELINE_EVENT_DATA)
+  {
+    for (int i = 0; (i < evt->size) && ((t.len + 3) <= t.max); i++)
+    {
+      const uint8_t data_8bit = evt->data[i];
+      t.text[t.len++]         = (char)gbp_pgm_readByte(&nibbleToCharLUT[(data_8bit >> 4) & 0xF]);
+      t.text[t.len++]         = (char)gbp_pgm_readByte(&nibbleToCharLUT[(data_8bit >> 0) & 0xF]);
+      t.text[t.len++]         = ' ';
+    }
+    if (t.len > 0)
+      t.len--;  // Last byte ends the line instead
+    gbp_pipeline_textStr(&t, GBP_PSTR("\r\n"));
+  }
+  return t.len;
+}
+
+// Dev Note: The rest is not built for AVR. There is not enough RAM for the queues and no second core to use
+#ifndef __AVR__
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif !defined(ARDUINO)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+bool gbp_pipeline_init(gbp_pipeline_t *p, const gbp_pipeline_io_t *io, bool decompress)
+{
+  if ((p == NULL) || (io == NULL) || (io->read == NULL) || (io->write == NULL))
+    return false;
+  memset(p, 0, sizeof(*p));
+  p->io         = *io;
+  p->decompress = decompress;
+  gbp_spsc_init(&p->rawQueue, (uint8_t *)p->rawQueueBuff, sizeof(gbp_pipeline_chunk_t), GBP_PIPELINE_RAW_QUEUE_LEN);
+  gbp_spsc_init(&p->eventQueue, (uint8_t *)p->eventQueueBuff, sizeof(gbp_pipeline_event_t), GBP_PIPELINE_EVENT_QUEUE_LEN);
+  gbp_pkt_init(&p->pktState);
+  return true;
+}
+
+/*******************************************************************************
+  Capture Stage
+*******************************************************************************/
+
+bool gbp_pipeline_captureStep(gbp_pipeline_t *p)
+{
+  if (!p->captureChunkPending)
+  {
+    bool sessionEnd = false;
+    const size_t size = p->io.read(p->io.ctx, p->captureChunk.data, GBP_PIPELINE_CHUNK_SIZE, &sessionEnd);
+    if ((size == 0) && !sessionEnd)
+      return false;
+    p->captureChunk.size       = (uint8_t)size;
+    p->captureChunk.sessionEnd = sessionEnd;
+    p->captureChunkPending     = true;
+    p->bytesCaptured += size;
+  }
+  // Parse stage is behind. Hold on to the chunk, bytes will back up into dataBuff
+  if (!gbp_spsc_push(&p->rawQueue, &p->captureChunk))
+    return false;
+  p->captureChunkPending = false;
+  return true;
+}
+
+/*******************************************************************************
+  Parse Stage
+*******************************************************************************/
+
+// Returns false if the event queue is full. The event is then held until the next step
+static bool gbp_pipeline_parseEmit(gbp_pipeline_t *p)
+{
+  if (!gbp_spsc_push(&p->eventQueue, &p->parseEvent))
+  {
+    p->parseEventPending = true;
+    return false;
+  }
+  return true;
+}
+
+static void gbp_pipeline_parseEvent(gbp_pipeline_t *p, gbp_pipeline_event_type_t type, const uint8_t *data, uint8_t size)
+{
+  gbp_pipeline_event_t *evt = &p->parseEvent;
+  evt->type                 = type;
+  evt->command              = p->pktState.command;
+  evt->compression          = p->pktState.compression;
+  evt->status               = p->pktState.status;
+  evt->dataLength           = p->pktState.dataLength;
+  evt->size                 = size;
+  if (size > 0)
+    memcpy(evt->data, data, size);
+}
+
+bool gbp_pipeline_parseStep(gbp_pipeline_t *p)
+{
+  bool worked = false;
+
+  // Event queue was full last time
+  if (p->parseEventPending)
+  {
+    if (!gbp_spsc_push(&p->eventQueue, &p->parseEvent))
+      return false;
+    p->parseEventPending = false;
+    worked               = true;
+  }
+
+  // Tiles left over from a partial payload
+  while (p->parseDecompressing)
+  {
+    if (!gbp_pkt_decompressor(&p->pktState, p->pktBuff, p->pktBuffSize, &p->tileBuff))
+    {
+      p->parseDecompressing = false;
+      break;
+    }
+    if (gbp_pkt_tileAccu_tileReadyCheck(&p->tileBuff))
+    {
+      // Got Tile
+      gbp_pipeline_parseEvent(p, GBP_PIPELINE_EVENT_DATA, p->tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+      if (!gbp_pipeline_parseEmit(p))
+        return true;
+    }
+  }
+
+  if (!p->parseChunkPending)
+  {
+    if (!gbp_spsc_pop(&p->rawQueue, &p->parseChunk))
+      return worked;
+    p->parseChunkPending = true;
+    p->parseChunkIndex   = 0;
+  }
+
+  gbp_pipeline_chunk_t *chunk = &p->parseChunk;
+  while (p->parseChunkIndex < chunk->size)
+  {
+    const uint8_t b = chunk->data[p->parseChunkIndex++];
+    if (!gbp_pkt_processByte(&p->pktState, b, p->pktBuff, &p->pktBuffSize, sizeof(p->pktBuff)))
+      continue;
+
+    if (p->pktState.received == GBP_REC_GOT_PACKET)
+    {
+      gbp_pipeline_parseEvent(p, GBP_PIPELINE_EVENT_PACKET, p->pktBuff, p->pktBuffSize);
+      if (!gbp_pipeline_parseEmit(p))
+        return true;
+    }
+    else if (p->decompress)
+    {
+      // Required for more complex games with compression support
+      // Dev Note: Resumes at the top of the next step, before any more bytes are parsed
+      p->parseDecompressing = true;
+      return true;
+    }
+    else if (p->pktBuffSize > 0)
+    {
+      // Simplified support for gameboy camera only application
+      gbp_pipeline_parseEvent(p, GBP_PIPELINE_EVENT_DATA, p->pktBuff, p->pktBuffSize);
+      if (!gbp_pipeline_parseEmit(p))
+        return true;
+    }
+  }
+
+  p->parseChunkPending = false;
+  if (chunk->sessionEnd)
+  {
+    gbp_pkt_reset(&p->pktState);
+    p->tileBuff.count = 0;
+    gbp_pipeline_parseEvent(p, GBP_PIPELINE_EVENT_SESSION_END, NULL, 0);
+    gbp_pipeline_parseEmit(p);
+  }
+  return true;
+}
+
+/*******************************************************************************
+  Output Stage
+*******************************************************************************/
+
+bool gbp_pipeline_outputStep(gbp_pipeline_t *p)
+{
+  gbp_pipeline_event_t evt;
+  if (!gbp_spsc_pop(&p->eventQueue, &evt))
+    return false;
+  if (evt.type == GBP_PIPELINE_EVENT_SESSION_END)
+  {
+    p->sessionsOutput++;
+    if (p->io.sessionEnd)
+      p->io.sessionEnd(p->io.ctx);
+    return true;
+  }
+  char text[GBP_PIPELINE_TEXT_MAX];
+  const size_t len = gbp_pipeline_formatEvent(&evt, p->decompress, text, sizeof(text));
+  p->io.write(p->io.ctx, text, len);
+  p->eventsOutput++;
+  return true;
+}
+
+/*******************************************************************************
+  Runners
+*******************************************************************************/
+
+bool gbp_pipeline_poll(gbp_pipeline_t *p)
+{
+  // Not short circuited, every stage gets a turn
+  const bool captured = gbp_pipeline_captureStep(p);
+  const bool parsed   = gbp_pipeline_parseStep(p);
+  const bool output   = gbp_pipeline_outputStep(p);
+  return captured || parsed || output;
+}
+
+#ifdef GBP_PIPELINE_THREADS_SUPPORTED
+typedef bool (*gbp_pipeline_step_t)(gbp_pipeline_t *p);
+
+static void gbp_pipeline_idle(void)
+{
+#if defined(ESP32)
+  vTaskDelay(1);
+#else
+  sched_yield();
+#endif
+}
+
+static void gbp_pipeline_runStage(gbp_pipeline_t *p, gbp_pipeline_step_t step)
+{
+  while (__atomic_load_n(&p->running, __ATOMIC_ACQUIRE))
+  {
+    if (!step(p))
+      gbp_pipeline_idle();
+  }
+  __atomic_sub_fetch(&p->stageThreads, 1, __ATOMIC_ACQ_REL);
+}
+
+#if defined(ESP32)
+static void gbp_pipeline_captureTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_captureStep); vTaskDelete(NULL); }
+static void gbp_pipeline_parseTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_parseStep); vTaskDelete(NULL); }
+static void gbp_pipeline_outputTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_outputStep); vTaskDelete(NULL); }
+
+static bool gbp_pipeline_spawn(gbp_pipeline_t *p, void (*task)(void *), const char *name, UBaseType_t priority, int core)
+{
+  __atomic_add_fetch(&p->stageThreads, 1, __ATOMIC_ACQ_REL);
+  if (xTaskCreatePinnedToCore(task, name, GBP_PIPELINE_TASK_STACK_SIZE, p, priority, NULL, core) == pdPASS)
+    return true;
+  __atomic_sub_fetch(&p->stageThreads, 1, __ATOMIC_ACQ_REL);
+  return false;
+}
+#else
+static void *gbp_pipeline_captureTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_captureStep); return NULL; }
+static void *gbp_pipeline_parseTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_parseStep); return NULL; }
+static void *gbp_pipeline_outputTask(void *p) { gbp_pipeline_runStage((gbp_pipeline_t *)p, gbp_pipeline_outputStep); return NULL; }
+
+static bool gbp_pipeline_spawn(gbp_pipeline_t *p, void *(*task)(void *), const char *name, int priority, int core)
+{
+  (void)name;
+  (void)priority;
+  (void)core;
+  pthread_t thread;
+  __atomic_add_fetch(&p->stageThreads, 1, __ATOMIC_ACQ_REL);
+  if (pthread_create(&thread, NULL, task, p) == 0)
+  {
+    pthread_detach(thread);
+    return true;
+  }
+  __atomic_sub_fetch(&p->stageThreads, 1, __ATOMIC_ACQ_REL);
+  return false;
+}
+#endif
+
+bool gbp_pipeline_start(gbp_pipeline_t *p, const gbp_pipeline_cores_t *cores)
+{
+  if (p->running)
+    return false;
+  __atomic_store_n(&p->running, true, __ATOMIC_RELEASE);
+  // Capture drains dataBuff so it gets the highest priority
+  bool started = true;
+  started      = started && gbp_pipeline_spawn(p, gbp_pipeline_captureTask, "gbpCapture", 3, cores->capture);
+  started      = started && gbp_pipeline_spawn(p, gbp_pipeline_parseTask, "gbpParse", 2, cores->parse);
+  started      = started && gbp_pipeline_spawn(p, gbp_pipeline_outputTask, "gbpOutput", 1, cores->output);
+  if (!started)
+    gbp_pipeline_stop(p);
+  return started;
+}
+
+void gbp_pipeline_stop(gbp_pipeline_t *p)
+{
+  __atomic_store_n(&p->running, false, __ATOMIC_RELEASE);
+  while (__atomic_load_n(&p->stageThreads, __ATOMIC_ACQUIRE) > 0)
+    gbp_pipeline_idle();
+}
+#endif
+
+#endif  // __AVR__
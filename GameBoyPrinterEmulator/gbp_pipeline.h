@@ -0,0 +1,159 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Parse Pipeline
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Splits parse mode into capture, parse and output stages that can run on separate cores
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Stages
+
+    [link ISR] -> dataBuff -> CAPTURE -> (raw queue) -> PARSE -> (event queue) -> OUTPUT -> serial
+
+  * CAPTURE : Drains raw packet bytes via io.read() in chunks. Keep this on the
+              same core as the link ISR, as that core already owns dataBuff
+  * PARSE   : gbp_pkt packet parser and optional decompressor
+  * OUTPUT  : Formats events as the same text as parse mode and passes it to io.write()
+
+  The end of a print session (io.read() reporting a timeout) travels through
+  the queues in order, so io.sessionEnd() is called after the last line of the
+  session has been written.
+
+  Each queue has one producer and one consumer (see gbp_spsc.h). When a queue
+  is full the upstream stage simply waits, so bytes back up into dataBuff as
+  they do without the pipeline.
+
+  ## Backends
+
+  * ESP32 : gbp_pipeline_start() creates a FreeRTOS task per stage pinned to
+            the cores in gbp_pipeline_cores_t
+  * Host  : gbp_pipeline_start() creates a pthread per stage (cores ignored)
+  * Any   : gbp_pipeline_poll() runs each stage once on the calling thread
+*******************************************************************************/
+#ifndef GBP_PIPELINE_H
+#define GBP_PIPELINE_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "gbp_pkt.h"
+#include "gbp_spsc.h"
+
+#define GBP_PIPELINE_CHUNK_SIZE      30  // Raw bytes per capture queue item (item is 32 bytes)
+#define GBP_PIPELINE_RAW_QUEUE_LEN   16  // Power of two
+#define GBP_PIPELINE_EVENT_QUEUE_LEN 32  // Power of two
+#define GBP_PIPELINE_TEXT_MAX        160 // Longest formatted line (INQY status)
+#define GBP_PIPELINE_TASK_STACK_SIZE 4096 // Per stage (FreeRTOS)
+
+#if defined(ESP32) || !defined(ARDUINO)
+#define GBP_PIPELINE_THREADS_SUPPORTED
+#endif
+
+typedef enum
+{
+  GBP_PIPELINE_EVENT_PACKET,      ///< Packet header and small payload (e.g. print instruction)
+  GBP_PIPELINE_EVENT_DATA,        ///< Tile or partial payload
+  GBP_PIPELINE_EVENT_SESSION_END  ///< Link timed out
+} gbp_pipeline_event_type_t;
+
+typedef struct
+{
+  uint8_t size;
+  bool sessionEnd;  ///< Set after the last chunk of a session
+  uint8_t data[GBP_PIPELINE_CHUNK_SIZE];
+} gbp_pipeline_chunk_t;
+
+typedef struct
+{
+  uint8_t type;  ///< gbp_pipeline_event_type_t
+  uint8_t command;
+  uint8_t compression;
+  uint8_t status;
+  uint16_t dataLength;
+  uint8_t size;
+  uint8_t data[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+} gbp_pipeline_event_t;
+
+typedef struct
+{
+  void *ctx;
+  // Capture stage. Copy up to max raw bytes. Set *sessionEnd when the link has timed out
+  size_t (*read)(void *ctx, uint8_t *data, size_t max, bool *sessionEnd);
+  // Output stage. One formatted line
+  void (*write)(void *ctx, const char *text, size_t len);
+  // Output stage. Optional, after the last line of a session
+  void (*sessionEnd)(void *ctx);
+} gbp_pipeline_io_t;
+
+typedef struct
+{
+  int capture;
+  int parse;
+  int output;
+} gbp_pipeline_cores_t;
+
+typedef struct
+{
+  gbp_pipeline_io_t io;
+  bool decompress;
+  bool running;         ///< Stage threads keep going while set
+  uint8_t stageThreads; ///< Stage threads that have not exited yet
+
+  /* Queues */
+  gbp_spsc_t rawQueue;
+  gbp_spsc_t eventQueue;
+  gbp_pipeline_chunk_t rawQueueBuff[GBP_PIPELINE_RAW_QUEUE_LEN];
+  gbp_pipeline_event_t eventQueueBuff[GBP_PIPELINE_EVENT_QUEUE_LEN];
+
+  /* Stage state. Only touched by the owning stage */
+  gbp_pipeline_chunk_t captureChunk;  ///< Held while rawQueue is full
+  bool captureChunkPending;
+  gbp_pipeline_chunk_t parseChunk;
+  uint8_t parseChunkIndex;
+  bool parseChunkPending;
+  gbp_pipeline_event_t parseEvent;  ///< Held while eventQueue is full
+  bool parseEventPending;
+  bool parseDecompressing;
+  gbp_pkt_t pktState;
+  uint8_t pktBuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktBuffSize;
+  gbp_pkt_tileAcc_t tileBuff;
+
+  /* Diagnostics */
+  uint32_t bytesCaptured;  ///< Capture stage
+  uint32_t eventsOutput;   ///< Output stage
+  uint32_t sessionsOutput; ///< Output stage
+} gbp_pipeline_t;
+
+bool gbp_pipeline_init(gbp_pipeline_t *p, const gbp_pipeline_io_t *io, bool decompress);
+
+/* Stages. Each returns true if it did any work */
+bool gbp_pipeline_captureStep(gbp_pipeline_t *p);
+bool gbp_pipeline_parseStep(gbp_pipeline_t *p);
+bool gbp_pipeline_outputStep(gbp_pipeline_t *p);
+bool gbp_pipeline_poll(gbp_pipeline_t *p);
+
+size_t gbp_pipeline_formatEvent(const gbp_pipeline_event_t *evt, bool decompressed, char *text, size_t textMax);
+
+#ifdef GBP_PIPELINE_THREADS_SUPPORTED
+bool gbp_pipeline_start(gbp_pipeline_t *p, const gbp_pipeline_cores_t *cores);
+void gbp_pipeline_stop(gbp_pipeline_t *p);
+#endif
+
+#endif
@@ -21,6 +21,8 @@
  *   You should have received a copy of the GNU General Public License
  *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
  */
+#ifndef GBP_PKT_H
+#define GBP_PKT_H
 
 #include <stdint.h>   // uint8_t
 #include <stddef.h>   // size_t
@@ -101,3 +103,5 @@ static inline int gbp_pkt_printInstruction_print_density(uint8_t payloadBuff[GBP
 {
   return (payloadBuff[GBP_PRINT_INSTRUCT_INDEX_PRINT_DENSITY]);
 }
+
+#endif
@@ -0,0 +1,89 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Payload Pool
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Parse mode payload slots, filled by the parser while earlier ones are still being output
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_spsc.h"
+#include "gbp_pipeline.h"
+#include "gbp_pool.h"
+
+void gbp_pool_init(gbp_pool_t *p)
+{
+  memset(p, 0, sizeof(*p));
+  gbp_spsc_init(&p->queue, (uint8_t *)p->slots, sizeof(gbp_pipeline_event_t), GBP_POOL_SLOTS);
+}
+
+/*******************************************************************************
+  Parser
+*******************************************************************************/
+
+gbp_pipeline_event_t *gbp_pool_acquire(gbp_pool_t *p)
+{
+  gbp_pipeline_event_t *evt = (gbp_pipeline_event_t *)gbp_spsc_acquire(&p->queue);
+  // Only counted once per stall, the parser keeps asking until a slot frees
+  if ((evt == NULL) && !p->stalled)
+    p->parserStalls++;
+  p->stalled = (evt == NULL);
+  return evt;
+}
+
+void gbp_pool_commit(gbp_pool_t *p)
+{
+  gbp_spsc_commit(&p->queue);
+  const uint8_t used = gbp_pool_slotsUsed(p);
+  if (used > p->highWater)
+    p->highWater = used;
+}
+
+/*******************************************************************************
+  Output
+*******************************************************************************/
+
+bool gbp_pool_outputStep(gbp_pool_t *p, gbp_pool_write_t write, void *ctx)
+{
+  bool worked = false;
+  if (p->lineSent == p->lineLen)
+  {
+    const gbp_pipeline_event_t *evt = (const gbp_pipeline_event_t *)gbp_spsc_peek(&p->queue);
+    if (evt == NULL)
+      return false;
+    // Compression is already cleared by the parser when it decompresses
+    p->lineLen  = (uint8_t)gbp_pipeline_formatEvent(evt, false, p->line, sizeof(p->line));
+    p->lineSent = 0;
+    // Slot is free as soon as it is formatted, the parser can fill it while the line goes out
+    gbp_spsc_release(&p->queue);
+    p->linesOutput++;
+    worked = true;
+  }
+  const size_t sent = write(ctx, &p->line[p->lineSent], p->lineLen - p->lineSent);
+  p->lineSent += (uint8_t)sent;
+  return worked || (sent > 0);
+}
+
+bool gbp_pool_isIdle(gbp_pool_t *p)
+{
+  return (p->lineSent == p->lineLen) && gbp_spsc_isEmpty(&p->queue);
+}
@@ -0,0 +1,88 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Payload Pool
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Parse mode payload slots, filled by the parser while earlier ones are still being output
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Slots
+
+    parser -> [slot][slot][slot][slot] -> output -> (line) -> serial
+
+  Without the pipeline, parse mode used to print each packet or tile and wait
+  for serial to drain (Serial.flush()) before parsing the next byte. With the
+  pool the parser builds each event in a free slot (gbp_pool_acquire()) and
+  hands it over (gbp_pool_commit()), then carries on. The output step formats
+  the oldest slot into one line, releases the slot, and writes the line out as
+  serial has room for it, so it never waits for the UART.
+
+  Each slot is a gbp_pipeline_event_t, so the text is exactly that of the
+  pipeline (gbp_pipeline_formatEvent()). When every slot is waiting for output
+  the parser stops and bytes back up into dataBuff, as they do without the pool.
+
+  ## Sizing
+
+  GBP_POOL_SLOTS in gbp_config.h. The line buffer is the fixed cost and each
+  slot is one more event the parser can run ahead of serial. See the pool in
+  test/gbp_budget.cc for what each configuration can afford.
+*******************************************************************************/
+#ifndef GBP_POOL_H
+#define GBP_POOL_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "gbp_config.h"
+#include "gbp_spsc.h"
+#include "gbp_pipeline.h"
+
+// Output. Write up to len bytes without waiting, returns how many were taken
+typedef size_t (*gbp_pool_write_t)(void *ctx, const char *text, size_t len);
+
+typedef struct
+{
+  gbp_spsc_t queue;
+  gbp_pipeline_event_t slots[GBP_POOL_SLOTS];
+
+  /* Output. Line formatted from the last released slot */
+  char line[GBP_PIPELINE_TEXT_MAX];
+  uint8_t lineLen;
+  uint8_t lineSent;
+
+  /* Diagnostics */
+  bool stalled;
+  uint8_t highWater;      ///< Most slots waiting for output at once
+  uint16_t parserStalls;  ///< Times gbp_pool_acquire() found every slot waiting for output
+  uint32_t linesOutput;
+} gbp_pool_t;
+
+void gbp_pool_init(gbp_pool_t *p);
+
+/* Parser */
+gbp_pipeline_event_t *gbp_pool_acquire(gbp_pool_t *p);  ///< Free slot to fill, NULL if output is behind
+void gbp_pool_commit(gbp_pool_t *p);                    ///< Queue the acquired slot for output
+
+/* Output */
+bool gbp_pool_outputStep(gbp_pool_t *p, gbp_pool_write_t write, void *ctx);  ///< True if anything was written
+bool gbp_pool_isIdle(gbp_pool_t *p);  ///< No slot queued and no line part way out
+
+static inline uint8_t gbp_pool_slotsUsed(gbp_pool_t *p) { return (uint8_t)gbp_spsc_count(&p->queue); }
+
+#endif
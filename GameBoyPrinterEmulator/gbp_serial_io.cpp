@@ -25,10 +25,25 @@
     I was trying to do most of the processing here, however I think it makes
     more sense to simply grab a stream of packets then process that in a separate
     module. This will also make maintainance easier this way.
+
+  ## Byte Gap Resync (gpb_serial_io_OnEdgeTime_ISR)
+    The bit engine only counts edges, so one missed or extra clock edge leaves
+    every later bit of the packet in the wrong place until the link timeout.
+    The gameboy idles between bytes, so an edge after a gap longer than
+    resyncGap_us must be bit 0 of a byte. If the bit counter is not at a byte
+    boundary then, it is realigned to the nearest one:
+    * 1 to 3 bits into the byte  : extra edges. Those bits are dropped
+    * 4 to 7 bits into the byte  : missed edges. The byte ends as it is
+    Either way only that byte is wrong, and the packet carries on. A missed
+    edge leaves a gap of two bit periods, about as long as the gap between
+    bytes, so it may be realigned there and again at the byte gap. That is
+    two resyncs, but still the one byte. The preamble scan is not realigned
+    (it finds the next sync word by itself).
 *******************************************************************************/
 
 #include <stdint.h>  // uint8_t
 #include <stddef.h>  // size_t
+#include <string.h>  // memcpy
 
 #include "gameboy_printer_protocol.h"
 #include "gbp_serial_io.h"
@@ -36,8 +51,6 @@
 
 /******************************************************************************/
 
-#define GBP_PKT10_TIMEOUT_MS 500
-
 // Testing
 //#define TEST_CHECKSUM_FORCE_FAIL
 //#define TEST_PRETEND_BUFFER_FULL
@@ -45,8 +58,6 @@
 // Feature
 //#define FEATURE_CHECKSUM_SUPPORTED ///< WIP
 
-#define GBP_BUSY_PACKET_COUNT 20  // 68 Inquiry packets is generally approximately how long it takes for a real printer to print. This is not a real printer so can be shorter
-
 
 /******************************************************************************/
 
@@ -67,9 +78,13 @@ static struct
   uint16_t preamble;  ///< Scanning for Preamble
   // Byte Tx/Rx
   uint16_t bitMaskMap;  // gpb_sio_bitmaskmaps_t
-  gpb_sio_mode_t mode;
+  uint8_t mode;         ///< gpb_sio_mode_t (byte sized to keep the nano budget)
   uint16_t rx_buff;
   uint16_t tx_buff;
+  // Byte Gap Resync
+  uint16_t lastEdge_us;   ///< Low bits of the edge time. Gaps over 65ms can alias, the next gap catches up
+  uint16_t resyncGap_us;  ///< See gbp_serial_io_setResyncGap()
+  uint16_t resyncs;
 } gpb_sio;
 
 
@@ -93,6 +108,7 @@ static struct
   // Initialized Command
   bool initReceived;
   uint32_t timeout_ms;
+  uint16_t timeoutReload_ms;  ///< See gbp_serial_io_setTimeout()
 
   // Circular Buffer : To store raw packet stream for packet processor
   gpb_cbuff_t dataBuffer;
@@ -105,7 +121,7 @@ static struct
   bool nulPacketReceived;         ///< Inquiry Packet Command
 
   // Packet Parsing
-  gbp_pktIO_parse_state_t packetState;
+  uint8_t packetState;  ///< gbp_pktIO_parse_state_t (byte sized to keep the nano budget)
   uint8_t command;
   uint8_t compression;
   uint16_t data_length;
@@ -115,6 +131,7 @@ static struct
   uint16_t statusBuffer;  ///< This is send on every packet in the dummy data region
 
   // Status Packet Sequencing (For faking the printer for more advance games)
+  uint8_t busyPacketCount;  ///< See gbp_serial_io_setBusyPacketCount()
   int busyPacketCountdown;
   int untransPacketCountdown;
   int dataPacketCountdown;
@@ -179,6 +196,16 @@ static uint16_t gpb_sio_getWord()
   return temp;
 }
 
+// Next byte to preload into a byte-per-interrupt transmitter (e.g. hardware SPI data register)
+static uint8_t gpb_sio_getTxByte()
+{
+  if (gpb_sio.bitMaskMap > 0xFF)
+    return (uint8_t)((gpb_sio.tx_buff >> 8) & 0xFF);
+  if (gpb_sio.bitMaskMap > 0)
+    return (uint8_t)((gpb_sio.tx_buff >> 0) & 0xFF);
+  return 0x00;
+}
+
 static uint8_t gpb_sio_getByte(const int bytePos)
 {
   switch (bytePos)
@@ -226,7 +253,7 @@ uint8_t gbp_serial_io_dataBuff_getByte(void)
     return 0;
 
   /* Packet Timeout Reset (Still Processing) */
-  gpb_pktIO.timeout_ms = GBP_PKT10_TIMEOUT_MS;
+  gpb_pktIO.timeout_ms = gpb_pktIO.timeoutReload_ms;
 
   return b;
 }
@@ -253,6 +280,97 @@ uint16_t gbp_serial_io_dataBuff_max(void)
   return gpb_cbuff_Capacity(&gpb_pktIO.dataBuffer);
 }
 
+void gbp_serial_io_setTimeout(uint16_t timeout_ms)
+{
+  gpb_pktIO.timeoutReload_ms = timeout_ms;
+}
+
+void gbp_serial_io_setBusyPacketCount(uint8_t count)
+{
+  gpb_pktIO.busyPacketCount = count;
+}
+
+void gbp_serial_io_setResyncGap(uint16_t gap_us)
+{
+  gpb_sio.resyncGap_us = gap_us;
+}
+
+uint16_t gbp_serial_io_resyncCount(bool resetCount)
+{
+  uint16_t retval = gpb_sio.resyncs;
+  if (resetCount)
+  {
+    gpb_sio.resyncs = 0;
+  }
+  return retval;
+}
+
+size_t gbp_serial_io_stateSize(void)
+{
+  return sizeof(gpb_sio) + sizeof(gpb_pktIO);
+}
+
+/******************************************************************************/
+
+// [SIO SIZE u16][PKTIO SIZE u16][gpb_sio][gpb_pktIO][dataBuff bytes, oldest first]
+// The dataBuff pointer is not kept and its bytes are stored from index 0, so the
+// same state always gives the same checkpoint however far the buffer had wrapped.
+// Not ISR safe, take and restore checkpoints between bytes
+#define GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE 4
+
+size_t gbp_serial_io_checkpointSize(void)
+{
+  return GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE + sizeof(gpb_sio) + sizeof(gpb_pktIO) + gpb_cbuff_Capacity(&gpb_pktIO.dataBuffer);
+}
+
+size_t gbp_serial_io_checkpointSave(uint8_t *out, size_t max)
+{
+  const size_t count = gpb_cbuff_Count(&gpb_pktIO.dataBuffer);
+  const size_t size  = GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE + sizeof(gpb_sio) + sizeof(gpb_pktIO) + count;
+  if (size > max)
+    return 0;
+  out[0] = (uint8_t)(sizeof(gpb_sio) >> 0);
+  out[1] = (uint8_t)(sizeof(gpb_sio) >> 8);
+  out[2] = (uint8_t)(sizeof(gpb_pktIO) >> 0);
+  out[3] = (uint8_t)(sizeof(gpb_pktIO) >> 8);
+  uint8_t *pos = &out[GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE];
+  memcpy(pos, &gpb_sio, sizeof(gpb_sio));
+  pos += sizeof(gpb_sio);
+  // Saved as if the bytes started at index 0 of no particular buffer
+  const gpb_cbuff_t dataBuffer  = gpb_pktIO.dataBuffer;
+  gpb_pktIO.dataBuffer.buffer = NULL;
+  gpb_pktIO.dataBuffer.tail   = 0;
+  gpb_pktIO.dataBuffer.head   = (count < dataBuffer.capacity) ? count : 0;
+  memcpy(pos, &gpb_pktIO, sizeof(gpb_pktIO));
+  gpb_pktIO.dataBuffer = dataBuffer;
+  pos += sizeof(gpb_pktIO);
+  for (size_t i = 0; i < count; i++)
+    gpb_cbuff_Dequeue_Peek(&gpb_pktIO.dataBuffer, &pos[i], (uint32_t)i);
+  return size;
+}
+
+bool gbp_serial_io_checkpointRestore(const uint8_t *in, size_t size)
+{
+  if ((size < (GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE + sizeof(gpb_sio) + sizeof(gpb_pktIO))) ||
+      (((size_t)in[0] | ((size_t)in[1] << 8)) != sizeof(gpb_sio)) ||
+      (((size_t)in[2] | ((size_t)in[3] << 8)) != sizeof(gpb_pktIO)))
+    return false;  ///< Not from this build
+  const uint8_t *pos  = &in[GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE];
+  const size_t count  = size - (GBP_SERIAL_IO_CHECKPOINT_HEADER_SIZE + sizeof(gpb_sio) + sizeof(gpb_pktIO));
+  const gpb_cbuff_t current = gpb_pktIO.dataBuffer;
+  if (count > current.capacity)
+    return false;  ///< Bigger than this dataBuff
+  memcpy(&gpb_sio, pos, sizeof(gpb_sio));
+  pos += sizeof(gpb_sio);
+  memcpy(&gpb_pktIO, pos, sizeof(gpb_pktIO));
+  pos += sizeof(gpb_pktIO);
+  // Keep this build's buffer
+  gpb_cbuff_Init(&gpb_pktIO.dataBuffer, current.capacity, current.buffer);
+  for (size_t i = 0; i < count; i++)
+    gpb_cbuff_Enqueue(&gpb_pktIO.dataBuffer, pos[i]);
+  return true;
+}
+
 
 /******************************************************************************/
 
@@ -290,7 +408,13 @@ bool gpb_serial_io_init(size_t buffSize, uint8_t *buffPtr)
   // reset status data
   gpb_pktIO.statusBuffer        = 0x0000;
   gpb_pktIO.statusBuffer        = GBP_DEVICE_ID << 8;
-  gpb_pktIO.busyPacketCountdown = 0;
+  gpb_pktIO.busyPacketCountdown    = 0;
+  gpb_pktIO.untransPacketCountdown = 0;
+  gpb_pktIO.busyPacketCount        = GBP_BUSY_PACKET_COUNT;
+  gpb_pktIO.timeoutReload_ms       = GBP_PKT10_TIMEOUT_MS;
+  gpb_pktIO.dataPacketCountdown    = 0;
+  gpb_sio.resyncGap_us             = GBP_RESYNC_GAP_US;
+  gpb_sio.resyncs                  = 0;
 
   // print data buffer
   gpb_cbuff_Init(&gpb_pktIO.dataBuffer, buffSize, buffPtr);
@@ -304,84 +428,10 @@ bool gpb_serial_io_init(size_t buffSize, uint8_t *buffPtr)
 
 /******************************************************************************/
 
-// Assumption: Only one gameboy printer connection required
-// Return: pin state of GBP_SIN
-#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
-bool gpb_serial_io_OnRising_ISR(const bool GBP_SOUT)
-#else
-bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
-#endif
+// Called once a full 8 or 16 bit word has been clocked in (by either the bit or byte engine)
+// Queues the captured bytes and advances the packet state (which preps gpb_sio for the next word)
+static void gpb_serial_io_OnWordReceived(void)
 {
-  // Based on SIO Timing Chart. Page 30 of GameBoy PROGRAMMING MANUAL Version 1.0:
-  // * CPOL=1 : Clock Polarity 1. Idle on high.
-  // * CPHA=1 : Clock Phase 1. Change on falling. Check bit on rising edge.
-
-  // # Pin input state
-  // * GBP_SCLK : Serial Clock (1 = Rising Edge) (0 = Falling Edge)
-  // * GBP_SOUT : Master Output Slave Input (This device is slave)
-
-  // Scan for preamble
-  if (!gpb_sio.syncronised)
-  {
-#ifndef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
-    // Expecting rising edge
-    if (!GBP_SCLK)
-      return false;
-#endif
-
-    // Clocking bits on rising edge
-    gpb_sio.preamble |= GBP_SOUT ? 1 : 0;
-
-    // Sync Not Found? Keep scanning
-    if ((gpb_sio.preamble & 0xFFFF) != GBP_SYNC_WORD)
-    {
-      gpb_sio.preamble <<= 1;
-      return false;
-    }
-
-    // Preamble Found... Currently at rising edge
-    // Start reading the packet header
-    gpb_pktIO.packetState = GBP_PKT10_PARSE_HEADER_COMMAND_AND_COMPRESSION;
-    gpb_sio.preamble      = 0;
-    gpb_sio.syncronised   = true;
-    gpb_sio_next(GBP_SIO_MODE_16BITS_BIG_ENDIAN, 0);
-    return false;
-  }
-
-  /* Psudo SPI Engine */
-  // Basically I have one bit acting as a mask moving across a word sized buffer
-  if (gpb_sio.bitMaskMap > 0)
-  {
-    // Serial Transaction Is Active
-#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
-    // Rising Edge Clock (Rx Bit)
-    gpb_sio.rx_buff |= GBP_SOUT ? (gpb_sio.bitMaskMap & 0xFFFF) : 0;  ///< Clocking bits on rising edge
-    gpb_sio.bitMaskMap >>= 1;                                         ///< One tx/rx bit cycle complete, next bit now
-    // Falling Edge Clock (Tx Bit) (Prep now for next rising edge)
-    gpb_sio.SINOutputPinState = (gpb_sio.bitMaskMap & gpb_sio.tx_buff) > 0;
-    if (gpb_sio.bitMaskMap > 0)
-      return gpb_sio.SINOutputPinState;
-#else
-    if (GBP_SCLK)
-    {
-      // Rising Edge Clock (Rx Bit)
-      gpb_sio.rx_buff |= GBP_SOUT ? (gpb_sio.bitMaskMap & 0xFFFF) : 0;  ///< Clocking bits on rising edge
-      gpb_sio.bitMaskMap >>= 1;                                         ///< One tx/rx bit cycle complete, next bit now
-
-      if (gpb_sio.bitMaskMap > 0)
-        return gpb_sio.SINOutputPinState;
-    }
-    else
-    {
-      // Falling Edge Clock (Tx Bit)
-      gpb_sio.SINOutputPinState = (gpb_sio.bitMaskMap & gpb_sio.tx_buff) > 0;
-      return gpb_sio.SINOutputPinState;
-    }
-#endif
-  }
-
-  /****************************************************************************/
-
   /* There is uncaptured sync bytes so add it in */
   if (gpb_pktIO.packetState == GBP_PKT10_PARSE_HEADER_COMMAND_AND_COMPRESSION)
   {
@@ -425,7 +475,7 @@ bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
   }
 
   /* Packet Timeout Reset */
-  gpb_pktIO.timeout_ms = GBP_PKT10_TIMEOUT_MS;
+  gpb_pktIO.timeout_ms = gpb_pktIO.timeoutReload_ms;
 
   /****************************************************************************/
   /* Packet State */
@@ -571,7 +621,7 @@ bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
             gpb_status_bit_update_printer_busy(gpb_pktIO.statusBuffer, false);
             break;
           case GBP_COMMAND_PRINT:
-            gpb_pktIO.busyPacketCountdown = GBP_BUSY_PACKET_COUNT;
+            gpb_pktIO.busyPacketCountdown = gpb_pktIO.busyPacketCount;
             break;
           case GBP_COMMAND_DATA:
             gpb_pktIO.untransPacketCountdown = 3;
@@ -710,6 +760,88 @@ bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
         gpb_sio.SINOutputPinState = false;
       }
   }
+}
+
+/******************************************************************************/
+
+// Assumption: Only one gameboy printer connection required
+// Return: pin state of GBP_SIN
+#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+bool gpb_serial_io_OnRising_ISR(const bool GBP_SOUT)
+#else
+bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
+#endif
+{
+  // Based on SIO Timing Chart. Page 30 of GameBoy PROGRAMMING MANUAL Version 1.0:
+  // * CPOL=1 : Clock Polarity 1. Idle on high.
+  // * CPHA=1 : Clock Phase 1. Change on falling. Check bit on rising edge.
+
+  // # Pin input state
+  // * GBP_SCLK : Serial Clock (1 = Rising Edge) (0 = Falling Edge)
+  // * GBP_SOUT : Master Output Slave Input (This device is slave)
+
+  // Scan for preamble
+  if (!gpb_sio.syncronised)
+  {
+#ifndef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+    // Expecting rising edge
+    if (!GBP_SCLK)
+      return false;
+#endif
+
+    // Clocking bits on rising edge
+    gpb_sio.preamble |= GBP_SOUT ? 1 : 0;
+
+    // Sync Not Found? Keep scanning
+    if ((gpb_sio.preamble & 0xFFFF) != GBP_SYNC_WORD)
+    {
+      gpb_sio.preamble <<= 1;
+      return false;
+    }
+
+    // Preamble Found... Currently at rising edge
+    // Start reading the packet header
+    gpb_pktIO.packetState = GBP_PKT10_PARSE_HEADER_COMMAND_AND_COMPRESSION;
+    gpb_sio.preamble      = 0;
+    gpb_sio.syncronised   = true;
+    gpb_sio_next(GBP_SIO_MODE_16BITS_BIG_ENDIAN, 0);
+    return false;
+  }
+
+  /* Psudo SPI Engine */
+  // Basically I have one bit acting as a mask moving across a word sized buffer
+  if (gpb_sio.bitMaskMap > 0)
+  {
+    // Serial Transaction Is Active
+#ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+    // Rising Edge Clock (Rx Bit)
+    gpb_sio.rx_buff |= GBP_SOUT ? (gpb_sio.bitMaskMap & 0xFFFF) : 0;  ///< Clocking bits on rising edge
+    gpb_sio.bitMaskMap >>= 1;                                         ///< One tx/rx bit cycle complete, next bit now
+    // Falling Edge Clock (Tx Bit) (Prep now for next rising edge)
+    gpb_sio.SINOutputPinState = (gpb_sio.bitMaskMap & gpb_sio.tx_buff) > 0;
+    if (gpb_sio.bitMaskMap > 0)
+      return gpb_sio.SINOutputPinState;
+#else
+    if (GBP_SCLK)
+    {
+      // Rising Edge Clock (Rx Bit)
+      gpb_sio.rx_buff |= GBP_SOUT ? (gpb_sio.bitMaskMap & 0xFFFF) : 0;  ///< Clocking bits on rising edge
+      gpb_sio.bitMaskMap >>= 1;                                         ///< One tx/rx bit cycle complete, next bit now
+
+      if (gpb_sio.bitMaskMap > 0)
+        return gpb_sio.SINOutputPinState;
+    }
+    else
+    {
+      // Falling Edge Clock (Tx Bit)
+      gpb_sio.SINOutputPinState = (gpb_sio.bitMaskMap & gpb_sio.tx_buff) > 0;
+      return gpb_sio.SINOutputPinState;
+    }
+#endif
+  }
+
+  /* Word captured */
+  gpb_serial_io_OnWordReceived();
 
 #ifdef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
   /*
@@ -728,4 +860,88 @@ bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT)
 }
 
 
+/******************************************************************************/
+
+// Call with the time of each clock edge, before the edge ISR above (see Byte Gap Resync)
+bool gpb_serial_io_OnEdgeTime_ISR(const uint32_t now_us)
+{
+  const uint16_t gap_us = (uint16_t)now_us - gpb_sio.lastEdge_us;
+  gpb_sio.lastEdge_us   = (uint16_t)now_us;
+  if ((gpb_sio.resyncGap_us == 0) || (gap_us < gpb_sio.resyncGap_us))
+    return false;
+  if (!gpb_sio.syncronised || (gpb_sio.bitMaskMap == 0))
+    return false;
+
+  // Bits clocked into the current byte
+  const bool upperByte  = gpb_sio.bitMaskMap > 0xFF;
+  const uint8_t byteMap = upperByte ? (uint8_t)(gpb_sio.bitMaskMap >> 8) : (uint8_t)gpb_sio.bitMaskMap;
+  uint8_t bits          = 0;
+  while ((byteMap << bits) < 0x80)
+    bits++;
+  if (bits == 0)
+    return false;  ///< Aligned
+
+  gpb_sio.resyncs++;
+  if (bits < 4)
+  {
+    // Extra edges, start the byte again
+    gpb_sio.rx_buff &= upperByte ? 0x00FF : 0xFF00;
+    gpb_sio.bitMaskMap = upperByte ? 0x8000 : 0x0080;
+  }
+  else if (upperByte)
+  {
+    // Missed edges, on to the lower byte of the word
+    gpb_sio.bitMaskMap = 0x0080;
+  }
+  else
+  {
+    // Missed edges, word is as complete as it will get
+    gpb_sio.bitMaskMap = 0;
+    gpb_serial_io_OnWordReceived();
+  }
+  gpb_sio.SINOutputPinState = (gpb_sio.bitMaskMap & gpb_sio.tx_buff) > 0;
+  return true;
+}
+
+
+/******************************************************************************/
+
+// Byte-per-interrupt variant of the ISR above, for links where the hardware
+// shift register (e.g. SPI slave in mode 3) already clocked in a whole byte.
+// Return: byte to preload for the next transfer (GBP_SIN)
+uint8_t gpb_serial_io_OnByte_ISR(const uint8_t GBP_SOUT)
+{
+  // Scan for preamble (byte aligned, as the gameboy idles between each byte)
+  if (!gpb_sio.syncronised)
+  {
+    gpb_sio.preamble = (uint16_t)((gpb_sio.preamble << 8) | GBP_SOUT);
+    if (gpb_sio.preamble != GBP_SYNC_WORD)
+      return 0x00;
+
+    // Preamble Found... Start reading the packet header
+    gpb_pktIO.packetState = GBP_PKT10_PARSE_HEADER_COMMAND_AND_COMPRESSION;
+    gpb_sio.preamble      = 0;
+    gpb_sio.syncronised   = true;
+    gpb_sio_next(GBP_SIO_MODE_16BITS_BIG_ENDIAN, 0);
+    return gpb_sio_getTxByte();
+  }
+
+  /* Psudo SPI Engine (Eight bits at a time) */
+  if (gpb_sio.bitMaskMap > 0xFF)
+  {
+    // Upper byte of a 16bit word
+    gpb_sio.rx_buff |= ((uint16_t)GBP_SOUT << 8) & 0xFF00;
+    gpb_sio.bitMaskMap >>= 8;
+    return gpb_sio_getTxByte();
+  }
+  gpb_sio.rx_buff |= ((uint16_t)GBP_SOUT << 0) & 0x00FF;
+  gpb_sio.bitMaskMap = 0;
+
+  /* Word captured */
+  gpb_serial_io_OnWordReceived();
+
+  return gpb_sio_getTxByte();
+}
+
+
 /******************************************************************************/
@@ -29,6 +29,10 @@
 
 #define GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR  // Away from technical accuracy towards double speed mode compatibility
 
+#define GBP_PKT10_TIMEOUT_MS  500  // Default link idle time before the session is reset
+#define GBP_RESYNC_GAP_US     180  // Default clock edge gap taken as a byte boundary (127us bit period, ~290us between bytes at 8kHz)
+#define GBP_BUSY_PACKET_COUNT 20   // 68 Inquiry packets is generally approximately how long it takes for a real printer to print. This is not a real printer so can be shorter
+
 /******************************************************************************/
 
 /* Init/Reset/ISR Functions */
@@ -39,16 +43,33 @@ bool gpb_serial_io_OnRising_ISR(const bool GBP_SOUT);
 #else
 bool gpb_serial_io_OnChange_ISR(const bool GBP_SCLK, const bool GBP_SOUT);
 #endif
+uint8_t gpb_serial_io_OnByte_ISR(const uint8_t GBP_SOUT);  ///< For byte-per-interrupt links (See gbp_link.h)
+bool gpb_serial_io_OnEdgeTime_ISR(const uint32_t now_us);  ///< Optional, before each clock edge. True if the bit counter was realigned
 
 /* Timeout */
 bool gbp_serial_io_timeout_handler(uint32_t elapsed_ms);
 
+/* Tuning (Defaults are set by gpb_serial_io_init(). Change them between sessions) */
+void gbp_serial_io_setTimeout(uint16_t timeout_ms);
+void gbp_serial_io_setBusyPacketCount(uint8_t count);
+void gbp_serial_io_setResyncGap(uint16_t gap_us);  ///< 0 turns byte gap resynchronisation off
+
 /* Output */
 size_t gbp_serial_io_dataBuff_getByteCount(void);
 uint8_t gbp_serial_io_dataBuff_getByte(void);
 uint8_t gbp_serial_io_dataBuff_getByte_Peek(uint32_t offset);
 uint16_t gbp_serial_io_dataBuff_waterline(bool resetWaterline);
 uint16_t gbp_serial_io_dataBuff_max(void);
+uint16_t gbp_serial_io_resyncCount(bool resetCount);  ///< Bytes realigned by gpb_serial_io_OnEdgeTime_ISR()
+
+/* Diagnostics */
+size_t gbp_serial_io_stateSize(void);  ///< Static RAM used by the link state machine, not counting the data buffer
+
+/* Checkpoint (Replay seeking on the host, see test/gbp_checkpoint.h) */
+// Link state and the unread dataBuff bytes. Only restores into the same build
+size_t gbp_serial_io_checkpointSize(void);                              ///< Largest checkpoint, with dataBuff full
+size_t gbp_serial_io_checkpointSave(uint8_t *out, size_t max);          ///< Bytes written, 0 if max is too small
+bool gbp_serial_io_checkpointRestore(const uint8_t *in, size_t size);  ///< False if from another build or dataBuff is too small
 
 /******************************************************************************/
 #endif
@@ -0,0 +1,346 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Runtime Settings
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Tuning knobs that can be queried, changed and persisted without a reflash
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>  // uint8_t
+#include <stddef.h>  // size_t
+#include <stdio.h>   // snprintf
+#include <string.h>  // strlen
+
+#include "gbp_serial_io.h"
+#include "gbp_settings.h"
+
+/******************************************************************************/
+
+typedef enum
+{
+  GBP_SETTING_MODE,
+  GBP_SETTING_DECOMP,
+  GBP_SETTING_BUSY,
+  GBP_SETTING_TIMEOUT,
+  GBP_SETTING_WATERMARK,
+  GBP_SETTING_COUNT
+} gbp_setting_id_t;
+
+#define GBP_SETTING_NAME_MAX 6  ///< Longest value name, with its terminator
+
+typedef struct
+{
+  char key[10];
+  uint16_t min;
+  uint16_t max;
+  uint16_t defaultValue;
+  bool named;  ///< Values are gbp_setting_modeNames (min..max), else numbers
+} gbp_setting_info_t;
+
+// Read with gbp_setting_info(), both are in flash on AVR
+static const char gbp_setting_modeNames[][GBP_SETTING_NAME_MAX] GBP_PROGMEM = { "parse", "raw" };
+
+static const gbp_setting_info_t gbp_setting_table[GBP_SETTING_COUNT] GBP_PROGMEM = {
+  { "mode", GBP_SETTINGS_MODE_PARSE, GBP_SETTINGS_MODE_RAW, GBP_SETTINGS_MODE_RAW, true },  // See gbp_settings_setBuildDefaults()
+  { "decomp", 0, 1, 0, false },                           // 0..0 if the decompressor is not built in
+  { "busy", 0, 200, GBP_BUSY_PACKET_COUNT, false },       // A real printer stays busy for ~68 inquiries
+  { "timeout", 100, 5000, GBP_PKT10_TIMEOUT_MS, false },  // Must outlast the gap between packets of one print
+  { "watermark", 0, 100, 90, false },
+};
+
+// Mode and decompressor default to what the sketch was built with
+static uint8_t gbp_settings_buildMode         = GBP_SETTINGS_MODE_RAW;
+static uint8_t gbp_settings_buildDecompressor = 0;
+
+static uint16_t gbp_setting_get(const gbp_settings_t *s, int id)
+{
+  switch (id)
+  {
+    case GBP_SETTING_MODE: return s->mode;
+    case GBP_SETTING_DECOMP: return s->decompressor;
+    case GBP_SETTING_BUSY: return s->busyPacketCount;
+    case GBP_SETTING_TIMEOUT: return s->timeoutMs;
+    case GBP_SETTING_WATERMARK: return s->watermarkPercent;
+    default: return 0;
+  }
+}
+
+static void gbp_setting_set(gbp_settings_t *s, int id, uint16_t value)
+{
+  switch (id)
+  {
+    case GBP_SETTING_MODE: s->mode = (uint8_t)value; break;
+    case GBP_SETTING_DECOMP: s->decompressor = (uint8_t)value; break;
+    case GBP_SETTING_BUSY: s->busyPacketCount = (uint8_t)value; break;
+    case GBP_SETTING_TIMEOUT: s->timeoutMs = value; break;
+    case GBP_SETTING_WATERMARK: s->watermarkPercent = (uint8_t)value; break;
+  }
+}
+
+static gbp_setting_info_t gbp_setting_info(int id)
+{
+  gbp_setting_info_t info;
+  gbp_pgm_memcpy(&info, &gbp_setting_table[id], sizeof(info));
+  if ((id == GBP_SETTING_DECOMP) && !gbp_settings_buildDecompressor)
+    info.max = 0;  // Not built in, so it cannot be switched on
+  return info;
+}
+
+static bool gbp_setting_inRange(int id, uint16_t value)
+{
+  const gbp_setting_info_t info = gbp_setting_info(id);
+  return (info.min <= value) && (value <= info.max);
+}
+
+/*******************************************************************************
+ * Defaults and Validation
+*******************************************************************************/
+
+void gbp_settings_setBuildDefaults(gbp_settings_mode_t mode, bool decompressor)
+{
+  gbp_settings_buildMode         = (uint8_t)mode;
+  gbp_settings_buildDecompressor = decompressor ? 1 : 0;
+}
+
+void gbp_settings_defaults(gbp_settings_t *s)
+{
+  for (int id = 0; id < GBP_SETTING_COUNT; id++)
+    gbp_setting_set(s, id, gbp_setting_info(id).defaultValue);
+  s->mode         = gbp_settings_buildMode;
+  s->decompressor = gbp_settings_buildDecompressor;
+}
+
+bool gbp_settings_valid(const gbp_settings_t *s)
+{
+  for (int id = 0; id < GBP_SETTING_COUNT; id++)
+    if (!gbp_setting_inRange(id, gbp_setting_get(s, id)))
+      return false;
+  return true;
+}
+
+/*******************************************************************************
+ * Settings Block
+*******************************************************************************/
+
+void gbp_settings_pack(const gbp_settings_t *s, uint8_t block[GBP_SETTINGS_BLOCK_SIZE])
+{
+  block[0] = (uint8_t)(GBP_SETTINGS_MAGIC & 0xFF);
+  block[1] = (uint8_t)(GBP_SETTINGS_MAGIC >> 8);
+  block[2] = GBP_SETTINGS_VERSION;
+  block[3] = GBP_SETTINGS_FIELDS_SIZE;
+  block[4] = s->mode;
+  block[5] = s->decompressor;
+  block[6] = s->busyPacketCount;
+  block[7] = (uint8_t)(s->timeoutMs & 0xFF);
+  block[8] = (uint8_t)(s->timeoutMs >> 8);
+  block[9] = s->watermarkPercent;
+  uint8_t sum = 0;
+  for (int i = 0; i < GBP_SETTINGS_BLOCK_SIZE - 1; i++)
+    sum += block[i];
+  block[GBP_SETTINGS_BLOCK_SIZE - 1] = (uint8_t)(0x100 - sum);
+}
+
+bool gbp_settings_unpack(gbp_settings_t *s, const uint8_t *block, size_t size)
+{
+  gbp_settings_defaults(s);
+  if (size < 5)
+    return false;
+  if ((block[0] | ((uint16_t)block[1] << 8)) != GBP_SETTINGS_MAGIC)
+    return false;
+  const size_t fieldsSize = block[3];
+  if ((block[2] == 0) || (4 + fieldsSize + 1 > size))
+    return false;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < 4 + fieldsSize + 1; i++)
+    sum += block[i];
+  if (sum != 0)
+    return false;
+
+  // Only the fields this block has. A newer block may have more that are skipped
+  const uint8_t *f = &block[4];
+  const uint16_t values[GBP_SETTING_COUNT] = { f[0], f[1], f[2], (uint16_t)(f[3] | ((uint16_t)f[4] << 8)), f[5] };
+  const uint8_t fieldEnd[GBP_SETTING_COUNT] = { 1, 2, 3, 5, 6 };
+  for (int id = 0; id < GBP_SETTING_COUNT; id++)
+    if ((fieldEnd[id] <= fieldsSize) && gbp_setting_inRange(id, values[id]))
+      gbp_setting_set(s, id, values[id]);
+  return true;
+}
+
+/*******************************************************************************
+ * Console
+*******************************************************************************/
+
+void gbp_settings_console_begin(gbp_settings_console_t *c)
+{
+  c->len      = 0;
+  c->active   = true;
+  c->overflow = false;
+}
+
+bool gbp_settings_console_byte(gbp_settings_console_t *c, char ch)
+{
+  if (!c->active || (ch == '\r'))
+    return false;
+  if (ch == '\n')
+  {
+    c->active = false;
+    while ((c->len > 0) && (c->line[c->len - 1] == ' '))
+      c->len--;
+    c->line[c->len] = '\0';
+    return true;
+  }
+  if ((c->len == 0) && (ch == ' '))
+    return false;
+  if (c->len < GBP_SETTINGS_LINE_MAX)
+    c->line[c->len++] = ch;
+  else
+    c->overflow = true;
+  return false;
+}
+
+void gbp_settings_reply(bool ok, const char *reason, gbp_settings_write_t write, void *ctx)
+{
+  char text[48];
+  if (ok)
+  {
+    gbp_pgm_strlcpy(text, GBP_PSTR("// settings ok"), sizeof(text));
+  }
+  else
+  {
+    gbp_pgm_strlcpy(text, GBP_PSTR("// settings error "), sizeof(text));
+    gbp_pgm_strlcpy(&text[strlen(text)], reason, sizeof(text) - strlen(text));
+  }
+  write(ctx, text);
+}
+
+static void gbp_settings_show(const gbp_settings_t *s, int id, gbp_settings_write_t write, void *ctx)
+{
+  char text[56];
+  const gbp_setting_info_t info = gbp_setting_info(id);
+  const uint16_t value          = gbp_setting_get(s, id);
+  if (info.named)
+  {
+    char names[3][GBP_SETTING_NAME_MAX];
+    gbp_pgm_strlcpy(names[0], gbp_setting_modeNames[value - info.min], sizeof(names[0]));
+    gbp_pgm_strlcpy(names[1], gbp_setting_modeNames[0], sizeof(names[1]));
+    gbp_pgm_strlcpy(names[2], gbp_setting_modeNames[info.max - info.min], sizeof(names[2]));
+    gbp_pgm_snprintf(text, sizeof(text), GBP_PSTR("// setting %s=%s %s..%s"), info.key, names[0], names[1], names[2]);
+  }
+  else
+  {
+    gbp_pgm_snprintf(text, sizeof(text), GBP_PSTR("// setting %s=%u %u..%u"), info.key, (unsigned)value, (unsigned)info.min, (unsigned)info.max);
+  }
+  write(ctx, text);
+}
+
+// Number, or one of the value names of the setting. False if neither
+static bool gbp_settings_parseValue(const gbp_setting_info_t *info, const char *text, uint16_t *value)
+{
+  if (info->named)
+  {
+    for (uint16_t v = info->min; v <= info->max; v++)
+    {
+      if (gbp_pgm_strcmp(text, gbp_setting_modeNames[v - info->min]) == 0)
+      {
+        *value = v;
+        return true;
+      }
+    }
+  }
+  if (*text == '\0')
+    return false;
+  uint32_t acc = 0;
+  for (; *text; text++)
+  {
+    if ((*text < '0') || (*text > '9'))
+      return false;
+    acc = acc * 10 + (uint32_t)(*text - '0');
+    if (acc > 0xFFFF)
+      return false;
+  }
+  *value = (uint16_t)acc;
+  return true;
+}
+
+gbp_settings_cmd_t gbp_settings_command(gbp_settings_t *s, const gbp_settings_console_t *c, gbp_settings_write_t write, void *ctx)
+{
+  if (c->overflow)
+  {
+    gbp_settings_reply(false, GBP_PSTR("line too long"), write, ctx);
+    return GBP_SETTINGS_CMD_ERROR;
+  }
+
+  const char *line = c->line;
+  if (line[0] == '\0')
+  {
+    for (int id = 0; id < GBP_SETTING_COUNT; id++)
+      gbp_settings_show(s, id, write, ctx);
+    gbp_settings_reply(true, NULL, write, ctx);
+    return GBP_SETTINGS_CMD_OK;
+  }
+  if (gbp_pgm_strcmp(line, GBP_PSTR("save")) == 0)
+    return GBP_SETTINGS_CMD_SAVE;
+  if (gbp_pgm_strcmp(line, GBP_PSTR("load")) == 0)
+    return GBP_SETTINGS_CMD_LOAD;
+  if (gbp_pgm_strcmp(line, GBP_PSTR("defaults")) == 0)
+  {
+    gbp_settings_defaults(s);
+    gbp_settings_reply(true, NULL, write, ctx);
+    return GBP_SETTINGS_CMD_CHANGED;
+  }
+
+  // KEY or KEY=VALUE
+  const char *eq      = strchr(line, '=');
+  const size_t keyLen = eq ? (size_t)(eq - line) : strlen(line);
+  int id              = 0;
+  gbp_setting_info_t info;
+  for (; id < GBP_SETTING_COUNT; id++)
+  {
+    info = gbp_setting_info(id);
+    if ((strlen(info.key) == keyLen) && (strncmp(line, info.key, keyLen) == 0))
+      break;
+  }
+  if (id == GBP_SETTING_COUNT)
+  {
+    gbp_settings_reply(false, GBP_PSTR("unknown setting"), write, ctx);
+    return GBP_SETTINGS_CMD_ERROR;
+  }
+  if (!eq)
+  {
+    gbp_settings_show(s, id, write, ctx);
+    gbp_settings_reply(true, NULL, write, ctx);
+    return GBP_SETTINGS_CMD_OK;
+  }
+
+  uint16_t value = 0;
+  if (!gbp_settings_parseValue(&info, eq + 1, &value))
+  {
+    gbp_settings_reply(false, GBP_PSTR("bad value"), write, ctx);
+    return GBP_SETTINGS_CMD_ERROR;
+  }
+  if (!gbp_setting_inRange(id, value))
+  {
+    gbp_settings_reply(false, GBP_PSTR("out of range"), write, ctx);
+    return GBP_SETTINGS_CMD_ERROR;
+  }
+  gbp_setting_set(s, id, value);
+  gbp_settings_show(s, id, write, ctx);
+  gbp_settings_reply(true, NULL, write, ctx);
+  return GBP_SETTINGS_CMD_CHANGED;
+}
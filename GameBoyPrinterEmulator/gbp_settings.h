@@ -0,0 +1,113 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Runtime Settings
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Tuning knobs that can be queried, changed and persisted without a reflash
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Settings Block (as stored in EEPROM/flash)
+
+    [MAGIC u16][VERSION u8][LENGTH u8][FIELDS (LENGTH bytes)][CHECKSUM u8]
+
+    FIELDS (version 1) : [MODE u8][DECOMP u8][BUSY u8][TIMEOUT u16][WATERMARK u8]
+
+  * Values are little endian
+  * CHECKSUM makes the sum of every byte of the block 0x00 (mod 256)
+  * Newer versions only append fields. An older block loads the fields it
+    has and leaves the rest at their defaults. A field that is out of range
+    also falls back to its default, so a bad block never reaches the link.
+
+  ## Console Protocol (one line per command, after the `s` console key)
+
+    s                 List every setting
+    s KEY             Get one setting
+    s KEY=VALUE       Set one setting (validated, not persisted)
+    s save            Write the settings block
+    s load            Reload the settings block (defaults if it is invalid)
+    s defaults        Restore the defaults (not persisted)
+
+  Each setting is reported as `// setting KEY=VALUE MIN..MAX`.
+  Every command ends with exactly one `// settings ok` or `// settings error REASON`
+  line, so a host tool knows when the reply is complete.
+*******************************************************************************/
+#ifndef GBP_SETTINGS_H
+#define GBP_SETTINGS_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "gbp_pgmspace.h"
+
+#define GBP_SETTINGS_MAGIC        0x4347  // "GC"
+#define GBP_SETTINGS_VERSION      1
+#define GBP_SETTINGS_FIELDS_SIZE  6
+#define GBP_SETTINGS_BLOCK_SIZE   (4 + GBP_SETTINGS_FIELDS_SIZE + 1)
+#define GBP_SETTINGS_LINE_MAX     24  ///< Longest console command, without the `s`
+
+typedef enum
+{
+  GBP_SETTINGS_MODE_PARSE = 0,  ///< Parsed packets (GBP_OUTPUT_RAW_PACKETS false)
+  GBP_SETTINGS_MODE_RAW   = 1,  ///< Raw packet capture (GBP_OUTPUT_RAW_PACKETS true)
+} gbp_settings_mode_t;
+
+typedef struct
+{
+  uint8_t mode;              ///< gbp_settings_mode_t. Applies from the next boot
+  uint8_t decompressor;      ///< Parse mode decompressor. Applies from the next boot
+  uint8_t busyPacketCount;   ///< Inquiry packets reported busy after a print
+  uint16_t timeoutMs;        ///< Link idle time that ends a session
+  uint8_t watermarkPercent;  ///< Warn when a session fills the buffer past this. 0 is off
+} gbp_settings_t;
+
+typedef enum
+{
+  GBP_SETTINGS_CMD_ERROR,    ///< Reply already has its error line
+  GBP_SETTINGS_CMD_OK,       ///< Nothing changed
+  GBP_SETTINGS_CMD_CHANGED,  ///< Settings in RAM changed, apply them
+  GBP_SETTINGS_CMD_SAVE,     ///< Caller writes the block, then ends the reply
+  GBP_SETTINGS_CMD_LOAD,     ///< Caller reads the block, then ends the reply
+} gbp_settings_cmd_t;
+
+typedef void (*gbp_settings_write_t)(void *ctx, const char *text);
+
+typedef struct
+{
+  char line[GBP_SETTINGS_LINE_MAX + 1];
+  uint8_t len;
+  bool active;    ///< Inside a command line
+  bool overflow;  ///< Line was too long, reported when it ends
+} gbp_settings_console_t;
+
+/* Defaults and Validation */
+void gbp_settings_setBuildDefaults(gbp_settings_mode_t mode, bool decompressor);  ///< decompressor: built in (and on by default), else decomp is 0..0
+void gbp_settings_defaults(gbp_settings_t *s);
+bool gbp_settings_valid(const gbp_settings_t *s);
+
+/* Settings Block */
+void gbp_settings_pack(const gbp_settings_t *s, uint8_t block[GBP_SETTINGS_BLOCK_SIZE]);
+bool gbp_settings_unpack(gbp_settings_t *s, const uint8_t *block, size_t size);  ///< Defaults (and false) if the block is not valid
+
+/* Console */
+void gbp_settings_console_begin(gbp_settings_console_t *c);
+bool gbp_settings_console_byte(gbp_settings_console_t *c, char ch);  ///< True once the line is complete
+gbp_settings_cmd_t gbp_settings_command(gbp_settings_t *s, const gbp_settings_console_t *c, gbp_settings_write_t write, void *ctx);
+void gbp_settings_reply(bool ok, const char *reason, gbp_settings_write_t write, void *ctx);  ///< reason is a GBP_PSTR() string
+
+#endif
@@ -0,0 +1,88 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Runtime Settings (EEPROM Storage)
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Keeps the gbp_settings block in EEPROM (or the emulated EEPROM in flash on ESP)
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Only bytes that differ are written, so saving unchanged settings costs no
+//           EEPROM wear. ESP8266/ESP32 keep a RAM copy of the emulated EEPROM that
+//           is only written to flash by EEPROM.commit().
+#ifndef GBP_SETTINGS_EEPROM_H
+#define GBP_SETTINGS_EEPROM_H
+#include <EEPROM.h>
+
+#include "gbp_settings.h"
+
+#ifndef GBP_SETTINGS_EEPROM_ADDRESS
+#define GBP_SETTINGS_EEPROM_ADDRESS 0
+#endif
+#define GBP_SETTINGS_EEPROM_SIZE 64  // Emulated EEPROM size on ESP. Room for later settings versions
+
+#if defined(ESP8266) || defined(ESP32)
+#define GBP_SETTINGS_EEPROM_EMULATED
+#endif
+
+static bool gbp_settings_eeprom_begin(void)
+{
+#ifdef GBP_SETTINGS_EEPROM_EMULATED
+  static bool started = false;
+  if (!started)
+    started = EEPROM.begin(GBP_SETTINGS_EEPROM_ADDRESS + GBP_SETTINGS_EEPROM_SIZE);
+  return started;
+#else
+  return true;
+#endif
+}
+
+// Defaults (and false) if there is no valid block
+static bool gbp_settings_eeprom_load(gbp_settings_t *s)
+{
+  uint8_t block[GBP_SETTINGS_BLOCK_SIZE];
+  if (!gbp_settings_eeprom_begin())
+  {
+    gbp_settings_defaults(s);
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(block); i++)
+    block[i] = EEPROM.read(GBP_SETTINGS_EEPROM_ADDRESS + i);
+  return gbp_settings_unpack(s, block, sizeof(block));
+}
+
+static bool gbp_settings_eeprom_save(const gbp_settings_t *s)
+{
+  uint8_t block[GBP_SETTINGS_BLOCK_SIZE];
+  if (!gbp_settings_eeprom_begin())
+    return false;
+  gbp_settings_pack(s, block);
+  for (size_t i = 0; i < sizeof(block); i++)
+    if (EEPROM.read(GBP_SETTINGS_EEPROM_ADDRESS + i) != block[i])
+      EEPROM.write(GBP_SETTINGS_EEPROM_ADDRESS + i, block[i]);
+#ifdef GBP_SETTINGS_EEPROM_EMULATED
+  if (!EEPROM.commit())
+    return false;
+#endif
+  // Read back, a worn out cell shows up here rather than at the next boot
+  for (size_t i = 0; i < sizeof(block); i++)
+    if (EEPROM.read(GBP_SETTINGS_EEPROM_ADDRESS + i) != block[i])
+      return false;
+  return true;
+}
+
+#endif
@@ -0,0 +1,381 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Spool
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Log structured store for captured packets while no host is listening
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gbp_spool.h"
+
+/*******************************************************************************
+  Utilities
+*******************************************************************************/
+
+static inline uint16_t gbp_spool_getU16(const uint8_t *b)
+{
+  return (uint16_t)(((uint16_t)b[0] << 0) | ((uint16_t)b[1] << 8));
+}
+
+static inline uint32_t gbp_spool_getU32(const uint8_t *b)
+{
+  return ((uint32_t)b[0] << 0) | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static inline void gbp_spool_putU16(uint8_t *b, const uint16_t v)
+{
+  b[0] = (v >> 0) & 0xFF;
+  b[1] = (v >> 8) & 0xFF;
+}
+
+static inline void gbp_spool_putU32(uint8_t *b, const uint32_t v)
+{
+  b[0] = (v >> 0) & 0xFF;
+  b[1] = (v >> 8) & 0xFF;
+  b[2] = (v >> 16) & 0xFF;
+  b[3] = (v >> 24) & 0xFF;
+}
+
+// Returns true if the segment has been formatted. Blank segments read as free with no erases
+static bool gbp_spool_readHeader(gbp_spool_t *spool, const uint16_t segment, uint32_t *eraseCount, uint32_t *sequence)
+{
+  uint8_t header[GBP_SPOOL_HEADER_SIZE] = { 0 };
+  *eraseCount = 0;
+  *sequence   = GBP_SPOOL_SEQUENCE_FREE;
+  if (!spool->storage->read(spool->storage->ctx, segment, 0, header, sizeof(header)))
+    return false;
+  if (gbp_spool_getU16(&header[0]) != GBP_SPOOL_MAGIC)
+    return false;
+  *eraseCount = gbp_spool_getU32(&header[4]);
+  *sequence   = gbp_spool_getU32(&header[8]);
+  return true;
+}
+
+static bool gbp_spool_format(gbp_spool_t *spool, const uint16_t segment, const uint32_t eraseCount, const uint32_t sequence)
+{
+  uint8_t header[GBP_SPOOL_HEADER_SIZE] = { 0 };
+  gbp_spool_putU16(&header[0], GBP_SPOOL_MAGIC);
+  gbp_spool_putU16(&header[2], 0x0000);
+  gbp_spool_putU32(&header[4], eraseCount);
+  gbp_spool_putU32(&header[8], sequence);
+  // Erased until the header is written
+  spool->eraseCounts[segment] = eraseCount;
+  spool->sequences[segment]   = GBP_SPOOL_SEQUENCE_FREE;
+  if (!spool->storage->erase(spool->storage->ctx, segment))
+    return false;
+  if (!spool->storage->write(spool->storage->ctx, segment, 0, header, sizeof(header)))
+    return false;
+  spool->sequences[segment] = sequence;
+  return true;
+}
+
+// Offset just past the last complete record of a segment
+static uint32_t gbp_spool_segmentEnd(gbp_spool_t *spool, const uint16_t segment)
+{
+  uint32_t offset = GBP_SPOOL_HEADER_SIZE;
+  while ((offset + GBP_SPOOL_RECORD_OVERHEAD) <= spool->storage->segmentSize)
+  {
+    uint8_t lenBuff[GBP_SPOOL_RECORD_OVERHEAD] = { 0 };
+    if (!spool->storage->read(spool->storage->ctx, segment, offset, lenBuff, sizeof(lenBuff)))
+      break;
+    const uint16_t len = gbp_spool_getU16(lenBuff);
+    if ((len == 0xFFFF) || (len > GBP_SPOOL_RECORD_MAX_SIZE) || ((offset + GBP_SPOOL_RECORD_OVERHEAD + len) > spool->storage->segmentSize))
+      break;
+    offset += GBP_SPOOL_RECORD_OVERHEAD + len;
+  }
+  return offset;
+}
+
+// True if nothing was programmed past the end of the segment (e.g. a write cut short by a power loss)
+static bool gbp_spool_segmentTailErased(gbp_spool_t *spool, const uint16_t segment, const uint32_t offset)
+{
+  uint8_t tail[GBP_SPOOL_RECORD_OVERHEAD + GBP_SPOOL_RECORD_MAX_SIZE];
+  uint32_t len = spool->storage->segmentSize - offset;
+  len = (len > sizeof(tail)) ? sizeof(tail) : len;
+  if (!spool->storage->read(spool->storage->ctx, segment, offset, tail, len))
+    return false;
+  for (uint32_t i = 0; i < len; i++)
+  {
+    if (tail[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+// Start a new segment, picking the least worn free segment first
+static bool gbp_spool_openSegment(gbp_spool_t *spool)
+{
+  uint16_t freeSegment     = GBP_SPOOL_SEGMENT_NONE;
+  uint32_t freeEraseCount  = 0xFFFFFFFF;
+  uint16_t oldestSegment   = GBP_SPOOL_SEGMENT_NONE;
+  uint32_t oldestSequence  = 0xFFFFFFFF;
+  uint32_t oldestEraseCount = 0;
+  for (uint16_t segment = 0; segment < spool->storage->segmentCount; segment++)
+  {
+    const uint32_t eraseCount = spool->eraseCounts[segment];
+    const uint32_t sequence   = spool->sequences[segment];
+    if (sequence == GBP_SPOOL_SEQUENCE_FREE)
+    {
+      if (eraseCount < freeEraseCount)
+      {
+        freeSegment    = segment;
+        freeEraseCount = eraseCount;
+      }
+    }
+    else if (sequence < oldestSequence)
+    {
+      oldestSegment    = segment;
+      oldestSequence   = sequence;
+      oldestEraseCount = eraseCount;
+    }
+  }
+
+  uint16_t segment    = freeSegment;
+  uint32_t eraseCount = freeEraseCount;
+  if (segment == GBP_SPOOL_SEGMENT_NONE)
+  {
+    // Spool full. Overwrite the oldest data
+    if (oldestSegment == GBP_SPOOL_SEGMENT_NONE)
+      return false;
+    segment    = oldestSegment;
+    eraseCount = oldestEraseCount;
+    if (oldestSequence > spool->replayedSequence)
+      spool->segmentsDropped++;
+  }
+
+  spool->activeSegment = GBP_SPOOL_SEGMENT_NONE;
+  if (!gbp_spool_format(spool, segment, eraseCount + 1, spool->nextSequence))
+    return false;
+  spool->nextSequence++;
+  spool->activeSegment = segment;
+  spool->writeOffset   = GBP_SPOOL_HEADER_SIZE;
+  return true;
+}
+
+
+/*******************************************************************************
+  Spool
+*******************************************************************************/
+
+bool gbp_spool_mount(gbp_spool_t *spool, const gbp_spool_storage_t *storage)
+{
+  if ((spool == NULL) || (storage == NULL))
+    return false;
+  if (storage->segmentSize < (GBP_SPOOL_HEADER_SIZE + GBP_SPOOL_RECORD_OVERHEAD + GBP_SPOOL_RECORD_MAX_SIZE))
+    return false;
+  if ((storage->segmentCount == 0) || (storage->segmentCount > GBP_SPOOL_SEGMENT_MAX))
+    return false;
+
+  spool->storage          = storage;
+  spool->activeSegment    = GBP_SPOOL_SEGMENT_NONE;
+  spool->writeOffset      = 0;
+  spool->nextSequence     = GBP_SPOOL_SEQUENCE_FREE + 1;
+  spool->replayedSequence = GBP_SPOOL_SEQUENCE_FREE;  // Unknown, so every reclaim counts
+  spool->bytesSpooled     = 0;
+  spool->segmentsDropped  = 0;
+
+  // Find the newest segment, appends resume there
+  uint32_t newestSequence = GBP_SPOOL_SEQUENCE_FREE;
+  for (uint16_t segment = 0; segment < storage->segmentCount; segment++)
+  {
+    uint32_t eraseCount = 0;
+    uint32_t sequence   = 0;
+    gbp_spool_readHeader(spool, segment, &eraseCount, &sequence);
+    spool->eraseCounts[segment] = eraseCount;
+    spool->sequences[segment]   = sequence;
+    if (sequence == GBP_SPOOL_SEQUENCE_FREE)
+      continue;
+    if (sequence >= spool->nextSequence)
+      spool->nextSequence = sequence + 1;
+    if (sequence > newestSequence)
+    {
+      newestSequence       = sequence;
+      spool->activeSegment = segment;
+    }
+  }
+
+  if (spool->activeSegment != GBP_SPOOL_SEGMENT_NONE)
+  {
+    spool->writeOffset = gbp_spool_segmentEnd(spool, spool->activeSegment);
+    if (!gbp_spool_segmentTailErased(spool, spool->activeSegment, spool->writeOffset))
+    {
+      // Partially written record. Leave this segment as is and start a new one on next append
+      spool->activeSegment = GBP_SPOOL_SEGMENT_NONE;
+    }
+  }
+
+  return true;
+}
+
+bool gbp_spool_append(gbp_spool_t *spool, const uint8_t *data, size_t len)
+{
+  if (spool->storage == NULL)
+    return false;
+
+  while (len > 0)
+  {
+    const uint16_t recordLen = (len > GBP_SPOOL_RECORD_MAX_SIZE) ? GBP_SPOOL_RECORD_MAX_SIZE : (uint16_t)len;
+    const uint32_t recordSize = GBP_SPOOL_RECORD_OVERHEAD + recordLen;
+
+    if ((spool->activeSegment == GBP_SPOOL_SEGMENT_NONE) || ((spool->writeOffset + recordSize) > spool->storage->segmentSize))
+    {
+      if (!gbp_spool_openSegment(spool))
+        return false;
+    }
+
+    // Payload first, length last. A record only exists once its length is written
+    uint8_t lenBuff[GBP_SPOOL_RECORD_OVERHEAD] = { 0 };
+    gbp_spool_putU16(lenBuff, recordLen);
+    if (!spool->storage->write(spool->storage->ctx, spool->activeSegment, spool->writeOffset + GBP_SPOOL_RECORD_OVERHEAD, data, recordLen))
+      return false;
+    if (!spool->storage->write(spool->storage->ctx, spool->activeSegment, spool->writeOffset, lenBuff, sizeof(lenBuff)))
+      return false;
+
+    spool->writeOffset += recordSize;
+    spool->bytesSpooled += recordLen;
+    const uint32_t sequence = spool->sequences[spool->activeSegment];
+    if (spool->replayedSequence >= sequence)
+      spool->replayedSequence = sequence - 1;  // Replayed segment has new data
+    data += recordLen;
+    len -= recordLen;
+  }
+  return true;
+}
+
+uint32_t gbp_spool_replay(gbp_spool_t *spool, gbp_spool_replay_cb_t cb, void *ctx)
+{
+  if (spool->storage == NULL)
+    return 0;
+
+  uint32_t byteCount    = 0;
+  uint32_t lastSequence = GBP_SPOOL_SEQUENCE_FREE;
+  while (1)
+  {
+    // Next segment in write order
+    uint16_t nextSegment  = GBP_SPOOL_SEGMENT_NONE;
+    uint32_t nextSequence = 0xFFFFFFFF;
+    for (uint16_t segment = 0; segment < spool->storage->segmentCount; segment++)
+    {
+      const uint32_t sequence = spool->sequences[segment];
+      if ((sequence > lastSequence) && (sequence < nextSequence))
+      {
+        nextSegment  = segment;
+        nextSequence = sequence;
+      }
+    }
+    if (nextSegment == GBP_SPOOL_SEGMENT_NONE)
+      break;
+    lastSequence = nextSequence;
+
+    // Replay each record in the segment
+    uint32_t offset = GBP_SPOOL_HEADER_SIZE;
+    while ((offset + GBP_SPOOL_RECORD_OVERHEAD) <= spool->storage->segmentSize)
+    {
+      uint8_t record[GBP_SPOOL_RECORD_OVERHEAD + GBP_SPOOL_RECORD_MAX_SIZE];
+      if (!spool->storage->read(spool->storage->ctx, nextSegment, offset, record, GBP_SPOOL_RECORD_OVERHEAD))
+        break;
+      const uint16_t len = gbp_spool_getU16(record);
+      if ((len == 0xFFFF) || (len > GBP_SPOOL_RECORD_MAX_SIZE) || ((offset + GBP_SPOOL_RECORD_OVERHEAD + len) > spool->storage->segmentSize))
+        break;
+      if (!spool->storage->read(spool->storage->ctx, nextSegment, offset + GBP_SPOOL_RECORD_OVERHEAD, &record[GBP_SPOOL_RECORD_OVERHEAD], len))
+        break;
+      cb(ctx, &record[GBP_SPOOL_RECORD_OVERHEAD], len);
+      byteCount += len;
+      offset += GBP_SPOOL_RECORD_OVERHEAD + len;
+    }
+  }
+  spool->replayedSequence = lastSequence;
+  return byteCount;
+}
+
+bool gbp_spool_clear(gbp_spool_t *spool)
+{
+  if (spool->storage == NULL)
+    return false;
+
+  bool ok = true;
+  for (uint16_t segment = 0; segment < spool->storage->segmentCount; segment++)
+  {
+    uint32_t eraseCount = 0;
+    uint32_t sequence   = 0;
+    const bool formatted = gbp_spool_readHeader(spool, segment, &eraseCount, &sequence);
+    if (formatted && (sequence == GBP_SPOOL_SEQUENCE_FREE))
+      continue;  // Already free. Save an erase
+    ok &= gbp_spool_format(spool, segment, eraseCount + 1, GBP_SPOOL_SEQUENCE_FREE);
+  }
+  spool->activeSegment = GBP_SPOOL_SEGMENT_NONE;
+  spool->writeOffset   = 0;
+  return ok;
+}
+
+uint32_t gbp_spool_eraseCount(gbp_spool_t *spool, uint16_t segment)
+{
+  uint32_t eraseCount = 0;
+  uint32_t sequence   = 0;
+  gbp_spool_readHeader(spool, segment, &eraseCount, &sequence);
+  return eraseCount;
+}
+
+
+/*******************************************************************************
+  Host Presence
+*******************************************************************************/
+
+void gbp_spool_host_init(gbp_spool_host_t *host, uint32_t now_ms)
+{
+  host->heard         = false;
+  host->heard_ms      = now_ms;
+  host->txRoom        = 0;
+  host->txRoomMax     = 0;
+  host->txProgress_ms = now_ms;
+}
+
+// Any byte received from the host
+void gbp_spool_host_heard(gbp_spool_host_t *host, uint32_t now_ms)
+{
+  host->heard    = true;
+  host->heard_ms = now_ms;
+}
+
+// Serial output room (e.g. availableForWrite()), sampled every loop
+void gbp_spool_host_txRoom(gbp_spool_host_t *host, int room, uint32_t now_ms)
+{
+  if (room > host->txRoomMax)
+    host->txRoomMax = room;
+  if ((room >= host->txRoomMax) || (room > host->txRoom))
+    host->txProgress_ms = now_ms;  // Empty, or draining
+  host->txRoom = room;
+}
+
+// backlog : link bytes waiting in dataBuff, out of backlogMax
+bool gbp_spool_host_ready(const gbp_spool_host_t *host, gbp_spool_host_link_t link, size_t backlog, size_t backlogMax, uint32_t now_ms)
+{
+  if (link == GBP_SPOOL_HOST_LINK_DOWN)
+    return false;
+  if ((link == GBP_SPOOL_HOST_LINK_UNKNOWN) && (!host->heard || ((uint32_t)(now_ms - host->heard_ms) >= GBP_SPOOL_HOST_KEEPALIVE_MS)))
+    return false;
+  if ((uint32_t)(now_ms - host->txProgress_ms) >= GBP_SPOOL_HOST_STALL_MS)
+    return false;  // Output is not draining
+  if ((backlogMax > 0) && (((uint32_t)backlog * 100) >= ((uint32_t)backlogMax * GBP_SPOOL_HOST_BACKLOG_PERCENT)))
+    return false;  // Host is reading, but slower than the gameboy sends
+  return true;
+}
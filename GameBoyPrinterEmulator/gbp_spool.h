@@ -0,0 +1,133 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Spool
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Log structured store for captured packets while no host is listening
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*******************************************************************************
+  ## Storage Layout
+
+  The store is split into equally sized segments. Each segment is only ever
+  appended to, and is erased as a whole before reuse, so it suits raw flash as
+  well as files on an SD card.
+
+    [SEGMENT HEADER (12B)][REC][REC][REC]...[0xFF 0xFF (erased)]
+
+    SEGMENT HEADER : [MAGIC u16][RESERVED u16][ERASE COUNT u32][SEQUENCE u32]
+    REC            : [LENGTH u16][PAYLOAD (LENGTH bytes)]
+
+  * Values are little endian
+  * Sequence 0 marks a free (cleared) segment. Open segments count up from 1
+  * A record payload is written before its length, so an interrupted write
+    reads back as the end of the segment
+  * When a new segment is needed the free segment with the lowest erase count
+    is picked. If none are free, the oldest segment is reclaimed. It is counted
+    as dropped unless it was replayed (since mount) and not appended to since
+  * Segment headers are read once at mount and then kept in gbp_spool_t, so
+    starting a segment while captures arrive costs one erase and one write
+
+  ## Host Presence
+
+  A serial port cannot tell whether anyone is reading it. The UART on most
+  boards drains at the baud rate with or without a host, so the capture loop
+  asks gbp_spool_host_ready() at the start of each packet, based on:
+
+  * Link state : USB CDC boards know if a host opened the port (DTR). Down
+                 means no host, whatever else is seen
+  * Keep-alive : Otherwise a host counts as present for GBP_SPOOL_HOST_KEEPALIVE_MS
+                 after it last sent a byte (e.g. a newline, ignored by the console)
+  * Backlog    : A host that is present but too slow is treated as absent. That
+                 is serial output that made no progress for GBP_SPOOL_HOST_STALL_MS,
+                 or link bytes waiting past GBP_SPOOL_HOST_BACKLOG_PERCENT of dataBuff
+*******************************************************************************/
+#ifndef GBP_SPOOL_H
+#define GBP_SPOOL_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#define GBP_SPOOL_MAGIC               0x5347  // "GS"
+#define GBP_SPOOL_HEADER_SIZE         12
+#define GBP_SPOOL_RECORD_MAX_SIZE     32  // Appends are split into records of this size. Also the replay read size
+#define GBP_SPOOL_RECORD_OVERHEAD     2
+#define GBP_SPOOL_SEQUENCE_FREE       0
+#define GBP_SPOOL_SEGMENT_NONE        0xFFFF
+#define GBP_SPOOL_SEGMENT_MAX         16  // Headers cached in gbp_spool_t
+
+#define GBP_SPOOL_HOST_KEEPALIVE_MS     5000
+#define GBP_SPOOL_HOST_STALL_MS         1000
+#define GBP_SPOOL_HOST_BACKLOG_PERCENT  75
+
+typedef struct
+{
+  void *ctx;
+  uint16_t segmentCount;
+  uint32_t segmentSize;  ///< In bytes, including the segment header
+  // Unwritten storage must read back as 0xFF
+  bool (*read)(void *ctx, uint16_t segment, uint32_t offset, uint8_t *data, size_t len);
+  bool (*write)(void *ctx, uint16_t segment, uint32_t offset, const uint8_t *data, size_t len);
+  bool (*erase)(void *ctx, uint16_t segment);
+} gbp_spool_storage_t;
+
+typedef struct
+{
+  const gbp_spool_storage_t *storage;
+  uint16_t activeSegment;  ///< GBP_SPOOL_SEGMENT_NONE if no segment is open for writing
+  uint32_t writeOffset;
+  uint32_t nextSequence;
+  uint32_t eraseCounts[GBP_SPOOL_SEGMENT_MAX];
+  uint32_t sequences[GBP_SPOOL_SEGMENT_MAX];  ///< GBP_SPOOL_SEQUENCE_FREE if free or never formatted
+  uint32_t replayedSequence;  ///< Segments up to this sequence hold nothing unreplayed. GBP_SPOOL_SEQUENCE_FREE after mount
+
+  // Diagnostics
+  uint32_t bytesSpooled;     ///< Since mount
+  uint16_t segmentsDropped;  ///< Reclaimed while still holding unreplayed data
+} gbp_spool_t;
+
+typedef enum
+{
+  GBP_SPOOL_HOST_LINK_UNKNOWN,  ///< e.g. a UART, which cannot see the host
+  GBP_SPOOL_HOST_LINK_DOWN,
+  GBP_SPOOL_HOST_LINK_UP,
+} gbp_spool_host_link_t;
+
+typedef struct
+{
+  bool heard;
+  uint32_t heard_ms;        ///< Last byte from the host
+  int txRoom;               ///< Serial output room at the last sample
+  int txRoomMax;            ///< Largest room seen, i.e. nothing waiting to go out
+  uint32_t txProgress_ms;   ///< Last time serial output was empty or draining
+} gbp_spool_host_t;
+
+typedef void (*gbp_spool_replay_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+bool gbp_spool_mount(gbp_spool_t *spool, const gbp_spool_storage_t *storage);
+bool gbp_spool_append(gbp_spool_t *spool, const uint8_t *data, size_t len);
+uint32_t gbp_spool_replay(gbp_spool_t *spool, gbp_spool_replay_cb_t cb, void *ctx);
+bool gbp_spool_clear(gbp_spool_t *spool);
+uint32_t gbp_spool_eraseCount(gbp_spool_t *spool, uint16_t segment);
+
+void gbp_spool_host_init(gbp_spool_host_t *host, uint32_t now_ms);
+void gbp_spool_host_heard(gbp_spool_host_t *host, uint32_t now_ms);
+void gbp_spool_host_txRoom(gbp_spool_host_t *host, int room, uint32_t now_ms);
+bool gbp_spool_host_ready(const gbp_spool_host_t *host, gbp_spool_host_link_t link, size_t backlog, size_t backlogMax, uint32_t now_ms);
+
+#endif
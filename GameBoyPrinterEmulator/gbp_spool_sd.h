@@ -0,0 +1,200 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Capture Spool (SD Card Storage)
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: gbp_spool storage backend with one file per segment on an SD card
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: The spool only ever appends to a segment after erasing it, so each
+//           segment maps onto a file that is deleted on erase and appended to on write.
+//           Missing bytes past the end of a file read back as erased (0xFF).
+//           The spool writes a record payload ahead of its length (for flash), so
+//           the payload is held back here and both are appended in one go.
+//           The segment being appended to stays open, and is flushed to the card
+//           every GBP_SPOOL_SD_FLUSH_BYTES or GBP_SPOOL_SD_FLUSH_MS (from
+//           gbp_spool_sd_poll()), so a power loss costs at most that much.
+//           It is closed before it is read (mount, replay) or erased.
+#ifndef GBP_SPOOL_SD_H
+#define GBP_SPOOL_SD_H
+#include <SD.h>
+
+#include "gbp_spool.h"
+
+#ifndef GBP_SPOOL_SD_CS_PIN
+#define GBP_SPOOL_SD_CS_PIN SS  // Default chip select of the board's SPI bus
+#endif
+#define GBP_SPOOL_SD_SEGMENT_COUNT 16
+#define GBP_SPOOL_SD_SEGMENT_SIZE  (64UL * 1024UL)
+#define GBP_SPOOL_SD_FLUSH_BYTES   512   // One card sector
+#define GBP_SPOOL_SD_FLUSH_MS      1000
+
+#if GBP_SPOOL_SD_SEGMENT_COUNT > GBP_SPOOL_SEGMENT_MAX
+#error "GBP_SPOOL_SD_SEGMENT_COUNT is more than gbp_spool_t can cache"
+#endif
+
+#ifdef ESP32
+#define GBP_SPOOL_SD_FILE_APPEND FILE_APPEND
+#else
+#define GBP_SPOOL_SD_FILE_APPEND FILE_WRITE
+#endif
+
+static struct
+{
+  // Segment open for appending
+  File file;
+  uint16_t segment;  ///< GBP_SPOOL_SEGMENT_NONE if closed
+  uint16_t unflushed;
+  uint32_t flushed_ms;
+
+  // Record payload waiting for its length
+  uint16_t pendingSegment;
+  uint32_t pendingOffset;
+  size_t pendingLen;
+  uint8_t pendingData[GBP_SPOOL_RECORD_MAX_SIZE];
+} gbp_spool_sd = { File(), GBP_SPOOL_SEGMENT_NONE, 0, 0, GBP_SPOOL_SEGMENT_NONE, 0, 0, { 0 } };
+
+static void gbp_spool_sd_path(char *path, size_t pathSize, uint16_t segment)
+{
+  snprintf(path, pathSize, "/GBPSP%02u.BIN", (unsigned)segment);  // 8.3 filename
+}
+
+static void gbp_spool_sd_flush(void)
+{
+  if (gbp_spool_sd.segment == GBP_SPOOL_SEGMENT_NONE)
+    return;
+  if (gbp_spool_sd.unflushed > 0)
+    gbp_spool_sd.file.flush();
+  gbp_spool_sd.unflushed  = 0;
+  gbp_spool_sd.flushed_ms = millis();
+}
+
+static void gbp_spool_sd_close(void)
+{
+  if (gbp_spool_sd.segment == GBP_SPOOL_SEGMENT_NONE)
+    return;
+  gbp_spool_sd.file.close();
+  gbp_spool_sd.segment   = GBP_SPOOL_SEGMENT_NONE;
+  gbp_spool_sd.unflushed = 0;
+}
+
+// Call from loop(), so a quiet link still gets its last records onto the card
+static void gbp_spool_sd_poll(void)
+{
+  if ((gbp_spool_sd.unflushed > 0) && ((uint32_t)(millis() - gbp_spool_sd.flushed_ms) >= GBP_SPOOL_SD_FLUSH_MS))
+    gbp_spool_sd_flush();
+}
+
+static bool gbp_spool_sd_read(void *ctx, uint16_t segment, uint32_t offset, uint8_t *data, size_t len)
+{
+  (void)ctx;
+  char path[16];
+  if (segment == gbp_spool_sd.segment)
+    gbp_spool_sd_close();  // Appends reopen it
+  gbp_spool_sd_path(path, sizeof(path), segment);
+  memset(data, 0xFF, len);
+  File f = SD.open(path, FILE_READ);
+  if (!f)
+    return true;  // Never written. Reads as erased
+  if (f.seek(offset))
+    f.read(data, len);
+  f.close();
+  return true;
+}
+
+static bool gbp_spool_sd_append(uint16_t segment, uint32_t offset, const uint8_t *data, size_t len, const uint8_t *data2, size_t len2)
+{
+  if (segment != gbp_spool_sd.segment)
+  {
+    char path[16];
+    gbp_spool_sd_close();
+    gbp_spool_sd_path(path, sizeof(path), segment);
+    gbp_spool_sd.file = SD.open(path, GBP_SPOOL_SD_FILE_APPEND);
+    if (!gbp_spool_sd.file)
+      return false;
+    gbp_spool_sd.segment    = segment;
+    gbp_spool_sd.flushed_ms = millis();
+  }
+  File &f = gbp_spool_sd.file;
+  while (f.size() < offset)
+    f.write((uint8_t)0xFF);
+  bool ok = (f.size() == offset);
+  ok = ok && (f.write(data, len) == len);
+  ok = ok && ((len2 == 0) || (f.write(data2, len2) == len2));
+  gbp_spool_sd.unflushed += len + len2;
+  if (!ok)
+    gbp_spool_sd_close();
+  else if (gbp_spool_sd.unflushed >= GBP_SPOOL_SD_FLUSH_BYTES)
+    gbp_spool_sd_flush();
+  return ok;
+}
+
+static bool gbp_spool_sd_write(void *ctx, uint16_t segment, uint32_t offset, const uint8_t *data, size_t len)
+{
+  (void)ctx;
+  if (offset < GBP_SPOOL_HEADER_SIZE)
+  {
+    // Segment header. Flushed straight away, as mount relies on it
+    const bool ok = gbp_spool_sd_append(segment, offset, data, len, NULL, 0);
+    gbp_spool_sd_flush();
+    return ok;
+  }
+  if ((gbp_spool_sd.pendingLen > 0) && (len == GBP_SPOOL_RECORD_OVERHEAD)
+      && (gbp_spool_sd.pendingSegment == segment) && (gbp_spool_sd.pendingOffset == (offset + GBP_SPOOL_RECORD_OVERHEAD)))
+  {
+    // Record length. Commit length and payload together
+    const size_t pendingLen = gbp_spool_sd.pendingLen;
+    gbp_spool_sd.pendingLen = 0;
+    return gbp_spool_sd_append(segment, offset, data, len, gbp_spool_sd.pendingData, pendingLen);
+  }
+  if (len > sizeof(gbp_spool_sd.pendingData))
+    return false;
+  // Record payload. Hold until its length arrives
+  gbp_spool_sd.pendingSegment = segment;
+  gbp_spool_sd.pendingOffset  = offset;
+  gbp_spool_sd.pendingLen     = len;
+  memcpy(gbp_spool_sd.pendingData, data, len);
+  return true;
+}
+
+static bool gbp_spool_sd_erase(void *ctx, uint16_t segment)
+{
+  (void)ctx;
+  char path[16];
+  if (segment == gbp_spool_sd.segment)
+    gbp_spool_sd_close();
+  gbp_spool_sd_path(path, sizeof(path), segment);
+  if (SD.exists(path))
+    return SD.remove(path);
+  return true;
+}
+
+static bool gbp_spool_sd_begin(gbp_spool_storage_t *storage)
+{
+  if (!SD.begin(GBP_SPOOL_SD_CS_PIN))
+    return false;
+  storage->ctx          = NULL;
+  storage->segmentCount = GBP_SPOOL_SD_SEGMENT_COUNT;
+  storage->segmentSize  = GBP_SPOOL_SD_SEGMENT_SIZE;
+  storage->read         = gbp_spool_sd_read;
+  storage->write        = gbp_spool_sd_write;
+  storage->erase        = gbp_spool_sd_erase;
+  return true;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Single Producer Single Consumer Queue
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Lock free queue of fixed size items between two threads or cores
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Unlike gpb_cbuff, head is only written by the producer and tail only
+//           by the consumer, so no count is shared. Both are free running and
+//           the capacity must be a power of two so they can wrap.
+//           Uses gcc __atomic builtins (gcc and clang, including xtensa for ESP32).
+//           avr-libgcc has no __atomic_*_2 libcalls for the 16 bit size_t, so AVR
+//           uses volatile accesses instead. Those are enough on its single core as
+//           long as both sides run from loop() (gbp_pool), not from an interrupt.
+//           GameBoyPrinterDecoderC/gbp_spsc.h is an identical copy, keep the two identical.
+#ifndef GBP_SPSC_H
+#define GBP_SPSC_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include <string.h>   // memcpy
+
+typedef struct
+{
+  uint8_t *buffer;  ///< capacity * itemSize bytes
+  size_t itemSize;  ///< Size of each item in bytes
+  size_t capacity;  ///< Maximum number of items in the queue (power of two)
+  size_t head;      ///< Items pushed (Producer)
+  size_t tail;      ///< Items popped (Consumer)
+} gbp_spsc_t;
+
+#ifdef __AVR__
+static inline size_t gbp_spsc_load(const size_t *p)
+{
+  const size_t v = *(const volatile size_t *)p;
+  __asm__ __volatile__("" ::: "memory");  // Item is read after the index
+  return v;
+}
+static inline void gbp_spsc_store(size_t *p, size_t v)
+{
+  __asm__ __volatile__("" ::: "memory");  // Item is written before the index
+  *(volatile size_t *)p = v;
+}
+#else
+static inline size_t gbp_spsc_load(const size_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void gbp_spsc_store(size_t *p, size_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#endif
+
+static inline bool gbp_spsc_init(gbp_spsc_t *q, uint8_t *buffPtr, size_t itemSize, size_t capacity)
+{
+  if ((q == NULL) || (buffPtr == NULL) || (capacity == 0) || ((capacity & (capacity - 1)) != 0))
+    return false;  ///< Failed
+  q->buffer   = buffPtr;
+  q->itemSize = itemSize;
+  q->capacity = capacity;
+  q->head     = 0;
+  q->tail     = 0;
+  return true;  ///< Successful
+}
+
+// Producer only
+static inline bool gbp_spsc_push(gbp_spsc_t *q, const void *item)
+{
+  const size_t head = q->head;
+  const size_t tail = gbp_spsc_load(&q->tail);
+  // Full
+  if ((head - tail) >= q->capacity)
+    return false;  ///< Failed
+  memcpy(&q->buffer[(head & (q->capacity - 1)) * q->itemSize], item, q->itemSize);
+  // Publish item
+  gbp_spsc_store(&q->head, head + 1);
+  return true;  ///< Successful
+}
+
+// Consumer only
+static inline bool gbp_spsc_pop(gbp_spsc_t *q, void *item)
+{
+  const size_t tail = q->tail;
+  const size_t head = gbp_spsc_load(&q->head);
+  // Empty
+  if (head == tail)
+    return false;  ///< Failed
+  memcpy(item, &q->buffer[(tail & (q->capacity - 1)) * q->itemSize], q->itemSize);
+  // Release slot
+  gbp_spsc_store(&q->tail, tail + 1);
+  return true;  ///< Successful
+}
+
+// Producer only. Slot to fill in place, NULL if full. Not queued until gbp_spsc_commit()
+static inline void *gbp_spsc_acquire(gbp_spsc_t *q)
+{
+  const size_t head = q->head;
+  const size_t tail = gbp_spsc_load(&q->tail);
+  // Full
+  if ((head - tail) >= q->capacity)
+    return NULL;
+  return &q->buffer[(head & (q->capacity - 1)) * q->itemSize];
+}
+
+// Producer only. Hands the acquired slot to the consumer
+static inline void gbp_spsc_commit(gbp_spsc_t *q)
+{
+  gbp_spsc_store(&q->head, q->head + 1);
+}
+
+// Consumer only. Oldest item read in place, NULL if empty. Stays queued until gbp_spsc_release()
+static inline const void *gbp_spsc_peek(gbp_spsc_t *q)
+{
+  const size_t tail = q->tail;
+  const size_t head = gbp_spsc_load(&q->head);
+  // Empty
+  if (head == tail)
+    return NULL;
+  return &q->buffer[(tail & (q->capacity - 1)) * q->itemSize];
+}
+
+// Consumer only. Hands the peeked slot back to the producer
+static inline void gbp_spsc_release(gbp_spsc_t *q)
+{
+  gbp_spsc_store(&q->tail, q->tail + 1);
+}
+
+// Either side. Only a snapshot while the other side is running
+static inline size_t gbp_spsc_count(gbp_spsc_t *q)
+{
+  return gbp_spsc_load(&q->head) - gbp_spsc_load(&q->tail);
+}
+
+static inline bool gbp_spsc_isEmpty(gbp_spsc_t *q) { return gbp_spsc_count(q) == 0; }
+
+#endif  // GBP_SPSC_H
@@ -0,0 +1,85 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Tile Strip Decoder
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Converts a line of 20 tiles into packed 2bpp pixel rows on the device
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_tiles.h"
+
+void gbp_tiles_strip_init(gbp_tiles_strip_t *strip)
+{
+  gbp_tiles_strip_reset(strip);
+  gbp_tiles_strip_setPallet(strip, 0xE4);
+}
+
+void gbp_tiles_strip_reset(gbp_tiles_strip_t *strip)
+{
+  strip->tileLineOffset = 0;
+}
+
+void gbp_tiles_strip_setPallet(gbp_tiles_strip_t *strip, uint8_t pallet)
+{
+  /* Harmonise Pallete */
+  // Ref: https://github.com/Raphael-Boichot/The-Arduino-SD-Game-Boy-Printer#some-technical-facts
+  // Palette 0x00 has the same effect than palette 0xE4 (the mainly encountered palette in games)
+  pallet               = (pallet == 0x00) ? 0xE4 : pallet;
+  strip->tonePallet[0] = ((pallet >> 0) & 0b11);
+  strip->tonePallet[1] = ((pallet >> 2) & 0b11);
+  strip->tonePallet[2] = ((pallet >> 4) & 0b11);
+  strip->tonePallet[3] = ((pallet >> 6) & 0b11);
+}
+
+// Returns true once the strip holds 20 tiles. Rows are then valid until the next tile is added
+bool gbp_tiles_strip_addTile(gbp_tiles_strip_t *strip, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE])
+{
+  // Each tile fills two bytes in each of the 8 rows
+  const int offset = strip->tileLineOffset * GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH);
+  for (int j = 0; j < GBP_TILE_PIXEL_HEIGHT; j++)
+  {
+    const uint8_t loByte = tileBuff[j * 2];
+    const uint8_t hiByte = tileBuff[j * 2 + 1];
+    uint8_t packed[GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILE_PIXEL_WIDTH)] = { 0 };
+    for (int i = 0; i < GBP_TILE_PIXEL_WIDTH; i++)
+    {
+      const uint8_t hiBit = (uint8_t)((hiByte >> (7 - i)) & 1);
+      const uint8_t loBit = (uint8_t)((loByte >> (7 - i)) & 1);
+      const uint8_t value = strip->tonePallet[(hiBit << 1) | loBit];  // Harmonised 0-3
+      packed[GBP_TILE_2BIT_LINEPACK_INDEX(i)] |= value << GBP_TILE_2BIT_LINEPACK_BITOFFSET(i);
+    }
+    strip->rows[j][offset + 0] = packed[0];
+    strip->rows[j][offset + 1] = packed[1];
+  }
+
+  strip->tileLineOffset++;
+  if (strip->tileLineOffset >= GBP_TILES_PER_LINE)
+  {
+    // Enough tiles decoded to output a fully decoded line
+    strip->tileLineOffset = 0;
+    return true;
+  }
+
+  // Tile Decoded, but not enough to make a line
+  return false;
+}
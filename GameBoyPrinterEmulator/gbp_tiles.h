@@ -0,0 +1,68 @@
+/*************************************************************************
+ *
+ * Gameboy Printer Tile Strip Decoder
+ * Part of GAMEBOY PRINTER EMULATION PROJECT V3 (Arduino)
+ * Copyright (C) 2022 Brian Khuu
+ *
+ * PURPOSE: Converts a line of 20 tiles into packed 2bpp pixel rows on the device
+ * LICENCE:
+ *   This file is part of Arduino Gameboy Printer Emulator.
+ *
+ *   Arduino Gameboy Printer Emulator is free software:
+ *   you can redistribute it and/or modify it under the terms of the
+ *   GNU General Public License as published by the Free Software Foundation,
+ *   either version 3 of the License, or (at your option) any later version.
+ *
+ *   Arduino Gameboy Printer Emulator is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Arduino Gameboy Printer Emulator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Dev Note: Same tile to row conversion as gbp_tiles in GameBoyPrinterDecoderC, but only
+//           one line of tiles is held (320 bytes instead of ~8KB), so each strip must be
+//           sent out before the next tile arrives.
+//           The palette is only sent in the print instruction after the image data, and
+//           a strip is gone by then. So the device leaves the strip on 0xE4, which
+//           keeps the raw tones, and hosts apply the palette of the PRNT line that
+//           follows, as they do for tiles. gbp_tiles_strip_setPallet() is for callers
+//           that know the palette before the tiles (e.g. host tests).
+#ifndef GBP_TILES_H
+#define GBP_TILES_H
+#include <stdint.h>   // uint8_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include "gameboy_printer_protocol.h"
+
+// IMAGE DEFINITION
+#define GBP_TILE_PIXEL_WIDTH  8
+#define GBP_TILE_PIXEL_HEIGHT 8
+#define GBP_TILES_PER_LINE    20
+#define GBP_TILE_MAX_TONES    4  // 2bits per pixel
+
+// 2B per pixel packing (Pixel 0 in the lowest two bits)
+#define GBP_TILE_2BIT_LINEPACK_INDEX(x)               (x / 4)
+#define GBP_TILE_2BIT_LINEPACK_BITOFFSET(x)           (2 * (x % 4))
+#define GBP_TILE_2BIT_LINEPACK_IN_BYTE_COUNT          (4)                ///< 4 2bit pixel in 8bit byte
+#define GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(byteCount)   (byteCount / 4)    ///< Row sized when 2bit packed is reduced by factor of 4
+
+#define GBP_TILES_STRIP_PIXEL_WIDTH (GBP_TILE_PIXEL_WIDTH * GBP_TILES_PER_LINE)                ///< 160
+#define GBP_TILES_STRIP_ROW_SIZE    GBP_TILE_2BIT_LINEPACK_ROWSIZE_B(GBP_TILES_STRIP_PIXEL_WIDTH)  ///< 40 Bytes per pixel row
+
+typedef struct
+{
+  uint8_t tileLineOffset;
+  uint8_t tonePallet[GBP_TILE_MAX_TONES];  ///< Raw tone to harmonised tone
+
+  // Each row is 160 packed 2bit pixels
+  uint8_t rows[GBP_TILE_PIXEL_HEIGHT][GBP_TILES_STRIP_ROW_SIZE];
+} gbp_tiles_strip_t;
+
+void gbp_tiles_strip_init(gbp_tiles_strip_t *strip);
+void gbp_tiles_strip_reset(gbp_tiles_strip_t *strip);
+void gbp_tiles_strip_setPallet(gbp_tiles_strip_t *strip, uint8_t pallet);
+bool gbp_tiles_strip_addTile(gbp_tiles_strip_t *strip, const uint8_t tileBuff[GBP_TILE_SIZE_IN_BYTE]);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_config.h"
+#include "gbp_serial_io.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+#include "gbp_spool.h"
+#include "gbp_pipeline.h"
+#include "gbp_pool.h"
+#include "gbp_settings.h"
+#include "gbp_capture.h"
+
+#include "gbp_budget_rodata.h"  // Generated by the Makefile
+
+/*******************************************************************************
+ * RAM Budget Report
+ *
+ * Lists every static buffer, state struct and SRAM constant each sketch
+ * configuration pulls in, and fails if a configuration does not leave
+ * BUDGET_HEADROOM_PERCENT of a target it is meant to run on.
+ *
+ * Each configuration is a set of sketch options (GBP_OUTPUT_RAW_PACKETS,
+ * GBP_USE_* in GameBoyPrinterEmulator.ino) that goes through gbp_features.h,
+ * the same header the sketch uses, so the features here are the features the
+ * sketch builds. When adding a feature, add its buffers to budgetItems() and
+ * its option to configs[] below.
+ *
+ * Constants ("data") are measured: the Makefile builds each module again with
+ * __AVR__ defined and counts what is left in .rodata, which AVR copies into
+ * SRAM at boot. GBP_PROGMEM and GBP_PSTR() data stays in flash and is not
+ * counted (see gbp_pgmspace.h).
+ *
+ * Dev Note: Sizes are the host sizes. Pointers and size_t are 8 bytes here but
+ *           2 bytes on AVR, so structs holding them are overestimated there.
+ *           Flash usage depends on the target compiler and is not reported.
+*******************************************************************************/
+
+#define BUDGET_HEADROOM_PERCENT 10  // Left unused on every target, for what is not listed here
+
+// Sketch features (GBP_FEATURE_*)
+#define FEATURE_CAPTURE      (1 << 0)
+#define FEATURE_PARSE        (1 << 1)
+#define FEATURE_DECOMPRESS   (1 << 2)
+#define FEATURE_PIXEL_ROWS   (1 << 3)
+#define FEATURE_SPOOL        (1 << 4)
+#define FEATURE_PIPELINE     (1 << 5)
+#define FEATURE_POOL         (1 << 6)
+#define FEATURE_HW_SPI       (1 << 7)
+#define FEATURE_SETTINGS     (1 << 8)  // both capture and parse, picked at boot
+#define FEATURE_INQY_SUMMARY (1 << 9)  // capture mode inquiry summary lines
+#define FEATURE_RESYNC       (1 << 10)
+#define FEATURE_ANY_TARGET   (FEATURE_CAPTURE | FEATURE_PARSE | FEATURE_POOL | FEATURE_RESYNC)
+
+typedef struct
+{
+  const char *name;
+  size_t ramBudget;       ///< Left for this sketch after the Arduino core and a stack reserve
+  unsigned int features;  ///< Features the target can use, besides FEATURE_ANY_TARGET
+} target_t;
+
+// clang-format off
+static const target_t targets[] = {
+  // 2KB RAM, less ~170B for the core (HardwareSerial buffers, millis) and 512B stack
+  // Not settings (both mode buffers and the pool) or pixel rows (the strip), neither leaves the headroom
+  {"nano",    2048 - 170 - 512,  FEATURE_DECOMPRESS | FEATURE_HW_SPI | FEATURE_INQY_SUMMARY},
+  // 80KB DRAM, less ~32KB for the SDK and WiFi stack
+  {"esp8266", (80 - 32) * 1024,  FEATURE_DECOMPRESS | FEATURE_PIXEL_ROWS | FEATURE_SETTINGS | FEATURE_INQY_SUMMARY},
+  // 320KB DRAM, half kept for WiFi/BT and heap
+  {"esp32",   160 * 1024,        FEATURE_DECOMPRESS | FEATURE_PIXEL_ROWS | FEATURE_SPOOL | FEATURE_PIPELINE | FEATURE_SETTINGS | FEATURE_INQY_SUMMARY},
+};
+
+// Sketch options of each configuration. Options not defined are false
+static const unsigned int configs[] = {
+#define GBP_OUTPUT_RAW_PACKETS true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS true
+#define GBP_USE_HW_SPI_LINK    true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS  true
+#define GBP_USE_BYTE_GAP_RESYNC true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS true
+#define GBP_USE_SPOOL          true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS   true
+#define GBP_CAPTURE_INQY_SUMMARY true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS   true
+#define GBP_CAPTURE_INQY_SUMMARY true
+#define GBP_USE_SPOOL            true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS false
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS false
+#define GBP_USE_HW_SPI_LINK    true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS     false
+#define GBP_USE_PARSE_DECOMPRESSOR true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS     false
+#define GBP_USE_PARSE_DECOMPRESSOR true
+#define GBP_OUTPUT_PIXEL_ROWS      true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS false
+#define GBP_USE_PIPELINE       true
+#include "gbp_budget_config.h"
+
+#define GBP_OUTPUT_RAW_PACKETS     false
+#define GBP_USE_PARSE_DECOMPRESSOR true
+#define GBP_USE_PIPELINE           true
+#include "gbp_budget_config.h"
+
+#define GBP_USE_SETTINGS true
+#include "gbp_budget_config.h"
+
+#define GBP_USE_SETTINGS           true
+#define GBP_USE_PARSE_DECOMPRESSOR true
+#include "gbp_budget_config.h"
+
+#define GBP_USE_SETTINGS true
+#define GBP_USE_SPOOL    true
+#include "gbp_budget_config.h"
+
+#define GBP_USE_SETTINGS         true
+#define GBP_USE_SPOOL            true
+#define GBP_CAPTURE_INQY_SUMMARY true
+#include "gbp_budget_config.h"
+};
+// clang-format on
+
+typedef struct
+{
+  const char *name;
+  size_t bytes;
+  const char *kind;  ///< "static", "data" (SRAM constants), "stack" (deepest call) or "estimate"
+} budget_item_t;
+
+#define BUDGET_ITEMS_MAX 32
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static void configName(unsigned int features, char *name, size_t nameSize)
+{
+  snprintf(name, nameSize, "%s%s%s%s%s%s%s%s",
+           (features & FEATURE_SETTINGS) ? "settings" : (features & FEATURE_PARSE) ? "parse" : "capture",
+           (features & FEATURE_DECOMPRESS) ? "+decompress" : "",
+           (features & FEATURE_PIXEL_ROWS) ? "+pixelrows" : "",
+           (features & FEATURE_SPOOL) ? "+spool" : "",
+           (features & FEATURE_PIPELINE) ? "+pipeline" : "",
+           (features & FEATURE_HW_SPI) ? "+hwspi" : "",
+           (features & FEATURE_RESYNC) ? "+resync" : "",
+           (features & FEATURE_INQY_SUMMARY) ? "+inqysummary" : "");
+}
+
+static void addItem(budget_item_t items[BUDGET_ITEMS_MAX], int *n, const char *name, size_t bytes, const char *kind)
+{
+  if (*n >= BUDGET_ITEMS_MAX)
+    return;
+  items[*n].name  = name;
+  items[*n].bytes = bytes;
+  items[*n].kind  = kind;
+  (*n)++;
+}
+
+static int budgetItems(unsigned int features, budget_item_t items[BUDGET_ITEMS_MAX])
+{
+  int n = 0;
+  const bool capture = (features & FEATURE_CAPTURE) != 0;
+  const bool parse   = (features & FEATURE_PARSE) != 0;
+
+  /* Serial IO */
+  addItem(items, &n, "gbp_serialIO_raw_buffer", capture ? GBP_BUFFER_SIZE_CAPTURE_MODE : GBP_BUFFER_SIZE_PARSE_MODE, "static");
+  addItem(items, &n, "gbp_serial_io state", gbp_serial_io_stateSize(), "static");
+  addItem(items, &n, "gbp_serial_io.cpp constants", GBP_BUDGET_RODATA_GBP_SERIAL_IO, "data");
+  addItem(items, &n, "sketch constants (LUT, INIT packet)", 32, "estimate");
+
+  /* Packet Capture */
+  if (capture)
+  {
+    addItem(items, &n, "gbp_capture_fmt_t", sizeof(gbp_capture_fmt_t), "static");
+    if (features & FEATURE_INQY_SUMMARY)
+      addItem(items, &n, "gbp_capture_inqy_t", sizeof(gbp_capture_inqy_t), "static");
+    addItem(items, &n, "capture text", (features & FEATURE_INQY_SUMMARY) ? GBP_CAPTURE_TEXT_MAX : GBP_CAPTURE_TEXT_PLAIN_MAX, "stack");
+    addItem(items, &n, "gbp_capture.cpp constants", GBP_BUDGET_RODATA_GBP_CAPTURE, "data");
+  }
+
+  /* Packet Parser */
+  if (parse)
+    addItem(items, &n, "gbp_pkt.cpp constants", GBP_BUDGET_RODATA_GBP_PKT, "data");
+  if (features & FEATURE_POOL)
+  {
+    addItem(items, &n, "gbp_pkt_t", sizeof(gbp_pkt_t), "static");
+    addItem(items, &n, "gbp_pktbuff", GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE + 1, "static");
+    if (features & FEATURE_DECOMPRESS)
+      addItem(items, &n, "gbp_pkt_tileAcc_t", sizeof(gbp_pkt_tileAcc_t), "static");
+    addItem(items, &n, "gbp_pool_t (GBP_POOL_SLOTS)", sizeof(gbp_pool_t), "static");
+    addItem(items, &n, "gbp_pool.cpp constants", GBP_BUDGET_RODATA_GBP_POOL, "data");
+  }
+  if (features & (FEATURE_POOL | FEATURE_PIPELINE))
+    addItem(items, &n, "gbp_pipeline.cpp constants (JSON)", GBP_BUDGET_RODATA_GBP_PIPELINE, "data");
+
+  /* Pixel Rows */
+  if (features & FEATURE_PIXEL_ROWS)
+  {
+    addItem(items, &n, "gbp_tiles_strip_t", sizeof(gbp_tiles_strip_t), "static");
+    addItem(items, &n, "pixel row hex line", GBP_TILES_STRIP_ROW_SIZE * 3 + 1, "stack");
+    addItem(items, &n, "gbp_tiles.cpp constants", GBP_BUDGET_RODATA_GBP_TILES, "data");
+  }
+
+  /* Capture Spool */
+  if (features & FEATURE_SPOOL)
+  {
+    addItem(items, &n, "gbp_spool_storage_t", sizeof(gbp_spool_storage_t), "static");
+    addItem(items, &n, "gbp_spool_t", sizeof(gbp_spool_t), "static");
+    addItem(items, &n, "gbp_spool_host_t", sizeof(gbp_spool_host_t), "static");
+    addItem(items, &n, "gbp_spool_sd file and pending record", 32 + 2 * sizeof(uint16_t) + 2 * sizeof(uint32_t) + sizeof(uint16_t) + sizeof(size_t) + GBP_SPOOL_RECORD_MAX_SIZE, "estimate");
+    addItem(items, &n, "SD library (sector cache, volume)", 600, "estimate");
+    addItem(items, &n, "spool replay line", GBP_SPOOL_RECORD_MAX_SIZE * 4 + ((features & FEATURE_INQY_SUMMARY) ? GBP_CAPTURE_TEXT_MAX : GBP_CAPTURE_TEXT_PLAIN_MAX), "stack");
+    addItem(items, &n, "gbp_spool.cpp constants", GBP_BUDGET_RODATA_GBP_SPOOL, "data");
+  }
+
+  /* Parse Pipeline */
+  if (features & FEATURE_PIPELINE)
+  {
+    addItem(items, &n, "gbp_pipeline_t", sizeof(gbp_pipeline_t), "static");
+    addItem(items, &n, "pipeline task stacks", 3 * GBP_PIPELINE_TASK_STACK_SIZE, "static");
+  }
+
+  /* Runtime Settings */
+  if (features & FEATURE_SETTINGS)
+  {
+    addItem(items, &n, "gbp_settings_t", sizeof(gbp_settings_t), "static");
+    addItem(items, &n, "gbp_settings_console_t", sizeof(gbp_settings_console_t), "static");
+    addItem(items, &n, "settings reply line and block", 56 + GBP_SETTINGS_BLOCK_SIZE, "stack");
+    addItem(items, &n, "gbp_settings.cpp constants", GBP_BUDGET_RODATA_GBP_SETTINGS, "data");
+  }
+
+  return n;
+}
+
+/*******************************************************************************
+ * Main Report Routine
+*******************************************************************************/
+int main(void)
+{
+  int failures = 0;
+  printf("/* GBP RAM Budget (host sizes, %d%% headroom, see test/gbp_budget.cc) */\r\n", BUDGET_HEADROOM_PERCENT);
+
+  for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+  {
+    const unsigned int features = configs[c];
+    budget_item_t items[BUDGET_ITEMS_MAX];
+    const int itemCount = budgetItems(features, items);
+    size_t total        = 0;
+    char name[80];
+
+    configName(features, name, sizeof(name));
+    printf("// %s\r\n", name);
+    for (int i = 0; i < itemCount; i++)
+    {
+      printf("//   %-36s %6lu B (%s)\r\n", items[i].name, (unsigned long)items[i].bytes, items[i].kind);
+      total += items[i].bytes;
+    }
+
+    printf("//   %-36s %6lu B |", "TOTAL", (unsigned long)total);
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+    {
+      const unsigned int usable = features & ~FEATURE_ANY_TARGET;
+      if ((usable & targets[t].features) != usable)
+      {
+        printf(" %s: n/a |", targets[t].name);
+        continue;
+      }
+      const bool fits = (total * 100) <= (targets[t].ramBudget * (100 - BUDGET_HEADROOM_PERCENT));
+      printf(" %s: %lu%% %s |", targets[t].name, (unsigned long)((total * 100) / targets[t].ramBudget), fits ? "ok" : "OVER BUDGET");
+      failures += fits ? 0 : 1;
+    }
+    printf("\r\n");
+  }
+
+  printf(failures ? "/* FAILED (%d over budget) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
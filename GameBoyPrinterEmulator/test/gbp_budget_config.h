@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * One configs[] entry of test/gbp_budget.cc
+ *
+ * Define the sketch options (GBP_OUTPUT_RAW_PACKETS, GBP_USE_*) of the
+ * configuration, then include this inside configs[]. The features come from the
+ * sketch's own gbp_features.h, and the options are undefined again afterwards.
+*******************************************************************************/
+#include "gbp_features.h"
+
+#ifdef GBP_FEATURE_PACKET_CAPTURE_MODE
+#define BUDGET_CAPTURE FEATURE_CAPTURE
+#else
+#define BUDGET_CAPTURE 0
+#endif
+#ifdef GBP_FEATURE_PARSE_PACKET_MODE
+#define BUDGET_PARSE FEATURE_PARSE
+#else
+#define BUDGET_PARSE 0
+#endif
+#ifdef GBP_FEATURE_PARSE_PACKET_USE_DECOMPRESSOR
+#define BUDGET_DECOMPRESS FEATURE_DECOMPRESS
+#else
+#define BUDGET_DECOMPRESS 0
+#endif
+#ifdef GBP_FEATURE_PIXEL_ROWS
+#define BUDGET_PIXEL_ROWS FEATURE_PIXEL_ROWS
+#else
+#define BUDGET_PIXEL_ROWS 0
+#endif
+#ifdef GBP_FEATURE_SPOOL
+#define BUDGET_SPOOL FEATURE_SPOOL
+#else
+#define BUDGET_SPOOL 0
+#endif
+#ifdef GBP_FEATURE_PIPELINE
+#define BUDGET_PIPELINE FEATURE_PIPELINE
+#else
+#define BUDGET_PIPELINE 0
+#endif
+#ifdef GBP_FEATURE_POOL
+#define BUDGET_POOL FEATURE_POOL
+#else
+#define BUDGET_POOL 0
+#endif
+#ifdef GBP_FEATURE_LINK_HW_SPI
+#define BUDGET_HW_SPI FEATURE_HW_SPI
+#else
+#define BUDGET_HW_SPI 0
+#endif
+#ifdef GBP_FEATURE_SETTINGS
+#define BUDGET_SETTINGS FEATURE_SETTINGS
+#else
+#define BUDGET_SETTINGS 0
+#endif
+#ifdef GBP_FEATURE_INQY_SUMMARY
+#define BUDGET_INQY_SUMMARY FEATURE_INQY_SUMMARY
+#else
+#define BUDGET_INQY_SUMMARY 0
+#endif
+#ifdef GBP_FEATURE_BYTE_GAP_RESYNC
+#define BUDGET_RESYNC FEATURE_RESYNC
+#else
+#define BUDGET_RESYNC 0
+#endif
+
+  BUDGET_CAPTURE | BUDGET_PARSE | BUDGET_DECOMPRESS | BUDGET_PIXEL_ROWS | BUDGET_SPOOL | BUDGET_PIPELINE | BUDGET_POOL | BUDGET_HW_SPI | BUDGET_SETTINGS | BUDGET_INQY_SUMMARY | BUDGET_RESYNC,
+
+#undef BUDGET_CAPTURE
+#undef BUDGET_PARSE
+#undef BUDGET_DECOMPRESS
+#undef BUDGET_PIXEL_ROWS
+#undef BUDGET_SPOOL
+#undef BUDGET_PIPELINE
+#undef BUDGET_POOL
+#undef BUDGET_HW_SPI
+#undef BUDGET_SETTINGS
+#undef BUDGET_INQY_SUMMARY
+#undef BUDGET_RESYNC
+
+#undef GBP_OUTPUT_RAW_PACKETS
+#undef GBP_USE_PARSE_DECOMPRESSOR
+#undef GBP_USE_HW_SPI_LINK
+#undef GBP_USE_BYTE_GAP_RESYNC
+#undef GBP_USE_SPOOL
+#undef GBP_CAPTURE_INQY_SUMMARY
+#undef GBP_OUTPUT_PIXEL_ROWS
+#undef GBP_PIXEL_ROWS_BINARY
+#undef GBP_USE_PIPELINE
+#undef GBP_USE_SETTINGS
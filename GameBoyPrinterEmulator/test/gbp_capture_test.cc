@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gbp_capture.h"
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+static const uint8_t inquiry[] = {0x88, 0x33, 0x0F, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x81, 0x00};
+
+typedef struct
+{
+  uint8_t *data;
+  size_t size;
+  size_t max;
+} testBytes_t;
+
+typedef struct
+{
+  char *text;
+  size_t len;
+  size_t max;
+} testText_t;
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static void test_addBytes(testBytes_t *b, const uint8_t *data, size_t size)
+{
+  if ((b->size + size) > b->max)
+  {
+    b->max  = (b->max + size) * 2;
+    b->data = (uint8_t *)realloc(b->data, b->max);
+  }
+  memcpy(&b->data[b->size], data, size);
+  b->size += size;
+}
+
+static void test_addText(testText_t *t, const char *text, size_t len)
+{
+  if ((t->len + len + 1) > t->max)
+  {
+    t->max  = (t->max + len + 1) * 2;
+    t->text = (char *)realloc(t->text, t->max);
+  }
+  memcpy(&t->text[t->len], text, len);
+  t->len += len;
+  t->text[t->len] = '\0';
+}
+
+// A busy printer: count inquiries, the status changing part way
+static void test_addBusyRun(testBytes_t *b, unsigned count, uint8_t busyStatus)
+{
+  uint8_t pkt[sizeof(inquiry)];
+  memcpy(pkt, inquiry, sizeof(pkt));
+  for (unsigned i = 0; i < count; i++)
+  {
+    pkt[9] = (i + 1 < count) ? busyStatus : 0x00;
+    test_addBytes(b, pkt, sizeof(pkt));
+  }
+}
+
+static void test_format(const testBytes_t *in, bool summarise, testText_t *out)
+{
+  gbp_capture_fmt_t fmt;
+  gbp_capture_inqy_t inqy;
+  char text[GBP_CAPTURE_TEXT_MAX];
+  gbp_capture_fmt_init(&fmt, summarise ? &inqy : NULL);
+  for (size_t i = 0; i < in->size; i++)
+  {
+    const size_t len = gbp_capture_fmt_byte(&fmt, in->data[i], text);
+    CHECK(len <= (summarise ? GBP_CAPTURE_TEXT_MAX : GBP_CAPTURE_TEXT_PLAIN_MAX), "byte text fits");
+    test_addText(out, text, len);
+  }
+  test_addText(out, text, gbp_capture_fmt_flush(&fmt, text));
+}
+
+// What a decoder does: hex bytes, `// INQY` lines expanded, other comments skipped
+static void test_decode(const testText_t *in, testBytes_t *out)
+{
+  char *copy = strdup(in->text);
+  for (char *line = strtok(copy, "\r\n"); line != NULL; line = strtok(NULL, "\r\n"))
+  {
+    const bool summary = (strncmp(line, "// INQY", 7) == 0);
+    if (!summary && (line[0] == '/'))
+      continue;
+    const char *p = summary ? line + 7 : line;
+    unsigned id, status, count;
+    int used;
+    while (summary && (sscanf(p, " %x %x *%u%n", &id, &status, &count, &used) == 3))
+    {
+      uint8_t pkt[sizeof(inquiry)];
+      memcpy(pkt, inquiry, sizeof(pkt));
+      pkt[8] = (uint8_t)id;
+      pkt[9] = (uint8_t)status;
+      for (unsigned i = 0; i < count; i++)
+        test_addBytes(out, pkt, sizeof(pkt));
+      p += used;
+    }
+    while (!summary && (sscanf(p, " %2x%n", &id, &used) == 1))
+    {
+      const uint8_t b = (uint8_t)id;
+      test_addBytes(out, &b, 1);
+      p += used;
+    }
+  }
+  free(copy);
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Capture Testing (%lu B formatter, %lu B inquiry summary) */\r\n", (unsigned long)sizeof(gbp_capture_fmt_t), (unsigned long)sizeof(gbp_capture_inqy_t));
+
+  // Capture with busy runs after every packet
+  testBytes_t capture = {0};
+  {
+    size_t i     = 0;
+    unsigned run = 0;
+    while ((i + 10) <= sizeof(testVector))
+    {
+      const size_t pktSize = 10 + (testVector[i + 4] | (testVector[i + 5] << 8));
+      test_addBytes(&capture, &testVector[i], pktSize);
+      test_addBusyRun(&capture, 1 + (run * 7) % 23, (run & 1) ? 0x06 : 0x04);
+      i += pktSize;
+      run++;
+    }
+  }
+
+  // Summary off is one line per packet as before
+  {
+    testText_t text = {0};
+    test_format(&capture, false, &text);
+    CHECK(strstr(text.text, "88 33 0F 00 00 00 0F 00 81 00\r\n") != NULL, "inquiry output as is");
+    CHECK(strstr(text.text, "INQY") == NULL, "no summary");
+    testBytes_t decoded = {0};
+    test_decode(&text, &decoded);
+    CHECK((decoded.size == capture.size) && (memcmp(decoded.data, capture.data, capture.size) == 0), "summary off round trip");
+    free(text.text);
+    free(decoded.data);
+  }
+
+  // Summary on expands back to the exact capture, in less text
+  {
+    testText_t plain = {0};
+    testText_t text  = {0};
+    test_format(&capture, false, &plain);
+    test_format(&capture, true, &text);
+    CHECK(strstr(text.text, "88 33 0F") == NULL, "inquiries summarised");
+    CHECK(text.len < plain.len, "summary is shorter");
+    testBytes_t decoded = {0};
+    test_decode(&text, &decoded);
+    CHECK((decoded.size == capture.size) && (memcmp(decoded.data, capture.data, capture.size) == 0), "summary on round trip");
+    printf("/* Busy runs: %lu chars, %lu with inquiry summary */\r\n", (unsigned long)plain.len, (unsigned long)text.len);
+    free(plain.text);
+    free(text.text);
+    free(decoded.data);
+  }
+
+  // Summary line
+  {
+    testBytes_t in = {0};
+    testText_t text = {0};
+    test_addBusyRun(&in, 41, 0x06);
+    const uint8_t init[] = {0x88, 0x33, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x81, 0x00};
+    test_addBytes(&in, init, sizeof(init));
+    test_format(&in, true, &text);
+    CHECK(strcmp(text.text, "// INQY 81 06 *40 81 00 *1\r\n88 33 01 00 00 00 01 00 81 00\r\n") == 0, "summary then next packet");
+    free(in.data);
+    free(text.text);
+  }
+
+  // More replies than fit a line, and a session ending part way into an inquiry
+  {
+    testBytes_t in = {0};
+    testText_t text = {0};
+    uint8_t pkt[sizeof(inquiry)];
+    memcpy(pkt, inquiry, sizeof(pkt));
+    for (int i = 0; i <= GBP_CAPTURE_INQY_RUNS_MAX; i++)
+    {
+      pkt[9] = (uint8_t)i;
+      test_addBytes(&in, pkt, sizeof(pkt));
+    }
+    test_addBytes(&in, inquiry, 9);
+    test_format(&in, true, &text);
+    CHECK(strcmp(text.text, "// INQY 81 00 *1 81 01 *1 81 02 *1 81 03 *1\r\n// INQY 81 04 *1\r\n88 33 0F 00 00 00 0F 00 81 ") == 0, "full line and held bytes");
+    free(in.data);
+    free(text.text);
+  }
+
+  // Not quite an inquiry
+  {
+    testBytes_t in = {0};
+    testText_t text = {0};
+    test_addBusyRun(&in, 2, 0x06);
+    const uint8_t badChecksum[] = {0x88, 0x33, 0x0F, 0x00, 0x00, 0x00, 0x0E, 0x00, 0x81, 0x00};
+    test_addBytes(&in, badChecksum, sizeof(badChecksum));
+    test_format(&in, true, &text);
+    CHECK(strcmp(text.text, "// INQY 81 06 *1 81 00 *1\r\n88 33 0F 00 00 00 0E 00 81 00\r\n") == 0, "odd checksum output as is");
+    free(in.data);
+    free(text.text);
+  }
+
+  free(capture.data);
+
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Replay checkpoints for host testing
+ * A replay records link and parser state into a sidecar file every so many
+ * bytes. A later replay of the same capture, with the same build, restores the
+ * nearest checkpoint at or before where it wants to be and replays from there,
+ * rather than clocking every bit in from byte zero.
+ *
+ * Sidecar: [MAGIC "GBPC"][VERSION u8][RESERVED u8 x3] then records of
+ *          [OFFSET u32][LINK SIZE u32][LINK (gbp_serial_io_checkpointSave())][PARSER (gbp_checkpoint_parser_t)]
+ *          OFFSET is link bytes clocked in before the checkpoint. Values are little endian
+*******************************************************************************/
+#ifndef GBP_CHECKPOINT_H
+#define GBP_CHECKPOINT_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gbp_serial_io.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+
+#define GBP_CHECKPOINT_MAGIC       "GBPC"
+#define GBP_CHECKPOINT_VERSION     1
+#define GBP_CHECKPOINT_HEADER_SIZE 8
+
+// Parse mode state, as in gbp_parse_packet_loop()
+typedef struct
+{
+  gbp_pkt_t pkt;
+  uint8_t pktBuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktBuffSize;
+  gbp_pkt_tileAcc_t tileBuff;
+  gbp_tiles_strip_t strip;
+} gbp_checkpoint_parser_t;
+
+static void gbp_checkpoint_putU32(uint8_t out[4], uint32_t v)
+{
+  out[0] = (uint8_t)(v >> 0);
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t gbp_checkpoint_getU32(const uint8_t in[4])
+{
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static bool gbp_checkpoint_create(FILE *f)
+{
+  const uint8_t header[GBP_CHECKPOINT_HEADER_SIZE] = {'G', 'B', 'P', 'C', GBP_CHECKPOINT_VERSION, 0, 0, 0};
+  return (fseek(f, 0, SEEK_SET) == 0) && (fwrite(header, 1, sizeof(header), f) == sizeof(header));
+}
+
+// Appends a checkpoint of the current link state and the given parser state
+static bool gbp_checkpoint_write(FILE *f, uint32_t offset, const gbp_checkpoint_parser_t *parser)
+{
+  const size_t linkMax = gbp_serial_io_checkpointSize();
+  uint8_t *link        = (uint8_t *)malloc(linkMax);
+  const size_t linkSize = gbp_serial_io_checkpointSave(link, linkMax);
+  uint8_t head[8];
+  gbp_checkpoint_putU32(&head[0], offset);
+  gbp_checkpoint_putU32(&head[4], (uint32_t)linkSize);
+  const bool ok = (linkSize > 0) && (fseek(f, 0, SEEK_END) == 0) &&
+                  (fwrite(head, 1, sizeof(head), f) == sizeof(head)) &&
+                  (fwrite(link, 1, linkSize, f) == linkSize) &&
+                  (fwrite(parser, 1, sizeof(*parser), f) == sizeof(*parser));
+  free(link);
+  return ok;
+}
+
+// Restores the last checkpoint at or before target. Returns false if there is none,
+// otherwise *offset is where the replay carries on from
+static bool gbp_checkpoint_seek(FILE *f, uint32_t target, uint32_t *offset, gbp_checkpoint_parser_t *parser)
+{
+  uint8_t header[GBP_CHECKPOINT_HEADER_SIZE];
+  if ((fseek(f, 0, SEEK_SET) != 0) || (fread(header, 1, sizeof(header), f) != sizeof(header)) ||
+      (memcmp(header, GBP_CHECKPOINT_MAGIC, 4) != 0) || (header[4] != GBP_CHECKPOINT_VERSION))
+    return false;
+
+  // Only the record headers are read until the one to restore is known
+  long best = -1;
+  uint32_t bestOffset = 0;
+  uint32_t bestLinkSize = 0;
+  uint8_t head[8];
+  while (fread(head, 1, sizeof(head), f) == sizeof(head))
+  {
+    const uint32_t recOffset   = gbp_checkpoint_getU32(&head[0]);
+    const uint32_t recLinkSize = gbp_checkpoint_getU32(&head[4]);
+    if (recOffset > target)
+      break;  // Written in replay order
+    best         = ftell(f);
+    bestOffset   = recOffset;
+    bestLinkSize = recLinkSize;
+    if (fseek(f, (long)recLinkSize + (long)sizeof(*parser), SEEK_CUR) != 0)
+      break;
+  }
+  if (best < 0)
+    return false;
+
+  uint8_t *link = (uint8_t *)malloc(bestLinkSize ? bestLinkSize : 1);
+  const bool ok = (fseek(f, best, SEEK_SET) == 0) &&
+                  (fread(link, 1, bestLinkSize, f) == bestLinkSize) &&
+                  (fread(parser, 1, sizeof(*parser), f) == sizeof(*parser)) &&
+                  gbp_serial_io_checkpointRestore(link, bestLinkSize);
+  free(link);
+  if (ok)
+    *offset = bestOffset;
+  return ok;
+}
+
+#endif
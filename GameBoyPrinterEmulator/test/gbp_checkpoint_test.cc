@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_config.h"
+#include "gbp_serial_io.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+#include "gbp_checkpoint.h"
+
+#define TEST_REPEAT           64    // Times the test vector is replayed back to back, as one long session
+#define TEST_CHECKPOINT_EVERY 4096  // Link bytes between checkpoints
+#define TEST_PROBES           6
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+#define TEST_TOTAL ((uint32_t)sizeof(testVector) * TEST_REPEAT)
+
+uint8_t gbp_buffer[GBP_BUFFER_SIZE_PARSE_MODE] = {0};
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static double test_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void test_parserInit(gbp_checkpoint_parser_t *parser)
+{
+  memset(parser, 0, sizeof(*parser));
+  gbp_pkt_init(&parser->pkt);
+  gbp_tiles_strip_init(&parser->strip);
+}
+
+// Parse mode with the decompressor and pixel rows, as in gbp_parse_packet_loop()
+static void test_parse(gbp_checkpoint_parser_t *p)
+{
+  while (gbp_serial_io_dataBuff_getByteCount() > 0)
+  {
+    if (!gbp_pkt_processByte(&p->pkt, gbp_serial_io_dataBuff_getByte(), p->pktBuff, &p->pktBuffSize, sizeof(p->pktBuff)))
+      continue;
+    if (p->pkt.received == GBP_REC_GOT_PACKET)
+    {
+      if (p->pkt.command == GBP_COMMAND_PRINT)
+        gbp_tiles_strip_setPallet(&p->strip, gbp_pkt_printInstruction_palette_value(p->pktBuff));
+      continue;
+    }
+    while (gbp_pkt_decompressor(&p->pkt, p->pktBuff, p->pktBuffSize, &p->tileBuff))
+    {
+      if (gbp_pkt_tileAccu_tileReadyCheck(&p->tileBuff))
+        gbp_tiles_strip_addTile(&p->strip, p->tileBuff.tile);
+    }
+  }
+}
+
+// Link bytes [from, to) clocked in bit by bit. Checkpoints go to the sidecar if given
+static void test_replay(uint32_t from, uint32_t to, gbp_checkpoint_parser_t *parser, FILE *sidecar)
+{
+  for (uint32_t offset = from; offset < to; offset++)
+  {
+    if (sidecar && ((offset % TEST_CHECKPOINT_EVERY) == 0))
+      gbp_checkpoint_write(sidecar, offset, parser);
+    const uint8_t byte = testVector[offset % sizeof(testVector)];
+    for (int bi = 7; bi >= 0; bi--)
+      gpb_serial_io_OnRising_ISR((byte >> bi) & 0x01);
+    test_parse(parser);
+  }
+}
+
+// Everything a checkpoint holds, to compare two replays
+static size_t test_state(const gbp_checkpoint_parser_t *parser, uint8_t *out, size_t max)
+{
+  const size_t linkSize = gbp_serial_io_checkpointSave(out, max);
+  if ((linkSize == 0) || ((linkSize + sizeof(*parser)) > max))
+    return 0;
+  memcpy(&out[linkSize], parser, sizeof(*parser));
+  return linkSize + sizeof(*parser);
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Checkpoint Testing (%lu link bytes, checkpoint every %d) */\r\n", (unsigned long)TEST_TOTAL, TEST_CHECKPOINT_EVERY);
+  static gbp_checkpoint_parser_t parser;
+  const size_t stateMax = gbp_serial_io_checkpointSize() + sizeof(parser);
+  static uint8_t expected[TEST_PROBES][sizeof(gbp_buffer) + 1024];
+  static uint8_t got[sizeof(gbp_buffer) + 1024];
+  size_t expectedSize[TEST_PROBES];
+  uint32_t probes[TEST_PROBES];
+  FILE *sidecar = tmpfile();
+  CHECK(sidecar != NULL, "sidecar");
+  if (!sidecar)
+    return 1;
+  CHECK(stateMax <= sizeof(got), "state fits the test buffers");
+
+  // Probes land mid packet, at odd offsets and at a checkpoint
+  for (int i = 0; i < TEST_PROBES; i++)
+    probes[i] = (TEST_TOTAL / (TEST_PROBES + 1)) * (i + 1) + (uint32_t)(i * 37);
+  probes[0] = TEST_CHECKPOINT_EVERY * 3;
+
+  // Full replay from byte zero, recording the sidecar
+  gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+  test_parserInit(&parser);
+  CHECK(gbp_checkpoint_create(sidecar), "sidecar header");
+  const double fullStart = test_now();
+  uint32_t offset = 0;
+  for (int i = 0; i < TEST_PROBES; i++)
+  {
+    test_replay(offset, probes[i], &parser, sidecar);
+    offset = probes[i];
+    expectedSize[i] = test_state(&parser, expected[i], sizeof(expected[i]));
+    CHECK(expectedSize[i] > 0, "state saved");
+  }
+  test_replay(offset, TEST_TOTAL, &parser, sidecar);
+  const double fullSec = test_now() - fullStart;
+
+  // Seek to each probe from the nearest checkpoint
+  double seekSec = 0;
+  for (int i = 0; i < TEST_PROBES; i++)
+  {
+    gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);  // Scramble
+    test_parserInit(&parser);
+    const double start = test_now();
+    uint32_t from = 0;
+    const bool found = gbp_checkpoint_seek(sidecar, probes[i], &from, &parser);
+    CHECK(found, "checkpoint found");
+    CHECK(found && (from <= probes[i]) && ((probes[i] - from) < TEST_CHECKPOINT_EVERY), "nearest checkpoint");
+    test_replay(from, probes[i], &parser, NULL);
+    seekSec += test_now() - start;
+    const size_t gotSize = test_state(&parser, got, sizeof(got));
+    CHECK((gotSize == expectedSize[i]) && (memcmp(got, expected[i], gotSize) == 0), "state matches the full replay");
+  }
+
+  // Same state gives the same checkpoint after a round trip, unread bytes included
+  {
+    uint8_t again[sizeof(got)];
+    for (uint32_t i = 0; i < 40; i++)
+    {
+      const uint8_t byte = testVector[i];
+      for (int bi = 7; bi >= 0; bi--)
+        gpb_serial_io_OnRising_ISR((byte >> bi) & 0x01);
+    }
+    const size_t unread = gbp_serial_io_dataBuff_getByteCount();
+    CHECK(unread > 0, "bytes left in dataBuff");
+    const size_t size = gbp_serial_io_checkpointSave(got, sizeof(got));
+    gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+    CHECK(gbp_serial_io_checkpointRestore(got, size), "restore");
+    CHECK(gbp_serial_io_dataBuff_getByteCount() == unread, "unread bytes restored");
+    CHECK((gbp_serial_io_checkpointSave(again, sizeof(again)) == size) && (memcmp(got, again, size) == 0), "round trip");
+    got[0] ^= 0xFF;  // Struct size from another build
+    CHECK(!gbp_serial_io_checkpointRestore(got, size), "other build refused");
+    CHECK(gbp_serial_io_checkpointSave(got, 8) == 0, "short buffer refused");
+  }
+
+  fclose(sidecar);
+  printf("/* Full replay %.1f ms, seek %.2f ms per probe */\r\n", fullSec * 1000, (seekSec * 1000) / TEST_PROBES);
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define GBP_FEATURE_LINK_SIM
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_serial_io.h"
+#include "gbp_link.h"
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+uint8_t gbp_buffer[sizeof(testVector)+100] = {0};
+
+// Captured by the byte engine (hardware SPI link), the bit engine and the GPIO ISR on mock pins
+uint8_t byteEngineReply[sizeof(testVector)] = {0};
+uint8_t bitEngineReply[sizeof(testVector)] = {0};
+uint8_t pinEngineReply[sizeof(testVector)] = {0};
+uint8_t byteEngineCapture[sizeof(gbp_buffer)] = {0};
+uint8_t bitEngineCapture[sizeof(gbp_buffer)] = {0};
+uint8_t pinEngineCapture[sizeof(gbp_buffer)] = {0};
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static size_t drainCapture(uint8_t *capture, size_t captureSize)
+{
+  size_t count = 0;
+  while ((gbp_serial_io_dataBuff_getByteCount() > 0) && (count < captureSize))
+  {
+    capture[count++] = gbp_serial_io_dataBuff_getByte();
+  }
+  return count;
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Link Testing (Test Vector Size: %lu) */\r\n", (long unsigned) sizeof(testVector));
+
+  // Byte per interrupt
+  gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+  gbp_link_init();
+  for (size_t i = 0 ; i < sizeof(testVector) ; i++)
+  {
+    byteEngineReply[i] = gbp_link_sim_transferByte(testVector[i]);
+  }
+  const size_t byteEngineCount = drainCapture(byteEngineCapture, sizeof(byteEngineCapture));
+
+  // Bit per interrupt
+  gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+  for (size_t i = 0 ; i < sizeof(testVector) ; i++)
+  {
+    bitEngineReply[i] = gbp_link_sim_transferBits(testVector[i]);
+  }
+  const size_t bitEngineCount = drainCapture(bitEngineCapture, sizeof(bitEngineCapture));
+
+  // Pin levels per clock edge, through the same ISR code as the GPIO link (gbp_fastio mock)
+  gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+  gbp_link_init();
+  for (size_t i = 0 ; i < sizeof(testVector) ; i++)
+  {
+    pinEngineReply[i] = gbp_link_sim_transferPins(testVector[i]);
+  }
+  const size_t pinEngineCount = drainCapture(pinEngineCapture, sizeof(pinEngineCapture));
+
+  // Both engines must capture the same packet stream and reply with the same status bytes
+  int failures = 0;
+  if ((byteEngineCount == 0) || (byteEngineCount != bitEngineCount))
+  {
+    printf("FAIL: captured %lu bytes (byte engine) vs %lu bytes (bit engine)\r\n", (unsigned long) byteEngineCount, (unsigned long) bitEngineCount);
+    failures++;
+  }
+  else if (memcmp(byteEngineCapture, bitEngineCapture, byteEngineCount) != 0)
+  {
+    printf("FAIL: captured packet stream mismatch\r\n");
+    failures++;
+  }
+  for (size_t i = 0 ; i < sizeof(testVector) ; i++)
+  {
+    if (byteEngineReply[i] != bitEngineReply[i])
+    {
+      printf("FAIL: reply mismatch at byte %lu (byte engine: 0x%02X, bit engine: 0x%02X)\r\n", (unsigned long) i, byteEngineReply[i], bitEngineReply[i]);
+      failures++;
+      break;
+    }
+  }
+
+  // GPIO ISR on mock pins must match too, with one SO read and one SI write per rising edge
+  if ((pinEngineCount != byteEngineCount) || (memcmp(byteEngineCapture, pinEngineCapture, byteEngineCount) != 0))
+  {
+    printf("FAIL: captured %lu bytes (pin engine) differ from the byte engine\r\n", (unsigned long) pinEngineCount);
+    failures++;
+  }
+  if (memcmp(byteEngineReply, pinEngineReply, sizeof(byteEngineReply)) != 0)
+  {
+    printf("FAIL: reply mismatch (pin engine)\r\n");
+    failures++;
+  }
+  const uint32_t edges = sizeof(testVector) * 8;
+  if ((gbp_fastio_mock.reads != edges) || (gbp_fastio_mock.writes != edges))
+  {
+    printf("FAIL: %lu pin reads and %lu pin writes for %lu rising edges\r\n",
+        (unsigned long) gbp_fastio_mock.reads, (unsigned long) gbp_fastio_mock.writes, (unsigned long) edges);
+    failures++;
+  }
+
+  printf("/* Captured %lu bytes. %s */\r\n", (unsigned long) byteEngineCount, failures ? "FAILED" : "Done");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "gbp_pipeline.h"
+
+#define TEST_BENCH_REPEAT 200
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+typedef struct
+{
+  // Source
+  size_t repeat;
+  size_t pos;
+  size_t readCount;
+  bool sessionEnded;
+  // Sink
+  char *text;
+  size_t textLen;
+  size_t textMax;
+  size_t lines;
+  bool sessionEndSeen;
+} testIO_t;
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+// Like the link, bytes trickle in at odd sizes. Session ends after the last repeat
+static size_t test_read(void *ctx, uint8_t *data, size_t max, bool *sessionEnd)
+{
+  testIO_t *io     = (testIO_t *)ctx;
+  const size_t end = sizeof(testVector) * io->repeat;
+  if (io->pos >= end)
+  {
+    *sessionEnd      = !io->sessionEnded;
+    io->sessionEnded = true;
+    return 0;
+  }
+  size_t n = (io->readCount++ % max) + 1;
+  if (n > (end - io->pos))
+    n = end - io->pos;
+  for (size_t i = 0; i < n; i++)
+    data[i] = testVector[(io->pos + i) % sizeof(testVector)];
+  io->pos += n;
+  return n;
+}
+
+static void test_write(void *ctx, const char *text, size_t len)
+{
+  testIO_t *io = (testIO_t *)ctx;
+  if ((io->textLen + len) > io->textMax)
+  {
+    io->textMax = (io->textMax + len) * 2;
+    io->text    = (char *)realloc(io->text, io->textMax);
+  }
+  memcpy(&io->text[io->textLen], text, len);
+  io->textLen += len;
+  io->lines++;
+}
+
+static void test_sessionEnd(void *ctx)
+{
+  testIO_t *io = (testIO_t *)ctx;
+  __atomic_store_n(&io->sessionEndSeen, true, __ATOMIC_RELEASE);
+}
+
+static double test_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static double test_runPolled(testIO_t *io, bool decompress)
+{
+  static gbp_pipeline_t p;
+  const gbp_pipeline_io_t pio = { io, test_read, test_write, test_sessionEnd };
+  gbp_pipeline_init(&p, &pio, decompress);
+  const double start = test_now();
+  while (!io->sessionEndSeen)
+    gbp_pipeline_poll(&p);
+  return test_now() - start;
+}
+
+static double test_runThreaded(testIO_t *io, bool decompress)
+{
+  static gbp_pipeline_t p;
+  const gbp_pipeline_io_t pio     = { io, test_read, test_write, test_sessionEnd };
+  const gbp_pipeline_cores_t cores = { 1, 0, 0 };
+  gbp_pipeline_init(&p, &pio, decompress);
+  const double start = test_now();
+  if (!gbp_pipeline_start(&p, &cores))
+    return -1;
+  while (!__atomic_load_n(&io->sessionEndSeen, __ATOMIC_ACQUIRE))
+    sched_yield();
+  const double elapsed = test_now() - start;
+  gbp_pipeline_stop(&p);
+  return elapsed;
+}
+
+static void test_free(testIO_t *io)
+{
+  free(io->text);
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Pipeline Testing (Test Vector Size: %lu) */\r\n", (unsigned long)sizeof(testVector));
+
+  for (int decompress = 0; decompress <= 1; decompress++)
+  {
+    // Threaded output must match running the same stages one after another
+    testIO_t polled   = { 1 };
+    testIO_t threaded = { 1 };
+    test_runPolled(&polled, decompress);
+    CHECK(test_runThreaded(&threaded, decompress) >= 0, "threads started");
+    CHECK(polled.lines > 0, "produced output");
+    CHECK(polled.textLen == threaded.textLen, "threaded output length");
+    CHECK((polled.textLen == threaded.textLen) && (memcmp(polled.text, threaded.text, polled.textLen) == 0), "threaded output matches");
+    CHECK(strstr(polled.text, "{\"command\":\"PRNT\", \"sheets\":1") != NULL, "print instruction parsed");
+    if (decompress)
+      CHECK(strstr(polled.text, "\"compressed\":1") == NULL, "data reported as decompressed");
+    else
+      CHECK(strstr(polled.text, "\"compressed\":1") != NULL, "compressed data passed through");
+    printf("/* %s: %lu lines, %lu chars */\r\n", decompress ? "Decompressed" : "Raw payload", (unsigned long)polled.lines, (unsigned long)polled.textLen);
+    test_free(&polled);
+    test_free(&threaded);
+  }
+
+  // Throughput
+  {
+    testIO_t polled   = { TEST_BENCH_REPEAT };
+    testIO_t threaded = { TEST_BENCH_REPEAT };
+    const double polledSec   = test_runPolled(&polled, true);
+    const double threadedSec = test_runThreaded(&threaded, true);
+    const double mb          = (sizeof(testVector) * TEST_BENCH_REPEAT) / 1e6;
+    CHECK((polled.textLen == threaded.textLen) && (memcmp(polled.text, threaded.text, polled.textLen) == 0), "benchmark output matches");
+    printf("/* Throughput: polled %.1f MB/s, threaded %.1f MB/s (%.1f MB of packets) */\r\n", mb / polledSec, mb / threadedSec, mb);
+    test_free(&polled);
+    test_free(&threaded);
+  }
+
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
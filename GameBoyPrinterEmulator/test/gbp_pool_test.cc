@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gbp_pkt.h"
+#include "gbp_pipeline.h"
+#include "gbp_pool.h"
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+typedef struct
+{
+  char *text;
+  size_t textLen;
+  size_t textMax;
+  size_t writes;
+  size_t room;  ///< Serial TX room left until the next test_drain()
+  size_t pos;   ///< Test vector read by the pipeline reference
+} testSink_t;
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static void test_append(testSink_t *sink, const char *text, size_t len)
+{
+  if ((sink->textLen + len) > sink->textMax)
+  {
+    sink->textMax = (sink->textMax + len) * 2;
+    sink->text    = (char *)realloc(sink->text, sink->textMax);
+  }
+  memcpy(&sink->text[sink->textLen], text, len);
+  sink->textLen += len;
+}
+
+// Like Serial.write() limited to Serial.availableForWrite()
+static size_t test_serialWrite(void *ctx, const char *text, size_t len)
+{
+  testSink_t *sink = (testSink_t *)ctx;
+  if (len > sink->room)
+    len = sink->room;
+  test_append(sink, text, len);
+  sink->room -= len;
+  sink->writes++;
+  return len;
+}
+
+// UART sends some bytes between loop() calls
+static void test_drain(testSink_t *sink, unsigned int *seed)
+{
+  sink->room += rand_r(seed) % 24;
+  if (sink->room > 64)
+    sink->room = 64;
+}
+
+static void test_pipelineWrite(void *ctx, const char *text, size_t len)
+{
+  test_append((testSink_t *)ctx, text, len);
+}
+
+static size_t test_pipelineRead(void *ctx, uint8_t *data, size_t max, bool *sessionEnd)
+{
+  testSink_t *sink = (testSink_t *)ctx;
+  size_t n         = sizeof(testVector) - sink->pos;
+  if (n > max)
+    n = max;
+  memcpy(data, &testVector[sink->pos], n);
+  sink->pos += n;
+  *sessionEnd = false;  // Poll until there is no work left instead
+  return n;
+}
+
+static void test_event(gbp_pipeline_event_t *evt, const gbp_pkt_t *pkt, gbp_pipeline_event_type_t type, const uint8_t *data, uint8_t size)
+{
+  evt->type        = type;
+  evt->command     = pkt->command;
+  evt->compression = pkt->compression;
+  evt->status      = pkt->status;
+  evt->dataLength  = pkt->dataLength;
+  evt->size        = size;
+  if (size > 0)
+    memcpy(evt->data, data, size);
+}
+
+// Same steps as gbp_parse_packet_loop() and loop() in GameBoyPrinterEmulator.ino
+static void test_runPool(gbp_pool_t *pool, testSink_t *sink, bool decompress, unsigned int seed)
+{
+  static gbp_pkt_t pkt;
+  static gbp_pkt_tileAcc_t tileBuff;
+  uint8_t pktBuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktBuffSize = 0;
+  size_t pos          = 0;
+  gbp_pkt_init(&pkt);
+  memset(&tileBuff, 0, sizeof(tileBuff));
+  gbp_pool_init(pool);
+
+  while ((pos < sizeof(testVector)) || !gbp_pool_isIdle(pool))
+  {
+    // Link delivered a few bytes since the last loop()
+    size_t avail = (rand_r(&seed) % 8) + 1;
+    for (; (avail > 0) && (pos < sizeof(testVector)); avail--)
+    {
+      gbp_pipeline_event_t *evt = gbp_pool_acquire(pool);
+      if (evt == NULL)
+        break;
+      if (!gbp_pkt_processByte(&pkt, testVector[pos++], pktBuff, &pktBuffSize, sizeof(pktBuff)))
+        continue;
+      if (pkt.received == GBP_REC_GOT_PACKET)
+      {
+        test_event(evt, &pkt, GBP_PIPELINE_EVENT_PACKET, pktBuff, pktBuffSize);
+        if (decompress)
+          evt->compression = 0;
+        gbp_pool_commit(pool);
+      }
+      else if (decompress)
+      {
+        while (gbp_pkt_decompressor(&pkt, pktBuff, pktBuffSize, &tileBuff))
+        {
+          if (!gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
+            continue;
+          while ((evt = gbp_pool_acquire(pool)) == NULL)
+          {
+            test_drain(sink, &seed);
+            gbp_pool_outputStep(pool, test_serialWrite, sink);
+          }
+          test_event(evt, &pkt, GBP_PIPELINE_EVENT_DATA, tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+          gbp_pool_commit(pool);
+        }
+      }
+      else if (pktBuffSize > 0)
+      {
+        test_event(evt, &pkt, GBP_PIPELINE_EVENT_DATA, pktBuff, pktBuffSize);
+        gbp_pool_commit(pool);
+      }
+    }
+    test_drain(sink, &seed);
+    gbp_pool_outputStep(pool, test_serialWrite, sink);
+  }
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  static gbp_pool_t pool;
+  static gbp_pipeline_t pipeline;
+  printf("/* GBP Payload Pool Testing (%d slots, %lu B) */\r\n", GBP_POOL_SLOTS, (unsigned long)sizeof(gbp_pool_t));
+
+  for (int decompress = 0; decompress <= 1; decompress++)
+  {
+    // Reference: the pipeline run one stage after another, output never held up
+    testSink_t expected         = { 0 };
+    const gbp_pipeline_io_t pio = { &expected, test_pipelineRead, test_pipelineWrite, NULL };
+    gbp_pipeline_init(&pipeline, &pio, decompress);
+    while (gbp_pipeline_poll(&pipeline))
+      ;
+
+    for (unsigned int seed = 1; seed <= 4; seed++)
+    {
+      testSink_t sink = { 0 };
+      test_runPool(&pool, &sink, decompress, seed);
+      CHECK(sink.textLen == expected.textLen, "output length");
+      CHECK((sink.textLen == expected.textLen) && (memcmp(sink.text, expected.text, sink.textLen) == 0), "output matches the pipeline");
+      CHECK(pool.linesOutput == pipeline.eventsOutput, "one line per slot");
+      CHECK((pool.highWater > 0) && (pool.highWater <= GBP_POOL_SLOTS), "high water within the pool");
+      CHECK(pool.parserStalls > 0, "slow serial stalls the parser");
+      CHECK(sink.writes > pool.linesOutput, "lines written in parts");
+      if (seed == 1)
+        printf("/* %s: %lu lines, high water %u, %u parser stalls */\r\n", decompress ? "Decompressed" : "Raw payload", (unsigned long)pool.linesOutput, pool.highWater, pool.parserStalls);
+      free(sink.text);
+    }
+    free(expected.text);
+  }
+
+  // Ownership: a slot is not handed back to the parser until its line is formatted
+  {
+    testSink_t sink = { 0 };
+    gbp_pool_init(&pool);
+    for (int i = 0; i < GBP_POOL_SLOTS; i++)
+    {
+      gbp_pipeline_event_t *evt = gbp_pool_acquire(&pool);
+      CHECK(evt != NULL, "free slot");
+      if (evt == NULL)
+        break;
+      memset(evt, 0, sizeof(*evt));
+      evt->type = GBP_PIPELINE_EVENT_DATA;
+      evt->size = 1;
+      evt->data[0] = (uint8_t)i;
+      gbp_pool_commit(&pool);
+    }
+    CHECK(gbp_pool_acquire(&pool) == NULL, "full pool");
+    CHECK(gbp_pool_acquire(&pool) == NULL, "still full");
+    CHECK(pool.parserStalls == 1, "stall counted once");
+    gbp_pool_outputStep(&pool, test_serialWrite, &sink);  // No serial room, line still formatted
+    CHECK(gbp_pool_acquire(&pool) != NULL, "slot freed once formatted");
+    CHECK(!gbp_pool_isIdle(&pool), "line still to send");
+    sink.room = 64;
+    while (gbp_pool_outputStep(&pool, test_serialWrite, &sink))
+      ;
+    CHECK(gbp_pool_isIdle(&pool), "idle once sent");
+    CHECK((sink.textLen == 4 * 4) && (memcmp(sink.text, "00\r\n01\r\n02\r\n03\r\n", sink.textLen) == 0), "slots sent in order");
+    free(sink.text);
+  }
+
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
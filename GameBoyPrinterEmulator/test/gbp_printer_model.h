@@ -0,0 +1,321 @@
+/*******************************************************************************
+ * Software model of a real Gameboy Printer for host testing
+ * Attaches to the simulated bridge (gbp_bridge.h) and answers on the link as a
+ * printer would: 8KiB image RAM, BUSY while printing for a time derived from
+ * the lines printed, the UNTRAN/FULL/SUM/ER0 status bits, and the printed paper.
+ *
+ * Timings are estimates (one dot line every GBP_PRINTER_MODEL_LINE_US, feeds
+ * included), not measurements of a specific printer.
+*******************************************************************************/
+#ifndef GBP_PRINTER_MODEL_H
+#define GBP_PRINTER_MODEL_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+
+#define GBP_PRINTER_MODEL_RAM_SIZE      (8 * 1024)  // 512 tiles
+#define GBP_PRINTER_MODEL_PAYLOAD_MAX   1024        // Longer payloads are packet errors
+#define GBP_PRINTER_MODEL_LINE_US       25000       // Per dot line (image or feed)
+#define GBP_PRINTER_MODEL_FEED_LINES    16          // 1 feed = 2.64mm
+#define GBP_PRINTER_MODEL_DOTS_PER_LINE 160
+#define GBP_PRINTER_MODEL_TILE_BYTES    16
+#define GBP_PRINTER_MODEL_TILES_PER_ROW 20
+
+typedef struct
+{
+  // Link
+  uint8_t shiftIn;
+  uint8_t shiftOut;
+  uint8_t bitCount;
+  bool outBit;
+  uint32_t now_us;
+
+  // Packet
+  uint16_t byteIndex;
+  uint8_t command;
+  uint8_t compression;
+  uint16_t length;
+  uint16_t checksum;
+  uint16_t checksumRx;
+  uint8_t payload[GBP_PRINTER_MODEL_PAYLOAD_MAX];
+  uint8_t status;
+
+  // Image RAM (tiles in the order received)
+  uint8_t ram[GBP_PRINTER_MODEL_RAM_SIZE];
+  uint16_t ramUsed;
+
+  // Print head
+  bool printing;
+  uint32_t printEnd_us;
+
+  // Paper, one tone per dot (0 white to 3 black)
+  uint8_t *paper;
+  size_t paperLines;
+
+  // Stats
+  uint32_t packets;
+  uint32_t checksumErrors;
+  uint32_t prints;
+} gbp_printer_model_t;
+
+static void gbp_printer_model_init(gbp_printer_model_t *m)
+{
+  memset(m, 0, sizeof(*m));
+}
+
+static void gbp_printer_model_free(gbp_printer_model_t *m)
+{
+  free(m->paper);
+  m->paper      = NULL;
+  m->paperLines = 0;
+}
+
+// Ends the print once its time is up
+static void gbp_printer_model_update(gbp_printer_model_t *m)
+{
+  if (m->printing && ((int32_t)(m->now_us - m->printEnd_us) >= 0))
+  {
+    m->printing = false;
+    m->ramUsed  = 0;
+    m->status &= ~(GBP_STATUS_MASK_BUSY | GBP_STATUS_MASK_FULL);
+  }
+}
+
+static bool gbp_printer_model_feedPaper(gbp_printer_model_t *m, size_t lines)
+{
+  uint8_t *paper = (uint8_t *)realloc(m->paper, (m->paperLines + lines) * GBP_PRINTER_MODEL_DOTS_PER_LINE);
+  if (!paper && lines)
+    return false;
+  m->paper = paper;
+  memset(&m->paper[m->paperLines * GBP_PRINTER_MODEL_DOTS_PER_LINE], 0, lines * GBP_PRINTER_MODEL_DOTS_PER_LINE);
+  m->paperLines += lines;
+  return true;
+}
+
+// Tiles in RAM to dots on paper, through the palette
+static void gbp_printer_model_printRam(gbp_printer_model_t *m, uint8_t palette)
+{
+  const size_t rowBytes = GBP_PRINTER_MODEL_TILES_PER_ROW * GBP_PRINTER_MODEL_TILE_BYTES;
+  const size_t rows     = m->ramUsed / rowBytes;
+  const size_t start    = m->paperLines;
+  palette               = (palette == 0x00) ? 0xE4 : palette;
+  if (!gbp_printer_model_feedPaper(m, rows * 8))
+    return;
+  for (size_t y = 0; y < rows * 8; y++)
+  {
+    uint8_t *dots = &m->paper[(start + y) * GBP_PRINTER_MODEL_DOTS_PER_LINE];
+    for (size_t x = 0; x < GBP_PRINTER_MODEL_DOTS_PER_LINE; x++)
+    {
+      const uint8_t *tile = &m->ram[(y / 8) * rowBytes + (x / 8) * GBP_PRINTER_MODEL_TILE_BYTES];
+      const int bit       = 7 - (x % 8);
+      const int raw       = (((tile[(y % 8) * 2 + 1] >> bit) & 1) << 1) | ((tile[(y % 8) * 2] >> bit) & 1);
+      dots[x]             = (palette >> (raw * 2)) & 0b11;
+    }
+  }
+}
+
+static void gbp_printer_model_ramWrite(gbp_printer_model_t *m, uint8_t b)
+{
+  if (m->ramUsed >= GBP_PRINTER_MODEL_RAM_SIZE)
+  {
+    m->status |= GBP_STATUS_MASK_ER0;
+    return;
+  }
+  m->ram[m->ramUsed++] = b;
+}
+
+static void gbp_printer_model_data(gbp_printer_model_t *m)
+{
+  if (m->length == 0)
+  {
+    m->status |= GBP_STATUS_MASK_FULL;  // End of data
+    return;
+  }
+  if (m->compression == GBP_COMPRESSION_DISABLED)
+  {
+    for (uint16_t i = 0; i < m->length; i++)
+      gbp_printer_model_ramWrite(m, m->payload[i]);
+  }
+  else
+  {
+    // Run length: 0x80 and up repeats the next byte (n - 128 + 2) times, below copies n + 1 bytes
+    uint16_t i = 0;
+    while (i < m->length)
+    {
+      const uint8_t c = m->payload[i++];
+      if (c & 0x80)
+      {
+        const uint8_t b = (i < m->length) ? m->payload[i++] : 0x00;
+        for (int n = 0; n < (c & 0x7F) + 2; n++)
+          gbp_printer_model_ramWrite(m, b);
+      }
+      else
+      {
+        for (int n = 0; (n < c + 1) && (i < m->length); n++)
+          gbp_printer_model_ramWrite(m, m->payload[i++]);
+      }
+    }
+  }
+  m->status |= GBP_STATUS_MASK_UNTRAN;
+  if (m->ramUsed >= GBP_PRINTER_MODEL_RAM_SIZE)
+    m->status |= GBP_STATUS_MASK_FULL;
+}
+
+static void gbp_printer_model_print(gbp_printer_model_t *m)
+{
+  if (m->length < GBP_PRINT_INSTRUCT_PAYLOAD_SIZE)
+  {
+    m->status |= GBP_STATUS_MASK_ER0;
+    return;
+  }
+  const uint8_t sheets      = m->payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_SHEETS];
+  const uint8_t feedsBefore = (m->payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED] >> 4) & 0x0F;
+  const uint8_t feedsAfter  = m->payload[GBP_PRINT_INSTRUCT_INDEX_NUM_OF_LINEFEED] & 0x0F;
+  const uint8_t palette     = m->payload[GBP_PRINT_INSTRUCT_INDEX_PALETTE_VALUE];
+  const size_t paperStart   = m->paperLines;
+
+  gbp_printer_model_feedPaper(m, feedsBefore * GBP_PRINTER_MODEL_FEED_LINES);
+  for (uint8_t s = 0; s < sheets; s++)
+    gbp_printer_model_printRam(m, palette);
+  gbp_printer_model_feedPaper(m, feedsAfter * GBP_PRINTER_MODEL_FEED_LINES);
+
+  m->prints++;
+  m->printing    = true;
+  m->printEnd_us = m->now_us + (uint32_t)(m->paperLines - paperStart) * GBP_PRINTER_MODEL_LINE_US;
+  m->status      = (m->status | GBP_STATUS_MASK_BUSY) & ~GBP_STATUS_MASK_UNTRAN;
+}
+
+// Whole packet received
+static void gbp_printer_model_execute(gbp_printer_model_t *m)
+{
+  m->packets++;
+  gbp_printer_model_update(m);
+  if (m->checksum != m->checksumRx)
+  {
+    m->checksumErrors++;
+    m->status |= GBP_STATUS_MASK_SUM;
+    return;
+  }
+  m->status &= ~GBP_STATUS_MASK_SUM;
+  if (m->length > GBP_PRINTER_MODEL_PAYLOAD_MAX)
+  {
+    m->status |= GBP_STATUS_MASK_ER0;
+    return;
+  }
+  switch (m->command)
+  {
+    case GBP_COMMAND_INIT:
+      if (!m->printing)
+      {
+        m->ramUsed = 0;
+        m->status  = 0x00;
+      }
+      break;
+    case GBP_COMMAND_DATA:
+      if (!m->printing)
+        gbp_printer_model_data(m);
+      break;
+    case GBP_COMMAND_PRINT:
+      if (!m->printing)
+        gbp_printer_model_print(m);
+      break;
+    case GBP_COMMAND_BREAK:
+      m->printing = false;
+      m->ramUsed  = 0;
+      m->status &= ~(GBP_STATUS_MASK_BUSY | GBP_STATUS_MASK_FULL | GBP_STATUS_MASK_UNTRAN);
+      break;
+    case GBP_COMMAND_INQUIRY:
+      break;
+    default:
+      m->status |= GBP_STATUS_MASK_ER0;
+      break;
+  }
+}
+
+// Byte received from the gameboy, returns the byte to send back with the next one
+static uint8_t gbp_printer_model_byte(gbp_printer_model_t *m, uint8_t b)
+{
+  const uint16_t i = m->byteIndex++;
+  if (i == 0)
+  {
+    m->byteIndex = (b == GBP_SYNC_WORD_0) ? 1 : 0;
+    return 0x00;
+  }
+  if (i == 1)
+  {
+    m->byteIndex = (b == GBP_SYNC_WORD_1) ? 2 : ((b == GBP_SYNC_WORD_0) ? 1 : 0);
+    return 0x00;
+  }
+  switch (i)
+  {
+    case 2: m->command = b; m->checksum = b; break;
+    case 3: m->compression = b; m->checksum += b; break;
+    case 4: m->length = b; m->checksum += b; break;
+    case 5: m->length |= (uint16_t)b << 8; m->checksum += b; break;
+    default:
+      if (i < (6 + m->length))
+      {
+        if ((i - 6) < GBP_PRINTER_MODEL_PAYLOAD_MAX)
+          m->payload[i - 6] = b;
+        m->checksum += b;
+      }
+      else if (i == (6 + m->length))
+      {
+        m->checksumRx = b;
+      }
+      else if (i == (7 + m->length))
+      {
+        m->checksumRx |= (uint16_t)b << 8;
+        gbp_printer_model_execute(m);
+        return GBP_DEVICE_ID;
+      }
+      else if (i == (8 + m->length))
+      {
+        gbp_printer_model_update(m);
+        return m->status;
+      }
+      else
+      {
+        m->byteIndex = 0;
+      }
+      break;
+  }
+  return 0x00;
+}
+
+// Clock edge from the bridge (gbp_bridge_sim_printer_t). Shifts out on falling, samples on rising
+static bool gbp_printer_model_edge(void *ctx, bool clock, bool in, uint32_t now_us)
+{
+  gbp_printer_model_t *m = (gbp_printer_model_t *)ctx;
+  m->now_us              = now_us;
+  if (!clock)
+  {
+    m->outBit = ((m->shiftOut >> (7 - m->bitCount)) & 0x01) != 0;
+    return m->outBit;
+  }
+  m->shiftIn = (uint8_t)((m->shiftIn << 1) | (in ? 1 : 0));
+  if (++m->bitCount == 8)
+  {
+    m->bitCount = 0;
+    m->shiftOut = gbp_printer_model_byte(m, m->shiftIn);
+  }
+  return m->outBit;
+}
+
+// Paper as a binary PGM (white is 255)
+static bool gbp_printer_model_writePgm(const gbp_printer_model_t *m, const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  fprintf(f, "P5\n%d %lu\n255\n", GBP_PRINTER_MODEL_DOTS_PER_LINE, (unsigned long)m->paperLines);
+  for (size_t i = 0; i < m->paperLines * GBP_PRINTER_MODEL_DOTS_PER_LINE; i++)
+    fputc(255 - m->paper[i] * 85, f);
+  return fclose(f) == 0;
+}
+
+#endif
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#define GBP_FEATURE_LINK_SIM
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+#include "gbp_bridge.h"
+#include "gbp_printer_model.h"
+
+#define TEST_POLL_US      100000  // Between inquiries while the printer is busy
+#define TEST_POLL_MAX     1000
+#define TEST_PACKET_MAX   (10 + 1024)
+#define TEST_TILES_MAX    (GBP_PRINTER_MODEL_RAM_SIZE / GBP_TILE_SIZE_IN_BYTE)
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+static gbp_printer_model_t printer;
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+// Host side, as a print tool on the serial console would: one packet through the bridge, returns the status reply
+static uint8_t sendPacket(const uint8_t *pkt, size_t size, uint8_t *deviceId)
+{
+  uint8_t reply[TEST_PACKET_MAX];
+  for (size_t i = 0; i < size; i++)
+    reply[i] = gbp_bridge_transferByte(pkt[i]);
+  *deviceId = reply[size - 2];
+  return reply[size - 1];
+}
+
+static size_t makePacket(uint8_t *pkt, uint8_t command, const uint8_t *payload, uint16_t length)
+{
+  uint16_t checksum = command + (length & 0xFF) + (length >> 8);
+  pkt[0] = GBP_SYNC_WORD_0;
+  pkt[1] = GBP_SYNC_WORD_1;
+  pkt[2] = command;
+  pkt[3] = GBP_COMPRESSION_DISABLED;
+  pkt[4] = length & 0xFF;
+  pkt[5] = length >> 8;
+  for (uint16_t i = 0; i < length; i++)
+  {
+    pkt[6 + i] = payload[i];
+    checksum += payload[i];
+  }
+  pkt[6 + length] = checksum & 0xFF;
+  pkt[7 + length] = checksum >> 8;
+  pkt[8 + length] = 0x00;
+  pkt[9 + length] = 0x00;
+  return 10 + length;
+}
+
+static uint8_t inquiry(uint8_t *deviceId)
+{
+  uint8_t pkt[10];
+  return sendPacket(pkt, makePacket(pkt, GBP_COMMAND_INQUIRY, NULL, 0), deviceId);
+}
+
+static uint8_t stripPixel(const gbp_tiles_strip_t *strip, int x, int y)
+{
+  return (strip->rows[y][x / 4] >> (2 * (x % 4))) & 0b11;
+}
+
+// Tiles decoded by the emulator's own parser, checked against the paper once printed
+typedef struct
+{
+  gbp_pkt_t pktState;
+  gbp_pkt_tileAcc_t tileBuff;
+  gbp_tiles_strip_t strip;
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE];
+  uint8_t pktbuffSize;
+  uint8_t tiles[TEST_TILES_MAX][GBP_TILE_SIZE_IN_BYTE];
+  size_t tileCount;
+  size_t paperLine;  ///< Where the next print starts
+  size_t dotMismatch;
+  size_t linesChecked;
+} reference_t;
+
+static reference_t ref;
+
+static void referenceCheckPrint(const uint8_t instruction[GBP_PRINT_INSTRUCT_PAYLOAD_SIZE])
+{
+  uint8_t payload[GBP_PRINT_INSTRUCT_PAYLOAD_SIZE];
+  memcpy(payload, instruction, sizeof(payload));
+  const int sheets      = gbp_pkt_printInstruction_num_of_sheets(payload);
+  const int feedsBefore = gbp_pkt_printInstruction_num_of_linefeed_before_print(payload);
+  const int feedsAfter  = gbp_pkt_printInstruction_num_of_linefeed_after_print(payload);
+  const size_t rows     = ref.tileCount / GBP_TILES_PER_LINE;
+
+  ref.paperLine += feedsBefore * GBP_PRINTER_MODEL_FEED_LINES;
+  for (int s = 0; s < sheets; s++)
+  {
+    for (size_t r = 0; r < rows; r++)
+    {
+      gbp_tiles_strip_reset(&ref.strip);
+      gbp_tiles_strip_setPallet(&ref.strip, gbp_pkt_printInstruction_palette_value(payload));
+      for (int t = 0; t < GBP_TILES_PER_LINE; t++)
+        gbp_tiles_strip_addTile(&ref.strip, ref.tiles[r * GBP_TILES_PER_LINE + t]);
+      for (int y = 0; y < GBP_TILE_PIXEL_HEIGHT; y++, ref.paperLine++)
+      {
+        if (ref.paperLine >= printer.paperLines)
+        {
+          ref.dotMismatch += GBP_TILES_STRIP_PIXEL_WIDTH;
+          continue;
+        }
+        const uint8_t *dots = &printer.paper[ref.paperLine * GBP_PRINTER_MODEL_DOTS_PER_LINE];
+        for (int x = 0; x < GBP_TILES_STRIP_PIXEL_WIDTH; x++)
+          ref.dotMismatch += (stripPixel(&ref.strip, x, y) != dots[x]) ? 1 : 0;
+        ref.linesChecked++;
+      }
+    }
+  }
+  ref.paperLine += feedsAfter * GBP_PRINTER_MODEL_FEED_LINES;
+  ref.tileCount = 0;
+}
+
+static void referenceByte(uint8_t b)
+{
+  if (!gbp_pkt_processByte(&ref.pktState, b, ref.pktbuff, &ref.pktbuffSize, sizeof(ref.pktbuff)))
+    return;
+  if (ref.pktState.received == GBP_REC_GOT_PACKET)
+  {
+    if (ref.pktState.command == GBP_COMMAND_PRINT)
+      referenceCheckPrint(ref.pktbuff);
+    else if (ref.pktState.command == GBP_COMMAND_INIT)
+      ref.tileCount = 0;
+    return;
+  }
+  while (gbp_pkt_decompressor(&ref.pktState, ref.pktbuff, ref.pktbuffSize, &ref.tileBuff))
+  {
+    if (gbp_pkt_tileAccu_tileReadyCheck(&ref.tileBuff) && (ref.tileCount < TEST_TILES_MAX))
+      memcpy(ref.tiles[ref.tileCount++], ref.tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+  }
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+  printf("/* GBP Printer Model Testing (Test Vector Size: %lu) */\r\n", (long unsigned) sizeof(testVector));
+  const clock_t wallStart = clock();
+  uint8_t deviceId        = 0;
+  uint8_t status          = 0;
+
+  // Nothing on the cable: the bridge stays in emulator mode
+  gbp_bridge_sim.printer = NULL;
+  gbp_bridge_init();
+  CHECK(!gbp_bridge_probe(), "no printer is not detected");
+
+  gbp_printer_model_init(&printer);
+  gbp_bridge_sim.printer = gbp_printer_model_edge;
+  gbp_bridge_sim.ctx     = &printer;
+  gbp_bridge_init();
+  CHECK(gbp_bridge_probe(), "printer model is detected");
+
+  // Corrupt checksum is reported, and cleared by the next good packet
+  {
+    uint8_t pkt[10];
+    makePacket(pkt, GBP_COMMAND_INQUIRY, NULL, 0);
+    pkt[6] ^= 0x01;
+    status = sendPacket(pkt, sizeof(pkt), &deviceId);
+    CHECK((deviceId == GBP_DEVICE_ID) && (status & GBP_STATUS_MASK_SUM), "checksum error reported");
+    status = inquiry(&deviceId);
+    CHECK(!(status & GBP_STATUS_MASK_SUM), "checksum error cleared");
+  }
+
+  // Replay the capture as a host tool, waiting out each print
+  memset(&ref, 0, sizeof(ref));
+  gbp_pkt_init(&ref.pktState);
+  gbp_tiles_strip_init(&ref.strip);
+  uint32_t packets    = 0;
+  uint32_t badId      = 0;
+  uint32_t busyPrints = 0;
+  uint32_t timedOut   = 0;
+  uint32_t untranSeen = 0;
+  uint32_t fullSeen   = 0;
+  uint32_t badTiming  = 0;
+  size_t linkBytes    = 0;
+  size_t i            = 0;
+  while ((i + 10) <= sizeof(testVector))
+  {
+    if ((testVector[i] != GBP_SYNC_WORD_0) || (testVector[i + 1] != GBP_SYNC_WORD_1))
+    {
+      i++;
+      continue;
+    }
+    const uint8_t command = testVector[i + 2];
+    const uint16_t length = (uint16_t)testVector[i + 4] | ((uint16_t)testVector[i + 5] << 8);
+    const size_t size     = 10 + length;
+    if ((command == GBP_COMMAND_INQUIRY) || ((i + size) > sizeof(testVector)) || (size > TEST_PACKET_MAX))
+    {
+      i += size;
+      continue;
+    }
+    uint8_t pkt[TEST_PACKET_MAX];
+    memcpy(pkt, &testVector[i], size);
+    pkt[size - 2] = 0x00;
+    pkt[size - 1] = 0x00;
+    i += size;
+
+    const uint32_t sent_us   = gbp_bridge_sim.now_us;
+    const size_t paperBefore = printer.paperLines;
+    status = sendPacket(pkt, size, &deviceId);
+    for (size_t n = 0; n < size; n++)
+      referenceByte(pkt[n]);
+    packets++;
+    linkBytes += size;
+    badId += (deviceId != GBP_DEVICE_ID) ? 1 : 0;
+    if (command == GBP_COMMAND_DATA)
+    {
+      untranSeen += ((length > 0) && (status & GBP_STATUS_MASK_UNTRAN)) ? 1 : 0;
+      fullSeen += ((length == 0) && (status & GBP_STATUS_MASK_FULL)) ? 1 : 0;
+    }
+    if (command != GBP_COMMAND_PRINT)
+      continue;
+
+    // BUSY until the paper is out, then idle
+    const bool busy = (status & GBP_STATUS_MASK_BUSY) != 0;
+    int polls       = 0;
+    while ((status & GBP_STATUS_MASK_BUSY) && (polls++ < TEST_POLL_MAX))
+    {
+      gbp_bridge_delayUs(TEST_POLL_US);
+      status = inquiry(&deviceId);
+      linkBytes += 10;
+    }
+    busyPrints += (busy && !(status & GBP_STATUS_MASK_UNTRAN)) ? 1 : 0;
+    timedOut += (status & GBP_STATUS_MASK_BUSY) ? 1 : 0;
+    CHECK(!(status & (GBP_STATUS_MASK_FULL | GBP_STATUS_MASK_UNTRAN)), "idle after print");
+    // Busy for the lines printed, seen within one poll
+    const uint32_t print_us = (uint32_t)(printer.paperLines - paperBefore) * GBP_PRINTER_MODEL_LINE_US;
+    const uint32_t busy_us  = gbp_bridge_sim.now_us - sent_us;
+    badTiming += ((busy_us < print_us) || (busy_us > (print_us + 2 * TEST_POLL_US))) ? 1 : 0;
+  }
+  const double wall_s = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+  const double sim_s  = gbp_bridge_sim.now_us / 1000000.0;
+
+  printf("/* %u packets, %u prints, %lu paper lines, %lu lines checked, %lu dot mismatch */\r\n",
+      packets, printer.prints, (unsigned long)printer.paperLines, (unsigned long)ref.linesChecked, (unsigned long)ref.dotMismatch);
+  printf("/* %.1f s printer time in %.3f s, bridge %.0f B/s */\r\n", sim_s, wall_s, linkBytes / sim_s);
+  CHECK(badId == 0, "device id in every reply");
+  CHECK(printer.checksumErrors == 1, "only the corrupted packet fails its checksum");
+  CHECK((printer.prints > 0) && (busyPrints == printer.prints), "BUSY while printing, UNTRAN cleared");
+  CHECK(timedOut == 0, "every print ends");
+  CHECK(badTiming == 0, "busy for as long as the lines printed take");
+  CHECK(untranSeen > 0, "UNTRAN after data");
+  CHECK(fullSeen > 0, "FULL after end of data");
+  CHECK(ref.linesChecked > 0, "paper checked");
+  CHECK(ref.dotMismatch == 0, "paper matches the decoded tiles");
+  CHECK(ref.paperLine == printer.paperLines, "paper feeds match the print instructions");
+
+  if (argc > 1)
+    CHECK(gbp_printer_model_writePgm(&printer, argv[1]), "paper written");
+  gbp_printer_model_free(&printer);
+
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define GBP_FEATURE_LINK_SIM
+#define GBP_FEATURE_BYTE_GAP_RESYNC
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_serial_io.h"
+#include "gbp_link.h"
+
+#define TEST_BIT_US      128  // 8kHz link clock
+#define TEST_BYTE_GAP_US 230  // Idle between bytes (See README.md Gameboy Printer Timing)
+#define TEST_GLITCH_US   2    // Extra edge this long after a real one
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+typedef enum
+{
+  TEST_FAULT_NONE,
+  TEST_FAULT_DROP,   ///< Edge missed by the ISR
+  TEST_FAULT_EXTRA,  ///< Edge seen twice (glitch)
+} test_fault_t;
+
+uint8_t gbp_buffer[sizeof(testVector)+100] = {0};
+uint8_t faults[sizeof(testVector)] = {0};  ///< test_fault_t per link byte, bit of the faulty edge in the upper nibble
+
+uint8_t cleanCapture[sizeof(gbp_buffer)] = {0};
+uint8_t resyncCapture[sizeof(gbp_buffer)] = {0};
+uint8_t noResyncCapture[sizeof(gbp_buffer)] = {0};
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+// Gameboy sends one byte on the mock pins, with link timing and an optional fault
+static void transferTimed(const uint8_t gbOut, const test_fault_t fault, const int faultBit)
+{
+  gbp_link_sim_us += TEST_BYTE_GAP_US;
+  for (int bi = 7; bi >= 0; bi--)
+  {
+    gbp_fastio_mock.sc = false;
+    gbp_fastio_mock.so = ((gbOut >> bi) & 0x01) != 0;
+    gbp_link_sim_us += TEST_BIT_US / 2;
+#ifndef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+    gbp_link_clockEdge();
+#endif
+    gbp_fastio_mock.sc = true;
+    gbp_link_sim_us += TEST_BIT_US / 2;
+    if ((bi == faultBit) && (fault == TEST_FAULT_DROP))
+      continue;
+    gbp_link_clockEdge();
+    if ((bi == faultBit) && (fault == TEST_FAULT_EXTRA))
+    {
+      gbp_link_sim_us += TEST_GLITCH_US;
+#ifndef GBP_FEATURE_USING_RISING_CLOCK_ONLY_ISR
+      gbp_link_clockEdge();
+#endif
+      gbp_link_clockEdge();
+      gbp_link_sim_us -= TEST_GLITCH_US;
+    }
+  }
+}
+
+static size_t runCapture(uint16_t gap_us, bool withFaults, uint8_t *capture, size_t captureSize)
+{
+  gpb_serial_io_init(sizeof(gbp_buffer), gbp_buffer);
+  gbp_serial_io_setResyncGap(gap_us);
+  gbp_link_init();
+  for (size_t i = 0 ; i < sizeof(testVector) ; i++)
+  {
+    transferTimed(testVector[i], withFaults ? (test_fault_t)(faults[i] & 0x0F) : TEST_FAULT_NONE, faults[i] >> 4);
+  }
+  size_t count = 0;
+  while ((gbp_serial_io_dataBuff_getByteCount() > 0) && (count < captureSize))
+  {
+    capture[count++] = gbp_serial_io_dataBuff_getByte();
+  }
+  return count;
+}
+
+static size_t countDifferences(const uint8_t *a, const uint8_t *b, size_t size)
+{
+  size_t diff = 0;
+  for (size_t i = 0 ; i < size ; i++)
+    diff += (a[i] != b[i]) ? 1 : 0;
+  return diff;
+}
+
+// One fault per packet, in turn in the payload, the checksum and the status reply, and on each bit in turn.
+// Never in the sync word or header, which no resync can recover
+static uint32_t placeFaults(void)
+{
+  uint32_t count = 0;
+  size_t i = 0;
+  while ((i + 10) <= sizeof(testVector))
+  {
+    if ((testVector[i] != GBP_SYNC_WORD_0) || (testVector[i + 1] != GBP_SYNC_WORD_1))
+    {
+      i++;
+      continue;
+    }
+    const size_t length = (size_t)testVector[i + 4] | ((size_t)testVector[i + 5] << 8);
+    size_t at = 0;
+    switch (count % 3)
+    {
+      case 0: at = (length > 0) ? (i + 6 + length / 2) : (i + 6 + length); break;  // Payload
+      case 1: at = i + 6 + length; break;                                            // Checksum
+      case 2: at = i + 8 + length; break;                                            // Status reply
+    }
+    if (at < sizeof(testVector))
+    {
+      faults[at] = (uint8_t)((((count / 2) % 8) << 4) | ((count & 1) ? TEST_FAULT_EXTRA : TEST_FAULT_DROP));
+      count++;
+    }
+    i += 10 + length;
+  }
+  return count;
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Byte Gap Resync Testing (Test Vector Size: %lu) */\r\n", (long unsigned) sizeof(testVector));
+  int failures = 0;
+
+  // Clean link, resync on: nothing to correct
+  const size_t cleanCount = runCapture(GBP_RESYNC_GAP_US, false, cleanCapture, sizeof(cleanCapture));
+  if ((cleanCount == 0) || (gbp_serial_io_resyncCount(false) != 0))
+  {
+    printf("FAIL: clean link captured %lu bytes with %u resyncs\r\n", (unsigned long) cleanCount, gbp_serial_io_resyncCount(false));
+    failures++;
+  }
+
+  // Faulty link, resync on: each fault costs that one byte
+  const uint32_t faultCount = placeFaults();
+  const size_t resyncCount  = runCapture(GBP_RESYNC_GAP_US, true, resyncCapture, sizeof(resyncCapture));
+  const uint16_t resyncs    = gbp_serial_io_resyncCount(true);
+  if (resyncCount != cleanCount)
+  {
+    printf("FAIL: captured %lu bytes with %lu faults, %lu on a clean link\r\n", (unsigned long) resyncCount, (unsigned long) faultCount, (unsigned long) cleanCount);
+    failures++;
+  }
+  else if (countDifferences(cleanCapture, resyncCapture, cleanCount) > faultCount)
+  {
+    printf("FAIL: %lu bytes differ for %lu faults\r\n", (unsigned long) countDifferences(cleanCapture, resyncCapture, cleanCount), (unsigned long) faultCount);
+    failures++;
+  }
+  // A dropped edge is a gap too, so it may be realigned twice (See gbp_serial_io.cpp)
+  if ((faultCount == 0) || (resyncs < faultCount) || (resyncs > (2 * faultCount)))
+  {
+    printf("FAIL: %u resyncs for %lu faults\r\n", resyncs, (unsigned long) faultCount);
+    failures++;
+  }
+  if (gbp_serial_io_resyncCount(false) != 0)
+  {
+    printf("FAIL: resync count was not reset\r\n");
+    failures++;
+  }
+
+  // Faulty link, resync off: the faults must actually break the capture
+  const size_t noResyncCount = runCapture(0, true, noResyncCapture, sizeof(noResyncCapture));
+  const size_t compared      = (noResyncCount < cleanCount) ? noResyncCount : cleanCount;
+  const size_t noResyncDiff  = countDifferences(cleanCapture, noResyncCapture, compared) + (cleanCount - compared);
+  if ((gbp_serial_io_resyncCount(false) != 0) || (noResyncDiff <= faultCount))
+  {
+    printf("FAIL: without resync %lu bytes differ for %lu faults\r\n", (unsigned long) noResyncDiff, (unsigned long) faultCount);
+    failures++;
+  }
+
+  printf("/* %lu faults, %u resyncs, %lu bytes lost without resync. %s */\r\n",
+      (unsigned long) faultCount, resyncs, (unsigned long) noResyncDiff, failures ? "FAILED" : "Done");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_serial_io.h"
+#include "gbp_settings.h"
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+typedef struct
+{
+  char text[512];
+  int lines;
+} replyBuff_t;
+
+static void reply_cb(void *ctx, const char *text)
+{
+  replyBuff_t *buff = (replyBuff_t *)ctx;
+  strncat(buff->text, text, sizeof(buff->text) - strlen(buff->text) - 2);
+  strcat(buff->text, "\n");
+  buff->lines++;
+}
+
+// Feeds a console line (as typed after `s`) and runs it
+static gbp_settings_cmd_t command(gbp_settings_t *s, replyBuff_t *reply, const char *line)
+{
+  gbp_settings_console_t console;
+  memset(reply, 0, sizeof(*reply));
+  gbp_settings_console_begin(&console);
+  for (const char *c = line; *c; c++)
+    if (gbp_settings_console_byte(&console, *c))
+      return GBP_SETTINGS_CMD_ERROR;  // Ended early
+  if (!gbp_settings_console_byte(&console, '\r') && gbp_settings_console_byte(&console, '\n'))
+    return gbp_settings_command(s, &console, reply_cb, reply);
+  return GBP_SETTINGS_CMD_ERROR;
+}
+
+static bool sameSettings(const gbp_settings_t *a, const gbp_settings_t *b)
+{
+  return (a->mode == b->mode) && (a->decompressor == b->decompressor) && (a->busyPacketCount == b->busyPacketCount) &&
+         (a->timeoutMs == b->timeoutMs) && (a->watermarkPercent == b->watermarkPercent);
+}
+
+static bool endsWith(const replyBuff_t *reply, const char *last)
+{
+  const size_t n = strlen(reply->text);
+  const size_t m = strlen(last);
+  return (n >= m) && (strcmp(&reply->text[n - m], last) == 0);
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Settings Testing (Block Size: %d) */\r\n", GBP_SETTINGS_BLOCK_SIZE);
+
+  gbp_settings_t s;
+  gbp_settings_t loaded;
+  replyBuff_t reply;
+  uint8_t block[GBP_SETTINGS_BLOCK_SIZE];
+
+  // Defaults follow the build, and match the link defaults
+  gbp_settings_setBuildDefaults(GBP_SETTINGS_MODE_PARSE, true);
+  gbp_settings_defaults(&s);
+  CHECK(gbp_settings_valid(&s), "defaults valid");
+  CHECK((s.mode == GBP_SETTINGS_MODE_PARSE) && (s.decompressor == 1), "build defaults");
+  CHECK((s.timeoutMs == GBP_PKT10_TIMEOUT_MS) && (s.busyPacketCount == GBP_BUSY_PACKET_COUNT), "link defaults");
+
+  // Query
+  CHECK(command(&s, &reply, "") == GBP_SETTINGS_CMD_OK, "list");
+  CHECK((reply.lines == 6) && endsWith(&reply, "// settings ok\n"), "list has every setting then ok");
+  CHECK(strstr(reply.text, "// setting mode=parse parse..raw\n") != NULL, "list names mode values");
+  CHECK(command(&s, &reply, "timeout") == GBP_SETTINGS_CMD_OK, "get");
+  CHECK(strcmp(reply.text, "// setting timeout=500 100..5000\n// settings ok\n") == 0, "get reply");
+
+  // Set, with validation
+  CHECK(command(&s, &reply, "  busy=68 ") == GBP_SETTINGS_CMD_CHANGED, "set busy");
+  CHECK(s.busyPacketCount == 68, "busy set");
+  CHECK(command(&s, &reply, "mode=raw") == GBP_SETTINGS_CMD_CHANGED, "set mode by name");
+  CHECK(s.mode == GBP_SETTINGS_MODE_RAW, "mode set");
+  CHECK(command(&s, &reply, "timeout=99") == GBP_SETTINGS_CMD_ERROR, "timeout below range");
+  CHECK(endsWith(&reply, "// settings error out of range\n"), "out of range reply");
+  CHECK(command(&s, &reply, "timeout=70000") == GBP_SETTINGS_CMD_ERROR, "timeout overflow");
+  CHECK(command(&s, &reply, "timeout=1x") == GBP_SETTINGS_CMD_ERROR, "timeout not a number");
+  CHECK(command(&s, &reply, "watermark=") == GBP_SETTINGS_CMD_ERROR, "empty value");
+  CHECK(command(&s, &reply, "mode=fast") == GBP_SETTINGS_CMD_ERROR, "unknown mode name");
+  CHECK(command(&s, &reply, "busyx=1") == GBP_SETTINGS_CMD_ERROR, "unknown key");
+  CHECK(command(&s, &reply, "bus=1") == GBP_SETTINGS_CMD_ERROR, "key prefix is not a key");
+  CHECK(command(&s, &reply, "timeout=1000000000000000000000000") == GBP_SETTINGS_CMD_ERROR, "line too long");
+  CHECK(endsWith(&reply, "// settings error line too long\n"), "line too long reply");
+  CHECK((s.timeoutMs == GBP_PKT10_TIMEOUT_MS) && gbp_settings_valid(&s), "errors change nothing");
+  CHECK(command(&s, &reply, "timeout=1500") == GBP_SETTINGS_CMD_CHANGED, "set timeout");
+  CHECK(command(&s, &reply, "save") == GBP_SETTINGS_CMD_SAVE, "save is left to the caller");
+  CHECK(command(&s, &reply, "load") == GBP_SETTINGS_CMD_LOAD, "load is left to the caller");
+
+  // Block round trip
+  gbp_settings_pack(&s, block);
+  CHECK(gbp_settings_unpack(&loaded, block, sizeof(block)), "unpack");
+  CHECK(sameSettings(&loaded, &s), "round trip");
+
+  // Corrupt blocks load the defaults
+  memset(block, 0xFF, sizeof(block));
+  CHECK(!gbp_settings_unpack(&loaded, block, sizeof(block)), "erased eeprom");
+  CHECK((loaded.timeoutMs == GBP_PKT10_TIMEOUT_MS) && (loaded.mode == GBP_SETTINGS_MODE_PARSE), "erased eeprom gives defaults");
+  gbp_settings_pack(&s, block);
+  block[7] ^= 0x01;
+  CHECK(!gbp_settings_unpack(&loaded, block, sizeof(block)), "checksum catches a flipped bit");
+
+  // Block with fewer fields (as an older version would write) keeps the missing field at its default
+  uint8_t oldBlock[4 + 5 + 1] = { GBP_SETTINGS_MAGIC & 0xFF, GBP_SETTINGS_MAGIC >> 8, 1, 5, 1, 0, 30, 0xE8, 0x03, 0 };
+  uint8_t sum = 0;
+  for (size_t i = 0; i < sizeof(oldBlock) - 1; i++)
+    sum += oldBlock[i];
+  oldBlock[sizeof(oldBlock) - 1] = (uint8_t)(0x100 - sum);
+  CHECK(gbp_settings_unpack(&loaded, oldBlock, sizeof(oldBlock)), "shorter block");
+  CHECK((loaded.busyPacketCount == 30) && (loaded.timeoutMs == 1000) && (loaded.watermarkPercent == 90), "shorter block fields");
+
+  // Out of range field in a valid block falls back to its default
+  s.timeoutMs = 50;
+  gbp_settings_pack(&s, block);
+  CHECK(gbp_settings_unpack(&loaded, block, sizeof(block)) && (loaded.timeoutMs == GBP_PKT10_TIMEOUT_MS), "out of range field");
+
+  CHECK(command(&s, &reply, "defaults") == GBP_SETTINGS_CMD_CHANGED, "defaults");
+  CHECK((s.busyPacketCount == GBP_BUSY_PACKET_COUNT) && (s.mode == GBP_SETTINGS_MODE_PARSE), "defaults restored");
+
+  // Decompressor that is not built in cannot be switched on, or loaded from a block
+  gbp_settings_pack(&s, block);
+  gbp_settings_setBuildDefaults(GBP_SETTINGS_MODE_PARSE, false);
+  CHECK(command(&s, &reply, "defaults") == GBP_SETTINGS_CMD_CHANGED, "defaults without decompressor");
+  CHECK(command(&s, &reply, "decomp") == GBP_SETTINGS_CMD_OK, "get decomp");
+  CHECK(strcmp(reply.text, "// setting decomp=0 0..0\n// settings ok\n") == 0, "decomp range without decompressor");
+  CHECK(command(&s, &reply, "decomp=1") == GBP_SETTINGS_CMD_ERROR, "decomp not built in");
+  CHECK(endsWith(&reply, "// settings error out of range\n") && (s.decompressor == 0), "decomp not built in reply");
+  CHECK(gbp_settings_unpack(&loaded, block, sizeof(block)) && (loaded.decompressor == 0), "saved decomp ignored");
+
+  printf("/* %s */\r\n", failures ? "FAILED" : "Done");
+  return failures ? 1 : 0;
+}
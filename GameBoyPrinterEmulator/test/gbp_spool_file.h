@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * File backed spool storage for host testing
+ * Behaves like NOR flash: erased bytes read as 0xFF and writes may only clear bits.
+*******************************************************************************/
+#ifndef GBP_SPOOL_FILE_H
+#define GBP_SPOOL_FILE_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_spool.h"
+
+typedef struct
+{
+  FILE *f;
+  uint32_t segmentSize;
+  uint32_t eraseOps;
+  uint32_t readOps;            ///< Reads by the spool
+  uint32_t programViolations;  ///< Writes that tried to set a bit back to 1 (invalid on flash)
+} gbp_spool_file_t;
+
+static bool gbp_spool_file_readRaw(void *ctx, uint16_t segment, uint32_t offset, uint8_t *data, size_t len)
+{
+  gbp_spool_file_t *file = (gbp_spool_file_t *)ctx;
+  memset(data, 0xFF, len);
+  if (fseek(file->f, (long)segment * file->segmentSize + offset, SEEK_SET) != 0)
+    return false;
+  const size_t got = fread(data, 1, len, file->f);
+  if (got < len)
+    memset(&data[got], 0xFF, len - got);
+  return true;
+}
+
+static bool gbp_spool_file_read(void *ctx, uint16_t segment, uint32_t offset, uint8_t *data, size_t len)
+{
+  ((gbp_spool_file_t *)ctx)->readOps++;
+  return gbp_spool_file_readRaw(ctx, segment, offset, data, len);
+}
+
+static bool gbp_spool_file_write(void *ctx, uint16_t segment, uint32_t offset, const uint8_t *data, size_t len)
+{
+  gbp_spool_file_t *file = (gbp_spool_file_t *)ctx;
+  uint8_t existing[64];
+  for (size_t done = 0; done < len;)
+  {
+    const size_t n = ((len - done) > sizeof(existing)) ? sizeof(existing) : (len - done);
+    gbp_spool_file_readRaw(ctx, segment, offset + done, existing, n);
+    for (size_t i = 0; i < n; i++)
+    {
+      if ((existing[i] & data[done + i]) != data[done + i])
+        file->programViolations++;
+    }
+    if (fseek(file->f, (long)segment * file->segmentSize + offset + done, SEEK_SET) != 0)
+      return false;
+    if (fwrite(&data[done], 1, n, file->f) != n)
+      return false;
+    done += n;
+  }
+  fflush(file->f);
+  return true;
+}
+
+static bool gbp_spool_file_erase(void *ctx, uint16_t segment)
+{
+  gbp_spool_file_t *file = (gbp_spool_file_t *)ctx;
+  uint8_t erased[256];
+  memset(erased, 0xFF, sizeof(erased));
+  if (fseek(file->f, (long)segment * file->segmentSize, SEEK_SET) != 0)
+    return false;
+  for (uint32_t done = 0; done < file->segmentSize; done += sizeof(erased))
+  {
+    const size_t n = ((file->segmentSize - done) > sizeof(erased)) ? sizeof(erased) : (file->segmentSize - done);
+    if (fwrite(erased, 1, n, file->f) != n)
+      return false;
+  }
+  fflush(file->f);
+  file->eraseOps++;
+  return true;
+}
+
+static inline bool gbp_spool_file_open(gbp_spool_file_t *file, gbp_spool_storage_t *storage, const char *path, uint16_t segmentCount, uint32_t segmentSize)
+{
+  file->f = fopen(path, "r+b");
+  if (file->f == NULL)
+    file->f = fopen(path, "w+b");
+  if (file->f == NULL)
+    return false;
+  file->segmentSize       = segmentSize;
+  file->eraseOps          = 0;
+  file->readOps           = 0;
+  file->programViolations = 0;
+  storage->ctx            = file;
+  storage->segmentCount   = segmentCount;
+  storage->segmentSize    = segmentSize;
+  storage->read           = gbp_spool_file_read;
+  storage->write          = gbp_spool_file_write;
+  storage->erase          = gbp_spool_file_erase;
+  return true;
+}
+
+static inline void gbp_spool_file_close(gbp_spool_file_t *file)
+{
+  if (file->f)
+    fclose(file->f);
+  file->f = NULL;
+}
+
+#endif
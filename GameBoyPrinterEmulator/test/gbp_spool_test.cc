@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gbp_spool.h"
+#include "gbp_spool_file.h"
+
+#define TEST_SPOOL_PATH          "gbp_spool_test.bin"
+#define TEST_SPOOL_SEGMENT_COUNT 8
+#define TEST_SPOOL_SEGMENT_SIZE  1024
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVector[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+typedef struct
+{
+  uint8_t data[sizeof(testVector) * 2];
+  size_t count;
+} replayBuff_t;
+
+replayBuff_t replayed = {{0}, 0};
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+static void replay_cb(void *ctx, const uint8_t *data, size_t len)
+{
+  replayBuff_t *buff = (replayBuff_t *)ctx;
+  for (size_t i = 0; (i < len) && (buff->count < sizeof(buff->data)); i++)
+    buff->data[buff->count++] = data[i];
+}
+
+// Append the capture in odd sized chunks, like the capture loop draining the ring buffer
+static bool appendChunked(gbp_spool_t *spool, const uint8_t *data, size_t len)
+{
+  size_t chunk = 1;
+  while (len > 0)
+  {
+    const size_t n = (chunk > len) ? len : chunk;
+    if (!gbp_spool_append(spool, data, n))
+      return false;
+    data += n;
+    len -= n;
+    chunk = (chunk % 45) + 7;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Spool Testing (Test Vector Size: %lu) */\r\n", (long unsigned) sizeof(testVector));
+  remove(TEST_SPOOL_PATH);
+
+  gbp_spool_file_t file = {0};
+  gbp_spool_storage_t storage = {0};
+  gbp_spool_t spool = {0};
+
+  // Spool a session, then "power cycle" by remounting before replaying
+  CHECK(gbp_spool_file_open(&file, &storage, TEST_SPOOL_PATH, TEST_SPOOL_SEGMENT_COUNT, TEST_SPOOL_SEGMENT_SIZE), "open");
+  CHECK(gbp_spool_mount(&spool, &storage), "mount blank");
+  const size_t half = sizeof(testVector) / 2;
+  CHECK(appendChunked(&spool, testVector, half), "append first half");
+  gbp_spool_file_close(&file);
+
+  CHECK(gbp_spool_file_open(&file, &storage, TEST_SPOOL_PATH, TEST_SPOOL_SEGMENT_COUNT, TEST_SPOOL_SEGMENT_SIZE), "reopen");
+  CHECK(gbp_spool_mount(&spool, &storage), "remount");
+  CHECK(appendChunked(&spool, &testVector[half], sizeof(testVector) - half), "append second half");
+  CHECK(spool.segmentsDropped == 0, "no segments dropped while spool has room");
+
+  replayed.count = 0;
+  const uint32_t replayCount = gbp_spool_replay(&spool, replay_cb, &replayed);
+  CHECK(replayCount == sizeof(testVector), "replay byte count");
+  CHECK((replayed.count == sizeof(testVector)) && (memcmp(replayed.data, testVector, sizeof(testVector)) == 0), "replay matches capture");
+
+  // Overfill. Oldest data is dropped and the newest capture is kept intact
+  CHECK(gbp_spool_clear(&spool), "clear");
+  replayed.count = 0;
+  CHECK(gbp_spool_replay(&spool, replay_cb, &replayed) == 0, "cleared spool is empty");
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append overfill 1");
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append overfill 2");
+  CHECK(spool.segmentsDropped > 0, "oldest segments dropped when full");
+  replayed.count = 0;
+  gbp_spool_replay(&spool, replay_cb, &replayed);
+  CHECK((replayed.count >= sizeof(testVector)) && (memcmp(&replayed.data[replayed.count - sizeof(testVector)], testVector, sizeof(testVector)) == 0), "newest capture survives overfill");
+
+  // Only segments holding data that was never replayed count as dropped when reclaimed
+  const uint16_t droppedBeforeReplayed = spool.segmentsDropped;
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append after replay");
+  CHECK(spool.segmentsDropped == droppedBeforeReplayed, "replayed segments are not dropped when reclaimed");
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append overfill 3");
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append overfill 4");
+  CHECK(spool.segmentsDropped > droppedBeforeReplayed, "unreplayed segments are dropped when reclaimed");
+
+  // Wear. Segment rotation keeps erase counts within one or two of each other
+  for (int i = 0; i < 20; i++)
+    appendChunked(&spool, testVector, sizeof(testVector));
+  uint32_t minErase = 0xFFFFFFFF;
+  uint32_t maxErase = 0;
+  for (uint16_t s = 0; s < TEST_SPOOL_SEGMENT_COUNT; s++)
+  {
+    const uint32_t e = gbp_spool_eraseCount(&spool, s);
+    minErase = (e < minErase) ? e : minErase;
+    maxErase = (e > maxErase) ? e : maxErase;
+  }
+  printf("/* Erase count spread: %lu..%lu (%lu erase ops) */\r\n", (unsigned long) minErase, (unsigned long) maxErase, (unsigned long) file.eraseOps);
+  CHECK((maxErase - minErase) <= 2, "erase counts evenly spread");
+
+  CHECK(file.programViolations == 0, "no flash bits programmed back to 1");
+
+  // Segment headers come from the mount, so appends (segment changes included) never read
+  file.readOps = 0;
+  CHECK(appendChunked(&spool, testVector, sizeof(testVector)), "append after wear");
+  CHECK(file.readOps == 0, "appends do not read segment headers");
+
+  gbp_spool_file_close(&file);
+  remove(TEST_SPOOL_PATH);
+
+  // Host presence. A UART cannot see the host, so only a recent keep-alive counts
+  {
+    gbp_spool_host_t host;
+    const size_t backlogMax = 650;
+    uint32_t now = 1000;
+    gbp_spool_host_init(&host, now);
+    gbp_spool_host_txRoom(&host, 64, now);
+    CHECK(!gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now), "absent host (never heard, empty output) is not ready");
+    gbp_spool_host_heard(&host, now);
+    CHECK(gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now), "host heard is ready");
+    CHECK(!gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_DOWN, 0, backlogMax, now), "host that closed the port is not ready");
+    now += GBP_SPOOL_HOST_KEEPALIVE_MS;
+    gbp_spool_host_txRoom(&host, 64, now);
+    CHECK(!gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now), "host gone quiet is not ready");
+    CHECK(gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UP, 0, backlogMax, now), "host with the port open needs no keep-alive");
+
+    // Slow host: output backlog that does not drain, or link bytes piling up
+    gbp_spool_host_heard(&host, now);
+    gbp_spool_host_txRoom(&host, 10, now);
+    gbp_spool_host_txRoom(&host, 0, now + 10);
+    CHECK(gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now + 10), "backlog within the stall time is ready");
+    gbp_spool_host_txRoom(&host, 0, now + GBP_SPOOL_HOST_STALL_MS);
+    CHECK(!gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now + GBP_SPOOL_HOST_STALL_MS), "stalled output is not ready");
+    gbp_spool_host_txRoom(&host, 5, now + GBP_SPOOL_HOST_STALL_MS + 1);
+    CHECK(gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UNKNOWN, 0, backlogMax, now + GBP_SPOOL_HOST_STALL_MS + 1), "draining output is ready");
+    CHECK(!gbp_spool_host_ready(&host, GBP_SPOOL_HOST_LINK_UP, backlogMax - 1, backlogMax, now + GBP_SPOOL_HOST_STALL_MS + 1), "link backlog past the threshold is not ready");
+  }
+
+  printf("/* %s */\r\n", failures ? "FAILED" : "Done");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gameboy_printer_protocol.h"
+#include "gbp_pkt.h"
+#include "gbp_tiles.h"
+
+/*******************************************************************************
+ * Test Vectors Variables
+*******************************************************************************/
+const uint8_t testVectorCompressed[] = {
+  #include "2020-08-10_Pokemon_trading_card_compressiontest.txt" // Compression
+};
+
+// Plain hex capture with palette changes, loaded at runtime
+#define TEST_PALLET_CAPTURE_PATH "test/2020-08-17_Alice_in_Wonderland_palletsupporttest.txt"
+static uint8_t testVectorPallet[32 * 1024];
+
+static int failures = 0;
+#define CHECK(COND, MSG) do { if (!(COND)) { printf("FAIL: %s\r\n", MSG); failures++; } } while (0)
+
+/*******************************************************************************
+ * Utilites
+*******************************************************************************/
+
+// Hex bytes, skipping `//` comment lines
+static size_t loadHexCapture(const char *path, uint8_t *data, size_t dataMax)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return 0;
+  char line[4096];
+  size_t count = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    if ((line[0] == '/') && (line[1] == '/'))
+      continue;
+    const char *c = line;
+    unsigned int byte;
+    int used;
+    while ((count < dataMax) && (sscanf(c, " %2x%n", &byte, &used) == 1))
+    {
+      data[count++] = (uint8_t)byte;
+      c += used;
+    }
+  }
+  fclose(f);
+  return count;
+}
+
+// Straight from the tile format, one pixel at a time
+static uint8_t referencePixel(const uint8_t tiles[GBP_TILES_PER_LINE][GBP_TILE_SIZE_IN_BYTE], uint8_t pallet, int x, int y)
+{
+  const uint8_t *tile = tiles[x / GBP_TILE_PIXEL_WIDTH];
+  const int bit       = 7 - (x % GBP_TILE_PIXEL_WIDTH);
+  const int raw       = (((tile[y * 2 + 1] >> bit) & 1) << 1) | ((tile[y * 2] >> bit) & 1);
+  pallet              = (pallet == 0x00) ? 0xE4 : pallet;
+  return (pallet >> (raw * 2)) & 0b11;
+}
+
+static uint8_t stripPixel(const gbp_tiles_strip_t *strip, int x, int y)
+{
+  return (strip->rows[y][x / 4] >> (2 * (x % 4))) & 0b11;
+}
+
+// Decodes a capture the same way as the parse loop, checking every completed strip
+static size_t checkCapture(const uint8_t *capture, size_t captureSize, size_t *pixelMismatch, int *palletChanges)
+{
+  static gbp_pkt_t pktState;
+  static gbp_pkt_tileAcc_t tileBuff;
+  static gbp_tiles_strip_t strip;
+  static uint8_t tiles[GBP_TILES_PER_LINE][GBP_TILE_SIZE_IN_BYTE];
+  uint8_t pktbuff[GBP_PKT_PAYLOAD_BUFF_SIZE_IN_BYTE] = { 0 };
+  uint8_t pktbuffSize                                = 0;
+  uint8_t pallet                                     = 0xE4;
+  size_t strips                                      = 0;
+  int tileCount                                      = 0;
+
+  memset(&pktState, 0, sizeof(pktState));
+  memset(&tileBuff, 0, sizeof(tileBuff));
+  gbp_pkt_init(&pktState);
+  gbp_tiles_strip_init(&strip);
+  *pixelMismatch = 0;
+  *palletChanges = 0;
+
+  for (size_t n = 0; n < captureSize; n++)
+  {
+    if (!gbp_pkt_processByte(&pktState, capture[n], pktbuff, &pktbuffSize, sizeof(pktbuff)))
+      continue;
+    if (pktState.received == GBP_REC_GOT_PACKET)
+    {
+      if (pktState.command == GBP_COMMAND_PRINT)
+      {
+        const uint8_t newPallet = gbp_pkt_printInstruction_palette_value(pktbuff);
+        *palletChanges += (newPallet != pallet) ? 1 : 0;
+        pallet = newPallet;
+        gbp_tiles_strip_setPallet(&strip, pallet);
+      }
+      continue;
+    }
+    while (gbp_pkt_decompressor(&pktState, pktbuff, pktbuffSize, &tileBuff))
+    {
+      if (!gbp_pkt_tileAccu_tileReadyCheck(&tileBuff))
+        continue;
+      memcpy(tiles[tileCount], tileBuff.tile, GBP_TILE_SIZE_IN_BYTE);
+      tileCount = (tileCount + 1) % GBP_TILES_PER_LINE;
+      if (!gbp_tiles_strip_addTile(&strip, tileBuff.tile))
+        continue;
+      // Full strip
+      strips++;
+      for (int y = 0; y < GBP_TILE_PIXEL_HEIGHT; y++)
+        for (int x = 0; x < GBP_TILES_STRIP_PIXEL_WIDTH; x++)
+          *pixelMismatch += (stripPixel(&strip, x, y) != referencePixel(tiles, pallet, x, y)) ? 1 : 0;
+    }
+  }
+  return strips;
+}
+
+/*******************************************************************************
+ * Main Test Routine
+*******************************************************************************/
+int main(void)
+{
+  printf("/* GBP Tile Strip Testing */\r\n");
+
+  size_t pixelMismatch = 0;
+  int palletChanges    = 0;
+  size_t strips        = checkCapture(testVectorCompressed, sizeof(testVectorCompressed), &pixelMismatch, &palletChanges);
+  printf("/* Compressed: %lu strips, %lu pixel mismatch */\r\n", (unsigned long)strips, (unsigned long)pixelMismatch);
+  CHECK(strips > 0, "compressed capture produced strips");
+  CHECK(pixelMismatch == 0, "compressed capture rows match tiles");
+
+  const size_t palletCaptureSize = loadHexCapture(TEST_PALLET_CAPTURE_PATH, testVectorPallet, sizeof(testVectorPallet));
+  CHECK(palletCaptureSize > 0, "palette capture loaded");
+  strips = checkCapture(testVectorPallet, palletCaptureSize, &pixelMismatch, &palletChanges);
+  printf("/* Palette: %lu strips, %lu pixel mismatch, %d palette changes */\r\n", (unsigned long)strips, (unsigned long)pixelMismatch, palletChanges);
+  CHECK(strips > 0, "palette capture produced strips");
+  CHECK(palletChanges > 0, "palette capture changes palette");
+  CHECK(pixelMismatch == 0, "palette capture rows match tiles");
+
+  // A new strip (as on the device) keeps the raw tones
+  {
+    gbp_tiles_strip_t strip;
+    uint8_t tile[GBP_TILE_SIZE_IN_BYTE];
+    memset(tile, 0, sizeof(tile));
+    tile[0] = 0xFF;                // Row 0 : tone 1
+    tile[3] = 0xFF;                // Row 1 : tone 2
+    tile[4] = 0xFF;                // Row 2 : tone 3
+    tile[5] = 0xFF;
+    gbp_tiles_strip_init(&strip);
+    gbp_tiles_strip_addTile(&strip, tile);
+    CHECK((strip.rows[0][0] == 0x55) && (strip.rows[1][0] == 0xAA) && (strip.rows[2][0] == 0xFF) && (strip.rows[3][0] == 0x00), "new strip outputs raw tones");
+  }
+
+  // Palette 0x00 behaves as 0xE4, 0x1B inverts
+  {
+    gbp_tiles_strip_t strip;
+    uint8_t tile[GBP_TILE_SIZE_IN_BYTE];
+    memset(tile, 0, sizeof(tile));
+    tile[0] = 0xFF;  // Row 0 : tone 1
+    tile[3] = 0xFF;  // Row 1 : tone 2
+    gbp_tiles_strip_init(&strip);
+    gbp_tiles_strip_setPallet(&strip, 0x00);
+    gbp_tiles_strip_addTile(&strip, tile);
+    CHECK((strip.rows[0][0] == 0x55) && (strip.rows[1][0] == 0xAA), "palette 0x00 is 0xE4");
+    gbp_tiles_strip_reset(&strip);
+    gbp_tiles_strip_setPallet(&strip, 0x1B);
+    gbp_tiles_strip_addTile(&strip, tile);
+    CHECK((strip.rows[0][0] == 0xAA) && (strip.rows[1][0] == 0x55) && (strip.rows[2][0] == 0xFF), "palette 0x1B inverts");
+  }
+
+  printf(failures ? "/* FAILED (%d) */\r\n" : "/* Done */\r\n", failures);
+  return failures ? 1 : 0;
+}
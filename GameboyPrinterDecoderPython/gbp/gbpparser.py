@@ -46,6 +46,17 @@ def command_to_str(t: int):
     return "COMMAND_UNKNOWN"
 
 
+# Expand inquiry summary lines of capture mode (`// INQY ID STATUS *COUNT ...`)
+# back to COUNT inquiry packets per reply, before comments are stripped.
+def expand_inquiry_summary(data: str):
+    header = '88 33 0F 00 00 00 0F 00'
+
+    def expand(m):
+        replies = re.findall(r'([0-9A-Fa-f]{2}) ([0-9A-Fa-f]{2}) \*(\d+)', m.group(1))
+        return '\n'.join(f'{header} {id} {status}' for (id, status, count) in replies for _ in range(int(count)))
+    return re.sub(r'^// INQY(.*)$', expand, data, flags=re.MULTILINE)
+
+
 # Convert hexadecimal array to bytes ignoring comment lines.
 def to_bytes(data: str):
     p = re.compile(r',| ')
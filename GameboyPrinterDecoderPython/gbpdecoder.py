@@ -5,7 +5,7 @@ import argparse
 import os
 import re
 
-from gbp import gbpimage
+from gbp import gbpimage, gbpparser
 
 verbose_debug = False
 
@@ -86,7 +86,7 @@ def main():
                 break
             hexdata += line
 
-    hexdata = stripComments(hexdata)
+    hexdata = stripComments(gbpparser.expand_inquiry_summary(hexdata))
     (pixels, (w, h)) = hexToImage(hexdata)
 
     if len(pixels) == w*h and len(pixels) > 0:
@@ -10,6 +10,7 @@ from gbp import gbpimage, gbpparser
 
 
 GBP_EMULATOR_BAUD_RATE = 115200
+GBP_EMULATOR_KEEPALIVE_S = 2  # Under the emulator's 5s (GBP_SPOOL_HOST_KEEPALIVE_MS), with the 2s read timeout
 DEFAULT_OUTPUT_DIR = 'output'
 OUTPUTFILE_PREFIX = 'GBP_'
 verbose_debug = False
@@ -39,6 +40,9 @@ class MockSerial():
             self.f = open(self.datafilename, 'rb')
             return None
 
+    def write(self, data):
+        return len(data)
+
 
 class EmulatorConnection:
     log = None
@@ -46,6 +50,15 @@ class EmulatorConnection:
     def __init__(self, verbose: bool = False):
         self.conn = None
         self.verbose = verbose
+        self.keepalive_sent = 0
+
+    def keepalive(self):
+        # A newline now and then shows the emulator a host is listening (ignored by its console).
+        # Without it, an emulator built with the capture spool on a UART board spools every print to SD
+        now = time.monotonic()
+        if now - self.keepalive_sent >= GBP_EMULATOR_KEEPALIVE_S:
+            self.conn.write(b'\n')
+            self.keepalive_sent = now
 
     def open_port(self, port, timeoutms):
         self.conn = serial.Serial(
@@ -67,6 +80,7 @@ class EmulatorConnection:
         self.log = open(path, 'wb')
 
     def readln(self) -> str:
+        self.keepalive()
         data = self.conn.readline()  # NOTE readline uses sole \n as a line separator
         if data:
             self.debug_print('< ', data)
@@ -121,6 +135,21 @@ def processPackets(packets, outputbase):
     return False
 
 
+def find_port(verbose: bool = False):
+    # Attempt to find serial port
+    port = None
+    if verbose:
+        print("Serial ports:")
+    ports = list(serial.tools.list_ports.comports())
+    for p in ports:
+        if verbose:
+            print("\t", p)
+        # Try to locate Arduino or a clone
+        if "Arduino" in p.description or "CH340" in p.description or p.vid == 0x2341:
+            port = p.device
+    return port
+
+
 def stripComments(hexdata):
     # Removes comments like //.. and /* ... */
     p = re.compile(r'^\/\*.*\*\/|^\/\/.*$', re.MULTILINE)
@@ -146,20 +175,7 @@ Data can be additionally logged to text files.
     global verbose_debug
     verbose_debug = args.verbose
 
-    port = None
-    if args.port:
-        port = args.port
-    else:
-        # Attempt to find serial port
-        if verbose_debug:
-            print("Serial ports:")
-        ports = list(serial.tools.list_ports.comports())
-        for p in ports:
-            if verbose_debug:
-                print("\t", p)
-            # Try to locate Arduino or a clone
-            if "Arduino" in p.description or "CH340" in p.description or p.vid == 0x2341:
-                port = p.device
+    port = args.port if args.port else find_port(verbose_debug)
 
     if port:
         print("Device port: ", port)
@@ -203,19 +219,19 @@ Data can be additionally logged to text files.
                 print("\nExiting.. (Ctrl-C)")
                 exit(0)
             if line != None:
-                line = stripComments(line)
+                line = stripComments(gbpparser.expand_inquiry_summary(line))
                 bytes = gbpparser.to_bytes(line)
                 packet = gbpparser.parse_packet_with_state(parser, bytes)
-                if packet:
+                if not packet and not verbose_debug:
+                    print('#', end='', flush=True)
+                while packet:  # An inquiry summary line holds many packets
                     if not verbose_debug:
                         print('.', end='', flush=True)
                     packets.append(packet)
                     if not packet.checksumOK:
                         print(
                             f'WARNING: Command {packet.command}. Checksum {hex(packet.checksum)} does not match data.')
-                else:
-                    if not verbose_debug:
-                        print('#', end='', flush=True)
+                    packet = gbpparser.parse_packet_with_state(parser, [])
 
             elif len(packets) > 0:  # timeout, try to process received packets
                 dongle.closelog()
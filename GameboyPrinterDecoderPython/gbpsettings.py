@@ -0,0 +1,133 @@
+import argparse
+import re
+import time
+
+import serial
+
+from gbpemulator_reader import GBP_EMULATOR_BAUD_RATE, find_port
+
+# Runtime settings of an emulator built with GBP_USE_SETTINGS.
+# See GameBoyPrinterEmulator/gbp_settings.h for the console protocol.
+
+BOOT_WAIT_S = 3  # Opening the port resets most Arduinos
+REPLY_TIMEOUT_S = 2
+SETTING_RE = re.compile(r'^// setting (\w+)=(\w+) (\w+)\.\.(\w+)$')
+
+
+class SettingsError(Exception):
+    pass
+
+
+class SettingsConnection:
+    def __init__(self, conn, verbose: bool = False):
+        self.conn = conn
+        self.verbose = verbose
+
+    def wait_boot(self):
+        # Skip the welcome message. Ends early once the settings line is seen
+        end = time.time() + BOOT_WAIT_S
+        while time.time() < end:
+            line = self.conn.readline().decode(errors='replace').strip('\r\n ')
+            if line and self.verbose:
+                print('< ', line)
+            if line.startswith('// Settings:'):
+                return
+        self.conn.reset_input_buffer()
+
+    def command(self, line: str):
+        """Runs one `s` command. Returns the reported settings as {key: (value, min, max)}"""
+        if '\n' in line or len(line) > 24:
+            raise SettingsError(f'command too long: {line}')
+        if self.verbose:
+            print('> ', 's ' + line)
+        self.conn.write(('s ' + line + '\n').encode())
+        settings = {}
+        end = time.time() + REPLY_TIMEOUT_S
+        while time.time() < end:
+            line = self.conn.readline().decode(errors='replace').strip('\r\n ')
+            if not line:
+                continue
+            if self.verbose:
+                print('< ', line)
+            m = SETTING_RE.match(line)
+            if m:
+                settings[m.group(1)] = (m.group(2), m.group(3), m.group(4))
+            elif line == '// settings ok':
+                return settings
+            elif line.startswith('// settings error'):
+                raise SettingsError(line[len('// settings error '):])
+            # Anything else is capture output or diagnostics, not part of the reply
+        raise SettingsError('no reply (is the sketch built with GBP_USE_SETTINGS?)')
+
+
+def read_profile(path):
+    # KEY=VALUE per line, # comments
+    sets = []
+    with open(path, 'r') as f:
+        for line in f:
+            line = line.split('#', 1)[0].strip()
+            if line:
+                sets.append(line)
+    return sets
+
+
+def print_settings(settings):
+    for key, (value, lo, hi) in settings.items():
+        print(f'{key}={value}  ({lo}..{hi})')
+
+
+def main():
+    description = """
+GameBoy Printer Emulator Settings queries and changes the runtime settings of an emulator
+built with GBP_USE_SETTINGS. Mode and decompressor changes apply from the next boot.
+"""
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument('--verbose', action='store_true', help='verbose mode')
+    parser.add_argument('-p', '--port', metavar='PORT', help='Serial port')
+    parser.add_argument('-f', '--profile', metavar='FILE',
+                        help='Apply KEY=VALUE lines from a profile file before any SET')
+    parser.add_argument('-s', '--save', action='store_true',
+                        help='Save the settings to EEPROM afterwards')
+    parser.add_argument('--defaults', action='store_true',
+                        help='Restore the defaults before applying anything')
+    parser.add_argument('--dump', metavar='FILE',
+                        help='Write the current settings as a profile file')
+    parser.add_argument('set', nargs='*', metavar='KEY[=VALUE]',
+                        help='Get (KEY) or set (KEY=VALUE) settings. Lists all settings if none are given')
+    args = parser.parse_args()
+
+    port = args.port if args.port else find_port(args.verbose)
+    if not port:
+        print("ERROR: No Device port found.")
+        exit(1)
+
+    dongle = SettingsConnection(serial.Serial(
+        port, baudrate=GBP_EMULATOR_BAUD_RATE, timeout=0.2), args.verbose)
+    dongle.wait_boot()
+
+    try:
+        if args.defaults:
+            dongle.command('defaults')
+        sets = read_profile(args.profile) if args.profile else []
+        for item in sets + args.set:
+            print_settings(dongle.command(item))
+        if args.save:
+            dongle.command('save')
+            print('Saved')
+        if not args.set or args.dump:
+            settings = dongle.command('')
+            if not args.set:
+                print_settings(settings)
+            if args.dump:
+                with open(args.dump, 'w') as f:
+                    f.write(f'# GameBoy Printer Emulator settings from {port}\n')
+                    for key, (value, _, _) in settings.items():
+                        f.write(f'{key}={value}\n')
+                print(f'Wrote {args.dump}')
+    except SettingsError as ex:
+        print(f'ERROR: {ex}')
+        exit(1)
+
+
+if __name__ == '__main__':
+    main()